@@ -0,0 +1,496 @@
+/*
+ * Microbenchmark of the container data-movement primitives.
+ *
+ * The container runtime is linked statically and embedded FMUs are replaced by
+ * in-process stubs (no library is loaded) which only copy values from or to a
+ * buffer. Each primitive called at every step is measured for all FMI-3.0 numeric
+ * types, several array dimensions and several link fan-outs:
+ *
+ *   fmu_set_inputs, fmu_get_outputs, fmu_get_clocked_outputs,
+ *   fmi3Get<Type> and fmi3Set<Type> (FMI_GETTER/FMI_SETTER of fmi3.c),
+ *   convert_proceed and datalog_log.
+ *
+ * Usage: container_micro [-n values] [-p ports] [-t type]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "container.h"
+#include "convert.h"
+#include "datalog.h"
+#include "fmu.h"
+#include "profile.h"
+
+#define MICRO_DEFAULT_VALUES    2000000 /* values moved per measurement */
+#define MICRO_DEFAULT_PORTS     16
+
+#ifdef WIN32
+#   define MICRO_NULL_DEVICE    "NUL"
+#else
+#   define MICRO_NULL_DEVICE    "/dev/null"
+#endif
+
+static const unsigned long micro_dimensions[] = { 1, 16, 256 };
+static const unsigned long micro_fanouts[] = { 1, 4, 16 };
+#define MICRO_NB(array)         (sizeof(array) / sizeof(array[0]))
+
+/*
+ * X-macro: lists FMI-3.0 numeric types (container field name, fmu type suffix, FMI type suffix).
+ */
+#define MICRO_TYPES(X)                          \
+    X(reals64,     Real64,     Float64)         \
+    X(reals32,     Real32,     Float32)         \
+    X(integers8,   Integer8,   Int8)            \
+    X(uintegers8,  UInteger8,  UInt8)           \
+    X(integers16,  Integer16,  Int16)           \
+    X(uintegers16, UInteger16, UInt16)          \
+    X(integers32,  Integer32,  Int32)           \
+    X(uintegers32, UInteger32, UInt32)          \
+    X(integers64,  Integer64,  Int64)           \
+    X(uintegers64, UInteger64, UInt64)          \
+    X(booleans1,   Boolean1,   Boolean)
+
+
+/*----------------------------------------------------------------------------
+                                 S T U B _ T
+----------------------------------------------------------------------------*/
+
+/* Instance of a stub FMU: getters and setters copy values from/to this buffer */
+typedef struct {
+    uint64_t                    *buffer;
+} stub_t;
+
+
+#define STUB(fmi_type)                                                                                  \
+static fmi3Status stub_get_ ## fmi_type(fmi3Instance instance, const fmi3ValueReference vr[],          \
+                                        size_t nvr, fmi3 ## fmi_type values[], size_t nValues) {        \
+    (void)vr; /* unused parameter */                                                                    \
+    (void)nvr; /* unused parameter */                                                                   \
+    memcpy(values, ((const stub_t *)instance)->buffer, nValues * sizeof(*values));                      \
+    return fmi3OK;                                                                                      \
+}                                                                                                       \
+static fmi3Status stub_set_ ## fmi_type(fmi3Instance instance, const fmi3ValueReference vr[],          \
+                                        size_t nvr, const fmi3 ## fmi_type values[], size_t nValues) {  \
+    (void)vr; /* unused parameter */                                                                    \
+    (void)nvr; /* unused parameter */                                                                   \
+    memcpy(((stub_t *)instance)->buffer, values, nValues * sizeof(*values));                            \
+    return fmi3OK;                                                                                      \
+}
+#define STUB_TYPE(variable, fmu_type, fmi_type) STUB(fmi_type)
+MICRO_TYPES(STUB_TYPE)
+#undef STUB_TYPE
+#undef STUB
+
+
+static fmi3Status stub_get_clock(fmi3Instance instance, const fmi3ValueReference vr[], size_t nvr,
+                                 fmi3Clock values[]) {
+    (void)instance; /* unused parameter */
+    (void)vr; /* unused parameter */
+
+    for (size_t i = 0; i < nvr; i += 1)
+        values[i] = fmi3ClockActive;
+
+    return fmi3OK;
+}
+
+
+/*----------------------------------------------------------------------------
+                                M I C R O _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * A container with `fanout` stub FMUs. Each FMU has `nb_ports` inputs of `dimension` values
+ * linked to the same local variables. FMU#0 also exposes them as (clocked) outputs.
+ * Container ports are linked to all FMUs.
+ */
+typedef struct {
+    unsigned long               nb_ports;
+    unsigned long               dimension;
+    unsigned long               fanout;
+
+    container_t                 *container;
+    stub_t                      *stubs;
+    fmu_translation_t           *translations;
+    fmu_translation_t           clock_translation;
+    fmu_clocked_port_t          clocked_port;
+    container_port_t            *ports;
+    container_vr_t              *links;
+    fmu_vr_t                    *vr;
+    bool                        clocks[1];
+    void                        *locals;
+    void                        *values;
+} micro_t;
+
+
+typedef fmu_status_t (*micro_function_t)(const micro_t *micro);
+
+
+static void micro_free(micro_t *micro) {
+    if (micro->container) {
+        if (micro->container->datalog) {
+            if (micro->container->datalog->file)
+                fclose(micro->container->datalog->file);
+            free(micro->container->datalog);
+        }
+        free(micro->container->fmu);
+        free(micro->container->instance_name);
+        free(micro->container->uuid);
+        free(micro->container);
+    }
+    if (micro->stubs) {
+        for (unsigned long i = 0; i < micro->fanout; i += 1)
+            free(micro->stubs[i].buffer);
+        free(micro->stubs);
+    }
+    free(micro->translations);
+    free(micro->ports);
+    free(micro->links);
+    free(micro->vr);
+    free(micro->locals);
+    free(micro->values);
+
+    return;
+}
+
+
+static int micro_new(micro_t *micro, unsigned long nb_ports, unsigned long dimension, unsigned long fanout) {
+    const unsigned long nb_values = nb_ports * dimension;
+
+    memset(micro, 0, sizeof(*micro));
+    micro->nb_ports = nb_ports;
+    micro->dimension = dimension;
+    micro->fanout = fanout;
+
+    micro->container = container_new("micro", "{micro}");
+    if (!micro->container)
+        return -1;
+    container_t *container = micro->container;
+
+    container->fmu = calloc(fanout, sizeof(*container->fmu));
+    container->datalog = calloc(1, sizeof(*container->datalog));
+    micro->stubs = calloc(fanout, sizeof(*micro->stubs));
+    micro->translations = malloc(nb_ports * sizeof(*micro->translations));
+    micro->ports = malloc(nb_ports * sizeof(*micro->ports));
+    micro->links = malloc(nb_ports * fanout * sizeof(*micro->links));
+    micro->vr = malloc(nb_ports * sizeof(*micro->vr));
+    micro->locals = calloc(nb_values, sizeof(uint64_t));
+    micro->values = calloc(nb_values, sizeof(uint64_t));
+    if (!container->fmu || !container->datalog || !micro->stubs || !micro->translations || !micro->ports ||
+        !micro->links || !micro->vr || !micro->locals || !micro->values) {
+        micro_free(micro);
+        return -1;
+    }
+
+    container->datalog->file = fopen(MICRO_NULL_DEVICE, "wt");
+    if (!container->datalog->file) {
+        micro_free(micro);
+        return -1;
+    }
+
+    for (unsigned long i = 0; i < nb_ports; i += 1) {
+        micro->translations[i].vr = i * dimension;
+        micro->translations[i].fmu_vr = i;
+        micro->translations[i].dimension = dimension;
+
+        micro->ports[i].dimension = dimension;
+        micro->ports[i].nb = fanout;
+        micro->ports[i].links = &micro->links[i * fanout];
+        for (unsigned long j = 0; j < fanout; j += 1) {
+            micro->ports[i].links[j].fmu_vr = i;
+            micro->ports[i].links[j].fmu_id = j;
+        }
+
+        micro->vr[i] = i;
+    }
+
+    micro->clock_translation.vr = 0;
+    micro->clock_translation.fmu_vr = 0;
+    micro->clock_translation.dimension = 1;
+    micro->clocked_port.clock_vr = 0;
+    micro->clocked_port.translations_list.nb = nb_ports;
+    micro->clocked_port.translations_list.translations = micro->translations;
+    container->nb_local_clocks = 1;
+    container->clocks = micro->clocks;
+
+    container->nb_fmu = fanout;
+    for (unsigned long i = 0; i < fanout; i += 1) {
+        fmu_t *fmu = &container->fmu[i];
+
+        micro->stubs[i].buffer = calloc(dimension, sizeof(*micro->stubs[i].buffer));
+        if (!micro->stubs[i].buffer) {
+            micro_free(micro);
+            return -1;
+        }
+
+        fmu->name = "stub";
+        fmu->index = (int)i;
+        fmu->fmi_version = FMU_3;
+        fmu->component = &micro->stubs[i];
+        fmu->container = container;
+        fmu->logger = &container->logger;
+        fmu->fmi_functions.version_3.fmi3GetClock = stub_get_clock;
+    }
+    container->fmu[0].fmu_io.clocks.out.nb = 1;
+    container->fmu[0].fmu_io.clocks.out.translations = &micro->clock_translation;
+
+    return 0;
+}
+
+
+/*
+ * Bind the type under test: local variables, container ports, FMU ports and datalog.
+ * Datalog only handles scalar variables.
+ */
+#define MICRO_BIND(variable, fmu_type, fmi_type)                                                    \
+static void micro_bind_ ## variable(micro_t *micro) {                                               \
+    container_t *container = micro->container;                                                      \
+    datalog_t *datalog = container->datalog;                                                        \
+                                                                                                    \
+    container->nb_local_ ## variable = micro->nb_ports * micro->dimension;                          \
+    container-> variable = micro->locals;                                                           \
+    container->nb_ports_ ## variable = micro->nb_ports;                                             \
+    container->port_ ## variable = micro->ports;                                                    \
+                                                                                                    \
+    for (unsigned long i = 0; i < micro->fanout; i += 1) {                                          \
+        fmu_t *fmu = &container->fmu[i];                                                            \
+        fmu->fmi_functions.version_3.fmi3Get ## fmi_type = stub_get_ ## fmi_type;                   \
+        fmu->fmi_functions.version_3.fmi3Set ## fmi_type = stub_set_ ## fmi_type;                   \
+        fmu->fmu_io. variable .in.nb = micro->nb_ports;                                             \
+        fmu->fmu_io. variable .in.translations = micro->translations;                               \
+    }                                                                                               \
+    container->fmu[0].fmu_io. variable .out.nb = micro->nb_ports;                                   \
+    container->fmu[0].fmu_io. variable .out.translations = micro->translations;                     \
+    container->fmu[0].fmu_io.clocked_ ## variable .nb_out = 1;                                      \
+    container->fmu[0].fmu_io.clocked_ ## variable .out = &micro->clocked_port;                      \
+                                                                                                    \
+    if (micro->dimension == 1) {                                                                    \
+        datalog->nb_ ## variable = micro->nb_ports;                                                 \
+        datalog->vr_ ## variable = micro->vr;                                                       \
+        datalog->values_ ## variable = micro->values;                                               \
+    }                                                                                               \
+                                                                                                    \
+    return;                                                                                         \
+}                                                                                                   \
+                                                                                                    \
+static fmu_status_t micro_fmi3_get_ ## variable(const micro_t *micro) {                             \
+    if (fmi3Get ## fmi_type(micro->container, micro->vr, micro->nb_ports, micro->values,            \
+                            micro->nb_ports * micro->dimension) != fmi3OK)                          \
+        return FMU_STATUS_ERROR;                                                                    \
+    return FMU_STATUS_OK;                                                                           \
+}                                                                                                   \
+                                                                                                    \
+static fmu_status_t micro_fmi3_set_ ## variable(const micro_t *micro) {                             \
+    if (fmi3Set ## fmi_type(micro->container, micro->vr, micro->nb_ports, micro->values,            \
+                            micro->nb_ports * micro->dimension) != fmi3OK)                          \
+        return FMU_STATUS_ERROR;                                                                    \
+    return FMU_STATUS_OK;                                                                           \
+}
+MICRO_TYPES(MICRO_BIND)
+#undef MICRO_BIND
+
+
+static fmu_status_t micro_set_inputs(const micro_t *micro) {
+    for (int i = 0; i < micro->container->nb_fmu; i += 1) {
+        fmu_status_t status = fmu_set_inputs(&micro->container->fmu[i]);
+        if (status != FMU_STATUS_OK)
+            return status;
+    }
+    return FMU_STATUS_OK;
+}
+
+
+static fmu_status_t micro_get_outputs(const micro_t *micro) {
+    return fmu_get_outputs(&micro->container->fmu[0]);
+}
+
+
+static fmu_status_t micro_get_clocked_outputs(const micro_t *micro) {
+    return fmu_get_clocked_outputs(&micro->container->fmu[0]);
+}
+
+
+static fmu_status_t micro_convert(const micro_t *micro) {
+    convert_proceed(micro->container, micro->container->fmu[0].conversions);
+    return FMU_STATUS_OK;
+}
+
+
+static fmu_status_t micro_datalog(const micro_t *micro) {
+    datalog_log(micro->container);
+    return FMU_STATUS_OK;
+}
+
+
+/*----------------------------------------------------------------------------
+                           M E A S U R E M E N T
+----------------------------------------------------------------------------*/
+
+static void micro_measure(const micro_t *micro, const char *primitive, const char *type_name,
+                          micro_function_t function, unsigned long values_per_call, unsigned long nb_values) {
+    unsigned long nb_calls = nb_values / values_per_call;
+    if (nb_calls < 10)
+        nb_calls = 10;
+
+    /* warm-up */
+    for (unsigned long i = 0; i < nb_calls / 10; i += 1) {
+        if (function(micro) != FMU_STATUS_OK) {
+            printf("%-24s %-8s %5lu %6lu   FAILED\n", primitive, type_name, micro->dimension, micro->fanout);
+            return;
+        }
+    }
+
+    const profile_tic_t start = profile_now();
+    for (unsigned long i = 0; i < nb_calls; i += 1)
+        function(micro);
+    const double elapsed = (double)(profile_now() - start);
+
+    printf("%-24s %-8s %5lu %6lu %8lu %12.1f %10.3f\n", primitive, type_name, micro->dimension,
+           micro->fanout, values_per_call, elapsed / (double)nb_calls,
+           elapsed / ((double)nb_calls * (double)values_per_call));
+
+    return;
+}
+
+
+typedef struct {
+    const char                  *name;
+    void                        (*bind)(micro_t *micro);
+    micro_function_t            fmi3_get;
+    micro_function_t            fmi3_set;
+} micro_type_t;
+
+
+static const micro_type_t micro_types[] = {
+#define MICRO_TYPE(variable, fmu_type, fmi_type) \
+    { #fmi_type, micro_bind_ ## variable, micro_fmi3_get_ ## variable, micro_fmi3_set_ ## variable },
+    MICRO_TYPES(MICRO_TYPE)
+#undef MICRO_TYPE
+};
+
+
+static int micro_run_type(const micro_type_t *type, unsigned long nb_ports, unsigned long nb_values) {
+    for (unsigned long d = 0; d < MICRO_NB(micro_dimensions); d += 1) {
+        const unsigned long dimension = micro_dimensions[d];
+        const unsigned long values = nb_ports * dimension;
+
+        for (unsigned long f = 0; f < MICRO_NB(micro_fanouts); f += 1) {
+            const unsigned long fanout = micro_fanouts[f];
+            micro_t micro;
+
+            if (micro_new(&micro, nb_ports, dimension, fanout)) {
+                fprintf(stderr, "Cannot allocate benchmark memory.\n");
+                return -1;
+            }
+            type->bind(&micro);
+
+            /* Reading outputs does not depend on fan-out */
+            if (f == 0) {
+                micro_measure(&micro, "fmu_get_outputs", type->name, micro_get_outputs, values, nb_values);
+                micro_measure(&micro, "fmu_get_clocked_outputs", type->name, micro_get_clocked_outputs, values,
+                              nb_values);
+                micro_measure(&micro, "fmi3Get", type->name, type->fmi3_get, values, nb_values);
+                if (dimension == 1)
+                    micro_measure(&micro, "datalog_log", type->name, micro_datalog, values, nb_values);
+            }
+            micro_measure(&micro, "fmu_set_inputs", type->name, micro_set_inputs, values * fanout, nb_values);
+            micro_measure(&micro, "fmi3Set", type->name, type->fmi3_set, values * fanout, nb_values);
+
+            micro_free(&micro);
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * convert_proceed() is measured on a conversion table of one FMU, as done by fmu_get_outputs().
+ */
+static int micro_run_convert(unsigned long nb_ports, unsigned long nb_values) {
+    static const char *functions[] = { "F32_F64", "D32_D64", "B1_B" };
+
+    for (unsigned long f = 0; f < MICRO_NB(functions); f += 1) {
+        micro_t micro;
+
+        if (micro_new(&micro, nb_ports, 1, 1)) {
+            fprintf(stderr, "Cannot allocate benchmark memory.\n");
+            return -1;
+        }
+        convert_table_t *table = convert_new(&micro.container->logger, nb_ports);
+        if (!table) {
+            micro_free(&micro);
+            return -1;
+        }
+        for (unsigned long i = 0; i < nb_ports; i += 1) {
+            table->entries[i].from = i;
+            table->entries[i].to = i;
+            table->entries[i].function = convert_function_get(functions[f]);
+        }
+        micro.container->fmu[0].conversions = table;
+
+        /* source and destination of each conversion use distinct buffers */
+        micro.container->reals32 = micro.locals;
+        micro.container->reals64 = micro.values;
+        micro.container->integers32 = micro.locals;
+        micro.container->integers64 = micro.values;
+        micro.container->booleans1 = micro.locals;
+        micro.container->booleans = micro.values;
+
+        micro_measure(&micro, "convert_proceed", functions[f], micro_convert, nb_ports, nb_values);
+
+        convert_free(table);
+        micro_free(&micro);
+    }
+
+    return 0;
+}
+
+
+static void micro_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n values] [-p ports] [-t type]\n", program);
+    fprintf(stderr, "  -n values   number of values moved per measurement (default: %d)\n", MICRO_DEFAULT_VALUES);
+    fprintf(stderr, "  -p ports    number of ports of each FMU (default: %d)\n", MICRO_DEFAULT_PORTS);
+    fprintf(stderr, "  -t type     measure only this FMI-3.0 type (Float64, Int32, ...)\n");
+
+    return;
+}
+
+
+int main(int argc, char *argv[]) {
+    unsigned long nb_values = MICRO_DEFAULT_VALUES;
+    unsigned long nb_ports = MICRO_DEFAULT_PORTS;
+    const char *type_name = NULL;
+
+    for (int i = 1; i < argc; i += 1) {
+        if (!strcmp(argv[i], "-n") && (i + 1 < argc))
+            nb_values = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-p") && (i + 1 < argc))
+            nb_ports = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-t") && (i + 1 < argc))
+            type_name = argv[++i];
+        else {
+            micro_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nb_values == 0 || nb_ports == 0) {
+        micro_usage(argv[0]);
+        return 1;
+    }
+
+    printf("%-24s %-8s %5s %6s %8s %12s %10s\n", "primitive", "type", "dim", "fanout", "values",
+           "ns/call", "ns/value");
+
+    for (unsigned long i = 0; i < MICRO_NB(micro_types); i += 1) {
+        if (type_name && strcmp(type_name, micro_types[i].name))
+            continue;
+        if (micro_run_type(&micro_types[i], nb_ports, nb_values))
+            return 2;
+    }
+    if (!type_name && micro_run_convert(nb_ports, nb_values))
+        return 2;
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+"""Thread-scaling benchmark of the container runtime.
+
+A grid of synthetic containers (number of FMUs x cost per step x number of ports) is built with
+`synthetic.py` and `fmu_manipulation_toolbox`, then each container is run by `container_driver` in
+the three stepping modes selected by `read_flags()`:
+
+    sequential: FMUs are stepped one after the other, outputs are propagated immediately
+    parallel:   FMUs are stepped in the calling thread, outputs are propagated after all steps
+    mt:         FMUs are grouped onto threads according to their cost (at most one thread per CPU)
+
+Speedup is measured against sequential mode, efficiency is the speedup divided by the number of
+threads. Configurations where MT mode is slower than parallel mode are marked: the
+synchronization overhead exceeds the benefit of threads.
+
+    python scaling.py -build ../../tests/bin/linux64 -nb-fmu 2,4,8 -cost 0,10000,1000000 -ports 1,16
+"""
+import argparse
+import logging
+import os
+import re
+import subprocess
+import sys
+import zipfile
+
+from pathlib import Path
+from typing import Dict, List, NamedTuple
+
+from synthetic import SyntheticAssembly, SyntheticError
+from fmu_manipulation_toolbox.assembly import Assembly, AssemblyError
+
+
+class ScalingError(Exception):
+    def __init__(self, reason: str):
+        self.reason = reason
+
+    def __repr__(self):
+        return f"{self.reason}"
+
+
+class ScalingResult(NamedTuple):
+    nb_fmu: int
+    cost: int
+    nb_ports: int
+    throughput: Dict[str, float]            # mode -> steps/s
+
+    def speedup(self, mode: str) -> float:
+        return self.throughput[mode] / self.throughput["sequential"]
+
+    @staticmethod
+    def threads(mode: str, nb_fmu: int) -> int:
+        return min(nb_fmu, os.cpu_count() or 1) if mode == "mt" else 1
+
+    def efficiency(self, mode: str) -> float:
+        return self.speedup(mode) / self.threads(mode, self.nb_fmu)
+
+    @property
+    def mt_overhead(self) -> bool:
+        return self.throughput["mt"] < self.throughput["parallel"]
+
+
+class ScalingBenchmark:
+    MODES = {
+        "sequential": {"mt": False, "sequential": True},
+        "parallel": {"mt": False, "sequential": False},
+        "mt": {"mt": True, "sequential": False}
+    }
+    THROUGHPUT_RE = re.compile(r"Throughput\s*:\s*([0-9.eE+-]+) steps/s")
+
+    def __init__(self, build_directory: Path, directory: Path, topology="chain", fmi_version=3, nb_steps=2000,
+                 repeat=3):
+        self.driver = self.find_binary(build_directory, "container_driver")
+        self.library = self.find_binary(build_directory, "synthetic")
+        self.directory = directory
+        self.topology = topology
+        self.fmi_version = fmi_version
+        self.nb_steps = nb_steps
+        self.repeat = repeat
+
+    @staticmethod
+    def find_binary(build_directory: Path, name: str) -> Path:
+        for suffix in ("", ".exe", ".so", ".dll", ".dylib"):
+            for filename in (build_directory / f"{name}{suffix}", build_directory / "Release" / f"{name}{suffix}"):
+                if filename.is_file():
+                    return filename
+        raise ScalingError(f"Cannot find '{name}' in '{build_directory}'. Build it with CMake first.")
+
+    def run_driver(self, fmu_directory: Path) -> float:
+        """Return the best throughput (steps/s) of several runs."""
+        best = 0.0
+        for _ in range(self.repeat):
+            result = subprocess.run([str(self.driver), "-n", str(self.nb_steps), str(fmu_directory)],
+                                    capture_output=True, text=True)
+            match = self.THROUGHPUT_RE.search(result.stdout)
+            if result.returncode != 0 or not match:
+                raise ScalingError(f"container_driver failed on '{fmu_directory}': {result.stderr.strip()}")
+            best = max(best, float(match.group(1)))
+        return best
+
+    def run(self, nb_fmu: int, cost: int, nb_ports: int) -> ScalingResult:
+        directory = self.directory / f"{self.topology}-{nb_fmu}-{cost}-{nb_ports}"
+        assembly = SyntheticAssembly(self.topology, nb_fmu, fmi_version=self.fmi_version, cost=cost,
+                                     nb_ports=nb_ports)
+        throughput = {}
+        for mode, flags in self.MODES.items():
+            json_filename = assembly.make(directory, self.library, **flags)
+            Assembly(json_filename.name, fmu_directory=directory).make_fmu(fmi_version=3)
+            fmu_directory = directory / mode
+            with zipfile.ZipFile(directory / f"{assembly.name}.fmu") as zin:
+                zin.extractall(fmu_directory)
+            throughput[mode] = self.run_driver(fmu_directory)
+
+        return ScalingResult(nb_fmu, cost, nb_ports, throughput)
+
+    @classmethod
+    def report(cls, results: List[ScalingResult]) -> str:
+        lines = [
+            "| FMUs | cost | ports | mode | threads | steps/s | speedup | efficiency | |",
+            "|-----:|-----:|------:|------|--------:|--------:|--------:|-----------:|-|"
+        ]
+        for result in results:
+            for mode in cls.MODES:
+                mark = "MT overhead" if mode == "mt" and result.mt_overhead else ""
+                lines.append(f"| {result.nb_fmu} | {result.cost} | {result.nb_ports} | {mode} "
+                             f"| {ScalingResult.threads(mode, result.nb_fmu)} "
+                             f"| {result.throughput[mode]:.0f} | {result.speedup(mode):.2f} "
+                             f"| {result.efficiency(mode):.2f} | {mark} |")
+        return "\n".join(lines) + "\n"
+
+
+def integer_list(value: str) -> List[int]:
+    return [int(item) for item in value.split(",")]
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="scaling", description="Measure container speedup in each stepping mode",
+                                     formatter_class=argparse.ArgumentDefaultsHelpFormatter, add_help=False)
+    parser.add_argument('-h', '-help', action="help")
+    parser.add_argument("-build", action="store", dest="build", required=True,
+                        help="CMake build directory containing container_driver and synthetic library.")
+    parser.add_argument("-topology", action="store", dest="topology", default="chain",
+                        choices=SyntheticAssembly.TOPOLOGIES, help="How embedded FMU's are connected.")
+    parser.add_argument("-fmi", action="store", dest="fmi_version", type=int, default=3, choices=(2, 3),
+                        help="FMI version of the synthetic FMU's.")
+    parser.add_argument("-nb-fmu", action="store", dest="nb_fmu", type=integer_list, default="2,4,8",
+                        help="Comma separated list of number of FMU's.")
+    parser.add_argument("-cost", action="store", dest="cost", type=integer_list, default="0,10000,1000000",
+                        help="Comma separated list of busy-loop iterations per step.")
+    parser.add_argument("-ports", action="store", dest="nb_ports", type=integer_list, default="1,16",
+                        help="Comma separated list of number of ports per FMU.")
+    parser.add_argument("-steps", action="store", dest="nb_steps", type=int, default=2000,
+                        help="Number of steps of each run.")
+    parser.add_argument("-repeat", action="store", dest="repeat", type=int, default=3,
+                        help="Number of runs of each configuration. Best throughput is kept.")
+    parser.add_argument("-output-directory", action="store", dest="directory", default="scaling",
+                        help="Directory where FMU's and containers are generated.")
+    parser.add_argument("-report", action="store", dest="report", default=None,
+                        help="Write the report (markdown) into this file.")
+    config = parser.parse_args(sys.argv[1:])
+
+    logging.getLogger("fmu_manipulation_toolbox").setLevel(logging.ERROR)
+    try:
+        benchmark = ScalingBenchmark(Path(config.build), Path(config.directory), topology=config.topology,
+                                     fmi_version=config.fmi_version, nb_steps=config.nb_steps,
+                                     repeat=config.repeat)
+        results = []
+        for nb_fmu in config.nb_fmu:
+            for cost in config.cost:
+                for nb_ports in config.nb_ports:
+                    print(f"Running {nb_fmu} FMU's, cost={cost}, ports={nb_ports}...", file=sys.stderr)
+                    results.append(benchmark.run(nb_fmu, cost, nb_ports))
+    except (ScalingError, SyntheticError, AssemblyError) as e:
+        print(f"ERROR: {e}")
+        sys.exit(1)
+
+    report = ScalingBenchmark.report(results)
+    print(report)
+    if config.report:
+        with open(config.report, "wt") as file:
+            file.write(report)
+
+
+if __name__ == "__main__":
+    main()
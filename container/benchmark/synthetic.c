@@ -0,0 +1,1368 @@
+/*
+ * Synthetic FMU used to benchmark containers.
+ *
+ * A single binary exports both FMI-2.0 and FMI-3.0 Co-Simulation APIs, and FMI-3.0 Model
+ * Exchange API. Its
+ * interface and its cost are defined by resources/synthetic.txt which is
+ * written by synthetic.py together with the modelDescription.xml:
+ *
+ * # Busy-loop iterations per step
+ * 1000
+ * # Output clocks period (in steps, 0: triggered only) and forwarding of input clocks (0/1)
+ * 10 0
+ * # Model Exchange: Float64 outputs are continuous states with der(x) = sum(inputs) - x (0/1)
+ * 0
+ * # <TYPE> <NB_INPUTS> <NB_OUTPUTS> <DIMENSION (payload size for Binary)>
+ * Float64 2 2 1
+ * Int32 1 1 1
+ * Boolean 1 1 1
+ * Binary 1 1 64
+ * Clock 1 1 0
+ *
+ * Variable #k of a type has value reference SYNTHETIC_VR(type, k): inputs come
+ * first, then outputs. When clocks are defined, binary inputs (resp. outputs)
+ * are clocked by input (resp. output) clocks. Payload of binary outputs is the
+ * number of steps plus the number of received frames (modulo 256), unless input
+ * frames are forwarded.
+ *
+ * In Scheduled Execution, each input clock is a partition. Its activation is a step up to
+ * the activation time followed by the event of this clock.
+ *
+ * In Model Exchange, Float64 outputs start at 1: without inputs, they are exp(-t). Their
+ * derivatives are local variables which are not accessible. Other outputs are not computed.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fmi2Functions.h"
+#include "fmi3Functions.h"
+
+#define SYNTHETIC_VR_STRIDE     100000
+#define SYNTHETIC_VR(type, k)   ((type) * SYNTHETIC_VR_STRIDE + (k))
+#define SYNTHETIC_LINE_SZ       1024
+#define SYNTHETIC_PATH_SZ       4096
+
+
+/*----------------------------------------------------------------------------
+                         S Y N T H E T I C _ T Y P E _ T
+----------------------------------------------------------------------------*/
+
+typedef enum {
+    SYNTHETIC_FLOAT64 = 0,
+    SYNTHETIC_INT32,
+    SYNTHETIC_BOOLEAN,
+    SYNTHETIC_BINARY,
+    SYNTHETIC_CLOCK,
+    SYNTHETIC_NB_TYPES
+} synthetic_type_t;
+
+
+/*----------------------------------------------------------------------------
+                        S Y N T H E T I C _ P O R T S _ T
+----------------------------------------------------------------------------*/
+
+typedef struct {
+    unsigned long               nb_in;
+    unsigned long               nb_out;
+    unsigned long               dimension;      /* payload size for Binary */
+} synthetic_ports_t;
+
+
+/*----------------------------------------------------------------------------
+                              S Y N T H E T I C _ T
+----------------------------------------------------------------------------*/
+
+typedef struct {
+    int                         fmi_version;
+    char                        *name;
+    fmi2CallbackFunctions       fmi2_callbacks;
+    fmi3LogMessageCallback      fmi3_logger;
+    fmi3ClockUpdateCallback     fmi3_clock_update;  /* Scheduled Execution only */
+    void                        *environment;
+
+    unsigned long               cost;           /* busy-loop iterations per step */
+    unsigned long               period;         /* output clocks period in steps */
+    int                         forward;        /* input clocks tick output clocks */
+    int                         model_exchange; /* Float64 outputs are continuous states */
+    synthetic_ports_t           ports[SYNTHETIC_NB_TYPES];
+
+    double                      *float64;
+    double                      *float64_derivative;    /* set for inputs, computed for outputs */
+    int32_t                     *int32;
+    bool                        *boolean;
+    uint8_t                     **binary;
+    size_t                      *binary_size;
+    bool                        *clock;
+
+    double                      time;
+    unsigned long long          nb_steps;
+    int                         input_clock_ticked;
+    unsigned long long          nb_received;    /* events with ticking input clocks */
+    unsigned long               last_binary_in;
+    volatile double             sink;
+} synthetic_t;
+
+
+static const char *synthetic_type_names[SYNTHETIC_NB_TYPES] = {
+    "Float64", "Int32", "Boolean", "Binary", "Clock"
+};
+
+
+static void synthetic_log(const synthetic_t *synthetic, const char *message, ...) {
+    char buffer[SYNTHETIC_LINE_SZ];
+    va_list ap;
+
+    va_start(ap, message);
+    vsnprintf(buffer, sizeof(buffer), message, ap);
+    va_end(ap);
+
+    if (synthetic->fmi_version == 2 && synthetic->fmi2_callbacks.logger)
+        synthetic->fmi2_callbacks.logger(synthetic->environment, synthetic->name, fmi2Error, "Error", "%s", buffer);
+    else if (synthetic->fmi_version == 3 && synthetic->fmi3_logger)
+        synthetic->fmi3_logger(synthetic->environment, fmi3Error, "Error", buffer);
+    else
+        fprintf(stderr, "%s: %s\n", synthetic->name, buffer);
+
+    return;
+}
+
+
+/*----------------------------------------------------------------------------
+                          C O N F I G U R A T I O N
+----------------------------------------------------------------------------*/
+
+static int synthetic_get_line(FILE *fp, char *line, size_t size) {
+    do {
+        if (!fgets(line, (int)size, fp))
+            return -1;
+    } while (line[0] == '#');
+
+    return 0;
+}
+
+
+static int synthetic_read(synthetic_t *synthetic, const char *resource_path) {
+    char filename[SYNTHETIC_PATH_SZ];
+    char line[SYNTHETIC_LINE_SZ];
+
+    if (strncmp(resource_path, "file://", 7) == 0)
+        resource_path += 7;
+#ifdef WIN32
+    if (resource_path[0] == '/')
+        resource_path += 1;
+#endif
+    snprintf(filename, sizeof(filename), "%s/synthetic.txt", resource_path);
+
+    FILE *fp = fopen(filename, "rt");
+    if (!fp) {
+        synthetic_log(synthetic, "Cannot open '%s'.", filename);
+        return -1;
+    }
+
+    int status = 0;
+    if (synthetic_get_line(fp, line, sizeof(line)) || sscanf(line, "%lu", &synthetic->cost) != 1)
+        status = -2;
+    if (!status && (synthetic_get_line(fp, line, sizeof(line)) ||
+                    sscanf(line, "%lu %d", &synthetic->period, &synthetic->forward) != 2))
+        status = -3;
+    if (!status && (synthetic_get_line(fp, line, sizeof(line)) ||
+                    sscanf(line, "%d", &synthetic->model_exchange) != 1))
+        status = -3;
+    for (int type = 0; !status && type < SYNTHETIC_NB_TYPES; type += 1) {
+        char type_name[32];
+        synthetic_ports_t *ports = &synthetic->ports[type];
+
+        if (synthetic_get_line(fp, line, sizeof(line)) ||
+            sscanf(line, "%31s %lu %lu %lu", type_name, &ports->nb_in, &ports->nb_out, &ports->dimension) != 4 ||
+            strcmp(type_name, synthetic_type_names[type]) ||
+            ports->nb_in + ports->nb_out >= SYNTHETIC_VR_STRIDE)
+            status = -4 - type;
+        if (ports->dimension == 0)
+            ports->dimension = 1;
+    }
+    fclose(fp);
+
+    if (status)
+        synthetic_log(synthetic, "Cannot read '%s' (%d).", filename, status);
+
+    return status;
+}
+
+
+static int synthetic_allocate(synthetic_t *synthetic) {
+#define SYNTHETIC_NB_VALUES(type) \
+    ((synthetic->ports[type].nb_in + synthetic->ports[type].nb_out) * synthetic->ports[type].dimension)
+
+    synthetic->float64 = calloc(SYNTHETIC_NB_VALUES(SYNTHETIC_FLOAT64) + 1, sizeof(*synthetic->float64));
+    synthetic->float64_derivative = calloc(SYNTHETIC_NB_VALUES(SYNTHETIC_FLOAT64) + 1,
+                                           sizeof(*synthetic->float64_derivative));
+    synthetic->int32 = calloc(SYNTHETIC_NB_VALUES(SYNTHETIC_INT32) + 1, sizeof(*synthetic->int32));
+    synthetic->boolean = calloc(SYNTHETIC_NB_VALUES(SYNTHETIC_BOOLEAN) + 1, sizeof(*synthetic->boolean));
+#undef SYNTHETIC_NB_VALUES
+
+    const synthetic_ports_t *binaries = &synthetic->ports[SYNTHETIC_BINARY];
+    const unsigned long nb_binaries = binaries->nb_in + binaries->nb_out;
+    synthetic->binary = calloc(nb_binaries + 1, sizeof(*synthetic->binary));
+    synthetic->binary_size = calloc(nb_binaries + 1, sizeof(*synthetic->binary_size));
+    synthetic->clock = calloc(synthetic->ports[SYNTHETIC_CLOCK].nb_in + synthetic->ports[SYNTHETIC_CLOCK].nb_out + 1,
+                              sizeof(*synthetic->clock));
+
+    if (!synthetic->float64 || !synthetic->float64_derivative || !synthetic->int32 || !synthetic->boolean || !synthetic->binary ||
+        !synthetic->binary_size || !synthetic->clock)
+        return -1;
+
+    for (unsigned long k = 0; k < nb_binaries; k += 1) {
+        synthetic->binary[k] = calloc(binaries->dimension, 1);
+        if (!synthetic->binary[k])
+            return -2;
+        synthetic->binary_size[k] = (k < binaries->nb_in) ? 0 : binaries->dimension;
+    }
+
+    return 0;
+}
+
+
+static void synthetic_free(synthetic_t *synthetic) {
+    if (synthetic) {
+        if (synthetic->binary) {
+            for (unsigned long k = 0; k < synthetic->ports[SYNTHETIC_BINARY].nb_in +
+                                          synthetic->ports[SYNTHETIC_BINARY].nb_out; k += 1)
+                free(synthetic->binary[k]);
+        }
+        free(synthetic->binary);
+        free(synthetic->binary_size);
+        free(synthetic->clock);
+        free(synthetic->float64);
+        free(synthetic->float64_derivative);
+        free(synthetic->int32);
+        free(synthetic->boolean);
+        free(synthetic->name);
+        free(synthetic);
+    }
+
+    return;
+}
+
+
+static synthetic_t *synthetic_new(int fmi_version, const char *name, void *environment) {
+    synthetic_t *synthetic = calloc(1, sizeof(*synthetic));
+
+    if (!synthetic)
+        return NULL;
+
+    synthetic->fmi_version = fmi_version;
+    synthetic->name = strdup(name ? name : "synthetic");
+    synthetic->environment = environment;
+
+    return synthetic;
+}
+
+
+static int synthetic_configure(synthetic_t *synthetic, const char *resource_path) {
+    if (!resource_path || synthetic_read(synthetic, resource_path))
+        return -1;
+
+    if (synthetic_allocate(synthetic)) {
+        synthetic_log(synthetic, "Cannot allocate memory.");
+        return -2;
+    }
+
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------
+                             C O M P U T A T I O N
+----------------------------------------------------------------------------*/
+
+/* Return offset of first value of variable vr, or -1 if vr is not a variable of this type */
+static long synthetic_offset(const synthetic_t *synthetic, synthetic_type_t type, unsigned int vr, int output) {
+    const synthetic_ports_t *ports = &synthetic->ports[type];
+    const unsigned long k = vr - SYNTHETIC_VR(type, 0);
+
+    if (vr < SYNTHETIC_VR(type, 0) || k >= ports->nb_in + ports->nb_out)
+        return -1;
+    if (output && k < ports->nb_in)
+        return -1;
+
+    return (long)(k * ports->dimension);
+}
+
+
+/* Derivatives of order 1 are stored. Higher orders are zero */
+static int synthetic_derivative(synthetic_t *synthetic, unsigned int vr, int order, double *value, int output) {
+    const long offset = synthetic_offset(synthetic, SYNTHETIC_FLOAT64, vr, output);
+
+    if (offset < 0 || order < 1 || (!output && vr - SYNTHETIC_VR(SYNTHETIC_FLOAT64, 0) >=
+                                                synthetic->ports[SYNTHETIC_FLOAT64].nb_in)) {
+        synthetic_log(synthetic, "Cannot access derivative of Float64 variable #%u.", vr);
+        return -1;
+    }
+    if (output)
+        *value = (order == 1) ? synthetic->float64_derivative[offset] : 0.0;
+    else if (order == 1)
+        synthetic->float64_derivative[offset] = *value;
+
+    return 0;
+}
+
+
+static void synthetic_tick(synthetic_t *synthetic) {
+    const synthetic_ports_t *clocks = &synthetic->ports[SYNTHETIC_CLOCK];
+    const synthetic_ports_t *binaries = &synthetic->ports[SYNTHETIC_BINARY];
+
+    for (unsigned long k = 0; k < clocks->nb_out; k += 1)
+        synthetic->clock[clocks->nb_in + k] = true;
+
+    /* Clocked binaries outputs are refreshed */
+    for (unsigned long k = binaries->nb_in; k < binaries->nb_in + binaries->nb_out; k += 1) {
+        if (synthetic->forward && binaries->nb_in > 0) {
+            const unsigned long from = synthetic->last_binary_in;
+            memcpy(synthetic->binary[k], synthetic->binary[from], synthetic->binary_size[from]);
+            synthetic->binary_size[k] = synthetic->binary_size[from];
+        } else {
+            memset(synthetic->binary[k], (int)((synthetic->nb_steps + synthetic->nb_received) & 0xFF),
+                   binaries->dimension);
+            synthetic->binary_size[k] = binaries->dimension;
+        }
+    }
+
+    return;
+}
+
+
+/*
+ * Outputs depend on all inputs of the same type so that links carry changing values.
+ * Float64 inputs are interpolated with their derivatives (order 1) which are zero unless
+ * set by the importer. Returns 1 if output clocks ticked during this step.
+ */
+static int synthetic_step(synthetic_t *synthetic, double current_time, double step_size) {
+    double x = synthetic->sink;
+    for (unsigned long i = 0; i < synthetic->cost; i += 1)
+        x = x * 0.999999 + 1.0e-6;
+    synthetic->sink = x;
+
+    synthetic->time = current_time + step_size;
+    synthetic->nb_steps += 1;
+
+#define SYNTHETIC_COMPUTE(type, field, ctype, reduce, compute)                              \
+    do {                                                                                    \
+        const synthetic_ports_t *ports = &synthetic->ports[type];                          \
+        const unsigned long nb_in = ports->nb_in * ports->dimension;                       \
+        const unsigned long nb_out = ports->nb_out * ports->dimension;                     \
+        ctype acc = 0;                                                                      \
+        for (unsigned long i = 0; i < nb_in; i += 1)                                        \
+            acc = reduce;                                                                   \
+        for (unsigned long i = 0; i < nb_out; i += 1)                                       \
+            synthetic->field[nb_in + i] = compute;                                          \
+    } while(0)
+
+    SYNTHETIC_COMPUTE(SYNTHETIC_FLOAT64, float64, double,
+                      acc + synthetic->float64[i] + synthetic->float64_derivative[i] * step_size,
+                      acc + (double)(i / ports->dimension) + synthetic->time);
+    SYNTHETIC_COMPUTE(SYNTHETIC_FLOAT64, float64_derivative, double, acc + synthetic->float64_derivative[i],
+                      acc + 1.0);
+    SYNTHETIC_COMPUTE(SYNTHETIC_INT32, int32, int32_t, acc + synthetic->int32[i],
+                      acc + (int32_t)(i / ports->dimension) + (int32_t)synthetic->nb_steps);
+    SYNTHETIC_COMPUTE(SYNTHETIC_BOOLEAN, boolean, bool, acc ^ synthetic->boolean[i],
+                      acc ^ (bool)(synthetic->nb_steps & 1));
+#undef SYNTHETIC_COMPUTE
+
+    if (synthetic->ports[SYNTHETIC_CLOCK].nb_out > 0) {
+        if (synthetic->period > 0 && synthetic->nb_steps % synthetic->period == 0) {
+            synthetic_tick(synthetic);
+            return 1;
+        }
+    } else if (synthetic->ports[SYNTHETIC_BINARY].nb_out > 0)
+        synthetic_tick(synthetic); /* not clocked: refresh on each step */
+
+    return 0;
+}
+
+
+static void synthetic_set_binary(synthetic_t *synthetic, unsigned int vr, const uint8_t *value, size_t size) {
+    const synthetic_ports_t *binaries = &synthetic->ports[SYNTHETIC_BINARY];
+    const unsigned long k = vr - SYNTHETIC_VR(SYNTHETIC_BINARY, 0);
+
+    if (size > binaries->dimension)
+        size = binaries->dimension; /* payload is truncated */
+    if (size > 0 && value)
+        memcpy(synthetic->binary[k], value, size);
+    synthetic->binary_size[k] = size;
+    if (k < binaries->nb_in)
+        synthetic->last_binary_in = k;
+
+    return;
+}
+
+
+/* Model Exchange: continuous states are the values of the Float64 outputs */
+static double *synthetic_states(const synthetic_t *synthetic, size_t *nb_states) {
+    const synthetic_ports_t *ports = &synthetic->ports[SYNTHETIC_FLOAT64];
+
+    *nb_states = ports->nb_out * ports->dimension;
+
+    return synthetic->float64 + ports->nb_in * ports->dimension;
+}
+
+
+static void synthetic_start_states(synthetic_t *synthetic) {
+    size_t nb_states;
+    double *x = synthetic_states(synthetic, &nb_states);
+
+    for (size_t i = 0; i < nb_states; i += 1)
+        x[i] = 1.0;
+
+    return;
+}
+
+
+/*----------------------------------------------------------------------------
+                                   S T A T E
+----------------------------------------------------------------------------*/
+
+/* A state is a synthetic_t with the same ports which holds values and counters */
+static void synthetic_copy(synthetic_t *to, const synthetic_t *from) {
+#define SYNTHETIC_COPY(type, field)                                                         \
+    memcpy(to->field, from->field, (from->ports[type].nb_in + from->ports[type].nb_out) *  \
+           from->ports[type].dimension * sizeof(*from->field))
+
+    SYNTHETIC_COPY(SYNTHETIC_FLOAT64, float64);
+    SYNTHETIC_COPY(SYNTHETIC_FLOAT64, float64_derivative);
+    SYNTHETIC_COPY(SYNTHETIC_INT32, int32);
+    SYNTHETIC_COPY(SYNTHETIC_BOOLEAN, boolean);
+#undef SYNTHETIC_COPY
+
+    const synthetic_ports_t *binaries = &from->ports[SYNTHETIC_BINARY];
+    for (unsigned long k = 0; k < binaries->nb_in + binaries->nb_out; k += 1) {
+        memcpy(to->binary[k], from->binary[k], binaries->dimension);
+        to->binary_size[k] = from->binary_size[k];
+    }
+    memcpy(to->clock, from->clock,
+           (from->ports[SYNTHETIC_CLOCK].nb_in + from->ports[SYNTHETIC_CLOCK].nb_out) * sizeof(*from->clock));
+
+    to->time = from->time;
+    to->nb_steps = from->nb_steps;
+    to->input_clock_ticked = from->input_clock_ticked;
+    to->nb_received = from->nb_received;
+    to->last_binary_in = from->last_binary_in;
+    to->sink = from->sink;
+
+    return;
+}
+
+
+static synthetic_t *synthetic_get_state(const synthetic_t *synthetic, synthetic_t *state) {
+    if (!state) {
+        state = synthetic_new(synthetic->fmi_version, synthetic->name, NULL);
+        if (!state)
+            return NULL;
+        memcpy(state->ports, synthetic->ports, sizeof(state->ports));
+        if (synthetic_allocate(state)) {
+            synthetic_free(state);
+            return NULL;
+        }
+    }
+    synthetic_copy(state, synthetic);
+
+    return state;
+}
+
+
+/*
+ * Serialized state is the concatenation of values and counters. Without buffer, only the
+ * size is computed. Returns 0 if the buffer is too small.
+ */
+static size_t synthetic_serialize(synthetic_t *state, uint8_t *buffer, size_t size, bool restore) {
+    size_t offset = 0;
+
+#define SYNTHETIC_PACK(ptr, len)                                                            \
+    if (buffer) {                                                                           \
+        if (offset + (len) > size)                                                          \
+            return 0;                                                                       \
+        if (restore)                                                                        \
+            memcpy((ptr), buffer + offset, (len));                                          \
+        else                                                                                \
+            memcpy(buffer + offset, (ptr), (len));                                          \
+    }                                                                                       \
+    offset += (len)
+
+#define SYNTHETIC_PACK_PORTS(type, field)                                                   \
+    SYNTHETIC_PACK(state->field, (state->ports[type].nb_in + state->ports[type].nb_out) *   \
+                   state->ports[type].dimension * sizeof(*state->field))
+
+    SYNTHETIC_PACK_PORTS(SYNTHETIC_FLOAT64, float64);
+    SYNTHETIC_PACK_PORTS(SYNTHETIC_FLOAT64, float64_derivative);
+    SYNTHETIC_PACK_PORTS(SYNTHETIC_INT32, int32);
+    SYNTHETIC_PACK_PORTS(SYNTHETIC_BOOLEAN, boolean);
+    const synthetic_ports_t *binaries = &state->ports[SYNTHETIC_BINARY];
+    for (unsigned long k = 0; k < binaries->nb_in + binaries->nb_out; k += 1) {
+        SYNTHETIC_PACK(state->binary[k], binaries->dimension);
+        SYNTHETIC_PACK(&state->binary_size[k], sizeof(state->binary_size[k]));
+    }
+    SYNTHETIC_PACK(state->clock, (state->ports[SYNTHETIC_CLOCK].nb_in + state->ports[SYNTHETIC_CLOCK].nb_out) *
+                   sizeof(*state->clock));
+
+    SYNTHETIC_PACK(&state->time, sizeof(state->time));
+    SYNTHETIC_PACK(&state->nb_steps, sizeof(state->nb_steps));
+    SYNTHETIC_PACK(&state->input_clock_ticked, sizeof(state->input_clock_ticked));
+    SYNTHETIC_PACK(&state->nb_received, sizeof(state->nb_received));
+    SYNTHETIC_PACK(&state->last_binary_in, sizeof(state->last_binary_in));
+#undef SYNTHETIC_PACK_PORTS
+#undef SYNTHETIC_PACK
+
+    return offset;
+}
+
+
+/*----------------------------------------------------------------------------
+                                F M I - 3 . 0
+----------------------------------------------------------------------------*/
+
+const char* fmi3GetVersion(void) {
+    return fmi3Version;
+}
+
+
+fmi3Status fmi3SetDebugLogging(fmi3Instance instance, fmi3Boolean loggingOn, size_t nCategories,
+                               const fmi3String categories[]) {
+    (void)instance; /* unused parameter */
+    (void)loggingOn; /* unused parameter */
+    (void)nCategories; /* unused parameter */
+    (void)categories; /* unused parameter */
+
+    return fmi3OK;
+}
+
+
+fmi3Instance fmi3InstantiateModelExchange(fmi3String instanceName, fmi3String instantiationToken,
+                                          fmi3String resourcePath, fmi3Boolean visible, fmi3Boolean loggingOn,
+                                          fmi3InstanceEnvironment instanceEnvironment,
+                                          fmi3LogMessageCallback logMessage) {
+    (void)instantiationToken; /* unused parameter */
+    (void)visible; /* unused parameter */
+    (void)loggingOn; /* unused parameter */
+
+    synthetic_t *synthetic = synthetic_new(3, instanceName, instanceEnvironment);
+    if (!synthetic)
+        return NULL;
+    synthetic->fmi3_logger = logMessage;
+
+    if (synthetic_configure(synthetic, resourcePath)) {
+        synthetic_free(synthetic);
+        return NULL;
+    }
+    if (!synthetic->model_exchange) {
+        synthetic_log(synthetic, "FMU is not generated for Model Exchange.");
+        synthetic_free(synthetic);
+        return NULL;
+    }
+    synthetic_start_states(synthetic);
+
+    return synthetic;
+}
+
+
+fmi3Instance fmi3InstantiateCoSimulation(fmi3String instanceName, fmi3String instantiationToken,
+                                         fmi3String resourcePath, fmi3Boolean visible, fmi3Boolean loggingOn,
+                                         fmi3Boolean eventModeUsed, fmi3Boolean earlyReturnAllowed,
+                                         const fmi3ValueReference requiredIntermediateVariables[],
+                                         size_t nRequiredIntermediateVariables,
+                                         fmi3InstanceEnvironment instanceEnvironment,
+                                         fmi3LogMessageCallback logMessage,
+                                         fmi3IntermediateUpdateCallback intermediateUpdate) {
+    (void)instantiationToken; /* unused parameter */
+    (void)visible; /* unused parameter */
+    (void)loggingOn; /* unused parameter */
+    (void)eventModeUsed; /* unused parameter */
+    (void)earlyReturnAllowed; /* unused parameter */
+    (void)requiredIntermediateVariables; /* unused parameter */
+    (void)nRequiredIntermediateVariables; /* unused parameter */
+    (void)intermediateUpdate; /* unused parameter */
+
+    synthetic_t *synthetic = synthetic_new(3, instanceName, instanceEnvironment);
+    if (!synthetic)
+        return NULL;
+    synthetic->fmi3_logger = logMessage;
+
+    if (synthetic_configure(synthetic, resourcePath)) {
+        synthetic_free(synthetic);
+        return NULL;
+    }
+
+    return synthetic;
+}
+
+
+fmi3Instance fmi3InstantiateScheduledExecution(fmi3String instanceName, fmi3String instantiationToken,
+                                               fmi3String resourcePath, fmi3Boolean visible,
+                                               fmi3Boolean loggingOn, fmi3InstanceEnvironment instanceEnvironment,
+                                               fmi3LogMessageCallback logMessage,
+                                               fmi3ClockUpdateCallback clockUpdate,
+                                               fmi3LockPreemptionCallback lockPreemption,
+                                               fmi3UnlockPreemptionCallback unlockPreemption) {
+    (void)instantiationToken; /* unused parameter */
+    (void)visible; /* unused parameter */
+    (void)loggingOn; /* unused parameter */
+    (void)lockPreemption; /* unused parameter */
+    (void)unlockPreemption; /* unused parameter */
+
+    synthetic_t *synthetic = synthetic_new(3, instanceName, instanceEnvironment);
+    if (!synthetic)
+        return NULL;
+    synthetic->fmi3_logger = logMessage;
+    synthetic->fmi3_clock_update = clockUpdate;
+
+    if (synthetic_configure(synthetic, resourcePath)) {
+        synthetic_free(synthetic);
+        return NULL;
+    }
+
+    return synthetic;
+}
+
+
+void fmi3FreeInstance(fmi3Instance instance) {
+    synthetic_free((synthetic_t *)instance);
+
+    return;
+}
+
+
+fmi3Status fmi3EnterInitializationMode(fmi3Instance instance, fmi3Boolean toleranceDefined, fmi3Float64 tolerance,
+                                       fmi3Float64 startTime, fmi3Boolean stopTimeDefined, fmi3Float64 stopTime) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+    (void)toleranceDefined; /* unused parameter */
+    (void)tolerance; /* unused parameter */
+    (void)stopTimeDefined; /* unused parameter */
+    (void)stopTime; /* unused parameter */
+
+    synthetic->time = startTime;
+
+    return fmi3OK;
+}
+
+
+#define SYNTHETIC_NOP3(function)                                                            \
+fmi3Status function(fmi3Instance instance) {                                                \
+    (void)instance; /* unused parameter */                                                  \
+    return fmi3OK;                                                                          \
+}
+
+SYNTHETIC_NOP3(fmi3ExitInitializationMode)
+SYNTHETIC_NOP3(fmi3EnterEventMode)
+SYNTHETIC_NOP3(fmi3Terminate)
+SYNTHETIC_NOP3(fmi3EnterConfigurationMode)
+SYNTHETIC_NOP3(fmi3ExitConfigurationMode)
+SYNTHETIC_NOP3(fmi3EvaluateDiscreteStates)
+SYNTHETIC_NOP3(fmi3EnterContinuousTimeMode)
+#undef SYNTHETIC_NOP3
+
+
+fmi3Status fmi3Reset(fmi3Instance instance) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    synthetic->time = 0.0;
+    synthetic->nb_steps = 0;
+    synthetic->nb_received = 0;
+    if (synthetic->model_exchange)
+        synthetic_start_states(synthetic);
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3EnterStepMode(fmi3Instance instance) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    /* Input clocks are active for one event only */
+    for (unsigned long k = 0; k < synthetic->ports[SYNTHETIC_CLOCK].nb_in; k += 1)
+        synthetic->clock[k] = false;
+
+    return fmi3OK;
+}
+
+
+#define SYNTHETIC_ACCESS3(type, field, fmi_type, direction, copy)                                   \
+    synthetic_t *synthetic = (synthetic_t *)instance;                                               \
+    size_t n = 0;                                                                                   \
+    for (size_t i = 0; i < nValueReferences; i += 1) {                                              \
+        const long offset = synthetic_offset(synthetic, type, valueReferences[i], direction);       \
+        if (offset < 0) {                                                                           \
+            synthetic_log(synthetic, "Unknown " #fmi_type " variable #%u.", valueReferences[i]);    \
+            return fmi3Error;                                                                       \
+        }                                                                                           \
+        for (unsigned long j = 0; j < synthetic->ports[type].dimension; j += 1, n += 1) {           \
+            if (n >= nValues)                                                                       \
+                return fmi3Error;                                                                   \
+            copy;                                                                                   \
+        }                                                                                           \
+    }                                                                                               \
+    return fmi3OK
+
+#define SYNTHETIC_GETTER3(fmi_type, type, field)                                                    \
+fmi3Status fmi3Get ## fmi_type(fmi3Instance instance, const fmi3ValueReference valueReferences[],    \
+                               size_t nValueReferences, fmi3 ## fmi_type values[], size_t nValues) {\
+    SYNTHETIC_ACCESS3(type, field, fmi_type, 0, values[n] = synthetic->field[offset + j]);          \
+}
+
+#define SYNTHETIC_SETTER3(fmi_type, type, field)                                                    \
+fmi3Status fmi3Set ## fmi_type(fmi3Instance instance, const fmi3ValueReference valueReferences[],    \
+                               size_t nValueReferences, const fmi3 ## fmi_type values[],            \
+                               size_t nValues) {                                                    \
+    SYNTHETIC_ACCESS3(type, field, fmi_type, 0, synthetic->field[offset + j] = values[n]);          \
+}
+
+SYNTHETIC_GETTER3(Float64, SYNTHETIC_FLOAT64, float64)
+SYNTHETIC_GETTER3(Int32, SYNTHETIC_INT32, int32)
+SYNTHETIC_GETTER3(Boolean, SYNTHETIC_BOOLEAN, boolean)
+SYNTHETIC_SETTER3(Float64, SYNTHETIC_FLOAT64, float64)
+SYNTHETIC_SETTER3(Int32, SYNTHETIC_INT32, int32)
+SYNTHETIC_SETTER3(Boolean, SYNTHETIC_BOOLEAN, boolean)
+#undef SYNTHETIC_GETTER3
+#undef SYNTHETIC_SETTER3
+#undef SYNTHETIC_ACCESS3
+
+
+fmi3Status fmi3GetOutputDerivatives(fmi3Instance instance, const fmi3ValueReference valueReferences[],
+                                    size_t nValueReferences, const fmi3Int32 orders[], fmi3Float64 values[],
+                                    size_t nValues) {
+    if (nValues < nValueReferences)
+        return fmi3Error;
+    for (size_t i = 0; i < nValueReferences; i += 1) {
+        if (synthetic_derivative((synthetic_t *)instance, valueReferences[i], orders[i], &values[i], 1))
+            return fmi3Error;
+    }
+
+    return fmi3OK;
+}
+
+
+/* Types which are not generated by synthetic.py */
+#define SYNTHETIC_UNSUPPORTED3(fmi_type)                                                            \
+fmi3Status fmi3Get ## fmi_type(fmi3Instance instance, const fmi3ValueReference valueReferences[],    \
+                               size_t nValueReferences, fmi3 ## fmi_type values[], size_t nValues) {\
+    (void)instance; /* unused parameter */                                                          \
+    (void)valueReferences; /* unused parameter */                                                   \
+    (void)values; /* unused parameter */                                                            \
+    (void)nValues; /* unused parameter */                                                           \
+    return nValueReferences ? fmi3Error : fmi3OK;                                                   \
+}                                                                                                   \
+fmi3Status fmi3Set ## fmi_type(fmi3Instance instance, const fmi3ValueReference valueReferences[],    \
+                               size_t nValueReferences, const fmi3 ## fmi_type values[],            \
+                               size_t nValues) {                                                    \
+    (void)instance; /* unused parameter */                                                          \
+    (void)valueReferences; /* unused parameter */                                                   \
+    (void)values; /* unused parameter */                                                            \
+    (void)nValues; /* unused parameter */                                                           \
+    return nValueReferences ? fmi3Error : fmi3OK;                                                   \
+}
+
+SYNTHETIC_UNSUPPORTED3(Float32)
+SYNTHETIC_UNSUPPORTED3(Int8)
+SYNTHETIC_UNSUPPORTED3(UInt8)
+SYNTHETIC_UNSUPPORTED3(Int16)
+SYNTHETIC_UNSUPPORTED3(UInt16)
+SYNTHETIC_UNSUPPORTED3(UInt32)
+SYNTHETIC_UNSUPPORTED3(Int64)
+SYNTHETIC_UNSUPPORTED3(UInt64)
+SYNTHETIC_UNSUPPORTED3(String)
+#undef SYNTHETIC_UNSUPPORTED3
+
+
+fmi3Status fmi3GetBinary(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences,
+                         size_t valueSizes[], fmi3Binary values[], size_t nValues) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    if (nValues < nValueReferences)
+        return fmi3Error;
+
+    for (size_t i = 0; i < nValueReferences; i += 1) {
+        if (synthetic_offset(synthetic, SYNTHETIC_BINARY, valueReferences[i], 0) < 0) {
+            synthetic_log(synthetic, "Unknown Binary variable #%u.", valueReferences[i]);
+            return fmi3Error;
+        }
+        const unsigned long k = valueReferences[i] - SYNTHETIC_VR(SYNTHETIC_BINARY, 0);
+        valueSizes[i] = synthetic->binary_size[k];
+        values[i] = synthetic->binary[k];
+    }
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3SetBinary(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences,
+                         const size_t valueSizes[], const fmi3Binary values[], size_t nValues) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    if (nValues < nValueReferences)
+        return fmi3Error;
+
+    for (size_t i = 0; i < nValueReferences; i += 1) {
+        if (synthetic_offset(synthetic, SYNTHETIC_BINARY, valueReferences[i], 0) < 0) {
+            synthetic_log(synthetic, "Unknown Binary variable #%u.", valueReferences[i]);
+            return fmi3Error;
+        }
+        synthetic_set_binary(synthetic, valueReferences[i], values[i], valueSizes[i]);
+    }
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetClock(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences,
+                        fmi3Clock values[]) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    for (size_t i = 0; i < nValueReferences; i += 1) {
+        const long k = synthetic_offset(synthetic, SYNTHETIC_CLOCK, valueReferences[i], 0);
+        if (k < 0) {
+            synthetic_log(synthetic, "Unknown Clock variable #%u.", valueReferences[i]);
+            return fmi3Error;
+        }
+        values[i] = synthetic->clock[k];
+        if ((unsigned long)k >= synthetic->ports[SYNTHETIC_CLOCK].nb_in)
+            synthetic->clock[k] = false; /* output clocks are reset once read */
+    }
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3SetClock(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences,
+                        const fmi3Clock values[]) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    for (size_t i = 0; i < nValueReferences; i += 1) {
+        const long k = synthetic_offset(synthetic, SYNTHETIC_CLOCK, valueReferences[i], 0);
+        if (k < 0 || (unsigned long)k >= synthetic->ports[SYNTHETIC_CLOCK].nb_in) {
+            synthetic_log(synthetic, "Unknown input Clock variable #%u.", valueReferences[i]);
+            return fmi3Error;
+        }
+        synthetic->clock[k] = values[i];
+        if (values[i])
+            synthetic->input_clock_ticked = 1;
+    }
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetIntervalDecimal(fmi3Instance instance, const fmi3ValueReference valueReferences[],
+                                  size_t nValueReferences, fmi3Float64 intervals[],
+                                  fmi3IntervalQualifier qualifiers[]) {
+    (void)instance; /* unused parameter */
+    (void)valueReferences; /* unused parameter */
+
+    /* All clocks are triggered */
+    for (size_t i = 0; i < nValueReferences; i += 1) {
+        intervals[i] = 0.0;
+        qualifiers[i] = fmi3IntervalNotYetKnown;
+    }
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3UpdateDiscreteStates(fmi3Instance instance, fmi3Boolean* discreteStatesNeedUpdate,
+                                    fmi3Boolean* terminateSimulation,
+                                    fmi3Boolean* nominalsOfContinuousStatesChanged,
+                                    fmi3Boolean* valuesOfContinuousStatesChanged,
+                                    fmi3Boolean* nextEventTimeDefined, fmi3Float64* nextEventTime) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    /* Forwarded frames are available for a new event iteration */
+    *discreteStatesNeedUpdate = fmi3False;
+    if (synthetic->forward && synthetic->input_clock_ticked) {
+        synthetic_tick(synthetic);
+        *discreteStatesNeedUpdate = fmi3True;
+    }
+    synthetic->nb_received += synthetic->input_clock_ticked;
+    synthetic->input_clock_ticked = 0;
+
+    *terminateSimulation = fmi3False;
+    *nominalsOfContinuousStatesChanged = fmi3False;
+    *valuesOfContinuousStatesChanged = fmi3False;
+    *nextEventTimeDefined = fmi3False;
+    *nextEventTime = 0.0;
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3DoStep(fmi3Instance instance, fmi3Float64 currentCommunicationPoint,
+                      fmi3Float64 communicationStepSize, fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                      fmi3Boolean* eventHandlingNeeded, fmi3Boolean* terminateSimulation,
+                      fmi3Boolean* earlyReturn, fmi3Float64* lastSuccessfulTime) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+    (void)noSetFMUStatePriorToCurrentPoint; /* unused parameter */
+
+    *eventHandlingNeeded = synthetic_step(synthetic, currentCommunicationPoint, communicationStepSize);
+    *terminateSimulation = fmi3False;
+    *earlyReturn = fmi3False;
+    *lastSuccessfulTime = synthetic->time;
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3ActivateModelPartition(fmi3Instance instance, fmi3ValueReference clockReference,
+                                      fmi3Float64 activationTime) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+
+    const long k = synthetic_offset(synthetic, SYNTHETIC_CLOCK, clockReference, 0);
+    if (k < 0 || (unsigned long)k >= synthetic->ports[SYNTHETIC_CLOCK].nb_in) {
+        synthetic_log(synthetic, "No partition for Clock variable #%u.", clockReference);
+        return fmi3Error;
+    }
+
+    int ticked = synthetic_step(synthetic, synthetic->time, activationTime - synthetic->time);
+    if (synthetic->forward) {
+        synthetic_tick(synthetic);
+        ticked = 1;
+    }
+    synthetic->nb_received += 1;
+
+    if (ticked && synthetic->fmi3_clock_update)
+        synthetic->fmi3_clock_update(synthetic->environment);
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3SetTime(fmi3Instance instance, fmi3Float64 time) {
+    ((synthetic_t *)instance)->time = time;
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetNumberOfContinuousStates(fmi3Instance instance, size_t* nContinuousStates) {
+    synthetic_states((synthetic_t *)instance, nContinuousStates);
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetNumberOfEventIndicators(fmi3Instance instance, size_t* nEventIndicators) {
+    (void)instance; /* unused parameter */
+
+    *nEventIndicators = 0;
+
+    return fmi3OK;
+}
+
+
+#define SYNTHETIC_STATES3(n)                                                                        \
+    synthetic_t *synthetic = (synthetic_t *)instance;                                               \
+    size_t nb_states;                                                                               \
+    double *x = synthetic_states(synthetic, &nb_states);                                            \
+    if ((n) != nb_states) {                                                                         \
+        synthetic_log(synthetic, "Expected %zu continuous states, got %zu.", nb_states, (n));       \
+        return fmi3Error;                                                                           \
+    }
+
+fmi3Status fmi3SetContinuousStates(fmi3Instance instance, const fmi3Float64 continuousStates[],
+                                   size_t nContinuousStates) {
+    SYNTHETIC_STATES3(nContinuousStates);
+
+    memcpy(x, continuousStates, nb_states * sizeof(*x));
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetContinuousStates(fmi3Instance instance, fmi3Float64 continuousStates[], size_t nContinuousStates) {
+    SYNTHETIC_STATES3(nContinuousStates);
+
+    memcpy(continuousStates, x, nb_states * sizeof(*x));
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetContinuousStateDerivatives(fmi3Instance instance, fmi3Float64 derivatives[],
+                                             size_t nContinuousStates) {
+    SYNTHETIC_STATES3(nContinuousStates);
+    const synthetic_ports_t *ports = &synthetic->ports[SYNTHETIC_FLOAT64];
+    double acc = 0.0;
+
+    /* der(x) = sum(inputs) - x */
+    for (unsigned long i = 0; i < ports->nb_in * ports->dimension; i += 1)
+        acc += synthetic->float64[i];
+    for (size_t i = 0; i < nb_states; i += 1)
+        derivatives[i] = acc - x[i];
+
+    return fmi3OK;
+}
+
+
+#undef SYNTHETIC_STATES3
+
+
+fmi3Status fmi3GetNominalsOfContinuousStates(fmi3Instance instance, fmi3Float64 nominals[], size_t nContinuousStates) {
+    (void)instance; /* unused parameter */
+
+    for (size_t i = 0; i < nContinuousStates; i += 1)
+        nominals[i] = 1.0;
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetEventIndicators(fmi3Instance instance, fmi3Float64 eventIndicators[], size_t nEventIndicators) {
+    (void)instance; /* unused parameter */
+    (void)eventIndicators; /* unused parameter */
+
+    return nEventIndicators ? fmi3Error : fmi3OK;
+}
+
+
+fmi3Status fmi3CompletedIntegratorStep(fmi3Instance instance, fmi3Boolean noSetFMUStatePriorToCurrentPoint,
+                                       fmi3Boolean* enterEventMode, fmi3Boolean* terminateSimulation) {
+    synthetic_t *synthetic = (synthetic_t *)instance;
+    (void)noSetFMUStatePriorToCurrentPoint; /* unused parameter */
+
+    synthetic->nb_steps += 1;
+    *enterEventMode = fmi3False;
+    *terminateSimulation = fmi3False;
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState) {
+    *FMUState = synthetic_get_state((synthetic_t *)instance, *FMUState);
+
+    return *FMUState ? fmi3OK : fmi3Error;
+}
+
+
+fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState) {
+    synthetic_copy((synthetic_t *)instance, (const synthetic_t *)FMUState);
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState) {
+    (void)instance; /* unused parameter */
+
+    synthetic_free((synthetic_t *)*FMUState);
+    *FMUState = NULL;
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance, fmi3FMUState FMUState, size_t* size) {
+    (void)instance; /* unused parameter */
+
+    *size = synthetic_serialize((synthetic_t *)FMUState, NULL, 0, false);
+
+    return fmi3OK;
+}
+
+
+fmi3Status fmi3SerializeFMUState(fmi3Instance instance, fmi3FMUState FMUState, fmi3Byte serializedState[],
+                                 size_t size) {
+    (void)instance; /* unused parameter */
+
+    return synthetic_serialize((synthetic_t *)FMUState, serializedState, size, false) ? fmi3OK : fmi3Error;
+}
+
+
+fmi3Status fmi3DeserializeFMUState(fmi3Instance instance, const fmi3Byte serializedState[], size_t size,
+                                   fmi3FMUState* FMUState) {
+    synthetic_t *state = synthetic_get_state((synthetic_t *)instance, NULL);
+
+    if (!state || !synthetic_serialize(state, (uint8_t *)serializedState, size, true)) {
+        synthetic_free(state);
+        return fmi3Error;
+    }
+    *FMUState = state;
+
+    return fmi3OK;
+}
+
+
+/*----------------------------------------------------------------------------
+                                F M I - 2 . 0
+----------------------------------------------------------------------------*/
+
+const char* fmi2GetTypesPlatform(void) {
+    return fmi2TypesPlatform;
+}
+
+
+const char* fmi2GetVersion(void) {
+    return fmi2Version;
+}
+
+
+fmi2Status fmi2SetDebugLogging(fmi2Component c, fmi2Boolean loggingOn, size_t nCategories,
+                               const fmi2String categories[]) {
+    (void)c; /* unused parameter */
+    (void)loggingOn; /* unused parameter */
+    (void)nCategories; /* unused parameter */
+    (void)categories; /* unused parameter */
+
+    return fmi2OK;
+}
+
+
+fmi2Component fmi2Instantiate(fmi2String instanceName, fmi2Type fmuType, fmi2String fmuGUID,
+                              fmi2String fmuResourceLocation, const fmi2CallbackFunctions* functions,
+                              fmi2Boolean visible, fmi2Boolean loggingOn) {
+    (void)fmuGUID; /* unused parameter */
+    (void)visible; /* unused parameter */
+    (void)loggingOn; /* unused parameter */
+
+    if (fmuType != fmi2CoSimulation)
+        return NULL;
+
+    synthetic_t *synthetic = synthetic_new(2, instanceName, functions ? functions->componentEnvironment : NULL);
+    if (!synthetic)
+        return NULL;
+    if (functions)
+        synthetic->fmi2_callbacks = *functions;
+
+    if (synthetic_configure(synthetic, fmuResourceLocation)) {
+        synthetic_free(synthetic);
+        return NULL;
+    }
+
+    /* FMI-2.0 has neither arrays, binaries nor clocks */
+    for (int type = 0; type < SYNTHETIC_NB_TYPES; type += 1) {
+        const synthetic_ports_t *ports = &synthetic->ports[type];
+        if ((type >= SYNTHETIC_BINARY && ports->nb_in + ports->nb_out > 0) ||
+            (type < SYNTHETIC_BINARY && ports->dimension > 1)) {
+            synthetic_log(synthetic, "%s variables are not supported with FMI-2.0.", synthetic_type_names[type]);
+            synthetic_free(synthetic);
+            return NULL;
+        }
+    }
+
+    return synthetic;
+}
+
+
+void fmi2FreeInstance(fmi2Component c) {
+    synthetic_free((synthetic_t *)c);
+
+    return;
+}
+
+
+fmi2Status fmi2SetupExperiment(fmi2Component c, fmi2Boolean toleranceDefined, fmi2Real tolerance,
+                               fmi2Real startTime, fmi2Boolean stopTimeDefined, fmi2Real stopTime) {
+    synthetic_t *synthetic = (synthetic_t *)c;
+    (void)toleranceDefined; /* unused parameter */
+    (void)tolerance; /* unused parameter */
+    (void)stopTimeDefined; /* unused parameter */
+    (void)stopTime; /* unused parameter */
+
+    synthetic->time = startTime;
+
+    return fmi2OK;
+}
+
+
+#define SYNTHETIC_NOP2(function)                                                            \
+fmi2Status function(fmi2Component c) {                                                      \
+    (void)c; /* unused parameter */                                                         \
+    return fmi2OK;                                                                          \
+}
+
+SYNTHETIC_NOP2(fmi2EnterInitializationMode)
+SYNTHETIC_NOP2(fmi2ExitInitializationMode)
+SYNTHETIC_NOP2(fmi2Terminate)
+SYNTHETIC_NOP2(fmi2CancelStep)
+#undef SYNTHETIC_NOP2
+
+
+fmi2Status fmi2Reset(fmi2Component c) {
+    synthetic_t *synthetic = (synthetic_t *)c;
+
+    synthetic->time = 0.0;
+    synthetic->nb_steps = 0;
+    synthetic->nb_received = 0;
+
+    return fmi2OK;
+}
+
+
+#define SYNTHETIC_ACCESS2(type, field, fmi_type, copy)                                              \
+    synthetic_t *synthetic = (synthetic_t *)c;                                                      \
+    for (size_t i = 0; i < nvr; i += 1) {                                                           \
+        const long offset = synthetic_offset(synthetic, type, vr[i], 0);                            \
+        if (offset < 0) {                                                                           \
+            synthetic_log(synthetic, "Unknown " #fmi_type " variable #%u.", vr[i]);                 \
+            return fmi2Error;                                                                       \
+        }                                                                                           \
+        copy;                                                                                       \
+    }                                                                                               \
+    return fmi2OK
+
+#define SYNTHETIC_GETTER2(fmi_type, type, field)                                                    \
+fmi2Status fmi2Get ## fmi_type(fmi2Component c, const fmi2ValueReference vr[], size_t nvr,          \
+                               fmi2 ## fmi_type value[]) {                                          \
+    SYNTHETIC_ACCESS2(type, field, fmi_type, value[i] = synthetic->field[offset]);                  \
+}
+
+#define SYNTHETIC_SETTER2(fmi_type, type, field)                                                    \
+fmi2Status fmi2Set ## fmi_type(fmi2Component c, const fmi2ValueReference vr[], size_t nvr,          \
+                               const fmi2 ## fmi_type value[]) {                                    \
+    SYNTHETIC_ACCESS2(type, field, fmi_type, synthetic->field[offset] = value[i]);                  \
+}
+
+SYNTHETIC_GETTER2(Real, SYNTHETIC_FLOAT64, float64)
+SYNTHETIC_GETTER2(Integer, SYNTHETIC_INT32, int32)
+SYNTHETIC_GETTER2(Boolean, SYNTHETIC_BOOLEAN, boolean)
+SYNTHETIC_SETTER2(Real, SYNTHETIC_FLOAT64, float64)
+SYNTHETIC_SETTER2(Integer, SYNTHETIC_INT32, int32)
+SYNTHETIC_SETTER2(Boolean, SYNTHETIC_BOOLEAN, boolean)
+#undef SYNTHETIC_GETTER2
+#undef SYNTHETIC_SETTER2
+
+
+fmi2Status fmi2SetRealInputDerivatives(fmi2Component c, const fmi2ValueReference vr[], size_t nvr,
+                                       const fmi2Integer order[], const fmi2Real value[]) {
+    for (size_t i = 0; i < nvr; i += 1) {
+        double derivative = value[i];
+        if (synthetic_derivative((synthetic_t *)c, vr[i], order[i], &derivative, 0))
+            return fmi2Error;
+    }
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2GetRealOutputDerivatives(fmi2Component c, const fmi2ValueReference vr[], size_t nvr,
+                                        const fmi2Integer order[], fmi2Real value[]) {
+    for (size_t i = 0; i < nvr; i += 1) {
+        if (synthetic_derivative((synthetic_t *)c, vr[i], order[i], &value[i], 1))
+            return fmi2Error;
+    }
+
+    return fmi2OK;
+}
+#undef SYNTHETIC_ACCESS2
+
+
+fmi2Status fmi2GetString(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, fmi2String value[]) {
+    (void)c; /* unused parameter */
+    (void)vr; /* unused parameter */
+    (void)value; /* unused parameter */
+
+    return nvr ? fmi2Error : fmi2OK;
+}
+
+
+fmi2Status fmi2SetString(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, const fmi2String value[]) {
+    (void)c; /* unused parameter */
+    (void)vr; /* unused parameter */
+    (void)value; /* unused parameter */
+
+    return nvr ? fmi2Error : fmi2OK;
+}
+
+
+fmi2Status fmi2DoStep(fmi2Component c, fmi2Real currentCommunicationPoint, fmi2Real communicationStepSize,
+                      fmi2Boolean noSetFMUStatePriorToCurrentPoint) {
+    (void)noSetFMUStatePriorToCurrentPoint; /* unused parameter */
+
+    synthetic_step((synthetic_t *)c, currentCommunicationPoint, communicationStepSize);
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2GetFMUstate(fmi2Component c, fmi2FMUstate* FMUstate) {
+    *FMUstate = synthetic_get_state((synthetic_t *)c, *FMUstate);
+
+    return *FMUstate ? fmi2OK : fmi2Error;
+}
+
+
+fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate FMUstate) {
+    synthetic_copy((synthetic_t *)c, (const synthetic_t *)FMUstate);
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2FreeFMUstate(fmi2Component c, fmi2FMUstate* FMUstate) {
+    (void)c; /* unused parameter */
+
+    synthetic_free((synthetic_t *)*FMUstate);
+    *FMUstate = NULL;
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2SerializedFMUstateSize(fmi2Component c, fmi2FMUstate FMUstate, size_t* size) {
+    (void)c; /* unused parameter */
+
+    *size = synthetic_serialize((synthetic_t *)FMUstate, NULL, 0, false);
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2SerializeFMUstate(fmi2Component c, fmi2FMUstate FMUstate, fmi2Byte serializedState[], size_t size) {
+    (void)c; /* unused parameter */
+
+    return synthetic_serialize((synthetic_t *)FMUstate, (uint8_t *)serializedState, size, false) ? fmi2OK : fmi2Error;
+}
+
+
+fmi2Status fmi2DeSerializeFMUstate(fmi2Component c, const fmi2Byte serializedState[], size_t size,
+                                   fmi2FMUstate* FMUstate) {
+    synthetic_t *state = synthetic_get_state((synthetic_t *)c, NULL);
+
+    if (!state || !synthetic_serialize(state, (uint8_t *)serializedState, size, true)) {
+        synthetic_free(state);
+        return fmi2Error;
+    }
+    *FMUstate = state;
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2GetStatus(fmi2Component c, const fmi2StatusKind s, fmi2Status* value) {
+    (void)c; /* unused parameter */
+    (void)s; /* unused parameter */
+
+    *value = fmi2OK;
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2GetRealStatus(fmi2Component c, const fmi2StatusKind s, fmi2Real* value) {
+    const synthetic_t *synthetic = (const synthetic_t *)c;
+
+    if (s != fmi2LastSuccessfulTime)
+        return fmi2Discard;
+    *value = synthetic->time;
+
+    return fmi2OK;
+}
+
+
+fmi2Status fmi2GetBooleanStatus(fmi2Component c, const fmi2StatusKind s, fmi2Boolean* value) {
+    (void)c; /* unused parameter */
+    (void)s; /* unused parameter */
+
+    *value = fmi2False;
+
+    return fmi2Discard;
+}
@@ -0,0 +1,422 @@
+"""Generator of synthetic FMUs and containers assemblies used to benchmark the container runtime.
+
+Each generated FMU embeds the `synthetic` library (built from `synthetic.c` by CMake) and a
+`resources/synthetic.txt` file which defines its interface and its cost per step. Generated FMUs
+are described together with a JSON assembly which can be given to `fmucontainer`:
+
+    python synthetic.py -library ../../tests/bin/linux64/synthetic.so -topology chain -nb-fmu 8 -output-directory bench
+    fmucontainer -fmu-directory bench -container synthetic-chain.json -fmi 3
+"""
+import argparse
+import io
+import json
+import sys
+import uuid
+import zipfile
+
+from pathlib import Path
+from typing import Dict, List, Tuple
+
+
+class SyntheticError(Exception):
+    def __init__(self, reason: str):
+        self.reason = reason
+
+    def __repr__(self):
+        return f"{self.reason}"
+
+
+class SyntheticFMU:
+    """Synthetic FMU with a configurable interface and cost.
+
+    Variable #k of a type has value reference `type_index * VR_STRIDE + k`. Inputs come first,
+    then outputs. This layout is shared with `synthetic.c`.
+
+    In Model Exchange (FMI-3.0 only), Float64 outputs are continuous states which start at 1 and
+    follow der(x) = sum(inputs) - x.
+    """
+
+    TYPES = ("Float64", "Int32", "Boolean", "Binary", "Clock")
+    FMI2_TYPES = {
+        "Float64": "Real",
+        "Int32": "Integer",
+        "Boolean": "Boolean"
+    }
+    VR_STRIDE = 100000
+
+    BINDIRS = {
+        2: {"dll": "win64", "so": "linux64", "dylib": "darwin64"},
+        3: {"dll": "x86_64-windows", "so": "x86_64-linux", "dylib": "aarch64-darwin"}
+    }
+
+    def __init__(self, name: str, fmi_version=3, cost=0, step_size=1e-3, period=0, forward=False,
+                 model_exchange=False):
+        if model_exchange and fmi_version != 3:
+            raise SyntheticError("Model Exchange needs FMI-3.0")
+        self.name = name
+        self.fmi_version = fmi_version
+        self.cost = cost
+        self.step_size = step_size
+        self.period = period
+        self.forward = forward
+        self.model_exchange = model_exchange
+        self.guid = "{" + str(uuid.uuid5(uuid.NAMESPACE_URL, f"synthetic/{name}")) + "}"
+        # type_name -> [nb_inputs, nb_outputs, dimension (payload size for Binary)]
+        self.ports: Dict[str, List[int]] = {type_name: [0, 0, 1] for type_name in self.TYPES}
+
+    def set_ports(self, type_name: str, nb_inputs: int, nb_outputs: int, dimension=1):
+        if self.fmi_version == 2:
+            if type_name not in self.FMI2_TYPES:
+                raise SyntheticError(f"{type_name} ports are not supported with FMI-2.0")
+            if dimension > 1:
+                raise SyntheticError(f"Arrays are not supported with FMI-2.0")
+        self.ports[type_name] = [nb_inputs, nb_outputs, dimension]
+
+    @staticmethod
+    def input_name(type_name: str, k: int) -> str:
+        return f"in_{type_name.lower()}_{k}"
+
+    @staticmethod
+    def output_name(type_name: str, k: int) -> str:
+        return f"out_{type_name.lower()}_{k}"
+
+    def vr(self, type_name: str, k: int) -> int:
+        return self.TYPES.index(type_name) * self.VR_STRIDE + k
+
+    def clock_vr(self, k: int, causality: str) -> int:
+        nb_inputs, nb_outputs, _ = self.ports["Clock"]
+        if causality == "input":
+            return self.vr("Clock", k % nb_inputs)
+        else:
+            return self.vr("Clock", nb_inputs + k % nb_outputs)
+
+    @property
+    def filename(self) -> str:
+        return f"{self.name}.fmu"
+
+    def write_txt(self, file):
+        print(f"# Busy-loop iterations per step", file=file)
+        print(f"{self.cost}", file=file)
+        print(f"# Output clocks period (in steps, 0: triggered only) and forwarding of input clocks (0/1)", file=file)
+        print(f"{self.period} {int(self.forward)}", file=file)
+        print(f"# Model Exchange: Float64 outputs are continuous states with der(x) = sum(inputs) - x (0/1)", file=file)
+        print(f"{int(self.model_exchange)}", file=file)
+        print(f"# <TYPE> <NB_INPUTS> <NB_OUTPUTS> <DIMENSION (payload size for Binary)>", file=file)
+        for type_name in self.TYPES:
+            nb_inputs, nb_outputs, dimension = self.ports[type_name]
+            print(f"{type_name} {nb_inputs} {nb_outputs} {dimension}", file=file)
+
+    def variables(self):
+        for type_name in self.TYPES:
+            nb_inputs, nb_outputs, dimension = self.ports[type_name]
+            for k in range(nb_inputs + nb_outputs):
+                if k < nb_inputs:
+                    yield type_name, self.input_name(type_name, k), self.vr(type_name, k), "input", k, dimension
+                else:
+                    yield (type_name, self.output_name(type_name, k - nb_inputs), self.vr(type_name, k), "output",
+                           k - nb_inputs, dimension)
+
+    def write_xml_2(self, file):
+        print(f'<?xml version="1.0" encoding="UTF-8"?>\n'
+              f'<fmiModelDescription fmiVersion="2.0" modelName="{self.name}" guid="{self.guid}"\n'
+              f'  generationTool="synthetic.py" variableNamingConvention="flat" numberOfEventIndicators="0">\n'
+              f'  <CoSimulation modelIdentifier="synthetic" needsExecutionTool="false"\n'
+              f'    canHandleVariableCommunicationStepSize="true" canBeInstantiatedOnlyOncePerProcess="false"\n'
+              f'    canGetAndSetFMUstate="true" canSerializeFMUstate="true"\n'
+              f'    canInterpolateInputs="true" maxOutputDerivativeOrder="1"/>\n'
+              f'  <DefaultExperiment startTime="0" stepSize="{self.step_size}"/>\n'
+              f'  <ModelVariables>', file=file)
+        outputs = []
+        for index, (type_name, name, vr, causality, _, _) in enumerate(self.variables(), start=1):
+            variability = "continuous" if type_name == "Float64" else "discrete"
+            if causality == "input":
+                print(f'    <ScalarVariable name="{name}" valueReference="{vr}" causality="input" '
+                      f'variability="{variability}"><{self.FMI2_TYPES[type_name]} start="0"/></ScalarVariable>',
+                      file=file)
+            else:
+                outputs.append(index)
+                print(f'    <ScalarVariable name="{name}" valueReference="{vr}" causality="output" '
+                      f'variability="{variability}" initial="calculated"><{self.FMI2_TYPES[type_name]}/>'
+                      f'</ScalarVariable>', file=file)
+        print(f'  </ModelVariables>\n'
+              f'  <ModelStructure>', file=file)
+        if outputs:
+            print(f'    <Outputs>', file=file)
+            for index in outputs:
+                print(f'      <Unknown index="{index}"/>', file=file)
+            print(f'    </Outputs>\n'
+                  f'    <InitialUnknowns>', file=file)
+            for index in outputs:
+                print(f'      <Unknown index="{index}"/>', file=file)
+            print(f'    </InitialUnknowns>', file=file)
+        print(f'  </ModelStructure>\n'
+              f'</fmiModelDescription>', file=file)
+
+    def write_xml_3(self, file):
+        if self.model_exchange:
+            interfaces = (f'  <ModelExchange modelIdentifier="synthetic" needsExecutionTool="false"\n'
+                          f'    canBeInstantiatedOnlyOncePerProcess="false"\n'
+                          f'    canGetAndSetFMUState="true" canSerializeFMUState="true"/>\n')
+        else:
+            interfaces = (f'  <CoSimulation modelIdentifier="synthetic" needsExecutionTool="false"\n'
+                          f'    canHandleVariableCommunicationStepSize="true" canBeInstantiatedOnlyOncePerProcess="false"\n'
+                          f'    canGetAndSetFMUState="true" canSerializeFMUState="true" hasEventMode="true"\n'
+                          f'    maxOutputDerivativeOrder="1"/>\n'
+                          f'  <ScheduledExecution modelIdentifier="synthetic" needsExecutionTool="false"\n'
+                          f'    canBeInstantiatedOnlyOncePerProcess="false"/>\n')
+        print(f'<?xml version="1.0" encoding="UTF-8"?>\n'
+              f'<fmiModelDescription fmiVersion="3.0" modelName="{self.name}" instantiationToken="{self.guid}"\n'
+              f'  generationTool="synthetic.py" variableNamingConvention="flat">\n'
+              f'{interfaces}'
+              f'  <DefaultExperiment startTime="0" stepSize="{self.step_size}"/>\n'
+              f'  <ModelVariables>\n'
+              f'    <Float64 name="time" valueReference="{len(self.TYPES) * self.VR_STRIDE}" '
+              f'causality="independent" variability="continuous"/>', file=file)
+        outputs = []
+        states = []
+        for type_name, name, vr, causality, k, dimension in self.variables():
+            if causality == "output":
+                outputs.append(vr)
+            if type_name == "Clock":
+                print(f'    <Clock name="{name}" valueReference="{vr}" causality="{causality}" '
+                      f'intervalVariability="triggered"/>', file=file)
+            elif type_name == "Binary":
+                if self.ports["Clock"][0 if causality == "input" else 1]:
+                    clocks = f' clocks="{self.clock_vr(k, causality)}"'
+                else:
+                    clocks = ""
+                if causality == "input":
+                    print(f'    <Binary name="{name}" valueReference="{vr}" causality="input" variability="discrete" '
+                          f'maxSize="{dimension}"{clocks}>\n'
+                          f'      <Start value=""/>\n'
+                          f'    </Binary>', file=file)
+                else:
+                    print(f'    <Binary name="{name}" valueReference="{vr}" causality="output" variability="discrete" '
+                          f'initial="calculated" maxSize="{dimension}"{clocks}/>', file=file)
+            else:
+                variability = "continuous" if type_name == "Float64" else "discrete"
+                if causality == "input":
+                    value = "false" if type_name == "Boolean" else "0"
+                    start = ' start="' + " ".join([value] * dimension) + '"'
+                elif self.model_exchange and type_name == "Float64":
+                    start = ' initial="exact" start="' + " ".join(["1"] * dimension) + '"'
+                    states.append((name, vr, k, dimension))
+                else:
+                    start = ' initial="calculated"'
+                if dimension > 1:
+                    print(f'    <{type_name} name="{name}" valueReference="{vr}" causality="{causality}" '
+                          f'variability="{variability}"{start}>\n'
+                          f'      <Dimension start="{dimension}"/>\n'
+                          f'    </{type_name}>', file=file)
+                else:
+                    print(f'    <{type_name} name="{name}" valueReference="{vr}" causality="{causality}" '
+                          f'variability="{variability}"{start}/>', file=file)
+        # Derivatives follow "time"
+        derivatives = []
+        for name, vr, k, dimension in states:
+            der_vr = (len(self.TYPES) + 1) * self.VR_STRIDE + k
+            derivatives.append(der_vr)
+            if dimension > 1:
+                print(f'    <Float64 name="der({name})" valueReference="{der_vr}" causality="local" '
+                      f'variability="continuous" derivative="{vr}">\n'
+                      f'      <Dimension start="{dimension}"/>\n'
+                      f'    </Float64>', file=file)
+            else:
+                print(f'    <Float64 name="der({name})" valueReference="{der_vr}" causality="local" '
+                      f'variability="continuous" derivative="{vr}"/>', file=file)
+        print(f'  </ModelVariables>\n'
+              f'  <ModelStructure>', file=file)
+        for vr in outputs:
+            print(f'    <Output valueReference="{vr}"/>', file=file)
+        for vr in derivatives:
+            print(f'    <ContinuousStateDerivative valueReference="{vr}"/>', file=file)
+        state_vrs = [vr for _, vr, _, _ in states]
+        for vr in outputs:
+            if vr not in state_vrs:
+                print(f'    <InitialUnknown valueReference="{vr}"/>', file=file)
+        print(f'  </ModelStructure>\n'
+              f'</fmiModelDescription>', file=file)
+
+    def make_fmu(self, directory: Path, library: Path) -> Path:
+        suffix = library.suffix[1:]
+        try:
+            bindir = self.BINDIRS[self.fmi_version][suffix]
+        except KeyError:
+            raise SyntheticError(f"Cannot deduce platform of '{library}'")
+
+        fmu_filename = directory / self.filename
+        with zipfile.ZipFile(fmu_filename, "w", zipfile.ZIP_DEFLATED) as zip_file:
+            with io.TextIOWrapper(zip_file.open("modelDescription.xml", "w"), encoding="utf-8") as file:
+                if self.fmi_version == 2:
+                    self.write_xml_2(file)
+                else:
+                    self.write_xml_3(file)
+            with io.TextIOWrapper(zip_file.open("resources/synthetic.txt", "w"), encoding="utf-8") as file:
+                self.write_txt(file)
+            zip_file.write(library, f"binaries/{bindir}/synthetic.{suffix}")
+
+        return fmu_filename
+
+
+class SyntheticAssembly:
+    """Set of synthetic FMUs connected according to a topology.
+
+    Topologies:
+        chain: output k of FMU #i feeds input k of FMU #i+1.
+        star: FMU #0 broadcasts its outputs to all other FMUs and gathers all their outputs.
+        full: each FMU gathers the outputs of all the other FMUs.
+        bus: LS-BUS like topology. A bus FMU forwards clocked binary frames sent by all nodes (FMI-3.0 only).
+    """
+
+    TOPOLOGIES = ("chain", "star", "full", "bus")
+
+    def __init__(self, topology: str, nb_fmu: int, fmi_version=3, cost=0, step_size=1e-3,
+                 nb_ports=1, types=("Float64",), dimension=1, payload=64, period=10):
+        if topology not in self.TOPOLOGIES:
+            raise SyntheticError(f"Unknown topology '{topology}'. Supported: {', '.join(self.TOPOLOGIES)}")
+        if nb_fmu < 2:
+            raise SyntheticError("At least 2 FMU's are needed")
+        if topology == "bus" and fmi_version != 3:
+            raise SyntheticError("Topology 'bus' needs FMI-3.0")
+
+        self.topology = topology
+        self.step_size = step_size
+        self.fmus: List[SyntheticFMU] = []
+        self.links: List[Tuple[str, str, str, str]] = []
+
+        if topology == "bus":
+            bus = SyntheticFMU("bus", fmi_version=fmi_version, cost=cost, step_size=step_size, forward=True)
+            self.fmus.append(bus)
+            for i in range(1, nb_fmu):
+                node = SyntheticFMU(f"node{i:03d}", fmi_version=fmi_version, cost=cost, step_size=step_size,
+                                    period=period)
+                node.set_ports("Binary", 1, 1, payload)
+                node.set_ports("Clock", 1, 1)
+                self.fmus.append(node)
+                for type_name in ("Binary", "Clock"):
+                    self.add_link(node, SyntheticFMU.output_name(type_name, 0),
+                                  bus, SyntheticFMU.input_name(type_name, i - 1))
+                    self.add_link(bus, SyntheticFMU.output_name(type_name, i - 1),
+                                  node, SyntheticFMU.input_name(type_name, 0))
+            bus.set_ports("Binary", nb_fmu - 1, nb_fmu - 1, payload)
+            bus.set_ports("Clock", nb_fmu - 1, nb_fmu - 1)
+            return
+
+        for i in range(nb_fmu):
+            self.fmus.append(SyntheticFMU(f"fmu{i:03d}", fmi_version=fmi_version, cost=cost, step_size=step_size))
+
+        for type_name in types:
+            for i, fmu in enumerate(self.fmus):
+                if topology == "chain":
+                    fmu.set_ports(type_name, nb_ports, nb_ports, dimension)
+                elif topology == "star":
+                    nb_inputs = nb_ports * (nb_fmu - 1) if i == 0 else nb_ports
+                    fmu.set_ports(type_name, nb_inputs, nb_ports, dimension)
+                else:
+                    fmu.set_ports(type_name, nb_ports * (nb_fmu - 1), nb_ports, dimension)
+
+            for k in range(nb_ports):
+                output_name = SyntheticFMU.output_name(type_name, k)
+                if topology == "chain":
+                    for i in range(nb_fmu - 1):
+                        self.add_link(self.fmus[i], output_name,
+                                      self.fmus[i + 1], SyntheticFMU.input_name(type_name, k))
+                elif topology == "star":
+                    for i in range(1, nb_fmu):
+                        self.add_link(self.fmus[0], output_name,
+                                      self.fmus[i], SyntheticFMU.input_name(type_name, k))
+                        self.add_link(self.fmus[i], output_name,
+                                      self.fmus[0], SyntheticFMU.input_name(type_name, (i - 1) * nb_ports + k))
+                else:
+                    for i in range(nb_fmu):
+                        for j in range(nb_fmu):
+                            if i != j:
+                                index = j if j < i else j - 1
+                                self.add_link(self.fmus[j], output_name,
+                                              self.fmus[i], SyntheticFMU.input_name(type_name, index * nb_ports + k))
+
+    def add_link(self, fmu_from: SyntheticFMU, port_from: str, fmu_to: SyntheticFMU, port_to: str):
+        self.links.append((fmu_from.filename, port_from, fmu_to.filename, port_to))
+
+    @property
+    def name(self) -> str:
+        return f"synthetic-{self.topology}"
+
+    def make_json(self, directory: Path, mt=False, profiling=False, sequential=False) -> Path:
+        json_filename = directory / f"{self.name}.json"
+        data = {
+            "name": f"{self.name}.fmu",
+            "fmu": [fmu.filename for fmu in self.fmus],
+            "link": [list(link) for link in self.links],
+            "mt": mt,
+            "profiling": profiling,
+            "sequential": sequential,
+            "auto_input": False,
+            "auto_output": False,
+            "auto_link": False,
+            "step_size": self.step_size
+        }
+        with open(json_filename, "wt") as file:
+            json.dump(data, file, indent=2)
+
+        return json_filename
+
+    def make(self, directory: Path, library: Path, mt=False, profiling=False, sequential=False) -> Path:
+        directory.mkdir(parents=True, exist_ok=True)
+        for fmu in self.fmus:
+            fmu.make_fmu(directory, library)
+        return self.make_json(directory, mt=mt, profiling=profiling, sequential=sequential)
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="synthetic", description="Generate synthetic FMU's and container assembly",
+                                     formatter_class=argparse.ArgumentDefaultsHelpFormatter, add_help=False)
+    parser.add_argument('-h', '-help', action="help")
+    parser.add_argument("-library", action="store", dest="library", required=True,
+                        help="synthetic library built by CMake (synthetic.so, .dll or .dylib).")
+    parser.add_argument("-topology", action="store", dest="topology", default="chain",
+                        choices=SyntheticAssembly.TOPOLOGIES, help="How embedded FMU's are connected.")
+    parser.add_argument("-nb-fmu", action="store", dest="nb_fmu", type=int, default=4,
+                        help="Number of embedded FMU's.")
+    parser.add_argument("-fmi", action="store", dest="fmi_version", type=int, default=3, choices=(2, 3),
+                        help="FMI version of the synthetic FMU's.")
+    parser.add_argument("-cost", action="store", dest="cost", type=int, default=0,
+                        help="Busy-loop iterations per step of each FMU.")
+    parser.add_argument("-ports", action="store", dest="nb_ports", type=int, default=1,
+                        help="Number of output ports per type and per FMU.")
+    parser.add_argument("-types", action="store", dest="types", default="Float64",
+                        help="Comma separated list of port types among Float64, Int32, Boolean.")
+    parser.add_argument("-dimension", action="store", dest="dimension", type=int, default=1,
+                        help="Array dimension of ports (FMI-3.0 only).")
+    parser.add_argument("-payload", action="store", dest="payload", type=int, default=64,
+                        help="Size of binary frames for 'bus' topology.")
+    parser.add_argument("-period", action="store", dest="period", type=int, default=10,
+                        help="Nodes send a frame every PERIOD steps for 'bus' topology.")
+    parser.add_argument("-step-size", action="store", dest="step_size", type=float, default=1e-3,
+                        help="Step size of FMU's and container.")
+    parser.add_argument("-output-directory", action="store", dest="directory", default=".",
+                        help="Directory where FMU's and JSON file are generated.")
+    parser.add_argument("-mt", action="store_true", dest="mt", default=False, help="Container use MT mode.")
+    parser.add_argument("-profile", action="store_true", dest="profiling", default=False,
+                        help="Container use profiling mode.")
+    parser.add_argument("-sequential", action="store_true", dest="sequential", default=False,
+                        help="Container use sequential mode.")
+    config = parser.parse_args(sys.argv[1:])
+
+    try:
+        assembly = SyntheticAssembly(config.topology, config.nb_fmu, fmi_version=config.fmi_version,
+                                     cost=config.cost, step_size=config.step_size, nb_ports=config.nb_ports,
+                                     types=config.types.split(","), dimension=config.dimension,
+                                     payload=config.payload, period=config.period)
+        json_filename = assembly.make(Path(config.directory), Path(config.library), mt=config.mt,
+                                      profiling=config.profiling, sequential=config.sequential)
+    except SyntheticError as e:
+        print(f"ERROR: {e}")
+        sys.exit(1)
+
+    print(f"'{json_filename}' is available. Build container with:")
+    print(f"  fmucontainer -fmu-directory {config.directory} -container {json_filename.name} -fmi {config.fmi_version}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,891 @@
+#ifdef WIN32
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "config.h"
+#include "container.h"
+#include "integrator.h"
+#include "logger.h"
+#include "thread.h"
+
+/*
+ * Checkpoint of a container. The state of each embedded FMU is got (or set) by its own
+ * thread in MT mode, so that capturing and restoring costs as much as the slowest FMU.
+ * Local variables and time counters are copied by the calling thread meanwhile.
+ */
+
+
+/*----------------------------------------------------------------------------
+                                   J O B S
+----------------------------------------------------------------------------*/
+
+/* FMUs flagged in keep (if not NULL) are left untouched */
+static void checkpoint_dispatch(container_t *container, checkpoint_t *checkpoint, fmu_job_t job, const bool *keep) {
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        container->fmu[i].job = job;
+        container->fmu[i].state = checkpoint->fmu_states[i];
+    }
+
+    if (container_use_threads(container)) {
+        logger_defer(&container->logger, true);
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            if (!keep || !keep[i])
+                thread_mutex_unlock(&container->fmu[i].mutex_container);
+        }
+    } else {
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            if (!keep || !keep[i])
+                fmu_do_job(&container->fmu[i]);
+        }
+    }
+
+    return;
+}
+
+
+static fmu_status_t checkpoint_wait(container_t *container, checkpoint_t *checkpoint, const bool *keep) {
+    fmu_status_t status = FMU_STATUS_OK;
+
+    if (container_use_threads(container)) {
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            if (!keep || !keep[i])
+                thread_mutex_lock(&container->fmu[i].mutex_fmu);
+        }
+        logger_defer(&container->logger, false);
+    }
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        fmu_t *fmu = &container->fmu[i];
+
+        if (keep && keep[i]) {
+            fmu->state = NULL;
+            fmu->job = FMU_JOB_STEP;
+            continue;
+        }
+
+        checkpoint->fmu_states[i] = fmu->state;
+        fmu->state = NULL;
+        fmu->job = FMU_JOB_STEP;
+        if (fmu->status != FMU_STATUS_OK)
+            status = FMU_STATUS_ERROR;
+    }
+
+    return status;
+}
+
+
+/*----------------------------------------------------------------------------
+                            L O C A L   C O P Y
+----------------------------------------------------------------------------*/
+
+/* A NULL string (never set) is copied as NULL */
+static int checkpoint_copy_strings(char **to, char * const *from, unsigned long nb) {
+    for (unsigned long i = 0; i < nb; i += 1) {
+        char *value = NULL;
+        if (from[i]) {
+            value = strdup(from[i]);
+            if (!value)
+                return -1;
+        }
+        free(to[i]);
+        to[i] = value;
+    }
+
+    return 0;
+}
+
+
+static int checkpoint_copy_binaries(fmu_binary_t *to, const fmu_binary_t *from, unsigned long nb) {
+    for (unsigned long i = 0; i < nb; i += 1) {
+        if (to[i].max_size < from[i].size) {
+            uint8_t *data = realloc(to[i].data, from[i].size);
+            if (!data)
+                return -1;
+            to[i].data = data;
+            to[i].max_size = from[i].size;
+        }
+        to[i].size = from[i].size;
+        if (from[i].size)
+            memcpy(to[i].data, from[i].data, from[i].size);
+    }
+
+    return 0;
+}
+
+
+static int checkpoint_save_locals(const container_t *container, checkpoint_t *checkpoint) {
+#define SAVE(type)                                                                          \
+    if (container->nb_local_ ## type)                                                       \
+        memcpy(checkpoint-> type, container-> type,                                         \
+               container->nb_local_ ## type * sizeof(*container-> type))
+
+    SAVE(reals64);
+    SAVE(reals32);
+    SAVE(integers8);
+    SAVE(uintegers8);
+    SAVE(integers16);
+    SAVE(uintegers16);
+    SAVE(integers32);
+    SAVE(uintegers32);
+    SAVE(integers64);
+    SAVE(uintegers64);
+    SAVE(booleans);
+    SAVE(booleans1);
+    SAVE(clocks);
+#undef SAVE
+
+    if (checkpoint_copy_strings(checkpoint->strings, container->strings, container->nb_local_strings) ||
+        checkpoint_copy_binaries(checkpoint->binaries, container->binaries, container->nb_local_binaries))
+        return -1;
+
+    if (checkpoint->nb_clocks_next_tick)
+        memcpy(checkpoint->clocks_next_tick, container->clocks_list.next_tick,
+               checkpoint->nb_clocks_next_tick * sizeof(*checkpoint->clocks_next_tick));
+    checkpoint->nb_next_clocks = container->clocks_list.nb_next_clocks;
+    if (checkpoint->nb_next_clocks)
+        memcpy(checkpoint->next_clocks, container->clocks_list.next_clocks,
+               checkpoint->nb_next_clocks * sizeof(*checkpoint->next_clocks));
+
+    if (checkpoint->nb_extrapolation)
+        memcpy(checkpoint->extrapolation_history, container->extrapolation.history,
+               checkpoint->nb_extrapolation * CONTAINER_EXTRAPOLATION_SAMPLES * sizeof(*checkpoint->extrapolation_history));
+    checkpoint->extrapolation_nb_samples = container->extrapolation.nb_samples;
+    memcpy(checkpoint->extrapolation_time, container->extrapolation.time, sizeof(checkpoint->extrapolation_time));
+
+    if (checkpoint->nb_adaptive)
+        memcpy(checkpoint->adaptive_history, container->adaptive.history,
+               checkpoint->nb_adaptive * CONTAINER_ADAPTIVE_SAMPLES * sizeof(*checkpoint->adaptive_history));
+    checkpoint->adaptive_multiplier = container->adaptive.multiplier;
+    checkpoint->adaptive_nb_samples = container->adaptive.nb_samples;
+    memcpy(checkpoint->adaptive_time, container->adaptive.time, sizeof(checkpoint->adaptive_time));
+
+    if (checkpoint->nb_integrator) {
+        memcpy(checkpoint->integrator_next_event_time, container->integrator->next_event_time,
+               checkpoint->nb_integrator * sizeof(*checkpoint->integrator_next_event_time));
+        checkpoint->integrator_h = container->integrator->h;
+    }
+
+    checkpoint->state = container->state;
+    checkpoint->start_time = container->start_time;
+    checkpoint->time = container->time;
+    checkpoint->nb_steps = container->nb_steps;
+    checkpoint->next_step = container->next_step;
+    checkpoint->need_event_update = container->need_event_update;
+
+    return 0;
+}
+
+
+static int checkpoint_restore_locals(container_t *container, const checkpoint_t *checkpoint) {
+#define RESTORE(type)                                                                       \
+    if (container->nb_local_ ## type)                                                       \
+        memcpy(container-> type, checkpoint-> type,                                         \
+               container->nb_local_ ## type * sizeof(*container-> type))
+
+    RESTORE(reals64);
+    RESTORE(reals32);
+    RESTORE(integers8);
+    RESTORE(uintegers8);
+    RESTORE(integers16);
+    RESTORE(uintegers16);
+    RESTORE(integers32);
+    RESTORE(uintegers32);
+    RESTORE(integers64);
+    RESTORE(uintegers64);
+    RESTORE(booleans);
+    RESTORE(booleans1);
+    RESTORE(clocks);
+#undef RESTORE
+
+    if (checkpoint_copy_strings(container->strings, checkpoint->strings, container->nb_local_strings) ||
+        checkpoint_copy_binaries(container->binaries, checkpoint->binaries, container->nb_local_binaries))
+        return -1;
+
+    if (checkpoint->nb_clocks_next_tick)
+        memcpy(container->clocks_list.next_tick, checkpoint->clocks_next_tick,
+               checkpoint->nb_clocks_next_tick * sizeof(*checkpoint->clocks_next_tick));
+    container_clocks_schedule(container);
+    container->clocks_list.nb_next_clocks = checkpoint->nb_next_clocks;
+    if (checkpoint->nb_next_clocks)
+        memcpy(container->clocks_list.next_clocks, checkpoint->next_clocks,
+               checkpoint->nb_next_clocks * sizeof(*checkpoint->next_clocks));
+
+    if (checkpoint->nb_extrapolation)
+        memcpy(container->extrapolation.history, checkpoint->extrapolation_history,
+               checkpoint->nb_extrapolation * CONTAINER_EXTRAPOLATION_SAMPLES * sizeof(*checkpoint->extrapolation_history));
+    container->extrapolation.nb_samples = checkpoint->extrapolation_nb_samples;
+    memcpy(container->extrapolation.time, checkpoint->extrapolation_time, sizeof(container->extrapolation.time));
+
+    if (checkpoint->nb_adaptive)
+        memcpy(container->adaptive.history, checkpoint->adaptive_history,
+               checkpoint->nb_adaptive * CONTAINER_ADAPTIVE_SAMPLES * sizeof(*checkpoint->adaptive_history));
+    container->adaptive.multiplier = checkpoint->adaptive_multiplier;
+    container->adaptive.nb_samples = checkpoint->adaptive_nb_samples;
+    memcpy(container->adaptive.time, checkpoint->adaptive_time, sizeof(container->adaptive.time));
+
+    /* States of Model-Exchange FMUs have been set: integrator reads them back */
+    if (checkpoint->nb_integrator) {
+        memcpy(container->integrator->next_event_time, checkpoint->integrator_next_event_time,
+               checkpoint->nb_integrator * sizeof(*checkpoint->integrator_next_event_time));
+        container->integrator->h = checkpoint->integrator_h;
+        container->integrator->restart = true;
+    }
+
+    container->state = checkpoint->state;
+    container->start_time = checkpoint->start_time;
+    container->time = checkpoint->time;
+    container->nb_steps = checkpoint->nb_steps;
+    container->next_step = checkpoint->next_step;
+    container->need_event_update = checkpoint->need_event_update;
+
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------
+                            C H E C K P O I N T
+----------------------------------------------------------------------------*/
+
+static checkpoint_t *checkpoint_alloc(container_t *container) {
+    checkpoint_t *checkpoint = calloc(1, sizeof(*checkpoint));
+    if (!checkpoint)
+        return NULL;
+
+    checkpoint->nb_fmu = container->nb_fmu;
+    checkpoint->fmu_states = calloc(container->nb_fmu, sizeof(*checkpoint->fmu_states));
+    if (!checkpoint->fmu_states)
+        goto error;
+
+#define ALLOC(type)                                                                         \
+    checkpoint->nb_local_ ## type = container->nb_local_ ## type;                           \
+    if (checkpoint->nb_local_ ## type) {                                                    \
+        checkpoint-> type = calloc(checkpoint->nb_local_ ## type, sizeof(*checkpoint-> type)); \
+        if (!checkpoint-> type)                                                             \
+            goto error;                                                                     \
+    }
+
+    ALLOC(reals64);
+    ALLOC(reals32);
+    ALLOC(integers8);
+    ALLOC(uintegers8);
+    ALLOC(integers16);
+    ALLOC(uintegers16);
+    ALLOC(integers32);
+    ALLOC(uintegers32);
+    ALLOC(integers64);
+    ALLOC(uintegers64);
+    ALLOC(booleans);
+    ALLOC(booleans1);
+    ALLOC(strings);
+    ALLOC(binaries);
+    ALLOC(clocks);
+#undef ALLOC
+
+    checkpoint->nb_clocks_next_tick = container->clocks_list.nb_local_clocks;
+    if (checkpoint->nb_clocks_next_tick) {
+        checkpoint->clocks_next_tick = calloc(checkpoint->nb_clocks_next_tick, sizeof(*checkpoint->clocks_next_tick));
+        checkpoint->next_clocks = calloc(checkpoint->nb_clocks_next_tick, sizeof(*checkpoint->next_clocks));
+        if (!checkpoint->clocks_next_tick || !checkpoint->next_clocks)
+            goto error;
+    }
+
+    checkpoint->nb_extrapolation = container->extrapolation.nb;
+    if (checkpoint->nb_extrapolation) {
+        checkpoint->extrapolation_history = calloc(checkpoint->nb_extrapolation * CONTAINER_EXTRAPOLATION_SAMPLES,
+                                                   sizeof(*checkpoint->extrapolation_history));
+        if (!checkpoint->extrapolation_history)
+            goto error;
+    }
+
+    checkpoint->nb_adaptive = container->adaptive.nb;
+    if (checkpoint->nb_adaptive) {
+        checkpoint->adaptive_history = calloc(checkpoint->nb_adaptive * CONTAINER_ADAPTIVE_SAMPLES,
+                                              sizeof(*checkpoint->adaptive_history));
+        if (!checkpoint->adaptive_history)
+            goto error;
+    }
+
+    checkpoint->nb_integrator = container->integrator ? container->integrator->nb_fmu : 0;
+    if (checkpoint->nb_integrator) {
+        checkpoint->integrator_next_event_time = calloc(checkpoint->nb_integrator,
+                                                        sizeof(*checkpoint->integrator_next_event_time));
+        if (!checkpoint->integrator_next_event_time)
+            goto error;
+    }
+
+    return checkpoint;
+
+error:
+    checkpoint_free(container, checkpoint);
+    return NULL;
+}
+
+
+checkpoint_t *checkpoint_new(container_t *container) {
+    checkpoint_t *checkpoint = checkpoint_alloc(container);
+
+    if (!checkpoint || checkpoint_get(container, checkpoint) != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot get state of container.");
+        checkpoint_free(container, checkpoint);
+        return NULL;
+    }
+
+    return checkpoint;
+}
+
+
+fmu_status_t checkpoint_get(container_t *container, checkpoint_t *checkpoint) {
+    checkpoint_dispatch(container, checkpoint, FMU_JOB_GET_STATE, NULL);
+    const int copied = checkpoint_save_locals(container, checkpoint);
+    fmu_status_t status = checkpoint_wait(container, checkpoint, NULL);
+
+    if (copied) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot copy local variables of container.");
+        status = FMU_STATUS_ERROR;
+    }
+
+    return status;
+}
+
+
+fmu_status_t checkpoint_set(container_t *container, const checkpoint_t *checkpoint) {
+    return checkpoint_rollback(container, checkpoint, NULL);
+}
+
+
+/*
+ * Same as checkpoint_set() but FMUs flagged in keep (if not NULL) keep their current state.
+ * Local variables and time counters are always restored.
+ */
+fmu_status_t checkpoint_rollback(container_t *container, const checkpoint_t *checkpoint, const bool *keep) {
+    /* FMUs states are given to the jobs but not modified */
+    checkpoint_dispatch(container, (checkpoint_t *)checkpoint, FMU_JOB_SET_STATE, keep);
+    const int copied = checkpoint_restore_locals(container, checkpoint);
+    fmu_status_t status = checkpoint_wait(container, (checkpoint_t *)checkpoint, keep);
+
+    if (copied) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot restore local variables of container.");
+        status = FMU_STATUS_ERROR;
+    }
+
+    /* Derivatives are not part of the state: they are queried again */
+    if ((status == FMU_STATUS_OK) && (checkpoint->state == CONTAINER_STATE_STEP_MODE)) {
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            status = fmu_get_output_derivatives(&container->fmu[i]);
+            if (status != FMU_STATUS_OK)
+                break;
+        }
+    }
+
+    return status;
+}
+
+
+void checkpoint_free(container_t *container, checkpoint_t *checkpoint) {
+    if (!checkpoint)
+        return;
+
+    if (checkpoint->fmu_states) {
+        checkpoint_dispatch(container, checkpoint, FMU_JOB_FREE_STATE, NULL);
+        checkpoint_wait(container, checkpoint, NULL);
+        free(checkpoint->fmu_states);
+    }
+
+    free(checkpoint->reals64);
+    free(checkpoint->reals32);
+    free(checkpoint->integers8);
+    free(checkpoint->uintegers8);
+    free(checkpoint->integers16);
+    free(checkpoint->uintegers16);
+    free(checkpoint->integers32);
+    free(checkpoint->uintegers32);
+    free(checkpoint->integers64);
+    free(checkpoint->uintegers64);
+    free(checkpoint->booleans);
+    free(checkpoint->booleans1);
+    if (checkpoint->strings) {
+        for (unsigned long i = 0; i < checkpoint->nb_local_strings; i += 1)
+            free(checkpoint->strings[i]);
+        free(checkpoint->strings);
+    }
+    if (checkpoint->binaries) {
+        for (unsigned long i = 0; i < checkpoint->nb_local_binaries; i += 1)
+            free(checkpoint->binaries[i].data);
+        free(checkpoint->binaries);
+    }
+    free(checkpoint->clocks);
+    free(checkpoint->clocks_next_tick);
+    free(checkpoint->next_clocks);
+    free(checkpoint->extrapolation_history);
+    free(checkpoint->adaptive_history);
+    free(checkpoint->integrator_next_event_time);
+
+    free(checkpoint);
+
+    return;
+}
+
+
+/*----------------------------------------------------------------------------
+                            S E R I A L I Z E
+----------------------------------------------------------------------------*/
+
+#define CHECKPOINT_ALIGN(size)  (((size) + 7) & ~(size_t)7)
+
+typedef struct {
+    uint8_t                     *buffer;        /* NULL: only compute size */
+    size_t                      offset;
+} checkpoint_writer_t;
+
+
+static void checkpoint_write(checkpoint_writer_t *writer, const void *data, size_t size) {
+    if (writer->buffer && size)
+        memcpy(writer->buffer + writer->offset, data, size);
+    writer->offset = CHECKPOINT_ALIGN(writer->offset + size);
+
+    return;
+}
+
+
+static fmu_status_t checkpoint_layout(container_t *container, const checkpoint_t *checkpoint,
+                                      checkpoint_writer_t *writer) {
+    checkpoint_header_t *header = (checkpoint_header_t *)writer->buffer;
+    checkpoint_fmu_t *fmu_table = (checkpoint_fmu_t *)(writer->buffer + sizeof(*header));
+
+    writer->offset = CHECKPOINT_ALIGN(sizeof(*header)) + CHECKPOINT_ALIGN(checkpoint->nb_fmu * sizeof(*fmu_table));
+
+    for (int i = 0; i < checkpoint->nb_fmu; i += 1) {
+        const fmu_t *fmu = &container->fmu[i];
+        size_t size;
+
+        if (fmuSerializedFMUStateSize(fmu, checkpoint->fmu_states[i], &size) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        if (writer->buffer) {
+            fmu_table[i].offset = writer->offset;
+            fmu_table[i].size = size;
+            memset(fmu_table[i].guid, 0, sizeof(fmu_table[i].guid));
+            STRLCPY(fmu_table[i].guid, fmu->guid, sizeof(fmu_table[i].guid));
+            if (fmuSerializeFMUState(fmu, checkpoint->fmu_states[i], writer->buffer + writer->offset, size) != FMU_STATUS_OK)
+                return FMU_STATUS_ERROR;
+        }
+        writer->offset = CHECKPOINT_ALIGN(writer->offset + size);
+    }
+
+#define WRITE(type) \
+    checkpoint_write(writer, checkpoint-> type, checkpoint->nb_local_ ## type * sizeof(*checkpoint-> type))
+
+    WRITE(reals64);
+    WRITE(reals32);
+    WRITE(integers8);
+    WRITE(uintegers8);
+    WRITE(integers16);
+    WRITE(uintegers16);
+    WRITE(integers32);
+    WRITE(uintegers32);
+    WRITE(integers64);
+    WRITE(uintegers64);
+    WRITE(booleans);
+    WRITE(booleans1);
+#undef WRITE
+
+    for (unsigned long i = 0; i < checkpoint->nb_local_strings; i += 1) {
+        const char *value = checkpoint->strings[i] ? checkpoint->strings[i] : "";
+        const uint64_t size = strlen(value) + 1;
+        checkpoint_write(writer, &size, sizeof(size));
+        checkpoint_write(writer, value, size);
+    }
+    for (unsigned long i = 0; i < checkpoint->nb_local_binaries; i += 1) {
+        const uint64_t size = checkpoint->binaries[i].size;
+        checkpoint_write(writer, &size, sizeof(size));
+        checkpoint_write(writer, checkpoint->binaries[i].data, size);
+    }
+
+    checkpoint_write(writer, checkpoint->clocks, checkpoint->nb_local_clocks * sizeof(*checkpoint->clocks));
+    checkpoint_write(writer, checkpoint->clocks_next_tick, checkpoint->nb_clocks_next_tick * sizeof(*checkpoint->clocks_next_tick));
+    checkpoint_write(writer, checkpoint->next_clocks, checkpoint->nb_next_clocks * sizeof(*checkpoint->next_clocks));
+    checkpoint_write(writer, checkpoint->extrapolation_history,
+                     checkpoint->nb_extrapolation * CONTAINER_EXTRAPOLATION_SAMPLES * sizeof(*checkpoint->extrapolation_history));
+    checkpoint_write(writer, checkpoint->adaptive_history,
+                     checkpoint->nb_adaptive * CONTAINER_ADAPTIVE_SAMPLES * sizeof(*checkpoint->adaptive_history));
+    checkpoint_write(writer, checkpoint->integrator_next_event_time,
+                     checkpoint->nb_integrator * sizeof(*checkpoint->integrator_next_event_time));
+
+    if (header) {
+        memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+        header->version = CHECKPOINT_VERSION;
+        header->nb_fmu = checkpoint->nb_fmu;
+        header->size = writer->offset;
+
+        int n = 0;
+#define COUNT(type) header->nb_local[n++] = checkpoint->nb_local_ ## type
+        COUNT(reals64);
+        COUNT(reals32);
+        COUNT(integers8);
+        COUNT(uintegers8);
+        COUNT(integers16);
+        COUNT(uintegers16);
+        COUNT(integers32);
+        COUNT(uintegers32);
+        COUNT(integers64);
+        COUNT(uintegers64);
+        COUNT(booleans);
+        COUNT(booleans1);
+        COUNT(strings);
+        COUNT(binaries);
+        COUNT(clocks);
+#undef COUNT
+
+        header->nb_clocks_next_tick = checkpoint->nb_clocks_next_tick;
+        header->nb_next_clocks = checkpoint->nb_next_clocks;
+        header->nb_steps = checkpoint->nb_steps;
+        header->start_time = checkpoint->start_time;
+        header->time = checkpoint->time;
+        header->next_step = checkpoint->next_step;
+        header->state = checkpoint->state;
+        header->need_event_update = checkpoint->need_event_update;
+        header->nb_extrapolation = checkpoint->nb_extrapolation;
+        header->extrapolation_nb_samples = checkpoint->extrapolation_nb_samples;
+        memcpy(header->extrapolation_time, checkpoint->extrapolation_time, sizeof(header->extrapolation_time));
+        header->nb_adaptive = checkpoint->nb_adaptive;
+        header->adaptive_multiplier = checkpoint->adaptive_multiplier;
+        header->adaptive_nb_samples = checkpoint->adaptive_nb_samples;
+        memcpy(header->adaptive_time, checkpoint->adaptive_time, sizeof(header->adaptive_time));
+        header->nb_integrator = checkpoint->nb_integrator;
+        header->integrator_h = checkpoint->integrator_h;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t checkpoint_serialized_size(container_t *container, const checkpoint_t *checkpoint, size_t *size) {
+    checkpoint_writer_t writer = { .buffer = NULL, .offset = 0 };
+
+    if (checkpoint_layout(container, checkpoint, &writer) != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot get size of serialized state of container.");
+        return FMU_STATUS_ERROR;
+    }
+    *size = writer.offset;
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t checkpoint_serialize(container_t *container, const checkpoint_t *checkpoint, uint8_t *buffer, size_t size) {
+    size_t needed;
+
+    if (checkpoint_serialized_size(container, checkpoint, &needed) != FMU_STATUS_OK)
+        return FMU_STATUS_ERROR;
+    if (size < needed) {
+        logger(&container->logger, LOGGER_ERROR, "Buffer is too small to serialize state of container (%zu < %zu bytes).",
+               size, needed);
+        return FMU_STATUS_ERROR;
+    }
+
+    checkpoint_writer_t writer = { .buffer = buffer, .offset = 0 };
+    if (checkpoint_layout(container, checkpoint, &writer) != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot serialize state of container.");
+        return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/*----------------------------------------------------------------------------
+                          D E S E R I A L I Z E
+----------------------------------------------------------------------------*/
+
+typedef struct {
+    const uint8_t               *buffer;
+    size_t                      size;
+    size_t                      offset;
+} checkpoint_reader_t;
+
+
+static const void *checkpoint_read(checkpoint_reader_t *reader, size_t size) {
+    if (size > reader->size - reader->offset)
+        return NULL;
+
+    const void *data = reader->buffer + reader->offset;
+    reader->offset = CHECKPOINT_ALIGN(reader->offset + size);
+    if (reader->offset > reader->size)
+        reader->offset = reader->size;  /* padding of the last section may be omitted */
+
+    return data;
+}
+
+
+static const char *checkpoint_check_header(const container_t *container, const checkpoint_header_t *header, size_t size) {
+    if (size < sizeof(*header) || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)))
+        return "not a container snapshot";
+    if (header->version != CHECKPOINT_VERSION)
+        return "unsupported version";
+    if (header->size > size)
+        return "truncated";
+    if (header->nb_fmu != (uint32_t)container->nb_fmu)
+        return "number of FMUs differs";
+
+    int n = 0;
+#define CHECK(type) \
+    if (header->nb_local[n++] != container->nb_local_ ## type) \
+        return "number of " #type " differs"
+
+    CHECK(reals64);
+    CHECK(reals32);
+    CHECK(integers8);
+    CHECK(uintegers8);
+    CHECK(integers16);
+    CHECK(uintegers16);
+    CHECK(integers32);
+    CHECK(uintegers32);
+    CHECK(integers64);
+    CHECK(uintegers64);
+    CHECK(booleans);
+    CHECK(booleans1);
+    CHECK(strings);
+    CHECK(binaries);
+    CHECK(clocks);
+#undef CHECK
+
+    if ((header->nb_clocks_next_tick != container->clocks_list.nb_local_clocks) ||
+        (header->nb_next_clocks > header->nb_clocks_next_tick))
+        return "number of clocks differs";
+    if ((header->nb_extrapolation != container->extrapolation.nb) ||
+        (header->extrapolation_nb_samples < 0) || (header->extrapolation_nb_samples > CONTAINER_EXTRAPOLATION_SAMPLES))
+        return "number of extrapolated links differs";
+    if ((header->nb_adaptive != container->adaptive.nb) ||
+        (header->adaptive_nb_samples < 0) || (header->adaptive_nb_samples > CONTAINER_ADAPTIVE_SAMPLES))
+        return "number of monitored outputs differs";
+    if (container->adaptive.min_multiplier &&
+        ((header->adaptive_multiplier < container->adaptive.min_multiplier) ||
+         (header->adaptive_multiplier > container->adaptive.max_multiplier)))
+        return "adaptive step out of bounds";
+    if (header->nb_integrator != (uint64_t)(container->integrator ? container->integrator->nb_fmu : 0))
+        return "number of Model-Exchange FMUs differs";
+
+    return NULL;
+}
+
+
+static const char *checkpoint_read_locals(checkpoint_t *checkpoint, checkpoint_reader_t *reader) {
+    const void *data;
+
+#define READ(type) \
+    data = checkpoint_read(reader, checkpoint->nb_local_ ## type * sizeof(*checkpoint-> type)); \
+    if (!data) \
+        return "truncated " #type; \
+    if (checkpoint->nb_local_ ## type) \
+        memcpy(checkpoint-> type, data, checkpoint->nb_local_ ## type * sizeof(*checkpoint-> type))
+
+    READ(reals64);
+    READ(reals32);
+    READ(integers8);
+    READ(uintegers8);
+    READ(integers16);
+    READ(uintegers16);
+    READ(integers32);
+    READ(uintegers32);
+    READ(integers64);
+    READ(uintegers64);
+    READ(booleans);
+    READ(booleans1);
+
+    for (unsigned long i = 0; i < checkpoint->nb_local_strings; i += 1) {
+        const uint64_t *size = checkpoint_read(reader, sizeof(*size));
+        const char *value = size ? checkpoint_read(reader, *size) : NULL;
+        if (!value || *size == 0 || value[*size - 1] != '\0')
+            return "truncated strings";
+        checkpoint->strings[i] = strdup(value);
+        if (!checkpoint->strings[i])
+            return "cannot allocate strings";
+    }
+    for (unsigned long i = 0; i < checkpoint->nb_local_binaries; i += 1) {
+        const uint64_t *size = checkpoint_read(reader, sizeof(*size));
+        const uint8_t *value = size ? checkpoint_read(reader, *size) : NULL;
+        if (!value)
+            return "truncated binaries";
+        if (*size) {
+            checkpoint->binaries[i].data = malloc(*size);
+            if (!checkpoint->binaries[i].data)
+                return "cannot allocate binaries";
+            memcpy(checkpoint->binaries[i].data, value, *size);
+        }
+        checkpoint->binaries[i].size = *size;
+        checkpoint->binaries[i].max_size = *size;
+    }
+
+    READ(clocks);
+#undef READ
+
+    data = checkpoint_read(reader, checkpoint->nb_clocks_next_tick * sizeof(*checkpoint->clocks_next_tick));
+    if (!data)
+        return "truncated clocks";
+    if (checkpoint->nb_clocks_next_tick)
+        memcpy(checkpoint->clocks_next_tick, data, checkpoint->nb_clocks_next_tick * sizeof(*checkpoint->clocks_next_tick));
+
+    data = checkpoint_read(reader, checkpoint->nb_next_clocks * sizeof(*checkpoint->next_clocks));
+    if (!data)
+        return "truncated clocks";
+    if (checkpoint->nb_next_clocks)
+        memcpy(checkpoint->next_clocks, data, checkpoint->nb_next_clocks * sizeof(*checkpoint->next_clocks));
+
+    const size_t history_size = checkpoint->nb_extrapolation * CONTAINER_EXTRAPOLATION_SAMPLES *
+                                sizeof(*checkpoint->extrapolation_history);
+    data = checkpoint_read(reader, history_size);
+    if (!data)
+        return "truncated extrapolation";
+    if (history_size)
+        memcpy(checkpoint->extrapolation_history, data, history_size);
+
+    const size_t adaptive_size = checkpoint->nb_adaptive * CONTAINER_ADAPTIVE_SAMPLES *
+                                 sizeof(*checkpoint->adaptive_history);
+    data = checkpoint_read(reader, adaptive_size);
+    if (!data)
+        return "truncated adaptive step";
+    if (adaptive_size)
+        memcpy(checkpoint->adaptive_history, data, adaptive_size);
+
+    const size_t integrator_size = checkpoint->nb_integrator * sizeof(*checkpoint->integrator_next_event_time);
+    data = checkpoint_read(reader, integrator_size);
+    if (!data)
+        return "truncated integrator";
+    if (integrator_size)
+        memcpy(checkpoint->integrator_next_event_time, data, integrator_size);
+
+    return NULL;
+}
+
+
+checkpoint_t *checkpoint_deserialize(container_t *container, const uint8_t *buffer, size_t size) {
+    const checkpoint_header_t *header = (const checkpoint_header_t *)buffer;
+    const char *reason = checkpoint_check_header(container, header, size);
+    if (reason) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot deserialize state of container: %s.", reason);
+        return NULL;
+    }
+
+    checkpoint_t *checkpoint = checkpoint_alloc(container);
+    if (!checkpoint) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot deserialize state of container: cannot allocate memory.");
+        return NULL;
+    }
+
+    checkpoint_reader_t reader = { .buffer = buffer, .size = header->size, .offset = 0 };
+    checkpoint_read(&reader, sizeof(*header));
+    const checkpoint_fmu_t *fmu_table = checkpoint_read(&reader, header->nb_fmu * sizeof(*fmu_table));
+    if (!fmu_table) {
+        reason = "truncated";
+        goto error;
+    }
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        const fmu_t *fmu = &container->fmu[i];
+
+        if (strncmp(fmu_table[i].guid, fmu->guid, sizeof(fmu_table[i].guid))) {
+            logger(&container->logger, LOGGER_ERROR, "Snapshot of FMU '%s' was taken from an other model.", fmu->name);
+            reason = "FMUs differ";
+            goto error;
+        }
+        if ((fmu_table[i].offset > header->size) || (fmu_table[i].size > header->size - fmu_table[i].offset)) {
+            reason = "truncated";
+            goto error;
+        }
+        if (fmuDeserializeFMUState(fmu, buffer + fmu_table[i].offset, fmu_table[i].size,
+                                   &checkpoint->fmu_states[i]) != FMU_STATUS_OK) {
+            reason = "cannot deserialize state of embedded FMU";
+            goto error;
+        }
+        reader.offset = CHECKPOINT_ALIGN(fmu_table[i].offset + fmu_table[i].size);
+    }
+
+    checkpoint->nb_next_clocks = header->nb_next_clocks;
+    reason = checkpoint_read_locals(checkpoint, &reader);
+    if (reason)
+        goto error;
+
+    checkpoint->state = header->state;
+    checkpoint->time = header->time;
+    checkpoint->nb_steps = header->nb_steps;
+    checkpoint->start_time = header->start_time;
+    checkpoint->next_step = header->next_step;
+    checkpoint->need_event_update = header->need_event_update;
+    checkpoint->extrapolation_nb_samples = (int)header->extrapolation_nb_samples;
+    memcpy(checkpoint->extrapolation_time, header->extrapolation_time, sizeof(checkpoint->extrapolation_time));
+    checkpoint->adaptive_multiplier = header->adaptive_multiplier;
+    checkpoint->adaptive_nb_samples = header->adaptive_nb_samples;
+    memcpy(checkpoint->adaptive_time, header->adaptive_time, sizeof(checkpoint->adaptive_time));
+    checkpoint->integrator_h = header->integrator_h;
+
+    return checkpoint;
+
+error:
+    logger(&container->logger, LOGGER_ERROR, "Cannot deserialize state of container: %s.", reason);
+    checkpoint_free(container, checkpoint);
+    return NULL;
+}
+
+
+/*
+ * Snapshot files are mapped rather than read: only pages of the snapshot which are
+ * deserialized are loaded from disk.
+ */
+checkpoint_t *checkpoint_load(container_t *container, const char *filename) {
+    checkpoint_t *checkpoint = NULL;
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot open snapshot '%s'.", filename);
+        return NULL;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    const uint8_t *buffer = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping)
+        buffer = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (buffer) {
+        checkpoint = checkpoint_deserialize(container, buffer, (size_t)size.QuadPart);
+        UnmapViewOfFile(buffer);
+    } else
+        logger(&container->logger, LOGGER_ERROR, "Cannot map snapshot '%s'.", filename);
+
+    if (mapping)
+        CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot open snapshot '%s': %s.", filename, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    void *buffer = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        buffer = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (buffer != MAP_FAILED) {
+        checkpoint = checkpoint_deserialize(container, buffer, (size_t)st.st_size);
+        munmap(buffer, (size_t)st.st_size);
+    } else
+        logger(&container->logger, LOGGER_ERROR, "Cannot map snapshot '%s'.", filename);
+
+    close(fd);
+#endif
+
+    return checkpoint;
+}
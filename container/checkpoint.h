@@ -0,0 +1,146 @@
+#ifndef CHECKPOINT_H
+#   define CHECKPOINT_H
+
+#	ifdef __cplusplus
+extern "C" {
+#	endif
+
+#include "container.h"
+
+/*----------------------------------------------------------------------------
+                          C H E C K P O I N T _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * State of a container: state of each embedded FMU, copy of local variables and of
+ * time counters. Used by fmi2GetFMUstate()/fmi3GetFMUState() and friends.
+ */
+typedef struct checkpoint_s {
+	container_state_t			state;
+	double						start_time;		/* origin of nb_steps */
+	double						time;
+	long long					nb_steps;
+	double						next_step;
+	bool						need_event_update;
+
+	int							nb_fmu;
+	void						**fmu_states;	/* fmi2FMUstate or fmi3FMUState */
+
+#define DECLARE_LOCAL(name, type) 					\
+	unsigned long				nb_local_ ## name;	\
+	type						* name
+
+	DECLARE_LOCAL(reals64, double);
+	DECLARE_LOCAL(reals32, float);
+	DECLARE_LOCAL(integers8, int8_t);
+	DECLARE_LOCAL(uintegers8, uint8_t);
+	DECLARE_LOCAL(integers16, int16_t);
+	DECLARE_LOCAL(uintegers16, uint16_t);
+	DECLARE_LOCAL(integers32, int32_t);
+	DECLARE_LOCAL(uintegers32, uint32_t);
+	DECLARE_LOCAL(integers64, int64_t);
+	DECLARE_LOCAL(uintegers64, uint64_t);
+	DECLARE_LOCAL(booleans, int);
+	DECLARE_LOCAL(booleans1, bool);
+	DECLARE_LOCAL(strings, char *);
+	DECLARE_LOCAL(binaries, fmu_binary_t);
+	DECLARE_LOCAL(clocks, bool);
+#undef DECLARE_LOCAL
+
+	unsigned long				nb_clocks_next_tick;
+	double						*clocks_next_tick;	/* clocks_list.next_tick */
+	unsigned long				nb_next_clocks;
+	container_clock_t			*next_clocks;
+
+	unsigned long				nb_extrapolation;
+	double						*extrapolation_history;
+	int							extrapolation_nb_samples;
+	double						extrapolation_time[CONTAINER_EXTRAPOLATION_SAMPLES];
+
+	unsigned long				nb_adaptive;
+	double						*adaptive_history;
+	int							adaptive_multiplier;
+	int							adaptive_nb_samples;
+	double						adaptive_time[CONTAINER_ADAPTIVE_SAMPLES];
+
+	unsigned long				nb_integrator;	/* Model-Exchange FMUs */
+	double						*integrator_next_event_time;
+	double						integrator_h;
+} checkpoint_t;
+
+
+/*----------------------------------------------------------------------------
+                            S N A P S H O T
+----------------------------------------------------------------------------*/
+
+/*
+ * Serialized checkpoint. Used by fmi2SerializeFMUstate()/fmi3SerializeFMUState() and
+ * to warm-start a container (see container.txt). Layout is:
+ *   - checkpoint_header_t
+ *   - checkpoint_fmu_t for each embedded FMU
+ *   - serialized state of each embedded FMU
+ *   - local variables in the order of checkpoint_t. Strings and binaries are stored
+ *     as their size (uint64_t) followed by their content.
+ *   - clocks_next_tick, then next_clocks
+ *   - history of extrapolated links
+ *   - history of outputs monitored by adaptive step
+ *   - next time event of each Model-Exchange FMU
+ * Each section starts at an offset aligned on 8 bytes, so that a mapped snapshot can be
+ * read in place. Values are stored with native endianness: a snapshot is only portable
+ * between builds of the same container on the same platform.
+ */
+#define CHECKPOINT_MAGIC			"FMUCSNAP"
+#define CHECKPOINT_VERSION			5
+#define CHECKPOINT_NB_LOCALS		15
+#define CHECKPOINT_GUID_LEN			128
+
+typedef struct {
+	char						magic[8];		/* CHECKPOINT_MAGIC without trailing NUL */
+	uint32_t					version;
+	uint32_t					nb_fmu;
+	uint64_t					size;			/* of the whole snapshot */
+	uint64_t					nb_local[CHECKPOINT_NB_LOCALS];
+	uint64_t					nb_clocks_next_tick;
+	uint64_t					nb_next_clocks;
+	int64_t						nb_steps;
+	double						start_time;
+	double						time;
+	double						next_step;
+	int32_t						state;
+	int32_t						need_event_update;
+	uint64_t					nb_extrapolation;
+	int64_t						extrapolation_nb_samples;
+	double						extrapolation_time[CONTAINER_EXTRAPOLATION_SAMPLES];
+	uint64_t					nb_adaptive;
+	int32_t						adaptive_multiplier;
+	int32_t						adaptive_nb_samples;
+	double						adaptive_time[CONTAINER_ADAPTIVE_SAMPLES];
+	uint64_t					nb_integrator;
+	double						integrator_h;
+} checkpoint_header_t;
+
+typedef struct {
+	uint64_t					offset;			/* of serialized state of the FMU */
+	uint64_t					size;
+	char						guid[CHECKPOINT_GUID_LEN];	/* checked at deserialization */
+} checkpoint_fmu_t;
+
+
+/*----------------------------------------------------------------------------
+                            P R O T O T Y P E S
+----------------------------------------------------------------------------*/
+
+extern checkpoint_t *checkpoint_new(container_t *container);
+extern fmu_status_t checkpoint_get(container_t *container, checkpoint_t *checkpoint);
+extern fmu_status_t checkpoint_set(container_t *container, const checkpoint_t *checkpoint);
+extern fmu_status_t checkpoint_rollback(container_t *container, const checkpoint_t *checkpoint, const bool *keep);
+extern void checkpoint_free(container_t *container, checkpoint_t *checkpoint);
+extern fmu_status_t checkpoint_serialized_size(container_t *container, const checkpoint_t *checkpoint, size_t *size);
+extern fmu_status_t checkpoint_serialize(container_t *container, const checkpoint_t *checkpoint, uint8_t *buffer, size_t size);
+extern checkpoint_t *checkpoint_deserialize(container_t *container, const uint8_t *buffer, size_t size);
+extern checkpoint_t *checkpoint_load(container_t *container, const char *filename);
+
+#	ifdef __cplusplus
+}
+#	endif
+#endif
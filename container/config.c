@@ -26,18 +26,19 @@ int get_line(config_file_t* config_file) {
 }
 
 
-int config_file_open(config_file_t* config_file, const char *dirname, const char *filename) {
+int config_file_open(config_file_t* config_file, const logger_t *context, const char *dirname, const char *filename) {
     char full_path[CONFIG_FILE_SZ];
 
     STRLCPY(full_path, dirname, sizeof(full_path));
     STRLCAT(full_path, "/", sizeof(full_path));
     STRLCAT(full_path, filename, sizeof(full_path));
     
+    config_file->logger = context;
     config_file->fp = fopen(full_path, "rt");
     if (! config_file->fp)
         return -1;
     
-    logger(LOGGER_DEBUG, "Reading '%s'...", filename);
+    logger(context, LOGGER_DEBUG, "Reading '%s'...", filename);
 
     config_file->line_number = 0;
 
@@ -60,5 +61,5 @@ void config_file_error(config_file_t *config_file, unsigned int code_line_number
     vsnprintf(message_buffer, sizeof(message_buffer), message, ap);
     va_end(ap);
 
-    logger(LOGGER_ERROR, "Configuration error(%u): line #%u: %s", code_line_number, config_file->line_number, message_buffer);
+    logger(config_file->logger, LOGGER_ERROR, "Configuration error(%u): line #%u: %s", code_line_number, config_file->line_number, message_buffer);
 }
@@ -29,6 +29,7 @@ typedef struct {
 	FILE						*fp;
 	char						line[CONFIG_FILE_SZ];
     unsigned int                line_number;
+    const struct logger_s       *logger;
 } config_file_t;
 
 
@@ -36,8 +37,10 @@ typedef struct {
                             P R O T O T Y P E S
 ----------------------------------------------------------------------------*/
 
+struct logger_s;
+
 int get_line(config_file_t* config_file);
-extern int config_file_open(config_file_t* config_file, const char *dirname, const char *filename);
+extern int config_file_open(config_file_t* config_file, const struct logger_s *context, const char *dirname, const char *filename);
 extern void config_file_close(config_file_t* config_file);
 extern void config_file_error(config_file_t *config_file, unsigned int code_line_number, const char *message, ...) __attribute__((__format__(__printf__, 3, 4)));
 
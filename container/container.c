@@ -5,15 +5,26 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "checkpoint.h"
 #include "config.h"
 #include "container.h"
 #include "datalog.h"
 #include "logger.h"
 #include "fmu.h"
+#include "integrator.h"
+#include "trace.h"
 #include "version.h"
 
 //#define DEBUG
 
+/* Trace events emitted from main thread */
+#define CONTAINER_TRACE(phase, track, name)                                             \
+    if (container->trace)                                                               \
+        trace_event(&container->trace->buffers[0], phase, track, name, 0, 0.0)
+
+#define CONTAINER_TRACE_FMU(phase, fmu, profile_phase)                                  \
+    CONTAINER_TRACE(phase, TRACE_TRACK_FMU + (fmu)->index, profile_phase_name(profile_phase))
+
 
 /*
  * Implementation of the fmu2Component/fmu3Instance depending on FMUContainer
@@ -26,11 +37,13 @@
 
 fmu_status_t container_enter_event_mode(container_t *container) {
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e| Container entering in EVENT mode", container->time);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e| Container entering in EVENT mode", container->time);
 #endif
     for (int i = 0; i < container->nb_fmu; i += 1) {
         fmu_t *fmu = &container->fmu[i];
 
+        if (fmu->model_exchange)
+            continue; /* events are handled by the integrator */
         if (fmuEnterEventMode(fmu) != FMU_STATUS_OK)
                 return FMU_STATUS_ERROR;
     }
@@ -40,7 +53,7 @@ fmu_status_t container_enter_event_mode(container_t *container) {
 
 fmu_status_t container_enter_step_mode(container_t *container) {
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e: Container entering in STEP mode", container->time);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e: Container entering in STEP mode", container->time);
 #endif
     for (int i = 0; i < container->nb_fmu; i += 1) {
         fmu_t *fmu = &container->fmu[i];
@@ -57,96 +70,215 @@ static inline int is_close (const container_t *container, double r1, double r2)
 }
 
 
+static void container_datalog(container_t *container) {
+    if (container->profile && container->datalog) {
+        const profile_tic_t start = profile_now();
+        datalog_log(container);
+        profile_record(container->profile, PROFILE_DATALOG, start);
+    } else
+        datalog_log(container);
+
+    return;
+}
+
+
+static void container_clocks_heap_swap(container_clock_list_t *clocks_list, unsigned long a, unsigned long b) {
+    const unsigned long clock = clocks_list->heap[a];
+
+    clocks_list->heap[a] = clocks_list->heap[b];
+    clocks_list->heap[b] = clock;
+    clocks_list->heap_index[clocks_list->heap[a]] = a;
+    clocks_list->heap_index[clocks_list->heap[b]] = b;
+
+    return;
+}
+
+
+static void container_clocks_heap_up(container_clock_list_t *clocks_list, unsigned long pos) {
+    while (pos > 0) {
+        const unsigned long parent = (pos - 1) / 2;
+        if (clocks_list->next_tick[clocks_list->heap[parent]] <= clocks_list->next_tick[clocks_list->heap[pos]])
+            break;
+        container_clocks_heap_swap(clocks_list, parent, pos);
+        pos = parent;
+    }
+
+    return;
+}
+
+
+static void container_clocks_heap_down(container_clock_list_t *clocks_list, unsigned long pos) {
+    for (;;) {
+        const unsigned long left = 2 * pos + 1;
+        const unsigned long right = left + 1;
+        unsigned long smallest = pos;
+
+        if ((left < clocks_list->nb_heap) &&
+            (clocks_list->next_tick[clocks_list->heap[left]] < clocks_list->next_tick[clocks_list->heap[smallest]]))
+            smallest = left;
+        if ((right < clocks_list->nb_heap) &&
+            (clocks_list->next_tick[clocks_list->heap[right]] < clocks_list->next_tick[clocks_list->heap[smallest]]))
+            smallest = right;
+        if (smallest == pos)
+            break;
+        container_clocks_heap_swap(clocks_list, pos, smallest);
+        pos = smallest;
+    }
+
+    return;
+}
+
+
+/* Schedule (or reschedule) next tick of clock #i */
+static void container_clocks_heap_set(container_clock_list_t *clocks_list, unsigned long i, double tick) {
+    unsigned long pos = clocks_list->heap_index[i];
+
+    clocks_list->next_tick[i] = tick;
+    if (pos == CONTAINER_CLOCK_NOT_SCHEDULED) {
+        pos = clocks_list->nb_heap;
+        clocks_list->nb_heap += 1;
+        clocks_list->heap[pos] = i;
+        clocks_list->heap_index[i] = pos;
+    }
+    container_clocks_heap_up(clocks_list, pos);
+    container_clocks_heap_down(clocks_list, clocks_list->heap_index[i]);
+
+    return;
+}
+
+
+static void container_clocks_heap_remove(container_clock_list_t *clocks_list, unsigned long i) {
+    const unsigned long pos = clocks_list->heap_index[i];
+
+    clocks_list->next_tick[i] = NAN;
+    if (pos == CONTAINER_CLOCK_NOT_SCHEDULED)
+        return;
+
+    clocks_list->nb_heap -= 1;
+    clocks_list->heap_index[i] = CONTAINER_CLOCK_NOT_SCHEDULED;
+    if (pos < clocks_list->nb_heap) {
+        clocks_list->heap[pos] = clocks_list->heap[clocks_list->nb_heap];
+        clocks_list->heap_index[clocks_list->heap[pos]] = pos;
+        container_clocks_heap_up(clocks_list, pos);
+        container_clocks_heap_down(clocks_list, clocks_list->heap_index[clocks_list->heap[pos]]);
+    }
+
+    return;
+}
+
+
+/*
+ * Rebuild the heap from next_tick (after restoring the state of the container). All FMUs
+ * will be queried at next event.
+ */
+void container_clocks_schedule(container_t *container) {
+    container_clock_list_t *clocks_list = &container->clocks_list;
+
+    clocks_list->nb_heap = 0;
+    for (unsigned long i = 0; i < clocks_list->nb_local_clocks; i += 1) {
+        clocks_list->heap_index[i] = CONTAINER_CLOCK_NOT_SCHEDULED;
+        if (!isnan(clocks_list->next_tick[i]))
+            container_clocks_heap_set(clocks_list, i, clocks_list->next_tick[i]);
+    }
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        clocks_list->fmu_query[i] = true;
+
+    return;
+}
+
+
+/* Walk the sub-heap of pos to get all clocks which tick before "before" */
+static void container_clocks_heap_collect(container_t *container, unsigned long pos, double before,
+                                          unsigned long *nb_events) {
+    container_clock_list_t *clocks_list = &container->clocks_list;
+
+    if ((pos >= clocks_list->nb_heap) || (clocks_list->next_tick[clocks_list->heap[pos]] > before))
+        return;
+
+    const unsigned long i = clocks_list->heap[pos];
+    clocks_list->next_clocks[*nb_events].local_vr = clocks_list->clock_index[i];
+    clocks_list->next_clocks[*nb_events].fmu_id   = clocks_list->fmu_id[i];
+    clocks_list->next_clocks[*nb_events].fmu_vr   = clocks_list->fmu_vr[i];
+    *nb_events += 1;
+
+    container_clocks_heap_collect(container, 2 * pos + 1, before, nb_events);
+    container_clocks_heap_collect(container, 2 * pos + 2, before, nb_events);
+
+    return;
+}
+
+
 static void container_set_next_event_time(container_t *container) {
-    double *event_interval = container->clocks_list.buffer_interval;
-    int *event_qualifier = container->clocks_list.buffer_qualifier;
-    fmu_vr_t *fmu_vr = container->clocks_list.fmu_vr;
+    container_clock_list_t *clocks_list = &container->clocks_list;
+    double *event_interval = clocks_list->buffer_interval;
+    int *event_qualifier = clocks_list->buffer_qualifier;
+    fmu_vr_t *fmu_vr = clocks_list->fmu_vr;
     double next_interval = container->next_step;
+    unsigned long pos = 0;
 
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | Get next scheduled ticks (nb_fmu=%d)", container->time, container->clocks_list.nb_fmu);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | Get next scheduled ticks (nb_fmu=%d)", container->time, clocks_list->nb_fmu);
 #endif
-    /* Get all clocks intervals */
-    for(unsigned long i = 0; i < container->clocks_list.nb_fmu; i += 1) {
-        container_clock_counter_t *counter = &container->clocks_list.counter[i]; 
+    /* Get clocks intervals of FMUs which took part in the event */
+    for(unsigned long i = 0; i < clocks_list->nb_fmu; i += 1) {
+        container_clock_counter_t *counter = &clocks_list->counter[i]; 
         const fmu_t *fmu = &container->fmu[counter->fmu_id];
 
-        if (fmuGetIntervalDecimal(fmu, fmu_vr, counter->nb, event_interval, event_qualifier) != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "FMU '%s' Cannot get next event interval", fmu->name);
-            return;
+        if (clocks_list->fmu_query[counter->fmu_id] || fmu->need_event_udpate) {
+            clocks_list->fmu_query[counter->fmu_id] = false;
+            if (fmuGetIntervalDecimal(fmu, fmu_vr, counter->nb, event_interval, event_qualifier) != FMU_STATUS_OK) {
+                logger(&container->logger, LOGGER_ERROR, "FMU '%s' Cannot get next event interval", fmu->name);
+                return;
+            }
+
+            for (unsigned long j = 0; j < counter->nb; j += 1) {
+                if (event_qualifier[j] == fmi3IntervalNotYetKnown)
+                    container_clocks_heap_remove(clocks_list, pos + j);
+                else if (event_qualifier[j] == fmi3IntervalChanged)
+                    container_clocks_heap_set(clocks_list, pos + j, container->time + event_interval[j]);
+                else if ((clocks_list->heap_index[pos + j] == CONTAINER_CLOCK_NOT_SCHEDULED) ||
+                         (clocks_list->next_tick[pos + j] - container->time < container->tolerance)) {
+                    logger(&container->logger, LOGGER_ERROR, "Clock '%s' vr=%u has no previous interval and fmi3IntervalUnchanged was set.",
+                        fmu->name, fmu_vr[j]);
+                    return;
+                }
+            }
         }
 
+        pos += counter->nb;
         fmu_vr += counter->nb;
         event_interval += counter->nb;
         event_qualifier += counter->nb;
     }
 
-    /* get next defined events (may be several) */
-    event_interval = container->clocks_list.buffer_interval;
-    event_qualifier = container->clocks_list.buffer_qualifier;
-
+    /* get next defined events (may be several) if they occur during next step */
     unsigned long nb_events = 0;
-    for(unsigned long i = 0; i < container->clocks_list.nb_local_clocks; i += 1) {
-        double interval = -1.0;
-        const int qualifier = event_qualifier[i];
-        
-        /* Get interval value */
-        if (qualifier == fmi3IntervalUnchanged) {
-            interval = container->clocks_list.buffer_previous[i] - container->next_step;
-            if (interval < container->tolerance) {
-                logger(LOGGER_ERROR, "Clock '%s' vr=%u has no previous interval and fmi3IntervalUnchanged was set.",
-                    container->fmu[container->clocks_list.fmu_id[i]].name, container->clocks_list.fmu_vr[i]);
-                return;
-            }
-        } else {
-            interval = event_interval[i];
+    if (clocks_list->nb_heap) {
+        const double interval = clocks_list->next_tick[clocks_list->heap[0]] - container->time;
+        if ((interval < next_interval) || is_close(container, interval, next_interval)) {
+            container_clocks_heap_collect(container, 0, container->time + interval + container->tolerance, &nb_events);
+            next_interval = interval;
         }
+    }
 
-        /* if interval is small enough, consider the event as the next one */
-        if (qualifier == fmi3IntervalNotYetKnown) {
-            container->clocks_list.buffer_previous[i] = -1.0; /* reset previous */
-        } else {
-            if (nb_events) {
-                if (is_close(container, next_interval, interval)) {
-                    /* found a event on the same time */
-                    container->clocks_list.next_clocks[nb_events].local_vr = container->clocks_list.clock_index[i];
-                    container->clocks_list.next_clocks[nb_events].fmu_id   = container->clocks_list.fmu_id[i];
-                    container->clocks_list.next_clocks[nb_events].fmu_vr   = container->clocks_list.fmu_vr[i];
-                    nb_events += 1;
-                } else {
-                    if (interval < next_interval) {
-                        /* found a event earlier */
-                        container->clocks_list.next_clocks[0].local_vr = container->clocks_list.clock_index[i];
-                        container->clocks_list.next_clocks[0].fmu_id   = container->clocks_list.fmu_id[i];
-                        container->clocks_list.next_clocks[0].fmu_vr   = container->clocks_list.fmu_vr[i];
-                        nb_events = 1;
-                        next_interval = interval;
-                    }
-                }
-            } else {
-                /* first event found */
-                if (interval < container->time_step || is_close(container, interval, next_interval)) {
-                    container->clocks_list.next_clocks[0].local_vr = container->clocks_list.clock_index[i];
-                    container->clocks_list.next_clocks[0].fmu_id   = container->clocks_list.fmu_id[i];
-                    container->clocks_list.next_clocks[0].fmu_vr   = container->clocks_list.fmu_vr[i];
-                    nb_events = 1;
-                    next_interval = interval;
-                }
-            }
-            container->clocks_list.buffer_previous[i] = interval;
+    clocks_list->nb_next_clocks = nb_events;
+
+    if (container->trace) {
+        for (unsigned long i = 0; i < nb_events; i += 1) {
+            const container_clock_t *next_clock = &clocks_list->next_clocks[i];
+            trace_event(&container->trace->buffers[0], TRACE_INSTANT, TRACE_TRACK_CLOCKS,
+                        container->fmu[next_clock->fmu_id].name, next_clock->fmu_vr, next_interval);
         }
     }
 
-    container->clocks_list.nb_next_clocks = nb_events;
-
 #ifdef DEBUG
     if (nb_events) {
-        logger(LOGGER_DEBUG, "[DEBUG] time=%e | Next event t=%e (interval=%e): %u clock ticks", container->time, 
+        logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | Next event t=%e (interval=%e): %u clock ticks", container->time, 
             container->time + next_interval, next_interval, nb_events);
         for (unsigned long i = 0; i < nb_events; i += 1) {
-            logger(LOGGER_DEBUG, "[DEBUG] > scheduled tick of clock '%s' vr = %lu",
-                container->fmu[container->clocks_list.next_clocks[i].fmu_id].name,
-                               container->clocks_list.next_clocks[i].fmu_vr);
+            logger(&container->logger, LOGGER_DEBUG, "[DEBUG] > scheduled tick of clock '%s' vr = %lu",
+                container->fmu[clocks_list->next_clocks[i].fmu_id].name,
+                               clocks_list->next_clocks[i].fmu_vr);
         }
     }
 #endif
@@ -177,27 +309,54 @@ void container_clocks_deactivate(container_t *container) {
 }
 
 
+/*
+ * Set input clocks (and clocked inputs if requested) of the FMUs which consume active local
+ * clocks, restricted to the FMUs flagged in visit (if not NULL). Those FMUs take part in the
+ * event: their clocks intervals will be queried.
+ */
+static fmu_status_t container_clocks_propagate(container_t *container, bool clocked_inputs, const bool *visit) {
+    for (unsigned long i = 0; i < container->nb_consumed_clocks; i += 1) {
+        const unsigned long clock = container->consumed_clocks[i];
+        if (! container->clocks[clock])
+            continue;
+
+        const fmu_clock_consumer_list_t *list = &container->clock_consumers[clock];
+        for (unsigned long j = 0; j < list->nb; j += 1) {
+            const fmu_clock_consumer_t *consumer = &list->consumers[j];
+
+            if ((!clocked_inputs && (consumer->type != FMU_CLOCK_CONSUMER_CLOCK)) ||
+                (visit && !visit[consumer->fmu_id]))
+                continue;
+            if (fmu_set_clock_consumer(&container->fmu[consumer->fmu_id], consumer) != FMU_STATUS_OK)
+                return FMU_STATUS_ERROR;
+            container->clocks_list.fmu_query[consumer->fmu_id] = true;
+        }
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
 static fmu_status_t container_proceed_event(container_t *container) {
     /* Activate clocks of next event and notify FMU */
     for(unsigned long i = 0; i < container->clocks_list.nb_next_clocks; i += 1) {
         container_clock_t *container_clock = &container->clocks_list.next_clocks[i];
         const bool value = true;
 #ifdef DEBUG
-        logger(LOGGER_DEBUG, "[DEBUG] time=%e | Activate Clock '%s' vr=%lu", 
+        logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | Activate Clock '%s' vr=%lu", 
             container->time, container->fmu[container_clock->fmu_id].name, container_clock->fmu_vr);
 #endif
         container->clocks[container_clock->local_vr] = true;
         fmuSetClock(&container->fmu[container_clock->fmu_id], &container_clock->fmu_vr, 1, &value);
+        container->clocks_list.fmu_query[container_clock->fmu_id] = true;
     }
 
     /* Propagate clocks (LS-BUS: input clocks could be shared)*/
-    for (int i = 0; i < container->nb_fmu; i += 1) {
-        fmu_t *fmu = &container->fmu[i];
-
-        if (fmu_set_clocks(fmu) != FMU_STATUS_OK)
-            return FMU_STATUS_ERROR;
+    if (container_clocks_propagate(container, false, NULL) != FMU_STATUS_OK)
+        return FMU_STATUS_ERROR;
 
-        if (fmu_get_clocked_outputs(fmu) != FMU_STATUS_OK)
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        if (fmu_get_clocked_outputs(&container->fmu[i]) != FMU_STATUS_OK)
             return FMU_STATUS_ERROR;
     }
 
@@ -208,44 +367,83 @@ static fmu_status_t container_proceed_event(container_t *container) {
 }
 
 
+/* Consumers of the output clocks raised by the FMU are revisited at next iteration */
+static void container_clocks_raised(const container_t *container, const fmu_t *fmu, bool *revisit) {
+    const fmu_translation_list_t *clocks = &fmu->fmu_io.clocks.out;
+
+    for (unsigned long i = 0; i < clocks->nb; i += 1) {
+        const fmu_vr_t clock = clocks->translations[i].vr;
+        if (container->clocks[clock]) {
+            const fmu_clock_consumer_list_t *list = &container->clock_consumers[clock];
+            for (unsigned long j = 0; j < list->nb; j += 1)
+                revisit[list->consumers[j].fmu_id] = true;
+        }
+    }
+
+    return;
+}
+
+
+/*
+ * Event iterations. The first one involves all FMUs which support events. Next ones only
+ * revisit the FMUs which asked for it (discreteStatesNeedUpdate) or which consume clocks
+ * raised during the previous iteration.
+ */
 static fmu_status_t container_update_discrete_state(container_t *container) {
-    const int ts_multiplier = container->integers32[0];
+    /* Adaptive step is not split: each internal step is truncated to its target time */
+    const int ts_multiplier = container->adaptive.min_multiplier ? container->adaptive.max_multiplier :
+                              container->integers32[0];
+    bool *visit = container->event_visit;
+    bool *revisit = container->event_revisit;
     bool more_event;
 
     container->next_step = container->time_step * ts_multiplier;
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | container_update_discrete_state()", container->time);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | container_update_discrete_state()", container->time);
 #endif
-    do {
-        for (int i = 0; i < container->nb_fmu; i += 1) {
-            fmu_t *fmu = &container->fmu[i];
-
-            /* Set remaining clocks */
-            if (fmu_set_clocks(fmu) != FMU_STATUS_OK)
-                return FMU_STATUS_ERROR;
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        visit[i] = container->fmu[i].support_event;
 
-            if (fmu_set_clocked_inputs(fmu) != FMU_STATUS_OK)
-                return FMU_STATUS_ERROR;
-        }
+    do {
+        CONTAINER_TRACE(TRACE_BEGIN, TRACE_TRACK_EVENTS, "iteration");
+        /* Set remaining clocks */
+        if (container_clocks_propagate(container, true, visit) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
             
-        datalog_log(container);
+        if (!container->snapshot)       /* warm-start: logged once the snapshot is applied */
+            container_datalog(container);
 
         for (int i = 0; i < container->nb_fmu; i += 1) {
-            fmu_t *fmu = &container->fmu[i];
+            revisit[i] = false;
+            if (visit[i]) {
+                fmu_t *fmu = &container->fmu[i];
 
-            if (fmu_get_clocked_outputs(fmu) != FMU_STATUS_OK)
-                return FMU_STATUS_ERROR;
+                if (fmu_get_clocked_outputs(fmu) != FMU_STATUS_OK)
+                    return FMU_STATUS_ERROR;
+            }
         }
 
         more_event = false;
         for (int i = 0; i < container->nb_fmu; i += 1) {
-            fmu_t *fmu = &container->fmu[i];
-            bool fmu_more_event = false;
-            if (fmuUpdateDiscreteStates(fmu, &fmu_more_event) != FMU_STATUS_OK)
-                return FMU_STATUS_ERROR;
-
-            more_event |= fmu_more_event;
+            if (visit[i]) {
+                fmu_t *fmu = &container->fmu[i];
+                bool fmu_more_event = false;
+                if (fmuUpdateDiscreteStates(fmu, &fmu_more_event) != FMU_STATUS_OK)
+                    return FMU_STATUS_ERROR;
+
+                if (fmu_more_event) {
+                    container->clocks_list.fmu_query[i] = true;
+                    revisit[i] = true;
+                }
+                more_event |= fmu_more_event;
+                container_clocks_raised(container, fmu, revisit);
+            }
         }
+
+        bool *swap = visit;
+        visit = revisit;
+        revisit = swap;
+        CONTAINER_TRACE(TRACE_END, TRACE_TRACK_EVENTS, "iteration");
     } while(more_event);
 
     /* All clock have been transmitted by now
@@ -264,6 +462,8 @@ static fmu_status_t container_update_discrete_state(container_t *container) {
 static fmu_status_t container_handle_events(container_t *container) {
     fmu_status_t status;
 
+    CONTAINER_TRACE(TRACE_BEGIN, TRACE_TRACK_EVENTS, "event");
+
     /* Event loop */
     status = container_enter_event_mode(container);
     if (status != FMU_STATUS_OK)
@@ -281,19 +481,164 @@ static fmu_status_t container_handle_events(container_t *container) {
     if (status != FMU_STATUS_OK)
         return status;
 
+    if (container->profiling) {
+        for (int i = 0; i < container->nb_fmu; i += 1)
+            profile_commit(container->fmu[i].profile, PROFILE_EVENT);
+    }
+
+    CONTAINER_TRACE(TRACE_END, TRACE_TRACK_EVENTS, "event");
+
     return FMU_STATUS_OK;
 }
 
 
+/*----------------------------------------------------------------------------
+                          E X T R A P O L A T I O N
+----------------------------------------------------------------------------*/
+
+/*
+ * In PARALLEL mode, inputs of each FMU are outputs of the previous step and are held
+ * during the step. For extrapolated links, the input is the value of the polynomial
+ * through the last samples (order+1 samples, fewer at startup) at the middle of the
+ * step: a constant input equal to the mid-step value is the best approximation of
+ * the signal over the step. Extrapolated values are written in place of the local
+ * variables, which are refreshed by fmu_get_outputs() at the end of the step.
+ */
+static void container_extrapolation_sample(container_t *container) {
+    container_extrapolation_t *extrapolation = &container->extrapolation;
+
+    /* Do not extrapolate through discontinuities */
+    if (container->need_event_update)
+        extrapolation->nb_samples = 0;
+
+    /* Values updated at the same time (event iteration) replace the last sample */
+    if ((extrapolation->nb_samples == 0) || !is_close(container, container->time, extrapolation->time[0])) {
+        for (int k = CONTAINER_EXTRAPOLATION_SAMPLES - 1; k > 0; k -= 1)
+            extrapolation->time[k] = extrapolation->time[k - 1];
+        for (unsigned long i = 0; i < extrapolation->nb; i += 1) {
+            double *history = &extrapolation->history[i * CONTAINER_EXTRAPOLATION_SAMPLES];
+            for (int k = CONTAINER_EXTRAPOLATION_SAMPLES - 1; k > 0; k -= 1)
+                history[k] = history[k - 1];
+        }
+        if (extrapolation->nb_samples < CONTAINER_EXTRAPOLATION_SAMPLES)
+            extrapolation->nb_samples += 1;
+    }
+
+    extrapolation->time[0] = container->time;
+    for (unsigned long i = 0; i < extrapolation->nb; i += 1)
+        extrapolation->history[i * CONTAINER_EXTRAPOLATION_SAMPLES] = container->reals64[extrapolation->vr[i]];
+
+    return;
+}
+
+
+static void container_extrapolation_predict(container_t *container, double target_time) {
+    const container_extrapolation_t *extrapolation = &container->extrapolation;
+    double weights[CONTAINER_EXTRAPOLATION_SAMPLES][CONTAINER_EXTRAPOLATION_SAMPLES];
+
+    /* Lagrange weights of polynomials through the n most recent samples */
+    for (int n = 1; n <= extrapolation->nb_samples; n += 1) {
+        for (int k = 0; k < n; k += 1) {
+            weights[n - 1][k] = 1.0;
+            for (int j = 0; j < n; j += 1) {
+                if (j != k)
+                    weights[n - 1][k] *= (target_time - extrapolation->time[j]) /
+                                         (extrapolation->time[k] - extrapolation->time[j]);
+            }
+        }
+    }
+
+    for (unsigned long i = 0; i < extrapolation->nb; i += 1) {
+        const double *history = &extrapolation->history[i * CONTAINER_EXTRAPOLATION_SAMPLES];
+        int n = extrapolation->order[i] + 1;
+        if (n > extrapolation->nb_samples)
+            n = extrapolation->nb_samples;
+        if (n > 1) {
+            double value = 0.0;
+            for (int k = 0; k < n; k += 1)
+                value += weights[n - 1][k] * history[k];
+            container->reals64[extrapolation->vr[i]] = value;
+        }
+    }
+
+    return;
+}
+
+
+/*----------------------------------------------------------------------------
+                          A D A P T I V E   S T E P
+----------------------------------------------------------------------------*/
+
+/*
+ * Error of the internal step is the largest deviation of monitored outputs from their linear
+ * extrapolation, relative to the tolerance. It grows as the square of the step: the next step
+ * is scaled accordingly (with a safety factor), by no more than a factor of 2. Events reset
+ * the history and restart with the smallest step.
+ */
+static void container_adaptive_update(container_t *container) {
+    container_adaptive_t *adaptive = &container->adaptive;
+
+    if (container->need_event_update) {
+        adaptive->nb_samples = 0;
+        adaptive->multiplier = adaptive->min_multiplier;
+    }
+
+    if (adaptive->nb_samples == CONTAINER_ADAPTIVE_SAMPLES) {
+        const double step = container->time - adaptive->time[0];
+        const double ratio = step / (adaptive->time[0] - adaptive->time[1]);
+        double error = 0.0;
+
+        for (unsigned long i = 0; i < adaptive->nb; i += 1) {
+            const double *history = &adaptive->history[i * CONTAINER_ADAPTIVE_SAMPLES];
+            const double value = container->reals64[adaptive->vr[i]];
+            const double predicted = history[0] + (history[0] - history[1]) * ratio;
+            const double e = fabs(value - predicted) / (adaptive->tolerance * (1.0 + fabs(value)));
+            if (e > error)
+                error = e;
+        }
+
+        double factor = (error > 0.0) ? 0.9 / sqrt(error) : 2.0;
+        if (factor > 2.0)
+            factor = 2.0;
+        if (factor < 0.5)
+            factor = 0.5;
+
+        /* a step shortened to reach the communication point does not shrink the next one */
+        double base = step / container->time_step;
+        if ((factor >= 1.0) && (base < adaptive->multiplier))
+            base = adaptive->multiplier;
+
+        int multiplier = (int)(base * factor + container->tolerance);
+        if (multiplier < adaptive->min_multiplier)
+            multiplier = adaptive->min_multiplier;
+        if (multiplier > adaptive->max_multiplier)
+            multiplier = adaptive->max_multiplier;
+        adaptive->multiplier = multiplier;
+    }
+
+    for (unsigned long i = 0; i < adaptive->nb; i += 1) {
+        double *history = &adaptive->history[i * CONTAINER_ADAPTIVE_SAMPLES];
+        history[1] = history[0];
+        history[0] = container->reals64[adaptive->vr[i]];
+    }
+    adaptive->time[1] = adaptive->time[0];
+    adaptive->time[0] = container->time;
+    if (adaptive->nb_samples < CONTAINER_ADAPTIVE_SAMPLES)
+        adaptive->nb_samples += 1;
+
+    return;
+}
+
+
 /*----------------------------------------------------------------------------
                            C O N F I G U R A T I O N
 ----------------------------------------------------------------------------*/
 
 static void container_set_start_values(container_t* container, int early_set) {
     if (early_set)
-        logger(LOGGER_DEBUG, "Setting start values...");
+        logger(&container->logger, LOGGER_DEBUG, "Setting start values...");
     else
-        logger(LOGGER_DEBUG, "Re-setting some start values...");
+        logger(&container->logger, LOGGER_DEBUG, "Re-setting some start values...");
     for (int i = 0; i < container->nb_fmu; i += 1) {
 #define SET_START(fmi_type, type)                                                               \
         for(unsigned long j=0; j<container->fmu[i].fmu_io.start_ ## type .nb; j ++) {           \
@@ -319,7 +664,7 @@ static void container_set_start_values(container_t* container, int early_set) {
         /* binaries and clocks don't support start values here */
 #undef SET_START
     }
-    logger(LOGGER_DEBUG, "Start values are set.");
+    logger(&container->logger, LOGGER_DEBUG, "Start values are set.");
     return;
 }
 
@@ -378,6 +723,12 @@ fmu_status_t container_exit_initialization_mode(container_t* container) {
 
     /* FMUs are in EventMode */
 
+    if (container->integrator) {
+        status = integrator_initialize(container);
+        if (status != FMU_STATUS_OK)
+            return status;
+    }
+
     container_init_values(container);
 
     status = container_update_discrete_state(container);
@@ -388,8 +739,39 @@ fmu_status_t container_exit_initialization_mode(container_t* container) {
     if (status != FMU_STATUS_OK)
         return status;
 
+    if (container->profiling) {
+        for (int i = 0; i < container->nb_fmu; i += 1)
+            profile_commit(container->fmu[i].profile, PROFILE_EVENT);
+    }
+
+    if (container->extrapolation.nb)
+        container_extrapolation_sample(container);
+    if (container->adaptive.min_multiplier)
+        container_adaptive_update(container);
+
+    /* FMUs are in StepMode: derivatives of their outputs can be queried */
+    if (container->nb_derivatives) {
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            status = fmu_get_output_derivatives(&container->fmu[i]);
+            if (status != FMU_STATUS_OK)
+                return status;
+        }
+    }
+
+    /* Warm-start: initialization is overridden by the snapshot */
+    if (container->snapshot) {
+        logger(&container->logger, LOGGER_WARNING, "Container restarts from snapshot taken at time=%g.",
+               container->snapshot->time);
+        status = checkpoint_set(container, container->snapshot);
+        checkpoint_free(container, container->snapshot);
+        container->snapshot = NULL;
+        if (status != FMU_STATUS_OK)
+            return status;
+        container_datalog(container);
+    }
+
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | first container->next_step = %e", container->time, container->next_step);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | first container->next_step = %e", container->time, container->next_step);
 #endif
 
     return status;
@@ -397,117 +779,964 @@ fmu_status_t container_exit_initialization_mode(container_t* container) {
 
 
 /*----------------------------------------------------------------------------
-                                D O   S T E P
+                              S C H E D U L E
 ----------------------------------------------------------------------------*/
 
-static fmu_status_t container_do_one_step_sequential(container_t *container) {
-    fmu_status_t status = FMU_STATUS_OK;
+/*
+ * In MULTI thread mode, FMUs are grouped onto threads. Cost of each FMU (set inputs and doStep)
+ * is measured, then FMUs are bin-packed with the LPT heuristic (Longest Processing Time first).
+ * The main thread is the bin 0, other bins are threads of the FMUs leading a group. The fewest
+ * bins giving a makespan close to the best one are used: tiny FMUs are stepped by the main thread
+ * instead of paying a thread synchronization. Grouping is evaluated periodically and is changed
+ * if step costs have drifted.
+ */
+#define CONTAINER_SCHEDULE_FIRST_STEPS  16      /* steps measured before first grouping (AUTO mode warm-up) */
+#define CONTAINER_SCHEDULE_PERIOD_STEPS 5000    /* steps measured before next evaluations */
+#define CONTAINER_SCHEDULE_TOLERANCE    0.05    /* makespan increase accepted to save a thread */
+#define CONTAINER_SCHEDULE_DRIFT        0.10    /* makespan decrease required to change grouping */
+
+static void container_schedule_free(container_schedule_t *schedule) {
+    free(schedule->workers);
+    free(schedule->order);
+    free(schedule->bin);
+    free(schedule->candidate);
+    free(schedule->sorted);
+    free(schedule->cost);
+    free(schedule->load);
 
-    container->need_event_update = false;
-    for (int i = 0; i < container->nb_fmu; i += 1) {
-        fmu_t* fmu = &container->fmu[i];
-        
-        status = fmu_set_inputs(fmu);
-        if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Container: FMU '%s' failed set inputs.", container->fmu[i].name);
-            return status;
-        }
-        
-        /* COMPUTATION */
+    return;
+}
 
-        status = fmuDoStep(fmu, container->time, container->next_step);
-        if (status != FMU_STATUS_OK)
-            return status;
-        container->need_event_update |= fmu->need_event_udpate;
 
-        status = fmu_get_outputs(fmu);
-        if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", container->fmu[i].name);
-            return status;
-        }
+static double container_schedule_makespan(const container_schedule_t *schedule, int nb_bins) {
+    double makespan = 0.0;
+
+    for (int b = 0; b < nb_bins; b += 1) {
+        if (schedule->load[b] > makespan)
+            makespan = schedule->load[b];
     }
 
-    return status;
+    return makespan;
 }
 
 
-static fmu_status_t container_do_one_step_parallel_mt(container_t* container) {
-    fmu_status_t status = FMU_STATUS_OK;
-
-    container->need_event_update = false;
-    for(int i = 0; i < container->nb_fmu; i += 1) {
-        fmu_t* fmu = &container->fmu[i];
-        fmu->status = FMU_STATUS_ERROR;
-        thread_mutex_unlock(&fmu->mutex_container);
-    }
-
-    /* Consolidate results */
-    for (int i = 0; i < container->nb_fmu; i += 1) {
-        fmu_t* fmu = &container->fmu[i];
+static double container_schedule_lpt(container_schedule_t *schedule, int nb_fmu, int nb_bins) {
+    for (int b = 0; b < nb_bins; b += 1)
+        schedule->load[b] = 0.0;
 
-        thread_mutex_lock(&fmu->mutex_fmu);
-        if (fmu->status != FMU_STATUS_OK)
-            return FMU_STATUS_ERROR;
-        container->need_event_update |= fmu->need_event_udpate;
-    }
+    for (int k = 0; k < nb_fmu; k += 1) {
+        const int i = schedule->sorted[k];
+        int lightest = 0;
 
-    for (int i = 0; i < container->nb_fmu; i += 1) {
-        status = fmu_get_outputs(&container->fmu[i]);
-        if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", container->fmu[i].name);
-            return FMU_STATUS_ERROR;
+        for (int b = 1; b < nb_bins; b += 1) {
+            if (schedule->load[b] < schedule->load[lightest])
+                lightest = b;
         }
+        schedule->candidate[i] = lightest;
+        schedule->load[lightest] += schedule->cost[i];
     }
 
-    return status;
+    return container_schedule_makespan(schedule, nb_bins);
 }
 
 
-static fmu_status_t container_do_one_step_parallel(container_t* container) {
-    fmu_status_t status = FMU_STATUS_OK;
+static void container_schedule_apply(container_t *container) {
+    container_schedule_t *schedule = &container->schedule;
+    int k = 0;
 
-    /* STEP MODE */
-    container->need_event_update = false;
-    for (int i = 0; i < container->nb_fmu; i += 1) {          
-        status = fmu_set_inputs(&container->fmu[i]);
-        if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Container: FMU '%s' failed set inputs.", container->fmu[i].name);
-            return status;
-        }
-    }
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        container->fmu[i].nb_group = 0;
 
-    for (int i = 0; i < container->nb_fmu; i += 1) {
-        fmu_t* fmu = &container->fmu[i];
-        /* COMPUTATION */
-        status = fmuDoStep(fmu, container->time, container->next_step);
-        if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Container: FMU '%s' failed doStep.", container->fmu[i].name);
-            return status;
+    /* Groups are contiguous in order[], heaviest FMU first: its thread is used */
+    schedule->nb_workers = 0;
+    for (int b = 0; b <= container->nb_fmu; b += 1) {
+        const int first = k;
+
+        for (int j = 0; j < container->nb_fmu; j += 1) {
+            const int i = schedule->sorted[j];
+            if (schedule->candidate[i] == b) {
+                schedule->order[k] = &container->fmu[i];
+                schedule->bin[i] = (b == 0) ? 0 : schedule->nb_workers + 1;
+                k += 1;
+            }
         }
-        container->need_event_update |= fmu->need_event_udpate;
-    }
 
-    for (int i = 0; i < container->nb_fmu; i += 1) {
-        status = fmu_get_outputs(&container->fmu[i]);
-        if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Container: FMU '%s' failed get outputs.", container->fmu[i].name);
-            return status;
+        if (b == 0)
+            schedule->nb_inline = k;
+        else if (k > first) {
+            fmu_t *leader = schedule->order[first];
+
+            leader->group = &schedule->order[first];
+            leader->nb_group = k - first;
+            schedule->workers[schedule->nb_workers] = leader;
+            schedule->nb_workers += 1;
         }
     }
 
+    return;
+}
+
+
+static int container_schedule_new(container_t *container) {
+    container_schedule_t *schedule = &container->schedule;
+    const int nb = container->nb_fmu;
+
+    schedule->grouped = false;
+    schedule->steps = 0;
+    schedule->nb_cpu = thread_nb_cpu();
+    if (nb == 0)
+        return 0;
+
+    schedule->workers = malloc(nb * sizeof(*schedule->workers));
+    schedule->order = malloc(nb * sizeof(*schedule->order));
+    schedule->bin = malloc(nb * sizeof(*schedule->bin));
+    schedule->candidate = malloc(nb * sizeof(*schedule->candidate));
+    schedule->sorted = malloc(nb * sizeof(*schedule->sorted));
+    schedule->cost = malloc(nb * sizeof(*schedule->cost));
+    schedule->load = malloc((nb + 1) * sizeof(*schedule->load));
+    if (!schedule->workers || !schedule->order || !schedule->bin || !schedule->candidate ||
+        !schedule->sorted || !schedule->cost || !schedule->load)
+        return -1;
+
+    /* Until first grouping: one thread per FMU, unless grouping is set in container.txt */
+    bool configured = true;
+    for (int i = 0; i < nb; i += 1) {
+        const fmu_t *fmu = &container->fmu[i];
+
+        schedule->bin[i] = i + 1;
+        schedule->candidate[i] = fmu->worker;
+        schedule->sorted[i] = i;
+        if ((fmu->worker < 0) || (fmu->worker > nb))
+            configured = false;
+    }
+
+    if (configured) {
+        container_schedule_apply(container);
+        schedule->grouped = true;
+        logger(&container->logger, LOGGER_DEBUG, "Container MULTI thread mode groups %d FMUs onto %d threads + main thread as configured",
+               nb, schedule->nb_workers);
+    } else {
+        schedule->nb_workers = nb;
+        schedule->nb_inline = 0;
+        for (int i = 0; i < nb; i += 1) {
+            fmu_t *fmu = &container->fmu[i];
+
+            schedule->workers[i] = fmu;
+            schedule->order[i] = fmu;
+            fmu->group = &schedule->order[i];
+            fmu->nb_group = 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void container_schedule_update(container_t *container, unsigned long nb_steps) {
+    container_schedule_t *schedule = &container->schedule;
+    const int nb = container->nb_fmu;
+
+    schedule->steps += nb_steps;
+    if (schedule->steps < (schedule->grouped ? CONTAINER_SCHEDULE_PERIOD_STEPS : CONTAINER_SCHEDULE_FIRST_STEPS))
+        return;
+
+    /* FMUs by decreasing cost (insertion sort: few FMUs) */
+    for (int i = 0; i < nb; i += 1) {
+        schedule->cost[i] = (double)container->fmu[i].step_cost / (double)schedule->steps;
+        container->fmu[i].step_cost = 0;
+
+        int k = i;
+        while ((k > 0) && (schedule->cost[schedule->sorted[k - 1]] < schedule->cost[i])) {
+            schedule->sorted[k] = schedule->sorted[k - 1];
+            k -= 1;
+        }
+        schedule->sorted[k] = i;
+    }
+    schedule->steps = 0;
+
+    /* Makespan of current grouping with up-to-date costs */
+    for (int b = 0; b <= nb; b += 1)
+        schedule->load[b] = 0.0;
+    for (int i = 0; i < nb; i += 1)
+        schedule->load[schedule->bin[i]] += schedule->cost[i];
+    const double current = container_schedule_makespan(schedule, nb + 1);
+
+    /* Main thread + at most one thread per other CPU */
+    const int max_bins = (nb < schedule->nb_cpu) ? nb : schedule->nb_cpu;
+    const double best = container_schedule_lpt(schedule, nb, max_bins);
+    double makespan = best;
+    int nb_bins;
+    for (nb_bins = 1; nb_bins <= max_bins; nb_bins += 1) {
+        makespan = container_schedule_lpt(schedule, nb, nb_bins);
+        if (makespan <= best * (1.0 + CONTAINER_SCHEDULE_TOLERANCE))
+            break;
+    }
+
+    if (schedule->grouped && (makespan > current * (1.0 - CONTAINER_SCHEDULE_DRIFT))) {
+        logger(&container->logger, LOGGER_DEBUG, "Container keeps grouping of FMUs at time=%e (%.3fus/step, best: %.3fus/step)",
+               container->time, current / 1.0e3, makespan / 1.0e3);
+        return;
+    }
+
+    container_schedule_apply(container);
+
+    logger(&container->logger, schedule->grouped ? LOGGER_DEBUG : LOGGER_WARNING, "Container MULTI thread mode groups %d FMUs onto %d threads + main thread at time=%e (%.3fus/step)",
+           nb, schedule->nb_workers, container->time, makespan / 1.0e3);
+    for (int i = 0; i < schedule->nb_inline; i += 1)
+        logger(&container->logger, LOGGER_DEBUG, "FMU '%s' is stepped by main thread (%.3fus/step)",
+               schedule->order[i]->name, schedule->cost[schedule->order[i]->index] / 1.0e3);
+    for (int w = 0; w < schedule->nb_workers; w += 1) {
+        const fmu_t *leader = schedule->workers[w];
+        for (int i = 0; i < leader->nb_group; i += 1)
+            logger(&container->logger, LOGGER_DEBUG, "FMU '%s' is stepped by thread #%d (%.3fus/step)",
+                   leader->group[i]->name, w + 1, schedule->cost[leader->group[i]->index] / 1.0e3);
+    }
+
+    schedule->grouped = true;
+
+    return;
+}
+
+
+/*----------------------------------------------------------------------------
+                                D O   S T E P
+----------------------------------------------------------------------------*/
+
+static fmu_status_t container_do_one_step_sequential(container_t *container) {
+    fmu_status_t status = FMU_STATUS_OK;
+
+    container->need_event_update = false;
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        fmu_t* fmu = &container->fmu[i];
+        
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, fmu, PROFILE_SET_INPUTS);
+        status = fmu_set_inputs(fmu);
+        CONTAINER_TRACE_FMU(TRACE_END, fmu, PROFILE_SET_INPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed set inputs.", container->fmu[i].name);
+            return status;
+        }
+        
+        /* COMPUTATION */
+
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, fmu, PROFILE_DO_STEP);
+        status = fmuDoStep(fmu, container->time, container->next_step);
+        CONTAINER_TRACE_FMU(TRACE_END, fmu, PROFILE_DO_STEP);
+        if (status != FMU_STATUS_OK)
+            return status;
+        container->need_event_update |= fmu->need_event_udpate;
+
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, fmu, PROFILE_GET_OUTPUTS);
+        status = fmu_get_outputs(fmu);
+        CONTAINER_TRACE_FMU(TRACE_END, fmu, PROFILE_GET_OUTPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", container->fmu[i].name);
+            return status;
+        }
+    }
+
+    return status;
+}
+
+
+static fmu_status_t container_do_one_step_parallel_mt(container_t* container) {
+    container_schedule_t *schedule = &container->schedule;
+    fmu_status_t status = FMU_STATUS_OK;
+
+    container->need_event_update = false;
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        container->fmu[i].status = FMU_STATUS_ERROR;
+
+    /* Messages of worker threads are given to importer at the end of the step */
+    logger_defer(&container->logger, true);
+    for (int i = 0; i < schedule->nb_workers; i += 1)
+        thread_mutex_unlock(&schedule->workers[i]->mutex_container);
+
+    /* Tiny FMUs are stepped by main thread meanwhile */
+    for (int i = 0; i < schedule->nb_inline; i += 1) {
+        if (fmu_do_step_inline(schedule->order[i]) != FMU_STATUS_OK)
+            break;
+    }
+
+    for (int i = 0; i < schedule->nb_workers; i += 1)
+        thread_mutex_lock(&schedule->workers[i]->mutex_fmu);
+    logger_defer(&container->logger, false);
+
+    /* Consolidate results */
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        fmu_t* fmu = &container->fmu[i];
+
+        if (fmu->status != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        container->need_event_update |= fmu->need_event_udpate;
+    }
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        status = fmu_get_outputs(&container->fmu[i]);
+        CONTAINER_TRACE_FMU(TRACE_END, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", container->fmu[i].name);
+            return FMU_STATUS_ERROR;
+        }
+    }
+
+    container_schedule_update(container, 1);
+
+    return status;
+}
+
+
+static fmu_status_t container_do_one_step_parallel(container_t* container) {
+    fmu_status_t status = FMU_STATUS_OK;
+
+    /* STEP MODE */
+    container->need_event_update = false;
+    for (int i = 0; i < container->nb_fmu; i += 1) {          
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, &container->fmu[i], PROFILE_SET_INPUTS);
+        status = fmu_set_inputs(&container->fmu[i]);
+        CONTAINER_TRACE_FMU(TRACE_END, &container->fmu[i], PROFILE_SET_INPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed set inputs.", container->fmu[i].name);
+            return status;
+        }
+    }
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        fmu_t* fmu = &container->fmu[i];
+        /* COMPUTATION */
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, fmu, PROFILE_DO_STEP);
+        status = fmuDoStep(fmu, container->time, container->next_step);
+        CONTAINER_TRACE_FMU(TRACE_END, fmu, PROFILE_DO_STEP);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed doStep.", container->fmu[i].name);
+            return status;
+        }
+        container->need_event_update |= fmu->need_event_udpate;
+    }
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        status = fmu_get_outputs(&container->fmu[i]);
+        CONTAINER_TRACE_FMU(TRACE_END, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed get outputs.", container->fmu[i].name);
+            return status;
+        }
+    }
+
+    return status;
+}
+
+
+/*
+ * AUTO mode: parallel mode with mono thread and parallel mode with multi thread give the same
+ * results. Each one is timed during CONTAINER_AUTO_TRIAL_STEPS steps (doStep of all FMUs and
+ * synchronization of threads). The fastest is used until the next evaluation.
+ */
+#define CONTAINER_AUTO_WARMUP_STEPS     16      /* first steps of each trial are not measured */
+#define CONTAINER_AUTO_TRIAL_STEPS      128
+#define CONTAINER_AUTO_PERIOD_STEPS     20000   /* steps between two evaluations */
+#define CONTAINER_STRATEGY_VR           1       /* integers32 local exported as container.strategy */
+
+static const container_do_step_function_t container_strategy_do_step[CONTAINER_NB_STRATEGIES] = {
+    container_do_one_step_sequential,
+    container_do_one_step_parallel,
+    container_do_one_step_parallel_mt
+};
+
+
+static const char *container_strategy_name(container_strategy_t strategy) {
+    switch (strategy) {
+    case CONTAINER_STRATEGY_SEQUENTIAL:
+        return "SEQUENTIAL mode";
+    case CONTAINER_STRATEGY_PARALLEL:
+        return "PARALLEL mode with MONO thread";
+    case CONTAINER_STRATEGY_PARALLEL_MT:
+        return "PARALLEL mode with MULTI thread";
+    default:
+        return "unknown mode";
+    }
+}
+
+
+static void container_auto_select(container_t *container) {
+    container_auto_t *strategy = &container->strategy;
+    const double mono = (double)strategy->elapsed[CONTAINER_STRATEGY_PARALLEL] /
+                        (double)strategy->nb[CONTAINER_STRATEGY_PARALLEL] / 1.0e3;
+    const double multi = (double)strategy->elapsed[CONTAINER_STRATEGY_PARALLEL_MT] /
+                         (double)strategy->nb[CONTAINER_STRATEGY_PARALLEL_MT] / 1.0e3;
+    const container_strategy_t selected = (multi < mono) ? CONTAINER_STRATEGY_PARALLEL_MT : CONTAINER_STRATEGY_PARALLEL;
+
+    logger(&container->logger, (strategy->evaluated && selected == strategy->selected) ? LOGGER_DEBUG : LOGGER_WARNING,
+           "Container AUTO mode selects %s at time=%e (MONO: %.3fus/step, MULTI: %.3fus/step)",
+           container_strategy_name(selected), container->time, mono, multi);
+
+    strategy->selected = selected;
+    strategy->evaluated = true;
+
+    return;
+}
+
+
+static fmu_status_t container_do_one_step_auto(container_t *container) {
+    container_auto_t *strategy = &container->strategy;
+    fmu_status_t status;
+    container_strategy_t current;
+
+    if (strategy->steps < 2 * CONTAINER_AUTO_TRIAL_STEPS) {
+        /* Evaluation: MONO thread trial then MULTI thread trial */
+        const unsigned long trial_step = strategy->steps % CONTAINER_AUTO_TRIAL_STEPS;
+        current = (strategy->steps < CONTAINER_AUTO_TRIAL_STEPS) ? CONTAINER_STRATEGY_PARALLEL : CONTAINER_STRATEGY_PARALLEL_MT;
+
+        const profile_tic_t start = profile_now();
+        status = container_strategy_do_step[current](container);
+        if (trial_step >= CONTAINER_AUTO_WARMUP_STEPS) {
+            strategy->elapsed[current] += profile_now() - start;
+            strategy->nb[current] += 1;
+        }
+        strategy->steps += 1;
+
+        if (strategy->steps == 2 * CONTAINER_AUTO_TRIAL_STEPS)
+            container_auto_select(container);
+    } else {
+        current = strategy->selected;
+        status = container_strategy_do_step[current](container);
+        strategy->steps += 1;
+
+        if (strategy->steps >= CONTAINER_AUTO_PERIOD_STEPS) {
+            strategy->steps = 0;
+            for (int i = 0; i < CONTAINER_NB_STRATEGIES; i += 1) {
+                strategy->elapsed[i] = 0;
+                strategy->nb[i] = 0;
+            }
+        }
+    }
+
+    if (container->nb_local_integers32 > CONTAINER_STRATEGY_VR)
+        container->integers32[CONTAINER_STRATEGY_VR] = (int32_t)current;
+
+    return status;
+}
+
+
+/*
+ * Profiling statistics are stored in reals64 after the RT ratios: for each FMU,
+ * PROFILE_NB_FMU_PHASES x PROFILE_NB_STATS values, followed by the container datalog phase.
+ */
+static void container_profile_export(container_t *container) {
+    double *values = &container->reals64[container->profile_offset];
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        profile_export(container->fmu[i].profile, 0, PROFILE_NB_FMU_PHASES, values);
+        values += PROFILE_NB_FMU_PHASES * PROFILE_NB_STATS;
+    }
+    profile_export(container->profile, PROFILE_DATALOG, PROFILE_NB_PHASES, values);
+
+    return;
+}
+
+
+/* Profiling: steps where outputs of each FMU have changed */
+static void container_profile_activity(container_t *container) {
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        fmu_outputs_activity(&container->fmu[i]);
+
+    return;
+}
+
+
+/*
+ * Profile of the run (JSON) to optimize the container at build time: cost of phases and
+ * activity of outputs of each FMU. Written if profiling is enabled and resources/profile.txt
+ * gives the filename (relative to the resources directory):
+ * # Profile filename
+ * container-profile.json
+ */
+static char *container_profile_filename(const container_t *container, const char *dirname) {
+    config_file_t config;
+    char *filename = NULL;
+
+    if (config_file_open(&config, &container->logger, dirname, "profile.txt"))
+        return NULL;
+
+    if (get_line(&config))
+        logger(&container->logger, LOGGER_ERROR, "Cannot determine profile file name");
+    else {
+        const size_t size = strlen(dirname) + 1 + strlen(config.line) + 1;
+        filename = malloc(size);
+        if (filename)
+            snprintf(filename, size, "%s/%s", dirname, config.line);
+    }
+    config_file_close(&config);
+
+    return filename;
+}
+
+
+static double container_profile_mean(const profile_t *profile, profile_phase_t phase) {
+    const profile_stats_t *stats = &profile->phases[phase];
+
+    return stats->nb ? (double)stats->total / (double)stats->nb : 0.0;
+}
+
+
+static void container_profile_write(const container_t *container) {
+    FILE *fp = fopen(container->profile_filename, "wt");
+    if (!fp) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot open profile file '%s': %s", container->profile_filename, strerror(errno));
+        return;
+    }
+
+    fprintf(fp, "{\n  \"version\": 1,\n  \"nb_cpu\": %d,\n  \"fmu\": [\n", container->schedule.nb_cpu);
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        const fmu_t *fmu = &container->fmu[i];
+        const unsigned long long steps = fmu->profile->phases[PROFILE_DO_STEP].nb;
+
+        fprintf(fp, "    {\"name\": ");
+        trace_write_string(fp, fmu->name);
+        fprintf(fp, ", \"steps\": %llu, \"set_inputs\": %.1f, \"do_step\": %.1f, "
+                "\"get_outputs\": %.1f, \"activity\": %.6f}%s\n",
+                steps,
+                container_profile_mean(fmu->profile, PROFILE_SET_INPUTS),
+                container_profile_mean(fmu->profile, PROFILE_DO_STEP),
+                container_profile_mean(fmu->profile, PROFILE_GET_OUTPUTS),
+                steps ? (double)fmu->outputs_changes / (double)steps : 0.0,
+                (i + 1 < container->nb_fmu) ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+
+    logger(&container->logger, LOGGER_WARNING, "Profile written to '%s'.", container->profile_filename);
+
+    return;
+}
+
+
+static fmu_status_t container_do_one_step(container_t *container) {
+    if (container->extrapolation.nb)
+        container_extrapolation_predict(container, container->time + container->next_step / 2.0);
+
+    if (!container->integrator)
+        return container->do_step(container);
+
+    fmu_status_t status = container->do_step(container);
+    if (status != FMU_STATUS_OK)
+        return status;
+
+    return integrator_do_step(container);
+}
+
+
+/*
+ * Step with early return allowed. The state of the container is kept before the step: if
+ * FMUs return early, all FMUs are rolled back and the step is done again up to the earliest
+ * lastSuccessfulTime, where events are handled. If an FMU made no progress, the FMUs which
+ * returned early at current time keep their state and the step is cancelled.
+ */
+static fmu_status_t container_do_step_rollback(container_t *container) {
+    bool truncated = false;
+    fmu_status_t status;
+
+    if (!container->rollback) {
+        container->rollback = checkpoint_new(container);
+        if (!container->rollback)
+            return FMU_STATUS_ERROR;
+    } else if (checkpoint_get(container, container->rollback) != FMU_STATUS_OK)
+        return FMU_STATUS_ERROR;
+
+    for (;;) {
+        status = container_do_one_step(container);
+        if (status != FMU_STATUS_OK)
+            return status;
+
+        const double end_time = container->time + container->next_step;
+        double last_time = end_time;
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            const fmu_t *fmu = &container->fmu[i];
+            if (fmu->early_return && (fmu->last_successful_time < last_time))
+                last_time = fmu->last_successful_time;
+        }
+        if (is_close(container, last_time, end_time)) {
+            /* events are handled at lastSuccessfulTime */
+            if (truncated)
+                container->need_event_update = true;
+            return FMU_STATUS_OK;
+        }
+
+        if (is_close(container, last_time, container->time) || (last_time < container->time)) {
+            for (int i = 0; i < container->nb_fmu; i += 1) {
+                const fmu_t *fmu = &container->fmu[i];
+                container->rollback_keep[i] = fmu->early_return && is_close(container, fmu->last_successful_time, container->time);
+            }
+            status = checkpoint_rollback(container, container->rollback, container->rollback_keep);
+            container->next_step = 0.0;
+            container->need_event_update = true;
+#ifdef DEBUG
+            logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | early return without progress", container->time);
+#endif
+            return status;
+        }
+
+        status = checkpoint_rollback(container, container->rollback, NULL);
+        if (status != FMU_STATUS_OK)
+            return status;
+        container->next_step = last_time - container->time;
+        truncated = true;
+#ifdef DEBUG
+        logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | early return: step truncated to ts=%e", container->time, container->next_step);
+#endif
+    }
+}
+
+
+/*
+ * Internal step of multiplier x time_step. It may be split by events.
+ */
+static fmu_status_t container_do_internal_step(container_t *container, int multiplier) {
+    fmu_status_t status = FMU_STATUS_OK;
+
+    container->time = container->start_time + container->time_step * container->nb_steps;
+    const double target_time = container->time + container->time_step * multiplier;
+
+    while(! is_close(container, container->time, target_time)) {
+        /* STEP MODE */
+        if (container->time + container->next_step > target_time) {
+            container->next_step = target_time - container->time;
+        }
+        CONTAINER_TRACE(TRACE_BEGIN, TRACE_TRACK_STEPS, "step");
+        container_datalog(container);
+#ifdef DEBUG
+        logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | do_step ts=%e", container->time, container->next_step);
+#endif
+        if (container->early_return)
+            status = container_do_step_rollback(container);
+        else
+            status = container_do_one_step(container);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container cannot Do Step (time=%e)", container->time);
+            return status;
+        }
+        if (container->profile)
+            container_profile_activity(container);
+        container->time += container->next_step;
+
+        /* EVENT MODE */
+        status = container_handle_events(container);
+        CONTAINER_TRACE(TRACE_END, TRACE_TRACK_STEPS, "step");
+        if ( status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container cannot Handle Events (time=%e)", container->time);
+            return status;
+        }
+        if (container->extrapolation.nb)
+            container_extrapolation_sample(container);
+    }
+    container->nb_steps += multiplier;
+
     return status;
 }
 
 
+/*
+ * ASYNC mode: nb_steps internal steps of multiplier x time_step. Threads do not wait for each
+ * other at each internal step: an FMU only waits for its own producers and consumers (see
+ * fmu_async_wait). All FMUs are synchronized again at the communication point where local
+ * variables are refreshed and events are handled. Datalog is written there only: in between, FMUs
+ * are not at the same internal step.
+ */
+static fmu_status_t container_do_steps_async(container_t *container, int nb_steps, int multiplier) {
+    container_schedule_t *schedule = &container->schedule;
+    container_async_t *async = &container->async;
+    fmu_status_t status;
+
+    container->time = container->start_time + container->time_step * container->nb_steps;
+    CONTAINER_TRACE(TRACE_BEGIN, TRACE_TRACK_STEPS, "step");
+    container_datalog(container);
+
+    async->nb_steps = nb_steps;
+    async->first_step = container->nb_steps;
+    async->multiplier = multiplier;
+    thread_atomic_store(&async->failed, 0);
+    thread_atomic_store(&async->need_event_update, 0);
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        thread_atomic_store(&async->completed[i], 0);
+        container->fmu[i].status = FMU_STATUS_ERROR;
+    }
+
+    /* Slot 0: local variables at communication point */
+#define ASYNC_HISTORY_INIT(name) \
+    if (container->nb_local_ ## name) \
+        memcpy(async->history_ ## name, container-> name, container->nb_local_ ## name * sizeof(*container-> name))
+
+    ASYNC_HISTORY_INIT(reals64);
+    ASYNC_HISTORY_INIT(reals32);
+    ASYNC_HISTORY_INIT(integers8);
+    ASYNC_HISTORY_INIT(uintegers8);
+    ASYNC_HISTORY_INIT(integers16);
+    ASYNC_HISTORY_INIT(uintegers16);
+    ASYNC_HISTORY_INIT(integers32);
+    ASYNC_HISTORY_INIT(uintegers32);
+    ASYNC_HISTORY_INIT(integers64);
+    ASYNC_HISTORY_INIT(uintegers64);
+    ASYNC_HISTORY_INIT(booleans);
+    ASYNC_HISTORY_INIT(booleans1);
+#undef ASYNC_HISTORY_INIT
+
+    logger_defer(&container->logger, true);
+    for (int i = 0; i < schedule->nb_workers; i += 1)
+        thread_mutex_unlock(&schedule->workers[i]->mutex_container);
+
+    fmu_do_steps_async_inline(container, schedule->order, schedule->nb_inline);
+
+    for (int i = 0; i < schedule->nb_workers; i += 1)
+        thread_mutex_lock(&schedule->workers[i]->mutex_fmu);
+    logger_defer(&container->logger, false);
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        if (container->fmu[i].status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container cannot Do Step of FMU '%s' in ASYNC mode (time=%e)",
+                   container->fmu[i].name, container->time);
+            return FMU_STATUS_ERROR;
+        }
+    }
+
+    container->nb_steps += (long long)nb_steps * multiplier;
+    container->time = container->start_time + container->time_step * container->nb_steps;
+    container->need_event_update = thread_atomic_load(&async->need_event_update) != 0;
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        status = fmu_get_outputs(&container->fmu[i]);
+        CONTAINER_TRACE_FMU(TRACE_END, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", container->fmu[i].name);
+            return FMU_STATUS_ERROR;
+        }
+    }
+    if (container->profile)
+        container_profile_activity(container);
+
+    status = container_handle_events(container);
+    CONTAINER_TRACE(TRACE_END, TRACE_TRACK_STEPS, "step");
+    if (status != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Container cannot Handle Events (time=%e)", container->time);
+        return status;
+    }
+
+    container_schedule_update(container, (unsigned long)nb_steps);
+
+    return FMU_STATUS_OK;
+}
+
+
+/*
+ * Waveform relaxation: largest difference between the outputs of the two last iterations,
+ * relative to the tolerance. Window is converged if it is not greater than 1.
+ */
+static double container_waveform_error(const container_t *container) {
+    const container_waveform_t *waveform = &container->waveform;
+    double error = 0.0;
+
+#define WAVEFORM_ERROR(name)                                                                            \
+    for (int i = 0; i < container->nb_fmu; i += 1) {                                                    \
+        const fmu_translation_list_t *out = &container->fmu[i].fmu_io. name .out;                       \
+        for (unsigned long j = 0; j < out->nb; j += 1) {                                                \
+            for (int step = 1; step <= waveform->nb_steps; step += 1) {                                 \
+                const unsigned long offset = step * container->nb_local_ ## name + out->translations[j].vr; \
+                for (unsigned int k = 0; k < out->translations[j].dimension; k += 1) {                  \
+                    const double current = (double)waveform->current_ ## name [offset + k];             \
+                    const double previous = (double)waveform->previous_ ## name [offset + k];           \
+                    const double e = fabs(current - previous) / (waveform->tolerance * (1.0 + fabs(current))); \
+                    if (e > error)                                                                      \
+                        error = e;                                                                      \
+                }                                                                                       \
+            }                                                                                           \
+        }                                                                                               \
+    }
+
+    WAVEFORM_ERROR(reals64);
+    WAVEFORM_ERROR(reals32);
+    WAVEFORM_ERROR(integers8);
+    WAVEFORM_ERROR(uintegers8);
+    WAVEFORM_ERROR(integers16);
+    WAVEFORM_ERROR(uintegers16);
+    WAVEFORM_ERROR(integers32);
+    WAVEFORM_ERROR(uintegers32);
+    WAVEFORM_ERROR(integers64);
+    WAVEFORM_ERROR(uintegers64);
+    WAVEFORM_ERROR(booleans);
+    WAVEFORM_ERROR(booleans1);
+#undef WAVEFORM_ERROR
+
+    return error;
+}
+
+
+/*
+ * Waveform relaxation: window of nb_steps internal steps of multiplier x time_step. All
+ * embedded FMUs simulate the whole window in parallel (Jacobi iteration) with inputs recorded
+ * during the previous iteration: they are synchronized once per iteration. The window is
+ * rolled back and simulated again until the outputs of two iterations are close enough.
+ * First iteration holds the values of the local variables at the beginning of the window.
+ * Datalog is written at the beginning of the window only: outputs which are not linked are
+ * read from the FMUs, which are at the end of the window.
+ */
+static fmu_status_t container_do_window(container_t *container, int nb_steps, int multiplier) {
+    container_schedule_t *schedule = &container->schedule;
+    container_waveform_t *waveform = &container->waveform;
+    fmu_status_t status;
+    double error = 0.0;
+    int iteration;
+
+    container->time = container->start_time + container->time_step * container->nb_steps;
+    CONTAINER_TRACE(TRACE_BEGIN, TRACE_TRACK_STEPS, "step");
+    container_datalog(container);
+
+    waveform->nb_steps = nb_steps;
+    waveform->first_step = container->nb_steps;
+    waveform->multiplier = multiplier;
+
+    if (!container->rollback) {
+        container->rollback = checkpoint_new(container);
+        if (!container->rollback)
+            return FMU_STATUS_ERROR;
+    } else if (checkpoint_get(container, container->rollback) != FMU_STATUS_OK)
+        return FMU_STATUS_ERROR;
+
+    /* All slots: local variables at the beginning of the window */
+#define WAVEFORM_INIT(name)                                                                             \
+    for (int step = 0; step <= nb_steps; step += 1) {                                                   \
+        if (container->nb_local_ ## name) {                                                             \
+            memcpy(&waveform->previous_ ## name [step * container->nb_local_ ## name], container-> name, \
+                   container->nb_local_ ## name * sizeof(*container-> name));                           \
+            memcpy(&waveform->current_ ## name [step * container->nb_local_ ## name], container-> name,  \
+                   container->nb_local_ ## name * sizeof(*container-> name));                           \
+        }                                                                                               \
+    }
+
+    WAVEFORM_INIT(reals64);
+    WAVEFORM_INIT(reals32);
+    WAVEFORM_INIT(integers8);
+    WAVEFORM_INIT(uintegers8);
+    WAVEFORM_INIT(integers16);
+    WAVEFORM_INIT(uintegers16);
+    WAVEFORM_INIT(integers32);
+    WAVEFORM_INIT(uintegers32);
+    WAVEFORM_INIT(integers64);
+    WAVEFORM_INIT(uintegers64);
+    WAVEFORM_INIT(booleans);
+    WAVEFORM_INIT(booleans1);
+#undef WAVEFORM_INIT
+
+    for (iteration = 1; iteration <= waveform->max_iterations; iteration += 1) {
+        if (iteration > 1) {
+            status = checkpoint_rollback(container, container->rollback, NULL);
+            if (status != FMU_STATUS_OK) {
+                logger(&container->logger, LOGGER_ERROR, "Container cannot roll back window (time=%e)", container->time);
+                return status;
+            }
+        }
+
+        thread_atomic_store(&waveform->need_event_update, 0);
+        for (int i = 0; i < container->nb_fmu; i += 1)
+            container->fmu[i].status = FMU_STATUS_ERROR;
+
+        if (container_use_threads(container)) {
+            logger_defer(&container->logger, true);
+            for (int i = 0; i < schedule->nb_workers; i += 1)
+                thread_mutex_unlock(&schedule->workers[i]->mutex_container);
+
+            fmu_do_steps_waveform_inline(container, schedule->order, schedule->nb_inline);
+
+            for (int i = 0; i < schedule->nb_workers; i += 1)
+                thread_mutex_lock(&schedule->workers[i]->mutex_fmu);
+            logger_defer(&container->logger, false);
+        } else
+            fmu_do_steps_waveform_inline(container, schedule->order, container->nb_fmu);
+
+        for (int i = 0; i < container->nb_fmu; i += 1) {
+            if (container->fmu[i].status != FMU_STATUS_OK) {
+                logger(&container->logger, LOGGER_ERROR, "Container cannot Do Step of FMU '%s' in window (time=%e)",
+                       container->fmu[i].name, container->time);
+                return FMU_STATUS_ERROR;
+            }
+        }
+
+        error = container_waveform_error(container);
+
+        /* Last outputs are the inputs of next iteration */
+#define WAVEFORM_SWAP(name) {                                                                           \
+        void *swap = waveform->previous_ ## name;                                                       \
+        waveform->previous_ ## name = waveform->current_ ## name;                                       \
+        waveform->current_ ## name = swap;                                                              \
+    }
+
+        WAVEFORM_SWAP(reals64);
+        WAVEFORM_SWAP(reals32);
+        WAVEFORM_SWAP(integers8);
+        WAVEFORM_SWAP(uintegers8);
+        WAVEFORM_SWAP(integers16);
+        WAVEFORM_SWAP(uintegers16);
+        WAVEFORM_SWAP(integers32);
+        WAVEFORM_SWAP(uintegers32);
+        WAVEFORM_SWAP(integers64);
+        WAVEFORM_SWAP(uintegers64);
+        WAVEFORM_SWAP(booleans);
+        WAVEFORM_SWAP(booleans1);
+#undef WAVEFORM_SWAP
+
+        if (error <= 1.0)
+            break;
+    }
+
+    if (error > 1.0)
+        logger(&container->logger, LOGGER_WARNING, "Window is not converged after %d iterations (time=%e, error=%g)",
+               waveform->max_iterations, container->time, error);
+#ifdef DEBUG
+    else
+        logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | window converged after %d iterations", container->time, iteration);
+#endif
+
+    container->nb_steps += (long long)nb_steps * multiplier;
+    container->time = container->start_time + container->time_step * container->nb_steps;
+    container->need_event_update = thread_atomic_load(&waveform->need_event_update) != 0;
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        CONTAINER_TRACE_FMU(TRACE_BEGIN, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        status = fmu_get_outputs(&container->fmu[i]);
+        CONTAINER_TRACE_FMU(TRACE_END, &container->fmu[i], PROFILE_GET_OUTPUTS);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", container->fmu[i].name);
+            return FMU_STATUS_ERROR;
+        }
+    }
+    if (container->profile)
+        container_profile_activity(container);
+
+    status = container_handle_events(container);
+    CONTAINER_TRACE(TRACE_END, TRACE_TRACK_STEPS, "step");
+    if (status != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Container cannot Handle Events (time=%e)", container->time);
+        return status;
+    }
+
+    if (container_use_threads(container))
+        container_schedule_update(container, (unsigned long)nb_steps);
+
+    return FMU_STATUS_OK;
+}
+
+
 fmu_status_t container_do_step(container_t* container, double currentCommunicationPoint, double communicationStepSize) {
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | container_do_step(%e, %e)", container->time, currentCommunicationPoint, communicationStepSize);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | container_do_step(%e, %e)", container->time, currentCommunicationPoint, communicationStepSize);
 #endif
     fmu_status_t status = FMU_STATUS_OK;
     const double end_time = currentCommunicationPoint + communicationStepSize;
     int ts_multiplier = container->integers32[0];
 
-    if (ts_multiplier < 1)
+    /* TS_MULTIPLIER is ignored when internal step is adaptive */
+    if ((ts_multiplier < 1) || container->adaptive.min_multiplier)
         ts_multiplier = 1;
 
     const double ts = container->time_step * ts_multiplier;
@@ -515,52 +1744,193 @@ fmu_status_t container_do_step(container_t* container, double currentCommunicati
     const int local_steps = ((int)((end_time - container->time + container->tolerance) / ts));
 
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | container do_step: end_time=%e, local_steps=%d", container->time, end_time, local_steps);
+    logger(&container->logger, LOGGER_DEBUG, "[DEBUG] time=%e | container do_step: end_time=%e, local_steps=%d", container->time, end_time, local_steps);
 #endif
     /*
      * Early return if requested end_time is lower than next container time step.
      */
     if (local_steps > 0) {
-        for(int i = 0; i < local_steps; i += 1) {
-            container->time = container->start_time + container->time_step * container->nb_steps;
-            const double target_time = container->time + ts;
-
-            while(! is_close(container, container->time, target_time)) {
-                /* STEP MODE */
-                if (container->time + container->next_step > target_time) {
-                    container->next_step = target_time - container->time;
-                }
-                datalog_log(container);
-#ifdef DEBUG
-                logger(LOGGER_DEBUG, "[DEBUG] time=%e | do_step ts=%e", container->time, container->next_step);
-#endif
-                status = container->do_step(container);
-                if (status != FMU_STATUS_OK) {
-                    logger(LOGGER_ERROR, "Container cannot Do Step (time=%e)", container->time);
+        if (container->async.max_lag >= 0) {
+            status = container_do_steps_async(container, local_steps, ts_multiplier);
+            if (status != FMU_STATUS_OK)
+                return status;
+        } else if (container->waveform.window) {
+            /* Windows do not cross communication points */
+            for (int i = 0; i < local_steps; i += container->waveform.window) {
+                const int nb_steps = (local_steps - i < container->waveform.window) ?
+                                     local_steps - i : container->waveform.window;
+                status = container_do_window(container, nb_steps, ts_multiplier);
+                if (status != FMU_STATUS_OK)
                     return status;
-                }
-                container->time += container->next_step;
-
-                /* EVENT MODE */
-                status = container_handle_events(container);
-                if ( status != FMU_STATUS_OK) {
-                    logger(LOGGER_ERROR, "Container cannot Handle Events (time=%e)", container->time);
+            }
+        } else if (container->adaptive.min_multiplier) {
+            /* Adaptive step is shortened to land on end_time */
+            int remaining = local_steps;
+            while (remaining > 0) {
+                const int multiplier = (container->adaptive.multiplier < remaining) ?
+                                       container->adaptive.multiplier : remaining;
+                status = container_do_internal_step(container, multiplier);
+                if (status != FMU_STATUS_OK)
+                    return status;
+                container_adaptive_update(container);
+                remaining -= multiplier;
+            }
+        } else {
+            for(int i = 0; i < local_steps; i += 1) {
+                status = container_do_internal_step(container, ts_multiplier);
+                if (status != FMU_STATUS_OK)
                     return status;
-                }
             }
-            container->nb_steps += ts_multiplier;
-        }       
+        }
 
         container->time = container->start_time + container->time_step * container->nb_steps;
         if (fabs(end_time - container->time) > container->tolerance) {
-            logger(LOGGER_WARNING, "Container CommunicationStepSize should be divisible by %e. (currentCommunicationPoint=%e, container_time=%e, expected_time=%e, tolerance=%e, local_steps=%d, nb_steps=%lld)", 
+            logger(&container->logger, LOGGER_WARNING, "Container CommunicationStepSize should be divisible by %e. (currentCommunicationPoint=%e, container_time=%e, expected_time=%e, tolerance=%e, local_steps=%d, nb_steps=%lld)", 
                 container->time_step, currentCommunicationPoint, container->time, end_time, container->tolerance, local_steps, container->nb_steps);
         }
-    } 
+    } 
+
+    container->reals64[0] = end_time;
+    if (container->profile_offset)
+        container_profile_export(container);
+    
+    return status;
+}
+
+
+/*----------------------------------------------------------------------------
+                  S C H E D U L E D   E X E C U T I O N
+----------------------------------------------------------------------------*/
+
+/*
+ * The importer activates the partitions of the container, which are its input clocks. Only
+ * the embedded FMUs bound to the clock execute their partition: there is no event mode. Then
+ * the output clocks raised by an FMU activate the partitions of their consumers (see
+ * clock_consumers), after their clocked inputs are set. Exchange of local variables is
+ * protected against preemption by the importer; partitions of embedded FMUs are not.
+ */
+static void container_lock_preemption(const container_t *container) {
+    if (container->scheduled_execution.lock_preemption)
+        container->scheduled_execution.lock_preemption();
+
+    return;
+}
+
+
+static void container_unlock_preemption(const container_t *container) {
+    if (container->scheduled_execution.unlock_preemption)
+        container->scheduled_execution.unlock_preemption();
+
+    return;
+}
+
+
+static fmu_status_t container_activate_fmu_partition(container_t *container, fmu_t *fmu, fmu_vr_t clock,
+                                                     double activation_time, unsigned long depth) {
+    fmu_status_t status;
+
+    /* Each level of recursion goes through another local clock, unless they make a loop */
+    if (depth > container->nb_local_clocks) {
+        logger(&container->logger, LOGGER_ERROR, "Container: loop of clocks through FMU '%s'.", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+
+    container_lock_preemption(container);
+    status = fmu_set_inputs(fmu);
+    container_unlock_preemption(container);
+    if (status != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed set inputs.", fmu->name);
+        return status;
+    }
+
+    status = fmuActivateModelPartition(fmu, clock, activation_time);
+    if (status != FMU_STATUS_OK)
+        return status;
+
+    container_lock_preemption(container);
+    status = fmu_get_outputs(fmu);
+    if (status == FMU_STATUS_OK)
+        status = fmu_get_clocked_outputs(fmu);
+    container_unlock_preemption(container);
+    if (status != FMU_STATUS_OK) {
+        logger(&container->logger, LOGGER_ERROR, "Container: FMU '%s' failed getting outputs.", fmu->name);
+        return status;
+    }
+
+    const fmu_translation_list_t *clocks = &fmu->fmu_io.clocks.out;
+    for (unsigned long i = 0; i < clocks->nb; i += 1) {
+        const fmu_vr_t local_clock = clocks->translations[i].vr;
+        if (!container->clocks[local_clock])
+            continue;
+
+        const fmu_clock_consumer_list_t *list = &container->clock_consumers[local_clock];
+        container_lock_preemption(container);
+        for (unsigned long j = 0; j < list->nb; j += 1) {
+            const fmu_clock_consumer_t *consumer = &list->consumers[j];
+            if (consumer->type != FMU_CLOCK_CONSUMER_CLOCK) {
+                status = fmu_set_clock_consumer(&container->fmu[consumer->fmu_id], consumer);
+                if (status != FMU_STATUS_OK)
+                    break;
+            }
+        }
+        container->clocks[local_clock] = false;
+        container_unlock_preemption(container);
+        if (status != FMU_STATUS_OK)
+            return status;
+
+        for (unsigned long j = 0; j < list->nb; j += 1) {
+            const fmu_clock_consumer_t *consumer = &list->consumers[j];
+            if (consumer->type == FMU_CLOCK_CONSUMER_CLOCK) {
+                fmu_t *consumer_fmu = &container->fmu[consumer->fmu_id];
+                const fmu_vr_t consumer_clock = consumer_fmu->fmu_io.clocks.in.translations[consumer->index].fmu_vr;
+                status = container_activate_fmu_partition(container, consumer_fmu, consumer_clock, activation_time, depth + 1);
+                if (status != FMU_STATUS_OK)
+                    return status;
+            }
+        }
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t container_activate_model_partition(container_t *container, unsigned long vr, double activation_time) {
+    if (!container->scheduled_execution.enabled || (vr >= container->nb_ports_clocks)) {
+        logger(&container->logger, LOGGER_ERROR, "Container: no partition for clock vr=%lu.", vr);
+        return FMU_STATUS_ERROR;
+    }
+
+    const container_port_t *port = &container->port_clocks[vr];
+    container_lock_preemption(container);
+    container->time = activation_time;
+    container_unlock_preemption(container);
+    for (unsigned long i = 0; i < port->nb; i += 1) {
+        const int fmu_id = port->links[i].fmu_id;
+        if (fmu_id < 0) {
+            logger(&container->logger, LOGGER_ERROR, "Container: clock vr=%lu is not bound to an embedded FMU.", vr);
+            return FMU_STATUS_ERROR;
+        }
+
+        fmu_status_t status = container_activate_fmu_partition(container, &container->fmu[fmu_id],
+                                                               port->links[i].fmu_vr, activation_time, 0);
+        if (status != FMU_STATUS_OK) {
+            logger(&container->logger, LOGGER_ERROR, "Container cannot activate partition (time=%e)", activation_time);
+            return status;
+        }
+    }
 
-    container->reals64[0] = end_time;
-    
-    return status;
+    container_lock_preemption(container);
+    container_datalog(container);
+    container_unlock_preemption(container);
+
+    return FMU_STATUS_OK;
+}
+
+
+/* Threads of embedded FMUs are used in MULTI thread mode (or if it may be selected at runtime) */
+bool container_use_threads(const container_t *container) {
+    return (container->do_step == container_do_one_step_parallel_mt) ||
+           (container->do_step == container_do_one_step_auto);
 }
 
 
@@ -588,7 +1958,10 @@ fmu_status_t container_do_step(container_t* container, double currentCommunicati
 /*
  * # Container flags <MT> <Profiling> <Sequential>
  * 1 0 0 
+ * MT flag: 0 (mono thread), 1 (multi thread) or 2 (AUTO: selected at runtime)
  */
+#define CONTAINER_MT_AUTO   2
+
 static int read_flags(container_t* container, config_file_t* file) {
     int mt, sequential;
 
@@ -599,20 +1972,25 @@ static int read_flags(container_t* container, config_file_t* file) {
     }
 
     if (sequential) {
-        logger(LOGGER_WARNING, "Container use SEQUENTIAL mode.");
+        logger(&container->logger, LOGGER_WARNING, "Container use SEQUENTIAL mode.");
+        if (mt == CONTAINER_MT_AUTO)
+            logger(&container->logger, LOGGER_WARNING, "Container AUTO mode is ignored in SEQUENTIAL mode.");
         container->do_step = container_do_one_step_sequential;
     } else {
-        if (mt) {
-            logger(LOGGER_WARNING, "Container use PARALLEL mode with MULTI thread");
+        if (mt == CONTAINER_MT_AUTO) {
+            logger(&container->logger, LOGGER_WARNING, "Container use PARALLEL mode with AUTO selection of MONO or MULTI thread.");
+            container->do_step = container_do_one_step_auto;
+        } else if (mt) {
+            logger(&container->logger, LOGGER_WARNING, "Container use PARALLEL mode with MULTI thread");
             container->do_step = container_do_one_step_parallel_mt;
         } else {
-            logger(LOGGER_WARNING, "Container use PARALLEL mode with MONO thread.");
+            logger(&container->logger, LOGGER_WARNING, "Container use PARALLEL mode with MONO thread.");
             container->do_step = container_do_one_step_parallel;
         }
     }
 
     if (container->profiling)
-        logger(LOGGER_WARNING, "Container use PROFILING");
+        logger(&container->logger, LOGGER_WARNING, "Container use PROFILING");
 
     return 0;
 }
@@ -629,7 +2007,7 @@ static int read_conf_time_step(container_t* container, config_file_t* file) {
         return -1;
     }
 
-    logger(LOGGER_DEBUG, "Container time_step = %es", container->time_step);
+    logger(&container->logger, LOGGER_DEBUG, "Container time_step = %es", container->time_step);
 
     return 0;
 }
@@ -644,6 +2022,9 @@ static int read_conf_time_step(container_t* container, config_file_t* file) {
  * array2scalar.fmu 3 1
  * array
  * {e092864e-3b8e-7e1d-a4bf-ee0e4c648539}
+ *
+ * FMU flags: <FMI version> <support event> [<worker>]. Optional worker is the MT mode group of
+ * the FMU (0: main thread), set at build time from a profile of a previous run.
  */
 static int read_conf_fmu(container_t *container, const char *dirname, config_file_t* file) {
     int nb_fmu;
@@ -654,7 +2035,7 @@ static int read_conf_fmu(container_t *container, const char *dirname, config_fil
         return -1;
     }
 
-    logger(LOGGER_DEBUG, "%d FMUs to be loaded.", nb_fmu);
+    logger(&container->logger, LOGGER_DEBUG, "%d FMUs to be loaded.", nb_fmu);
     if (!nb_fmu) {
         container->fmu = NULL;
         return 0;
@@ -670,11 +2051,13 @@ static int read_conf_fmu(container_t *container, const char *dirname, config_fil
         char* name = strdup(file->line);
         int fmi_version = 2;
         int support_event = 0;
+        int worker = -1;
+        int model_exchange = 0;
 
         for(size_t j=0; j < strlen(name); j += 1) {
             if (name[j] == ' ') {
                 name[j] = '\0';
-                if (sscanf(name+j+1, "%d %d", &fmi_version, &support_event) < 2) {
+                if (sscanf(name+j+1, "%d %d %d %d", &fmi_version, &support_event, &worker, &model_exchange) < 2) {
                     CONFIG_ERROR("Cannot read FMU flags from '%s'.", name + j + 1);
                     free(name);
                     return -2;
@@ -689,7 +2072,8 @@ static int read_conf_fmu(container_t *container, const char *dirname, config_fil
         CONFIG_GETLINE;
         const char *guid = file->line;
 
-        int status = fmu_load_from_directory(container, i, directory, name, identifier, guid, fmi_version, support_event);
+        int status = fmu_load_from_directory(container, i, directory, name, identifier, guid, fmi_version, support_event,
+                                             model_exchange);
         free(identifier);
         free(name);
         if (status) {
@@ -699,6 +2083,7 @@ static int read_conf_fmu(container_t *container, const char *dirname, config_fil
             container->nb_fmu = 0;
             return -1;
         }
+        container->fmu[i].worker = worker;
 
         container->nb_fmu = i + 1;  /* in case of error, free only loaded FMU */
     }
@@ -1206,7 +2591,7 @@ static int read_conf_fmu_conversion(fmu_t *fmu, config_file_t* file) {
         return -2;
     }
 
-    fmu->conversions = convert_new(nb);
+    fmu->conversions = convert_new(fmu->logger, nb);
     if (nb && !fmu->conversions) {
         CONFIG_ERROR("Cannot allocate conversion table for %lu entries.", nb);
         return -3;
@@ -1260,6 +2645,9 @@ static int read_conf_clocks(container_t *container, config_file_t *file) {
         CONFIG_ERROR("Cannot get size of clocks defintions table.");
         return -2;
     }
+    if (container->nb_fmu) {
+        CONFIG_ALLOC(container->clocks_list.fmu_query,          container->nb_fmu);
+    }
     if (container->clocks_list.nb_fmu) {
         CONFIG_ALLOC(container->clocks_list.counter,            container->clocks_list.nb_fmu);
 
@@ -1269,17 +2657,19 @@ static int read_conf_clocks(container_t *container, config_file_t *file) {
         CONFIG_ALLOC(container->clocks_list.fmu_id,             container->clocks_list.nb_local_clocks);
         CONFIG_ALLOC(container->clocks_list.next_clocks,        container->clocks_list.nb_local_clocks);
         CONFIG_ALLOC(container->clocks_list.clock_index,        container->clocks_list.nb_local_clocks);
-        CONFIG_ALLOC(container->clocks_list.buffer_previous,    container->clocks_list.nb_local_clocks);
+        CONFIG_ALLOC(container->clocks_list.next_tick,          container->clocks_list.nb_local_clocks);
+        CONFIG_ALLOC(container->clocks_list.heap,               container->clocks_list.nb_local_clocks);
+        CONFIG_ALLOC(container->clocks_list.heap_index,         container->clocks_list.nb_local_clocks);
 
         unsigned long pos = 0;
         for(unsigned long i = 0; i < container->clocks_list.nb_fmu; i += 1) {
             int offset;
 
             CONFIG_GETLINE;
-            if (sscanf(file->line, "%lu %lu %n",
+            if ((sscanf(file->line, "%lu %lu %n",
                 &container->clocks_list.counter[i].fmu_id,
                 &container->clocks_list.counter[i].nb,
-                &offset) < 2) {
+                &offset) < 2) || (container->clocks_list.counter[i].fmu_id >= (unsigned long)container->nb_fmu)) {
                 CONFIG_ERROR("Cannot interpret %luth clock table entries.", i);
                 return -5;
             }
@@ -1297,22 +2687,550 @@ static int read_conf_clocks(container_t *container, config_file_t *file) {
                 offset += read;
                 container->clocks_list.clock_index[pos] = local_clock_index & 0xFFFFFF;
                 container->clocks_list.fmu_id[pos] = container->clocks_list.counter[i].fmu_id;
+                container->clocks_list.next_tick[pos] = NAN;
                 pos += 1;
             }
         }
+        container_clocks_schedule(container);
     }
     
     return 0;
 }
 
 
+static int container_clocks_index(container_t *container) {
+    if (container->nb_fmu > 0) {
+        container->event_visit = calloc(container->nb_fmu, sizeof(*container->event_visit));
+        container->event_revisit = calloc(container->nb_fmu, sizeof(*container->event_revisit));
+        if (!container->event_visit || !container->event_revisit)
+            return -1;
+    }
+
+    if (container->nb_local_clocks == 0)
+        return 0;
+
+    container->clock_consumers = calloc(container->nb_local_clocks, sizeof(*container->clock_consumers));
+    container->consumed_clocks = calloc(container->nb_local_clocks, sizeof(*container->consumed_clocks));
+    if (!container->clock_consumers || !container->consumed_clocks)
+        return -1;
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        if (fmu_clock_consumers_append(&container->fmu[i], container->clock_consumers, container->nb_local_clocks))
+            return -2;
+    }
+
+    for (unsigned long i = 0; i < container->nb_local_clocks; i += 1) {
+        if (container->clock_consumers[i].nb) {
+            container->consumed_clocks[container->nb_consumed_clocks] = i;
+            container->nb_consumed_clocks += 1;
+        }
+    }
+
+    return 0;
+}
+
+
+static bool container_is_output_reals64(const container_t *container, unsigned long vr) {
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        const fmu_translation_list_t *out = &container->fmu[i].fmu_io.reals64.out;
+        for (unsigned long j = 0; j < out->nb; j += 1) {
+            if ((vr >= out->translations[j].vr) && (vr < out->translations[j].vr + out->translations[j].dimension))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+static int read_conf_extrapolation(container_t *container, config_file_t *file) {
+    container_extrapolation_t *extrapolation = &container->extrapolation;
+
+    if (sscanf(file->line, "EXTRAPOLATION %lu", &extrapolation->nb) < 1) {
+        CONFIG_ERROR("Cannot get number of extrapolated links.");
+        return -1;
+    }
+    if (extrapolation->nb == 0)
+        return 0;
+
+    CONFIG_ALLOC(extrapolation->vr, extrapolation->nb);
+    CONFIG_ALLOC(extrapolation->order, extrapolation->nb);
+    CONFIG_ALLOC(extrapolation->history, extrapolation->nb * CONTAINER_EXTRAPOLATION_SAMPLES);
+
+    for (unsigned long i = 0; i < extrapolation->nb; i += 1) {
+        CONFIG_GETLINE;
+        if (sscanf(file->line, "%lu %d", &extrapolation->vr[i], &extrapolation->order[i]) < 2) {
+            CONFIG_ERROR("Cannot interpret extrapolated link #%lu.", i);
+            return -3;
+        }
+        if ((extrapolation->order[i] < 0) || (extrapolation->order[i] >= CONTAINER_EXTRAPOLATION_SAMPLES) ||
+            !container_is_output_reals64(container, extrapolation->vr[i])) {
+            CONFIG_ERROR("Link #%lu cannot be extrapolated (vr=%lu, order=%d).", i, extrapolation->vr[i],
+                         extrapolation->order[i]);
+            return -4;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * # Adaptive step: ADAPTIVE <MIN_MULTIPLIER> <MAX_MULTIPLIER> <TOLERANCE>
+ * ADAPTIVE 1 100 0.001
+ * All reals64 outputs of embedded FMUs are monitored.
+ */
+static int read_conf_adaptive(container_t *container, config_file_t *file) {
+    container_adaptive_t *adaptive = &container->adaptive;
+
+    if ((sscanf(file->line, "ADAPTIVE %d %d %le", &adaptive->min_multiplier, &adaptive->max_multiplier,
+                &adaptive->tolerance) < 3) || (adaptive->min_multiplier < 1) ||
+        (adaptive->max_multiplier < adaptive->min_multiplier) || (adaptive->tolerance <= 0.0)) {
+        CONFIG_ERROR("Cannot interpret adaptive step.");
+        adaptive->min_multiplier = 0;
+        return -1;
+    }
+    adaptive->multiplier = adaptive->min_multiplier;
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        const fmu_translation_list_t *out = &container->fmu[i].fmu_io.reals64.out;
+        for (unsigned long j = 0; j < out->nb; j += 1)
+            adaptive->nb += out->translations[j].dimension;
+    }
+    if (adaptive->nb == 0)
+        return 0;
+
+    CONFIG_ALLOC(adaptive->vr, adaptive->nb);
+    CONFIG_ALLOC(adaptive->history, adaptive->nb * CONTAINER_ADAPTIVE_SAMPLES);
+
+    unsigned long n = 0;
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        const fmu_translation_list_t *out = &container->fmu[i].fmu_io.reals64.out;
+        for (unsigned long j = 0; j < out->nb; j += 1) {
+            for (unsigned int k = 0; k < out->translations[j].dimension; k += 1)
+                adaptive->vr[n++] = out->translations[j].vr + k;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * # Bounded-staleness asynchronous mode: ASYNC <MAX_LAG>
+ * ASYNC 2
+ */
+static int read_conf_async(container_t *container, config_file_t *file) {
+    if ((sscanf(file->line, "ASYNC %d", &container->async.max_lag) < 1) || (container->async.max_lag < 0)) {
+        CONFIG_ERROR("Cannot interpret asynchronous mode.");
+        container->async.max_lag = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * # Waveform relaxation: WAVEFORM <WINDOW> <MAX_ITERATIONS> <TOLERANCE>
+ * WAVEFORM 10 5 0.001
+ * WINDOW is expressed in internal steps.
+ */
+static int read_conf_waveform(container_t *container, config_file_t *file) {
+    container_waveform_t *waveform = &container->waveform;
+
+    if ((sscanf(file->line, "WAVEFORM %d %d %le", &waveform->window, &waveform->max_iterations,
+                &waveform->tolerance) < 3) || (waveform->window < 1) ||
+        (waveform->max_iterations < 1) || (waveform->tolerance <= 0.0)) {
+        CONFIG_ERROR("Cannot interpret waveform relaxation.");
+        waveform->window = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int fmu_translation_list_append(fmu_translation_list_t *list, fmu_vr_t vr, fmu_vr_t fmu_vr) {
+    fmu_translation_t *translations = realloc(list->translations, (list->nb + 1) * sizeof(*translations));
+
+    if (!translations)
+        return -1;
+    translations[list->nb].vr = vr;
+    translations[list->nb].fmu_vr = fmu_vr;
+    translations[list->nb].dimension = 1;
+    list->translations = translations;
+    list->nb += 1;
+
+    return 0;
+}
+
+
+/*
+ * # Derivatives of Float64 links: DERIVATIVES <NB> <NB_INPUTS>, then <FMU_INDEX> <FMU_VR> <NB> <FMU_INDEX> <FMU_VR> [...]
+ * DERIVATIVES 1 2
+ * 0 3 2 1 0 2 0
+ * Output derivatives (order 1) of the FMU producing each link are stored in container->derivatives
+ * and given as input derivatives to the consumers.
+ */
+static int read_conf_derivatives(container_t *container, config_file_t *file) {
+    unsigned long nb_inputs;
+    unsigned long nb_read = 0;
+
+    if (sscanf(file->line, "DERIVATIVES %lu %lu", &container->nb_derivatives, &nb_inputs) < 2) {
+        CONFIG_ERROR("Cannot get number of derivatives.");
+        return -1;
+    }
+    if (container->nb_derivatives == 0)
+        return 0;
+
+    CONFIG_ALLOC(container->derivatives, container->nb_derivatives);
+
+    for (unsigned long i = 0; i < container->nb_derivatives; i += 1) {
+        long fmu_id;
+        fmu_vr_t fmu_vr;
+        unsigned long nb;
+        int offset;
+
+        CONFIG_GETLINE;
+        if ((sscanf(file->line, "%ld %u %lu%n", &fmu_id, &fmu_vr, &nb, &offset) < 3) ||
+            (fmu_id < 0) || (fmu_id >= container->nb_fmu)) {
+            CONFIG_ERROR("Cannot read derivative #%lu.", i);
+            return -2;
+        }
+        if (fmu_translation_list_append(&container->fmu[fmu_id].fmu_io.derivatives.out, i, fmu_vr)) {
+            CONFIG_ERROR("Virtual memory exhaust. (derivatives)");
+            return -3;
+        }
+
+        for (unsigned long j = 0; j < nb; j += 1) {
+            int read;
+
+            if ((sscanf(file->line + offset, " %ld %u%n", &fmu_id, &fmu_vr, &read) < 2) ||
+                (fmu_id < 0) || (fmu_id >= container->nb_fmu)) {
+                CONFIG_ERROR("Cannot read consumers of derivative #%lu.", i);
+                return -2;
+            }
+            offset += read;
+            if (fmu_translation_list_append(&container->fmu[fmu_id].fmu_io.derivatives.in, i, fmu_vr)) {
+                CONFIG_ERROR("Virtual memory exhaust. (derivatives)");
+                return -3;
+            }
+            nb_read += 1;
+        }
+    }
+    if (nb_read != nb_inputs) {
+        CONFIG_ERROR("Read %lu consumers of derivatives for %lu expected.", nb_read, nb_inputs);
+        return -4;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Optional sections, written only if needed, may follow importer clocks. Each one starts
+ * with its keyword.
+ */
+/*
+ * # Model Exchange: MODEL_EXCHANGE <NB_FMU> <METHOD> <SUBSTEPS> <TOLERANCE>, then <FMU_INDEX> <NB_STATES> <NB_EVENT_INDICATORS>
+ * MODEL_EXCHANGE 2 rk4 10 1e-06
+ * 1 2 0
+ * 3 1 1
+ * Continuous states of these FMUs are advanced by the integrator of the container.
+ */
+static int read_conf_model_exchange(container_t *container, config_file_t *file) {
+    int nb_fmu;
+    char method[16];
+    int nb_substeps;
+    double tolerance;
+
+    if ((sscanf(file->line, "MODEL_EXCHANGE %d %15s %d %lf", &nb_fmu, method, &nb_substeps, &tolerance) < 4) ||
+        (nb_fmu < 0) || (nb_substeps < 1) || (tolerance <= 0.0)) {
+        CONFIG_ERROR("Cannot read integrator of Model-Exchange FMUs.");
+        return -1;
+    }
+    const int integrator_method_id = integrator_method(method);
+    if (integrator_method_id < 0) {
+        CONFIG_ERROR("Unknown integration method '%s'.", method);
+        return -1;
+    }
+
+    container->integrator = integrator_new(integrator_method_id, nb_substeps, tolerance, nb_fmu);
+    if (!container->integrator) {
+        CONFIG_ERROR("Virtual memory exhaust. (integrator)");
+        return -3;
+    }
+    integrator_t *integrator = container->integrator;
+
+    for (int i = 0; i < nb_fmu; i += 1) {
+        long fmu_id;
+        unsigned long nb_states;
+        unsigned long nb_indicators;
+
+        CONFIG_GETLINE;
+        if ((sscanf(file->line, "%ld %lu %lu", &fmu_id, &nb_states, &nb_indicators) < 3) ||
+            (fmu_id < 0) || (fmu_id >= container->nb_fmu) || !container->fmu[fmu_id].model_exchange) {
+            CONFIG_ERROR("Cannot read Model-Exchange FMU #%d.", i);
+            return -2;
+        }
+        integrator->fmu[i] = &container->fmu[fmu_id];
+        integrator->state_offset[i + 1] = integrator->state_offset[i] + nb_states;
+        integrator->indicator_offset[i + 1] = integrator->indicator_offset[i] + nb_indicators;
+        /* inputs held from co-simulation FMUs change at each step */
+        integrator->has_inputs |= fmu_has_inputs(integrator->fmu[i]);
+    }
+
+    if (integrator_configure(integrator)) {
+        CONFIG_ERROR("Virtual memory exhaust. (integrator)");
+        return -3;
+    }
+
+    return 0;
+}
+
+
+static int read_conf_options(container_t *container, const char *dirname, config_file_t *file,
+                             char *snapshot_filename, size_t size) {
+    snapshot_filename[0] = '\0';
+
+    while (!get_line(file)) {
+        if (!strncmp(file->line, "EXTRAPOLATION ", 14)) {
+            if (read_conf_extrapolation(container, file))
+                return -1;
+        } else if (!strncmp(file->line, "ADAPTIVE ", 9)) {
+            if (read_conf_adaptive(container, file))
+                return -1;
+        } else if (!strncmp(file->line, "DERIVATIVES ", 12)) {
+            if (read_conf_derivatives(container, file))
+                return -1;
+        } else if (!strncmp(file->line, "MODEL_EXCHANGE ", 15)) {
+            if (read_conf_model_exchange(container, file))
+                return -1;
+        } else if (!strncmp(file->line, "ASYNC ", 6)) {
+            if (read_conf_async(container, file))
+                return -1;
+        } else if (!strncmp(file->line, "WAVEFORM ", 9)) {
+            if (read_conf_waveform(container, file))
+                return -1;
+        } else if (!strcmp(file->line, "EARLY_RETURN")) {
+            container->early_return = true;
+        } else if (!strncmp(file->line, "SNAPSHOT ", 9)) {
+            STRLCPY(snapshot_filename, dirname, size);
+            STRLCAT(snapshot_filename, "/", size);
+            STRLCAT(snapshot_filename, file->line + 9, size);
+        } else {
+            CONFIG_ERROR("Unknown option '%s'.", file->line);
+            return -2;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * ASYNC mode: producer of each numeric local variable and peers (producers and consumers) of
+ * each FMU. Other features need all embedded FMUs to be at the same time.
+ */
+static int container_async_configure(container_t *container) {
+    container_async_t *async = &container->async;
+    const char *feature = NULL;
+
+    if (container->nb_local_clocks || container->clocks_list.nb_fmu)
+        feature = "clocks";
+    else if (container->early_return)
+        feature = "early return";
+    else if (container->extrapolation.nb)
+        feature = "extrapolation";
+    else if (container->adaptive.min_multiplier)
+        feature = "adaptive step";
+    else if (container->nb_derivatives)
+        feature = "derivatives";
+    else if (container->integrator)
+        feature = "Model-Exchange FMUs";
+    else if (container->scheduled_execution.enabled)
+        feature = "Scheduled Execution";
+    for (int i = 0; (i < container->nb_fmu) && !feature; i += 1) {
+        const fmu_t *fmu = &container->fmu[i];
+        if (fmu->fmu_io.strings.out.nb || fmu->fmu_io.binaries.out.nb)
+            feature = "links of strings or binaries";
+        else if (fmu->conversions && fmu->conversions->nb)
+            feature = "conversions";
+    }
+    if (feature) {
+        logger(&container->logger, LOGGER_ERROR, "ASYNC mode is not compatible with %s.", feature);
+        return -1;
+    }
+
+    async->depth = 2 * (unsigned long)async->max_lag + 2;
+    async->completed = calloc(container->nb_fmu, sizeof(*async->completed));
+    async->peer_offset = calloc(container->nb_fmu + 1, sizeof(*async->peer_offset));
+    if (!async->completed || !async->peer_offset)
+        return -2;
+
+#define ASYNC_ALLOC(name)                                                                               \
+    if (container->nb_local_ ## name) {                                                                 \
+        async->producer_ ## name = malloc(container->nb_local_ ## name * sizeof(*async->producer_ ## name)); \
+        async->history_ ## name = malloc(async->depth * container->nb_local_ ## name * sizeof(*async->history_ ## name)); \
+        if (!async->producer_ ## name || !async->history_ ## name)                                      \
+            return -2;                                                                                  \
+        for (unsigned long vr = 0; vr < container->nb_local_ ## name; vr += 1)                         \
+            async->producer_ ## name [vr] = -1;                                                         \
+        for (int i = 0; i < container->nb_fmu; i += 1) {                                                \
+            const fmu_translation_list_t *out = &container->fmu[i].fmu_io. name .out;                   \
+            for (unsigned long j = 0; j < out->nb; j += 1) {                                            \
+                for (unsigned int k = 0; k < out->translations[j].dimension; k += 1)                    \
+                    async->producer_ ## name [out->translations[j].vr + k] = i;                         \
+            }                                                                                           \
+        }                                                                                               \
+    }
+
+    ASYNC_ALLOC(reals64);
+    ASYNC_ALLOC(reals32);
+    ASYNC_ALLOC(integers8);
+    ASYNC_ALLOC(uintegers8);
+    ASYNC_ALLOC(integers16);
+    ASYNC_ALLOC(uintegers16);
+    ASYNC_ALLOC(integers32);
+    ASYNC_ALLOC(uintegers32);
+    ASYNC_ALLOC(integers64);
+    ASYNC_ALLOC(uintegers64);
+    ASYNC_ALLOC(booleans);
+    ASYNC_ALLOC(booleans1);
+#undef ASYNC_ALLOC
+
+    /* Adjacency matrix of links between FMUs: few FMUs */
+    const unsigned long nb = (unsigned long)container->nb_fmu;
+    bool *linked = calloc(nb * nb, sizeof(*linked));
+    if (!linked)
+        return -2;
+
+#define ASYNC_LINK(name)                                                                                \
+    for (unsigned long j = 0; j < container->fmu[i].fmu_io. name .in.nb; j += 1) {                      \
+        const int producer = async->producer_ ## name [container->fmu[i].fmu_io. name .in.translations[j].vr]; \
+        if ((producer >= 0) && (producer != i)) {                                                       \
+            linked[i * nb + producer] = true;                                                           \
+            linked[producer * nb + i] = true;                                                           \
+        }                                                                                               \
+    }
+
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        ASYNC_LINK(reals64);
+        ASYNC_LINK(reals32);
+        ASYNC_LINK(integers8);
+        ASYNC_LINK(uintegers8);
+        ASYNC_LINK(integers16);
+        ASYNC_LINK(uintegers16);
+        ASYNC_LINK(integers32);
+        ASYNC_LINK(uintegers32);
+        ASYNC_LINK(integers64);
+        ASYNC_LINK(uintegers64);
+        ASYNC_LINK(booleans);
+        ASYNC_LINK(booleans1);
+    }
+#undef ASYNC_LINK
+
+    for (unsigned long i = 0; i < nb; i += 1) {
+        async->peer_offset[i + 1] = async->peer_offset[i];
+        for (unsigned long j = 0; j < nb; j += 1)
+            async->peer_offset[i + 1] += linked[i * nb + j];
+    }
+    async->peers = malloc((async->peer_offset[nb] + 1) * sizeof(*async->peers));
+    if (!async->peers) {
+        free(linked);
+        return -2;
+    }
+    for (unsigned long i = 0; i < nb; i += 1) {
+        unsigned long n = async->peer_offset[i];
+        for (unsigned long j = 0; j < nb; j += 1) {
+            if (linked[i * nb + j])
+                async->peers[n++] = (int)j;
+        }
+    }
+    free(linked);
+
+    return 0;
+}
+
+
+/*
+ * Waveform relaxation: numeric links only. Rolling back a window needs all embedded FMUs to
+ * support getFMUState and setFMUState.
+ */
+static int container_waveform_configure(container_t *container) {
+    container_waveform_t *waveform = &container->waveform;
+    const char *feature = NULL;
+
+    if (container->nb_local_clocks || container->clocks_list.nb_fmu)
+        feature = "clocks";
+    else if (container->early_return)
+        feature = "early return";
+    else if (container->extrapolation.nb)
+        feature = "extrapolation";
+    else if (container->adaptive.min_multiplier)
+        feature = "adaptive step";
+    else if (container->nb_derivatives)
+        feature = "derivatives";
+    else if (container->integrator)
+        feature = "Model-Exchange FMUs";
+    else if (container->scheduled_execution.enabled)
+        feature = "Scheduled Execution";
+    else if (container->async.max_lag >= 0)
+        feature = "ASYNC mode";
+    for (int i = 0; (i < container->nb_fmu) && !feature; i += 1) {
+        const fmu_t *fmu = &container->fmu[i];
+        if (fmu->fmu_io.strings.out.nb || fmu->fmu_io.binaries.out.nb)
+            feature = "links of strings or binaries";
+        else if (fmu->conversions && fmu->conversions->nb)
+            feature = "conversions";
+    }
+    if (feature) {
+        logger(&container->logger, LOGGER_ERROR, "Waveform relaxation is not compatible with %s.", feature);
+        return -1;
+    }
+    for (int i = 0; i < container->nb_fmu; i += 1) {
+        if (!fmu_can_get_set_state(&container->fmu[i])) {
+            logger(&container->logger, LOGGER_ERROR, "Waveform relaxation needs get/set state of FMU '%s'.",
+                   container->fmu[i].name);
+            return -1;
+        }
+    }
+
+    const unsigned long nb_slots = (unsigned long)waveform->window + 1;
+#define WAVEFORM_ALLOC(name)                                                                            \
+    if (container->nb_local_ ## name) {                                                                 \
+        waveform->previous_ ## name = malloc(nb_slots * container->nb_local_ ## name * sizeof(*waveform->previous_ ## name)); \
+        waveform->current_ ## name = malloc(nb_slots * container->nb_local_ ## name * sizeof(*waveform->current_ ## name)); \
+        if (!waveform->previous_ ## name || !waveform->current_ ## name)                                \
+            return -2;                                                                                  \
+    }
+
+    WAVEFORM_ALLOC(reals64);
+    WAVEFORM_ALLOC(reals32);
+    WAVEFORM_ALLOC(integers8);
+    WAVEFORM_ALLOC(uintegers8);
+    WAVEFORM_ALLOC(integers16);
+    WAVEFORM_ALLOC(uintegers16);
+    WAVEFORM_ALLOC(integers32);
+    WAVEFORM_ALLOC(uintegers32);
+    WAVEFORM_ALLOC(integers64);
+    WAVEFORM_ALLOC(uintegers64);
+    WAVEFORM_ALLOC(booleans);
+    WAVEFORM_ALLOC(booleans1);
+#undef WAVEFORM_ALLOC
+
+    return 0;
+}
+
+
 int container_configure(container_t* container, const char* dirname) {
     config_file_t file;
     char filename[CONFIG_FILE_SZ];
 
-    logger(LOGGER_WARNING, "FMUContainer '" VERSION_TAG "'");
-    if (config_file_open(&file, dirname, "container.txt")) {
-        logger(LOGGER_ERROR, "Cannot open '%s': %s.", filename, strerror(errno));
+    logger(&container->logger, LOGGER_WARNING, "FMUContainer '" VERSION_TAG "'");
+    if (config_file_open(&file, &container->logger, dirname, "container.txt")) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot open '%s': %s.", filename, strerror(errno));
         return -1;
     }
 
@@ -1333,19 +3251,19 @@ int container_configure(container_t* container, const char* dirname) {
 
     if (read_conf_local(container, &file)) {
         config_file_close(&file);
-        logger(LOGGER_ERROR, "Cannot allocate local variables.");
+        logger(&container->logger, LOGGER_ERROR, "Cannot allocate local variables.");
         return -5;
     }
 
     if (read_conf_io(container, &file)) {
         config_file_close(&file);
-        logger(LOGGER_ERROR, "Cannot read translation table.");
+        logger(&container->logger, LOGGER_ERROR, "Cannot read translation table.");
         return -6;
     }
 
 #define LOG_IO(type) \
     if ((container->nb_local_ ## type > 0) || (container->nb_ports_ ## type > 0)) \
-        logger(LOGGER_DEBUG, "%-10s: %lu local variables and %lu ports", #type, container->nb_local_ ## type, container->nb_ports_ ## type)
+        logger(&container->logger, LOGGER_DEBUG, "%-10s: %lu local variables and %lu ports", #type, container->nb_local_ ## type, container->nb_ports_ ## type)
 
     LOG_IO(reals64);
     LOG_IO(reals32);
@@ -1367,21 +3285,21 @@ int container_configure(container_t* container, const char* dirname) {
     for (int i = 0; i < container->nb_fmu; i += 1) {
         if (read_conf_fmu_io(&container->fmu[i], &file)) {
             config_file_close(&file);
-            logger(LOGGER_ERROR, "Cannot read I/O table for FMU#%d", i);
+            logger(&container->logger, LOGGER_ERROR, "Cannot read I/O table for FMU#%d", i);
             return -7;
         }
 
 #define LOG_IO(orientation, type) \
     if ((container->fmu[i].fmu_io. type . orientation .nb > 0) || (container->fmu[i].fmu_io.clocked_ ## type .nb_ ## orientation > 0)) \
-        logger(LOGGER_DEBUG, "FMU#%2d: %-10s: [" #orientation "] %lu ports and %lu clocked", i, #type, container->fmu[i].fmu_io. type . orientation .nb, container->fmu[i].fmu_io.clocked_ ## type .nb_ ## orientation);
+        logger(&container->logger, LOGGER_DEBUG, "FMU#%2d: %-10s: [" #orientation "] %lu ports and %lu clocked", i, #type, container->fmu[i].fmu_io. type . orientation .nb, container->fmu[i].fmu_io.clocked_ ## type .nb_ ## orientation);
 
 #define LOG_IO_CLASSIC(orientation, type) \
     if (container->fmu[i].fmu_io. type . orientation .nb > 0)\
-        logger(LOGGER_DEBUG, "FMU#%2d: %-10s: [" #orientation "] %lu ports", i, #type, container->fmu[i].fmu_io. type . orientation .nb);
+        logger(&container->logger, LOGGER_DEBUG, "FMU#%2d: %-10s: [" #orientation "] %lu ports", i, #type, container->fmu[i].fmu_io. type . orientation .nb);
         
 #define LOG_START(type) \
     if (container->fmu[i].fmu_io.start_ ## type .nb > 0) \
-        logger(LOGGER_DEBUG, "FMU#%2d: %-10s: [start] %lu ", i, #type, container->fmu[i].fmu_io.start_ ## type .nb);
+        logger(&container->logger, LOGGER_DEBUG, "FMU#%2d: %-10s: [start] %lu ", i, #type, container->fmu[i].fmu_io.start_ ## type .nb);
     LOG_IO(in, reals64);
     LOG_IO(in, reals32);
     LOG_IO(in, integers8);
@@ -1434,33 +3352,182 @@ int container_configure(container_t* container, const char* dirname) {
     }
 
     read_conf_clocks(container, &file);
+    if (container_clocks_index(container)) {
+        config_file_close(&file);
+        logger(&container->logger, LOGGER_ERROR, "Cannot index clocks.");
+        return -7;
+    }
     if (container->clocks_list.nb_fmu)
-        logger(LOGGER_DEBUG, "Container will tick for clocks from %lu FMUs", container->clocks_list.nb_fmu);
+        logger(&container->logger, LOGGER_DEBUG, "Container will tick for clocks from %lu FMUs", container->clocks_list.nb_fmu);
+
+    char snapshot_filename[CONFIG_FILE_SZ];
+    if (read_conf_options(container, dirname, &file, snapshot_filename, sizeof(snapshot_filename))) {
+        config_file_close(&file);
+        logger(&container->logger, LOGGER_ERROR, "Cannot read options.");
+        return -7;
+    }
+
+    if (container->extrapolation.nb) {
+        if (container->do_step == container_do_one_step_sequential) {
+            logger(&container->logger, LOGGER_WARNING, "Links are not extrapolated in SEQUENTIAL mode.");
+            container->extrapolation.nb = 0;
+        } else
+            logger(&container->logger, LOGGER_DEBUG, "%lu links are extrapolated", container->extrapolation.nb);
+    }
+    if (container->nb_derivatives) {
+        if (container->do_step == container_do_one_step_sequential) {
+            logger(&container->logger, LOGGER_WARNING, "Derivatives are not forwarded in SEQUENTIAL mode.");
+            for (int i = 0; i < container->nb_fmu; i += 1) {
+                container->fmu[i].fmu_io.derivatives.in.nb = 0;
+                container->fmu[i].fmu_io.derivatives.out.nb = 0;
+            }
+            container->nb_derivatives = 0;
+        } else
+            logger(&container->logger, LOGGER_DEBUG, "%lu links forward derivatives", container->nb_derivatives);
+    }
+    if (container->early_return) {
+        container->rollback_keep = calloc(container->nb_fmu, sizeof(*container->rollback_keep));
+        if (!container->rollback_keep) {
+            config_file_close(&file);
+            logger(&container->logger, LOGGER_ERROR, "Cannot allocate rollback of early return.");
+            return -7;
+        }
+        logger(&container->logger, LOGGER_DEBUG, "Embedded FMUs may return early from doStep");
+    }
+    int nb_model_exchange = 0;
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        nb_model_exchange += container->fmu[i].model_exchange;
+    if (nb_model_exchange != (container->integrator ? container->integrator->nb_fmu : 0)) {
+        config_file_close(&file);
+        logger(&container->logger, LOGGER_ERROR, "%d Model-Exchange FMUs are not all integrated.", nb_model_exchange);
+        return -7;
+    }
+    if (nb_model_exchange && container->scheduled_execution.enabled) {
+        config_file_close(&file);
+        logger(&container->logger, LOGGER_ERROR, "Model-Exchange FMUs cannot be embedded in Scheduled Execution.");
+        return -7;
+    }
+    if (container->integrator)
+        logger(&container->logger, LOGGER_DEBUG, "%d Model-Exchange FMUs are integrated (%lu states, %lu event indicators)",
+               container->integrator->nb_fmu, container->integrator->nb_states, container->integrator->nb_indicators);
+    if (container->adaptive.min_multiplier)
+        logger(&container->logger, LOGGER_DEBUG, "Adaptive step between %g and %g s (tolerance=%g, %lu outputs monitored)",
+               container->time_step * container->adaptive.min_multiplier,
+               container->time_step * container->adaptive.max_multiplier,
+               container->adaptive.tolerance, container->adaptive.nb);
+    if (container->async.max_lag >= 0) {
+        if (!container_use_threads(container)) {
+            logger(&container->logger, LOGGER_WARNING, "ASYNC mode is ignored out of MULTI thread mode.");
+            container->async.max_lag = -1;
+        } else {
+            container->do_step = container_do_one_step_parallel_mt; /* no AUTO selection */
+            const int status = container_async_configure(container);
+            if (status) {
+                config_file_close(&file);
+                if (status == -2)
+                    logger(&container->logger, LOGGER_ERROR, "Cannot allocate history of ASYNC mode.");
+                return -7;
+            }
+            logger(&container->logger, LOGGER_DEBUG, "ASYNC mode: FMUs may lag by %d internal steps", container->async.max_lag);
+        }
+    }
+    if (container->waveform.window) {
+        if (container->do_step == container_do_one_step_sequential) {
+            logger(&container->logger, LOGGER_WARNING, "Waveform relaxation is ignored in SEQUENTIAL mode.");
+            container->waveform.window = 0;
+        } else {
+            if (container->do_step == container_do_one_step_auto)
+                container->do_step = container_do_one_step_parallel_mt; /* no AUTO selection */
+            const int status = container_waveform_configure(container);
+            if (status) {
+                config_file_close(&file);
+                if (status == -2)
+                    logger(&container->logger, LOGGER_ERROR, "Cannot allocate waveforms.");
+                return -7;
+            }
+            logger(&container->logger, LOGGER_DEBUG, "Waveform relaxation over %d internal steps (%d iterations max, tolerance=%g)",
+                   container->waveform.window, container->waveform.max_iterations, container->waveform.tolerance);
+        }
+    }
 
     config_file_close(&file);
 
-    logger(LOGGER_DEBUG, "Instanciate embedded FMUs...");
+    /* Partitions are executed by the threads of the importer */
+    if (container->scheduled_execution.enabled && container_use_threads(container)) {
+        logger(&container->logger, LOGGER_WARNING, "Container threads are not used in Scheduled Execution.");
+        container->do_step = container_do_one_step_parallel;
+    }
+
+    if (container_schedule_new(container)) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot allocate FMUs grouping.");
+        return -8;
+    }
+
+    if (container_use_threads(container)) {
+        if (logger_queue_new(&container->logger)) {
+            logger(&container->logger, LOGGER_ERROR, "Cannot allocate log queue.");
+            return -8;
+        }
+    }
+
+    logger(&container->logger, LOGGER_DEBUG, "Instanciate embedded FMUs...");
     for (int i = 0; i < container->nb_fmu; i += 1) {
-        logger(LOGGER_DEBUG, "FMU#%d: Instanciate '%s' for CoSimulation", i, container->fmu[i].name);
-        fmu_status_t status = fmuInstantiateCoSimulation(&container->fmu[i], container->instance_name);
+        fmu_status_t status;
+        if (container->fmu[i].model_exchange) {
+            logger(&container->logger, LOGGER_DEBUG, "FMU#%d: Instanciate '%s' for ModelExchange", i, container->fmu[i].name);
+            status = fmuInstantiateModelExchange(&container->fmu[i], container->instance_name);
+            if (status != FMU_STATUS_OK) {
+                logger(&container->logger, LOGGER_ERROR, "Cannot Instantiate FMU '%s'", container->fmu[i].name);
+                return -8;
+            }
+            continue;
+        }
+        logger(&container->logger, LOGGER_DEBUG, "FMU#%d: Instanciate '%s' for CoSimulation", i, container->fmu[i].name);
+        if (container->scheduled_execution.enabled)
+            status = fmuInstantiateScheduledExecution(&container->fmu[i], container->instance_name);
+        else
+            status = fmuInstantiateCoSimulation(&container->fmu[i], container->instance_name);
         if (status != FMU_STATUS_OK) {
-            logger(LOGGER_ERROR, "Cannot Instantiate FMU '%s'", container->fmu[i].name);
+            logger(&container->logger, LOGGER_ERROR, "Cannot Instantiate FMU '%s'", container->fmu[i].name);
             return -8;
         }
     }
 
+    if (snapshot_filename[0]) {
+        logger(&container->logger, LOGGER_DEBUG, "Loading snapshot '%s'...", snapshot_filename);
+        container->snapshot = checkpoint_load(container, snapshot_filename);
+        if (!container->snapshot)
+            return -8;
+    }
+
     container->integers32[0] = 1;                /* Default: TS multiplier */
     container->next_step = container->time_step; /* Default: no next event time */
     container->time = container->start_time;
     
-    container->datalog = datalog_new(dirname);
+    container->datalog = datalog_new(&container->logger, dirname, container->datalog_filename);
+    container->trace = trace_new(&container->logger, dirname, container->nb_fmu);
+
+    if (container->profiling) {
+        const unsigned long nb_stats = (container->nb_fmu * PROFILE_NB_FMU_PHASES + 1) * PROFILE_NB_STATS;
+
+        container->profile = profile_new(&container->logger);
+        if (!container->profile)
+            return -9;
+        container->profile_filename = container_profile_filename(container, dirname);
+        
+        /* Containers built by previous versions only expose RT ratios */
+        if (container->nb_local_reals64 >= 1 + container->nb_fmu + nb_stats)
+            container->profile_offset = 1 + container->nb_fmu;
+        else
+            logger(&container->logger, LOGGER_WARNING, "Profiling statistics are not exposed by this container.");
+    }
 
 
     /* Allocate buffer for arrays of strings and arrays of binaries */
     if (container->nb_local_strings) {
         container->strings_tmp = malloc(container->nb_local_strings * sizeof(*container->strings_tmp));
         if (!container->strings_tmp) {
-             logger(LOGGER_ERROR, "Cannot allocate buffer for strings.");
+             logger(&container->logger, LOGGER_ERROR, "Cannot allocate buffer for strings.");
              return -9;
         }
     } else
@@ -1470,7 +3537,7 @@ int container_configure(container_t* container, const char* dirname) {
         container->binaries_tmp = malloc(container->nb_local_binaries * sizeof(*container->binaries_tmp));
         container->binaries_size_tmp = malloc(container->nb_local_binaries * sizeof(*container->binaries_size_tmp));
         if (!container->binaries_tmp || !container->binaries_size_tmp) {
-            logger(LOGGER_ERROR, "Cannot allocate buffer for binaries.");
+            logger(&container->logger, LOGGER_ERROR, "Cannot allocate buffer for binaries.");
              return -9;
         }
     } else {
@@ -1478,7 +3545,7 @@ int container_configure(container_t* container, const char* dirname) {
         container->binaries_size_tmp = NULL;
     }
 
-    logger(LOGGER_DEBUG, "Container is configured.");
+    logger(&container->logger, LOGGER_DEBUG, "Container is configured.");
 
     return 0;
 }
@@ -1495,6 +3562,7 @@ container_t *container_new(const char *instance_name, const char *fmu_uuid) {
         container->free_memory = free;
         container->instance_name = strdup(instance_name);
         container->uuid = strdup(fmu_uuid);
+        memset(&container->logger, 0, sizeof(container->logger)); /* stdout until logger_init() */
 
         container->nb_fmu = 0;
         container->fmu = NULL;
@@ -1540,16 +3608,145 @@ container_t *container_new(const char *instance_name, const char *fmu_uuid) {
         container->clocks_list.buffer_interval = NULL;     /* nb_local_clocks */
         container->clocks_list.next_clocks = NULL;         /* nb_local_clocks */
         container->clocks_list.clock_index = NULL;         /* nb_local_clocks */
+        container->clocks_list.next_tick = NULL;           /* nb_local_clocks */
+        container->clocks_list.nb_heap = 0;
+        container->clocks_list.heap = NULL;                /* nb_local_clocks */
+        container->clocks_list.heap_index = NULL;          /* nb_local_clocks */
+        container->clocks_list.fmu_query = NULL;           /* nb_fmu of container */
 
         container->datalog = NULL;
+        container->trace = NULL;
+        container->profile = NULL;
+        container->profile_offset = 0;
+        container->profile_filename = NULL;
+        container->datalog_filename = NULL;
+        container->library_copy = 0;
+        container->scheduled_execution.enabled = false;
+        container->scheduled_execution.environment = NULL;
+        container->scheduled_execution.clock_update = NULL;
+        container->scheduled_execution.lock_preemption = NULL;
+        container->scheduled_execution.unlock_preemption = NULL;
+        container->snapshot = NULL;
+
+        container->clock_consumers = NULL;
+        container->nb_consumed_clocks = 0;
+        container->consumed_clocks = NULL;
+        container->event_visit = NULL;
+        container->event_revisit = NULL;
 
         container->need_event_update = false;
+        container->early_return = false;
+        container->rollback = NULL;
+        container->rollback_keep = NULL;
+
+        container->extrapolation.nb = 0;
+        container->extrapolation.vr = NULL;             /* nb */
+        container->extrapolation.order = NULL;          /* nb */
+        container->extrapolation.history = NULL;        /* nb x CONTAINER_EXTRAPOLATION_SAMPLES */
+        container->extrapolation.nb_samples = 0;
+
+        container->adaptive.min_multiplier = 0;
+        container->adaptive.max_multiplier = 0;
+        container->adaptive.tolerance = 0.0;
+        container->adaptive.multiplier = 1;
+        container->adaptive.nb = 0;
+        container->adaptive.vr = NULL;                  /* nb */
+        container->adaptive.history = NULL;             /* nb x CONTAINER_ADAPTIVE_SAMPLES */
+        container->adaptive.nb_samples = 0;
+
+        container->nb_derivatives = 0;
+        container->derivatives = NULL;
+
+        container->integrator = NULL;
+
+        container->async.max_lag = -1;
+        container->async.depth = 0;
+        container->async.nb_steps = 0;
+        container->async.first_step = 0;
+        container->async.multiplier = 1;
+        container->async.completed = NULL;
+        container->async.failed = 0;
+        container->async.need_event_update = 0;
+        container->async.peer_offset = NULL;
+        container->async.peers = NULL;
+#define ASYNC_INIT(name) \
+        container->async.producer_ ## name = NULL; \
+        container->async.history_ ## name = NULL
+        ASYNC_INIT(reals64);
+        ASYNC_INIT(reals32);
+        ASYNC_INIT(integers8);
+        ASYNC_INIT(uintegers8);
+        ASYNC_INIT(integers16);
+        ASYNC_INIT(uintegers16);
+        ASYNC_INIT(integers32);
+        ASYNC_INIT(uintegers32);
+        ASYNC_INIT(integers64);
+        ASYNC_INIT(uintegers64);
+        ASYNC_INIT(booleans);
+        ASYNC_INIT(booleans1);
+#undef ASYNC_INIT
+
+        container->waveform.window = 0;
+        container->waveform.max_iterations = 0;
+        container->waveform.tolerance = 0.0;
+        container->waveform.nb_steps = 0;
+        container->waveform.first_step = 0;
+        container->waveform.multiplier = 1;
+        container->waveform.need_event_update = 0;
+#define WAVEFORM_INIT(name) \
+        container->waveform.previous_ ## name = NULL; \
+        container->waveform.current_ ## name = NULL
+        WAVEFORM_INIT(reals64);
+        WAVEFORM_INIT(reals32);
+        WAVEFORM_INIT(integers8);
+        WAVEFORM_INIT(uintegers8);
+        WAVEFORM_INIT(integers16);
+        WAVEFORM_INIT(uintegers16);
+        WAVEFORM_INIT(integers32);
+        WAVEFORM_INIT(uintegers32);
+        WAVEFORM_INIT(integers64);
+        WAVEFORM_INIT(uintegers64);
+        WAVEFORM_INIT(booleans);
+        WAVEFORM_INIT(booleans1);
+#undef WAVEFORM_INIT
+
+        container->strategy.evaluated = false;
+        container->strategy.selected = CONTAINER_STRATEGY_PARALLEL;
+        container->strategy.steps = 0;
+        for (int i = 0; i < CONTAINER_NB_STRATEGIES; i += 1) {
+            container->strategy.elapsed[i] = 0;
+            container->strategy.nb[i] = 0;
+        }
+
+        container->schedule.nb_workers = 0;
+        container->schedule.workers = NULL;     /* nb_fmu */
+        container->schedule.nb_inline = 0;
+        container->schedule.order = NULL;       /* nb_fmu */
+        container->schedule.bin = NULL;         /* nb_fmu */
+        container->schedule.candidate = NULL;   /* nb_fmu */
+        container->schedule.sorted = NULL;      /* nb_fmu */
+        container->schedule.cost = NULL;        /* nb_fmu */
+        container->schedule.load = NULL;        /* nb_fmu + 1 */
     }
     return container;
 }
 
 
 void container_free(container_t *container) {
+    if (container->trace) {
+        trace_write(container->trace, container);   /* if not yet done by terminate */
+        trace_free(container->trace);
+    }
+    if (container->profile) {
+        profile_report(&container->logger, container->profile, container->instance_name);
+        if (container->profile_filename)
+            container_profile_write(container);
+    }
+
+    checkpoint_free(container, container->snapshot);   /* if initialization was not completed */
+    checkpoint_free(container, container->rollback);
+    free(container->rollback_keep);
+
     if (container->fmu) {
         for (int i = 0; i < container->nb_fmu; i += 1) {
             fmuFreeInstance(&container->fmu[i]);
@@ -1590,6 +3787,15 @@ void container_free(container_t *container) {
     free(container->binaries_size_tmp);
     free(container->strings_tmp);
 
+    if (container->clock_consumers) {
+        for (unsigned long i = 0; i < container->nb_local_clocks; i += 1)
+            free(container->clock_consumers[i].consumers);
+        free(container->clock_consumers);
+    }
+    free(container->consumed_clocks);
+    free(container->event_visit);
+    free(container->event_revisit);
+
     free(container->clocks_list.counter);
     free(container->clocks_list.buffer_qualifier);
     free(container->clocks_list.buffer_interval);
@@ -1597,7 +3803,58 @@ void container_free(container_t *container) {
     free(container->clocks_list.clock_index);
     free(container->clocks_list.fmu_id);
     free(container->clocks_list.next_clocks);
+    free(container->clocks_list.next_tick);
+    free(container->clocks_list.heap);
+    free(container->clocks_list.heap_index);
+    free(container->clocks_list.fmu_query);
+
+    free(container->extrapolation.vr);
+    free(container->extrapolation.order);
+    free(container->extrapolation.history);
+    free(container->adaptive.vr);
+    free(container->adaptive.history);
+    free(container->derivatives);
+    integrator_free(container->integrator);
+    free(container->async.completed);
+    free(container->async.peer_offset);
+    free(container->async.peers);
+#define ASYNC_FREE(name) \
+    free(container->async.producer_ ## name); \
+    free(container->async.history_ ## name)
+    ASYNC_FREE(reals64);
+    ASYNC_FREE(reals32);
+    ASYNC_FREE(integers8);
+    ASYNC_FREE(uintegers8);
+    ASYNC_FREE(integers16);
+    ASYNC_FREE(uintegers16);
+    ASYNC_FREE(integers32);
+    ASYNC_FREE(uintegers32);
+    ASYNC_FREE(integers64);
+    ASYNC_FREE(uintegers64);
+    ASYNC_FREE(booleans);
+    ASYNC_FREE(booleans1);
+#undef ASYNC_FREE
+#define WAVEFORM_FREE(name) \
+    free(container->waveform.previous_ ## name); \
+    free(container->waveform.current_ ## name)
+    WAVEFORM_FREE(reals64);
+    WAVEFORM_FREE(reals32);
+    WAVEFORM_FREE(integers8);
+    WAVEFORM_FREE(uintegers8);
+    WAVEFORM_FREE(integers16);
+    WAVEFORM_FREE(uintegers16);
+    WAVEFORM_FREE(integers32);
+    WAVEFORM_FREE(uintegers32);
+    WAVEFORM_FREE(integers64);
+    WAVEFORM_FREE(uintegers64);
+    WAVEFORM_FREE(booleans);
+    WAVEFORM_FREE(booleans1);
+#undef WAVEFORM_FREE
+    container_schedule_free(&container->schedule);
+    logger_queue_free(&container->logger);
     datalog_free(container->datalog);
+    profile_free(container->profile);
+    free(container->profile_filename);
 
     free(container);
 
@@ -9,6 +9,7 @@ extern "C" {
 #include "fmu.h"
 #include "library.h"
 #include "logger.h"
+#include "profile.h"
 
 /*----------------------------------------------------------------------------
                       C O N T A I N E R _ V R _ T
@@ -51,12 +52,20 @@ typedef struct {
                 C O N T A I N E R _ C L O C K _ L I S T _ T
 ----------------------------------------------------------------------------*/
 
+/*
+ * Clocks scheduled by the container. Intervals of the clocks of an FMU are queried only if
+ * the FMU took part in the last event (see fmu_query). Absolute times of the next ticks
+ * are kept in a binary min-heap, so that the earliest ticks are found without scanning all
+ * clocks.
+ */
+#define CONTAINER_CLOCK_NOT_SCHEDULED	((unsigned long)-1)
+
 typedef struct {
 	unsigned long				nb_fmu;
 	container_clock_counter_t	*counter;
+	bool						*fmu_query;			/* for each FMU of container */
 
 	double						*buffer_interval;	/* for getIntervalDecimal */
-	double                      *buffer_previous;	/* for getIntervalDecimal and fmi3IntervalUnchanged */
 	int							*buffer_qualifier;  /* for getIntervalDecimal */
 
 	unsigned long				nb_local_clocks;
@@ -64,11 +73,142 @@ typedef struct {
 	unsigned long				*clock_index;
 	unsigned long				*fmu_id;		
 
+	double						*next_tick;			/* absolute time, NAN if not scheduled */
+	unsigned long				nb_heap;
+	unsigned long				*heap;				/* clocks ordered by next_tick */
+	unsigned long				*heap_index;		/* position in heap or CONTAINER_CLOCK_NOT_SCHEDULED */
+
 	unsigned long				nb_next_clocks;
 	container_clock_t			*next_clocks;
 } container_clock_list_t;
 
 
+/*----------------------------------------------------------------------------
+            C O N T A I N E R _ E X T R A P O L A T I O N _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * Extrapolation of reals64 links in PARALLEL mode. Values of the last samples of each
+ * extrapolated local variable are kept (most recent first). Samples are taken at the end
+ * of each internal step: their times are shared by all variables.
+ */
+#define CONTAINER_EXTRAPOLATION_SAMPLES	3
+
+typedef struct {
+	unsigned long				nb;				/* extrapolated local variables */
+	unsigned long				*vr;			/* reals64 local vr */
+	int							*order;			/* 0, 1 or 2 */
+	double						*history;		/* nb x CONTAINER_EXTRAPOLATION_SAMPLES */
+	int							nb_samples;
+	double						time[CONTAINER_EXTRAPOLATION_SAMPLES];
+} container_extrapolation_t;
+
+
+/*----------------------------------------------------------------------------
+                C O N T A I N E R _ A D A P T I V E _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * Adaptive internal step: a multiple of time_step between min and max multipliers. After
+ * each internal step, reals64 outputs of embedded FMUs are compared with their linear
+ * extrapolation from the two previous samples to estimate the error of the coupling.
+ */
+#define CONTAINER_ADAPTIVE_SAMPLES	2
+
+typedef struct {
+	int							min_multiplier;			/* 0 if disabled */
+	int							max_multiplier;
+	double						tolerance;				/* relative and absolute */
+	int							multiplier;				/* of next internal step */
+	unsigned long				nb;						/* monitored local variables */
+	unsigned long				*vr;					/* reals64 local vr */
+	double						*history;				/* nb x CONTAINER_ADAPTIVE_SAMPLES */
+	int							nb_samples;
+	double						time[CONTAINER_ADAPTIVE_SAMPLES];
+} container_adaptive_t;
+
+
+/*----------------------------------------------------------------------------
+                   C O N T A I N E R _ A S Y N C _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * Bounded-staleness asynchronous mode (MULTI thread). Between communication points, an
+ * FMU reads the newest outputs of its producers, max_lag internal steps old at most. Numeric
+ * outputs of embedded FMUs are kept for depth steps: slot (n % depth) holds the local
+ * variables after n steps.
+ */
+typedef struct {
+	int							max_lag;				/* -1 if disabled */
+	unsigned long				depth;					/* 2 x max_lag + 2 slots */
+	long long					nb_steps;				/* internal steps of communication step */
+	long long					first_step;				/* container nb_steps at communication point */
+	int							multiplier;				/* of time_step for each internal step */
+	thread_atomic_t				*completed;				/* nb_fmu: steps done since communication point */
+	thread_atomic_t				failed;
+	thread_atomic_t				need_event_update;
+	unsigned long				*peer_offset;			/* nb_fmu + 1: producers and consumers of fmu[i] */
+	int							*peers;
+
+#define DECLARE_ASYNC(name, type)											\
+	int							*producer_ ## name;	/* FMU of local variable or -1 */	\
+	type						*history_ ## name	/* depth x nb_local */
+
+	DECLARE_ASYNC(reals64, double);
+	DECLARE_ASYNC(reals32, float);
+	DECLARE_ASYNC(integers8, int8_t);
+	DECLARE_ASYNC(uintegers8, uint8_t);
+	DECLARE_ASYNC(integers16, int16_t);
+	DECLARE_ASYNC(uintegers16, uint16_t);
+	DECLARE_ASYNC(integers32, int32_t);
+	DECLARE_ASYNC(uintegers32, uint32_t);
+	DECLARE_ASYNC(integers64, int64_t);
+	DECLARE_ASYNC(uintegers64, uint64_t);
+	DECLARE_ASYNC(booleans, int);
+	DECLARE_ASYNC(booleans1, bool);
+#undef DECLARE_ASYNC
+} container_async_t;
+
+
+/*----------------------------------------------------------------------------
+                C O N T A I N E R _ W A V E F O R M _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * Waveform relaxation (PARALLEL mode). Embedded FMUs simulate a window of internal steps on
+ * their own, with the inputs recorded during the previous iteration. The window is simulated
+ * again from its initial state until two iterations give the same outputs. Slot k of a
+ * waveform holds the local variables after k steps of the window.
+ */
+typedef struct {
+	int							window;					/* internal steps. 0 if disabled */
+	int							max_iterations;
+	double						tolerance;				/* relative and absolute */
+	int							nb_steps;				/* of current window */
+	long long					first_step;				/* container nb_steps at beginning of window */
+	int							multiplier;				/* of time_step for each internal step */
+	thread_atomic_t				need_event_update;
+
+#define DECLARE_WAVEFORM(name, type)										\
+	type						*previous_ ## name;	/* (window + 1) x nb_local: read */	\
+	type						*current_ ## name	/* (window + 1) x nb_local: written */
+
+	DECLARE_WAVEFORM(reals64, double);
+	DECLARE_WAVEFORM(reals32, float);
+	DECLARE_WAVEFORM(integers8, int8_t);
+	DECLARE_WAVEFORM(uintegers8, uint8_t);
+	DECLARE_WAVEFORM(integers16, int16_t);
+	DECLARE_WAVEFORM(uintegers16, uint16_t);
+	DECLARE_WAVEFORM(integers32, int32_t);
+	DECLARE_WAVEFORM(uintegers32, uint32_t);
+	DECLARE_WAVEFORM(integers64, int64_t);
+	DECLARE_WAVEFORM(uintegers64, uint64_t);
+	DECLARE_WAVEFORM(booleans, int);
+	DECLARE_WAVEFORM(booleans1, bool);
+#undef DECLARE_WAVEFORM
+} container_waveform_t;
+
+
 /*----------------------------------------------------------------------------
             C O N T A I N E R _ D O _ S T E P _ F U N C T I O N _ T
 ----------------------------------------------------------------------------*/
@@ -76,6 +216,70 @@ typedef struct {
 typedef fmu_status_t (*container_do_step_function_t)(struct container_s *container);
 
 
+/*----------------------------------------------------------------------------
+                   C O N T A I N E R _ S T R A T E G Y _ T
+----------------------------------------------------------------------------*/
+
+typedef enum {
+	CONTAINER_STRATEGY_SEQUENTIAL = 0,
+	CONTAINER_STRATEGY_PARALLEL,			/* parallel mode with mono thread */
+	CONTAINER_STRATEGY_PARALLEL_MT,			/* parallel mode with multi thread */
+	CONTAINER_NB_STRATEGIES
+} container_strategy_t;
+
+/* Runtime selection of the stepping strategy (MT flag set to AUTO) */
+typedef struct {
+	bool						evaluated;		/* a strategy has already been selected */
+	container_strategy_t		selected;		/* fastest strategy of last evaluation */
+	unsigned long				steps;			/* steps since beginning of last evaluation */
+	profile_tic_t				elapsed[CONTAINER_NB_STRATEGIES];	/* ns, measured during evaluation */
+	unsigned long				nb[CONTAINER_NB_STRATEGIES];		/* measured steps */
+} container_auto_t;
+
+
+/*----------------------------------------------------------------------------
+                   C O N T A I N E R _ S C H E D U L E _ T
+----------------------------------------------------------------------------*/
+
+/* Grouping of embedded FMUs onto threads (PARALLEL mode with MULTI thread) */
+typedef struct {
+	bool						grouped;		/* a grouping has been computed from measures */
+	unsigned long				steps;			/* steps measured since last grouping */
+	int							nb_cpu;
+	int							nb_workers;		/* threads in use */
+	fmu_t						**workers;		/* FMUs whose thread steps a group: workers[i]->group */
+	int							nb_inline;		/* FMUs stepped by the main thread: order[0..nb_inline-1] */
+	fmu_t						**order;		/* inline FMUs, then group of each worker */
+	int							*bin;			/* current bin of each FMU. Bin 0 is the main thread */
+	int							*candidate;		/* bin of each FMU computed by LPT */
+	int							*sorted;		/* FMU indexes by decreasing cost */
+	double						*cost;			/* ns per step of each FMU */
+	double						*load;			/* ns per step of each bin */
+} container_schedule_t;
+
+
+/*----------------------------------------------------------------------------
+       C O N T A I N E R _ S C H E D U L E D _ E X E C U T I O N _ T
+----------------------------------------------------------------------------*/
+
+/* FMI-3.0 Scheduled Execution: callbacks of the importer, given at instantiation */
+typedef struct {
+	bool						enabled;
+	fmi3InstanceEnvironment		environment;
+	fmi3ClockUpdateCallback		clock_update;
+	fmi3LockPreemptionCallback	lock_preemption;		/* forwarded to embedded FMUs */
+	fmi3UnlockPreemptionCallback unlock_preemption;
+} container_scheduled_execution_t;
+
+
+/* Optional settings of fmi3_container_new() */
+typedef struct {
+	const container_scheduled_execution_t *scheduled_execution;	/* NULL if not used */
+	const char					*datalog_filename;		/* ensemble: overrides filename given by datalog.txt */
+	int							library_copy;			/* ensemble: >0 to load copies of non reentrant FMUs */
+} container_instantiation_t;
+
+
 typedef enum {
 	CONTAINER_STATE_INSTANTIATED,
     CONTAINER_STATE_INITIALIZATION_MODE,
@@ -97,6 +301,7 @@ typedef struct container_s {
 	char						*instance_name;
 	char						*uuid;
 	container_state_t			state;		/* managed in fmi2.c and fmi3.c */
+	logger_t					logger;		/* shared with embedded FMUs */
 
 	/* storage of local variables (conveyed from one FMU to an other) */
 #define DECLARE_LOCAL(name, type) 					\
@@ -123,6 +328,13 @@ typedef struct container_s {
 	size_t 						*binaries_size_tmp;
 	const char					**strings_tmp;
 
+	/* reverse index of clocks: input clocks and clocked inputs activated by each local clock */
+	fmu_clock_consumer_list_t	*clock_consumers;		/* nb_local_clocks */
+	unsigned long				nb_consumed_clocks;
+	unsigned long				*consumed_clocks;		/* local clocks with consumers */
+	bool						*event_visit;			/* nb_fmu: FMUs of current event iteration */
+	bool						*event_revisit;			/* nb_fmu: FMUs of next event iteration */
+
 #undef DECLARE_LOCAL
 
 	/* container ports definition */
@@ -152,6 +364,8 @@ typedef struct container_s {
 
 	/* Simulation */
 	container_do_step_function_t do_step;
+	container_auto_t			strategy;				/* if do_step is selected at runtime */
+	container_schedule_t		schedule;				/* FMUs grouping in MULTI thread mode */
 	double						time_step;				/* fundamental timestep */
 	double						next_step;				/* in case of event */
 	long long					nb_steps;				/* incremental counter */
@@ -163,8 +377,26 @@ typedef struct container_s {
 	double						tolerance;				/* used for comparisons */
 	container_clock_list_t		clocks_list;
 	bool						need_event_update;
+	bool						early_return;			/* embedded FMUs may return early from doStep */
+	struct checkpoint_s			*rollback;				/* early return (waveform): state at beginning of step (window) */
+	bool						*rollback_keep;			/* nb_fmu: FMUs not rolled back */
+	container_extrapolation_t	extrapolation;			/* of inputs in PARALLEL mode */
+	container_adaptive_t		adaptive;				/* internal step */
+	unsigned long				nb_derivatives;
+	double						*derivatives;			/* of outputs (order 1), see fmu_io.derivatives */
+	struct integrator_s			*integrator;			/* of Model-Exchange FMUs. Optional */
+	container_async_t			async;					/* bounded-staleness MULTI thread mode */
+	container_waveform_t		waveform;				/* relaxation over windows of internal steps */
 
 	struct datalog_s			*datalog;
+	struct trace_s				*trace;					/* execution trace if enabled */
+	profile_t					*profile;				/* container phases (datalog) if profiling */
+	unsigned long				profile_offset;			/* first reals64 slot of profiling statistics */
+	char						*profile_filename;		/* profile of the run written at the end. Optional */
+	const char					*datalog_filename;		/* ensemble: overrides filename given by datalog.txt */
+	int							library_copy;			/* ensemble: >0 to load copies of non reentrant FMUs */
+	struct checkpoint_s			*snapshot;				/* warm-start: applied at end of initialization. Optional */
+	container_scheduled_execution_t	scheduled_execution;
 
 	fmi2CallbackAllocateMemory	allocate_memory;		/* used to embed FMU-2.0 */
 	fmi2CallbackFreeMemory      free_memory;			/* used to embed FMU-2.0 */
@@ -186,10 +418,20 @@ extern fmu_status_t container_exit_initialization_mode(container_t* container);
 extern fmu_status_t container_enter_event_mode(container_t *container);
 extern fmu_status_t container_enter_step_mode(container_t *container);
 extern fmu_status_t container_do_step(container_t* container, double currentCommunicationPoint, double communicationStepSize);
+extern bool container_use_threads(const container_t *container);
+extern fmu_status_t container_activate_model_partition(container_t *container, unsigned long vr, double activation_time);
+
+/* fmi3.c: also used by the ensemble runner */
+extern container_t *fmi3_container_new(fmi3String instanceName, fmi3String instantiationToken,
+                                       fmi3String resourcePath, fmi3Boolean loggingOn,
+                                       fmi3InstanceEnvironment instanceEnvironment,
+                                       fmi3LogMessageCallback logMessage,
+                                       const container_instantiation_t *instantiation);
 
 /* for datalog facilities. */
 extern void container_clocks_activate(container_t *container);
 extern void container_clocks_deactivate(container_t *container);
+extern void container_clocks_schedule(container_t *container);
 
 #	ifdef __cplusplus
 }
@@ -8,7 +8,7 @@
  * Simple conversion routines between C types.
  * Only conversions without losses are available.
  */
-convert_table_t *convert_new(unsigned long nb) {
+convert_table_t *convert_new(const logger_t *context, unsigned long nb) {
     convert_table_t *table = NULL;
 
     if (nb > 0) { 
@@ -17,12 +17,12 @@ convert_table_t *convert_new(unsigned long nb) {
             table->nb = nb;
             table->entries = malloc(nb * sizeof(*table->entries));
             if (! table->entries) {
-                logger(LOGGER_ERROR, "Cannot allocate conversion table for %lu entries.", nb);
+                logger(context, LOGGER_ERROR, "Cannot allocate conversion table for %lu entries.", nb);
                 free(table);
                 table = NULL;
             }
         } else
-            logger(LOGGER_ERROR, "Cannot allocate conversion table");
+            logger(context, LOGGER_ERROR, "Cannot allocate conversion table");
     } 
     return table;
 }
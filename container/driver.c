@@ -0,0 +1,624 @@
+/*
+ * Headless driver for FMU Containers.
+ *
+ * Loads the container library, instantiates a container FMU in Co-Simulation
+ * mode through the FMI-3.0 API and runs it for a number of steps without any
+ * external importer. Wall time, throughput and per-step latency percentiles
+ * are reported so the container runtime can be benchmarked reproducibly.
+ *
+ * In ensemble mode (-e or -p), several instances of the container are simulated
+ * concurrently in this process by ensemble_run().
+ *
+ * A snapshot of the container can be written at the end of the run (-s). Containers
+ * built with this snapshot restart from it and are run from its time (-b).
+ *
+ * With -r, each step is done, cancelled by restoring the state of the container, then done
+ * again: results of the run are unchanged if the container state is fully restored.
+ *
+ * With -x, the container is instantiated in Scheduled Execution and each step is the
+ * activation of the partition of one of its input clocks at the end of the step. Calls of the
+ * preemption callbacks are checked: locks must not be nested.
+ *
+ * Usage: container_driver [-n steps] [-h step_size] [-b start_time] [-l library] [-v]
+ *                         [-s snapshot.bin] [-r] [-x clock_vr]
+ *                         [-e members] [-p parameters.csv] [-o output.csv] [-t threads]
+ *                         <fmu_directory|file.fmu>
+ */
+
+#ifdef WIN32
+#	include <windows.h>
+#	include <direct.h>
+#else
+#	include <dlfcn.h>
+#	include <unistd.h>
+#endif
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "fmi3Functions.h"
+#include "ensemble.h"
+
+#define DRIVER_PATH_SZ          4096
+#define DRIVER_DEFAULT_STEPS    1000
+#define DRIVER_DEFAULT_STEP     1e-3
+
+
+/*----------------------------------------------------------------------------
+                               D R I V E R _ T
+----------------------------------------------------------------------------*/
+
+typedef struct {
+#ifdef WIN32
+    HINSTANCE                               library;
+#else
+    void                                    *library;
+#endif
+    fmi3InstantiateCoSimulationTYPE         *fmi3InstantiateCoSimulation;
+    fmi3InstantiateScheduledExecutionTYPE   *fmi3InstantiateScheduledExecution;
+    fmi3ActivateModelPartitionTYPE          *fmi3ActivateModelPartition;
+    fmi3FreeInstanceTYPE                    *fmi3FreeInstance;
+    fmi3EnterInitializationModeTYPE         *fmi3EnterInitializationMode;
+    fmi3ExitInitializationModeTYPE          *fmi3ExitInitializationMode;
+    fmi3DoStepTYPE                          *fmi3DoStep;
+    fmi3TerminateTYPE                       *fmi3Terminate;
+    fmi3GetFMUStateTYPE                     *fmi3GetFMUState;
+    fmi3SetFMUStateTYPE                     *fmi3SetFMUState;
+    fmi3FreeFMUStateTYPE                    *fmi3FreeFMUState;
+    fmi3SerializedFMUStateSizeTYPE          *fmi3SerializedFMUStateSize;
+    fmi3SerializeFMUStateTYPE               *fmi3SerializeFMUState;
+    ensemble_runTYPE                        *ensemble_run;
+} driver_t;
+
+
+static uint64_t driver_now(void) {
+#ifdef WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+		   (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+static void driver_logger(fmi3InstanceEnvironment environment, fmi3Status status, fmi3String category,
+                          fmi3String message) {
+    (void)environment; /* unused parameter */
+    (void)status; /* unused parameter */
+
+    fprintf(stderr, "[%s] %s\n", category, message);
+
+    return;
+}
+
+
+/* Preemption is not used by the driver: callbacks only check that locks are balanced */
+static unsigned long driver_nb_locks = 0;
+static unsigned long driver_nb_lock_errors = 0;
+static int driver_locked = 0;
+
+static void driver_lock_preemption(void) {
+    if (driver_locked)
+        driver_nb_lock_errors += 1;
+    driver_locked = 1;
+    driver_nb_locks += 1;
+
+    return;
+}
+
+
+static void driver_unlock_preemption(void) {
+    if (!driver_locked)
+        driver_nb_lock_errors += 1;
+    driver_locked = 0;
+
+    return;
+}
+
+
+static void driver_clock_update(fmi3InstanceEnvironment environment) {
+    (void)environment; /* unused parameter */
+
+    return;
+}
+
+
+static void *driver_symbol(const driver_t *driver, const char *name) {
+#ifdef WIN32
+    void *symbol = (void *)GetProcAddress(driver->library, name);
+#else
+    void *symbol = dlsym(driver->library, name);
+#endif
+    if (!symbol)
+        fprintf(stderr, "Missing API '%s'.\n", name);
+
+    return symbol;
+}
+
+
+static int driver_load(driver_t *driver, const char *filename) {
+#ifdef WIN32
+    driver->library = LoadLibraryA(filename);
+#else
+    driver->library = dlopen(filename, RTLD_LAZY);
+#endif
+    if (!driver->library) {
+#ifdef WIN32
+        fprintf(stderr, "Cannot load '%s'.\n", filename);
+#else
+        fprintf(stderr, "Cannot load '%s': %s\n", filename, dlerror());
+#endif
+        return -1;
+    }
+
+#define DRIVER_MAP(x) driver->x = (x ## TYPE *)driver_symbol(driver, #x); if (!driver->x) return -2
+    DRIVER_MAP(fmi3InstantiateCoSimulation);
+    DRIVER_MAP(fmi3InstantiateScheduledExecution);
+    DRIVER_MAP(fmi3ActivateModelPartition);
+    DRIVER_MAP(fmi3FreeInstance);
+    DRIVER_MAP(fmi3EnterInitializationMode);
+    DRIVER_MAP(fmi3ExitInitializationMode);
+    DRIVER_MAP(fmi3DoStep);
+    DRIVER_MAP(fmi3Terminate);
+    DRIVER_MAP(fmi3GetFMUState);
+    DRIVER_MAP(fmi3SetFMUState);
+    DRIVER_MAP(fmi3FreeFMUState);
+    DRIVER_MAP(fmi3SerializedFMUStateSize);
+    DRIVER_MAP(fmi3SerializeFMUState);
+    DRIVER_MAP(ensemble_run);
+#undef DRIVER_MAP
+
+    return 0;
+}
+
+
+static void driver_unload(driver_t *driver) {
+    if (driver->library) {
+#ifdef WIN32
+        FreeLibrary(driver->library);
+#else
+        dlclose(driver->library);
+#endif
+    }
+
+    return;
+}
+
+
+/*
+ * A container FMU archive is extracted in a temporary directory. Zip extraction relies on
+ * tools available on each platform (tar on Windows, unzip elsewhere).
+ */
+static int driver_unpack(const char *fmu_filename, char *directory, size_t size) {
+    char command[2 * DRIVER_PATH_SZ];
+#ifdef WIN32
+    char *tmp = _tempnam(NULL, "container-");
+    if (!tmp || _mkdir(tmp)) {
+        free(tmp);
+        return -1;
+    }
+    snprintf(directory, size, "%s", tmp);
+    free(tmp);
+    snprintf(command, sizeof(command), "tar -xf \"%s\" -C \"%s\"", fmu_filename, directory);
+#else
+    snprintf(directory, size, "/tmp/container-XXXXXX");
+    if (!mkdtemp(directory))
+        return -1;
+    snprintf(command, sizeof(command), "unzip -qo \"%s\" -d \"%s\"", fmu_filename, directory);
+#endif
+    printf("Unpacking '%s' into '%s'\n", fmu_filename, directory);
+
+    return system(command) ? -2 : 0;
+}
+
+
+static void driver_cleanup(const char *directory) {
+    char command[DRIVER_PATH_SZ + 32];
+#ifdef WIN32
+    snprintf(command, sizeof(command), "rmdir /s /q \"%s\"", directory);
+#else
+    snprintf(command, sizeof(command), "rm -rf \"%s\"", directory);
+#endif
+    if (system(command))
+        fprintf(stderr, "Cannot remove '%s'.\n", directory);
+
+    return;
+}
+
+
+/*
+ * Extract the value of an XML attribute from modelDescription.xml. This is not a
+ * full XML parser: the first occurrence of `attribute="` is used.
+ */
+static int driver_attribute(const char *directory, const char *attribute, char *value, size_t size) {
+    char filename[DRIVER_PATH_SZ];
+    char pattern[128];
+
+    snprintf(filename, sizeof(filename), "%s/modelDescription.xml", directory);
+    FILE *fp = fopen(filename, "rt");
+    if (!fp)
+        return -1;
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *xml = malloc(length + 1);
+    if (!xml) {
+        fclose(fp);
+        return -2;
+    }
+    xml[fread(xml, 1, length, fp)] = '\0';
+    fclose(fp);
+
+    snprintf(pattern, sizeof(pattern), "%s=\"", attribute);
+    const char *start = strstr(xml, pattern);
+    int status = -3;
+    if (start) {
+        start += strlen(pattern);
+        const char *end = strchr(start, '"');
+        if (end && (size_t)(end - start) < size) {
+            memcpy(value, start, end - start);
+            value[end - start] = '\0';
+            status = 0;
+        }
+    }
+    free(xml);
+
+    return status;
+}
+
+
+static int driver_compare(const void *a, const void *b) {
+    const uint64_t duration_a = *(const uint64_t *)a;
+    const uint64_t duration_b = *(const uint64_t *)b;
+
+    return (duration_a > duration_b) - (duration_a < duration_b);
+}
+
+
+static double driver_percentile(const uint64_t *sorted, unsigned long nb, double percentile) {
+    unsigned long rank = (unsigned long)(percentile * (double)(nb - 1) + 0.5);
+
+    return (double)sorted[rank] / 1.0e3; /* us */
+}
+
+
+static int driver_snapshot(const driver_t *driver, fmi3Instance instance, const char *filename) {
+    fmi3FMUState state = NULL;
+    size_t size = 0;
+    uint8_t *buffer = NULL;
+    int status = -1;
+
+    if ((driver->fmi3GetFMUState(instance, &state) == fmi3OK) &&
+        (driver->fmi3SerializedFMUStateSize(instance, state, &size) == fmi3OK) &&
+        (buffer = malloc(size)) &&
+        (driver->fmi3SerializeFMUState(instance, state, buffer, size) == fmi3OK)) {
+        FILE *fp = fopen(filename, "wb");
+        if (fp) {
+            if (fwrite(buffer, 1, size, fp) == size)
+                status = 0;
+            fclose(fp);
+        }
+    }
+    if (state)
+        driver->fmi3FreeFMUState(instance, &state);
+    free(buffer);
+
+    if (status)
+        fprintf(stderr, "Cannot write snapshot '%s'.\n", filename);
+    else
+        printf("Snapshot       : %s (%zu bytes)\n", filename, size);
+
+    return status;
+}
+
+
+/* The step is done then cancelled: state of the container is restored */
+static fmi3Status driver_rollback(const driver_t *driver, fmi3Instance instance, fmi3FMUState *state,
+                                  double time, double step_size) {
+    fmi3Boolean event_handling_needed;
+    fmi3Boolean terminate_simulation;
+    fmi3Boolean early_return;
+    fmi3Float64 last_successful_time;
+
+    fmi3Status status = driver->fmi3GetFMUState(instance, state);
+    if (status > fmi3Warning)
+        return status;
+    status = driver->fmi3DoStep(instance, time, step_size, fmi3True, &event_handling_needed,
+                                &terminate_simulation, &early_return, &last_successful_time);
+    if (status > fmi3Warning)
+        return status;
+
+    return driver->fmi3SetFMUState(instance, *state);
+}
+
+
+static int driver_run(const driver_t *driver, const char *directory, unsigned long nb_steps, double step_size,
+                      double start_time, const char *snapshot, int rollback, long partition, int verbose) {
+    char resources[DRIVER_PATH_SZ + 16];
+    char token[256] = "";
+    fmi3Boolean event_handling_needed;
+    fmi3Boolean terminate_simulation;
+    fmi3Boolean early_return;
+    fmi3Float64 last_successful_time;
+    fmi3FMUState state = NULL;
+    int status = 0;
+
+    snprintf(resources, sizeof(resources), "%s/resources/", directory);
+    driver_attribute(directory, "instantiationToken", token, sizeof(token));
+
+    uint64_t *durations = malloc(nb_steps * sizeof(*durations));
+    if (!durations) {
+        fprintf(stderr, "Cannot allocate memory for %lu steps.\n", nb_steps);
+        return -1;
+    }
+
+    uint64_t start = driver_now();
+    fmi3Instance instance;
+    if (partition >= 0)
+        instance = driver->fmi3InstantiateScheduledExecution("driver", token, resources, fmi3False, verbose, NULL,
+                                                             driver_logger, driver_clock_update,
+                                                             driver_lock_preemption, driver_unlock_preemption);
+    else
+        instance = driver->fmi3InstantiateCoSimulation("driver", token, resources, fmi3False,
+                                                       verbose, fmi3False, fmi3False, NULL, 0, NULL,
+                                                       driver_logger, NULL);
+    if (!instance) {
+        fprintf(stderr, "Cannot instantiate container from '%s'.\n", resources);
+        free(durations);
+        return -2;
+    }
+
+    if ((driver->fmi3EnterInitializationMode(instance, fmi3False, 0.0, start_time, fmi3False, 0.0) > fmi3Warning) ||
+        (driver->fmi3ExitInitializationMode(instance) > fmi3Warning)) {
+        fprintf(stderr, "Cannot initialize container.\n");
+        driver->fmi3FreeInstance(instance);
+        free(durations);
+        return -3;
+    }
+    const uint64_t initialized = driver_now();
+
+    unsigned long nb_done = 0;
+    for (unsigned long i = 0; i < nb_steps; i += 1) {
+        const uint64_t step_start = driver_now();
+        fmi3Status fmi_status = fmi3OK;
+        terminate_simulation = fmi3False;
+        if (partition >= 0)
+            fmi_status = driver->fmi3ActivateModelPartition(instance, (fmi3ValueReference)partition,
+                                                            start_time + (double)(i + 1) * step_size);
+        else {
+            if (rollback)
+                fmi_status = driver_rollback(driver, instance, &state, start_time + (double)i * step_size, step_size);
+            if (fmi_status <= fmi3Warning)
+                fmi_status = driver->fmi3DoStep(instance, start_time + (double)i * step_size, step_size, fmi3True,
+                                                &event_handling_needed, &terminate_simulation,
+                                                &early_return, &last_successful_time);
+        }
+        durations[i] = driver_now() - step_start;
+        if (fmi_status > fmi3Warning) {
+            fprintf(stderr, "%s failed at t=%g.\n", (partition >= 0) ? "fmi3ActivateModelPartition" : "fmi3DoStep",
+                    start_time + (double)i * step_size);
+            status = -4;
+            break;
+        }
+        nb_done += 1;
+        if (terminate_simulation)
+            break;
+    }
+    const uint64_t stepped = driver_now();
+
+    if (snapshot && !status && driver_snapshot(driver, instance, snapshot))
+        status = -5;
+    if (state)
+        driver->fmi3FreeFMUState(instance, &state);
+
+    driver->fmi3Terminate(instance);
+    driver->fmi3FreeInstance(instance);
+
+    if (nb_done > 0) {
+        const double elapsed = (double)(stepped - initialized) / 1.0e9;
+
+        qsort(durations, nb_done, sizeof(*durations), driver_compare);
+        printf("Steps          : %lu x %g s (simulated time %g s)\n", nb_done, step_size,
+               (double)nb_done * step_size);
+        printf("Initialization : %.6f s\n", (double)(initialized - start) / 1.0e9);
+        printf("Wall time      : %.6f s\n", elapsed);
+        printf("Throughput     : %.1f steps/s (RT ratio %.3f)\n", (double)nb_done / elapsed,
+               (double)nb_done * step_size / elapsed);
+        printf("Step latency   : min=%.3fus p50=%.3fus p90=%.3fus p99=%.3fus max=%.3fus\n",
+               (double)durations[0] / 1.0e3,
+               driver_percentile(durations, nb_done, 0.50),
+               driver_percentile(durations, nb_done, 0.90),
+               driver_percentile(durations, nb_done, 0.99),
+               (double)durations[nb_done - 1] / 1.0e3);
+    }
+    if (partition >= 0) {
+        printf("Preemption     : %lu locks\n", driver_nb_locks);
+        if (driver_nb_lock_errors || driver_locked) {
+            fprintf(stderr, "Unbalanced preemption locks (%lu errors).\n", driver_nb_lock_errors);
+            status = -6;
+        }
+    }
+    free(durations);
+
+    return status;
+}
+
+
+static int driver_ensemble(const driver_t *driver, ensemble_config_t *config) {
+    config->logger = driver_logger;
+    config->environment = NULL;
+
+    const uint64_t start = driver_now();
+    const int status = driver->ensemble_run(config);
+    const double elapsed = (double)(driver_now() - start) / 1.0e9;
+
+    if (!status) {
+        printf("Steps          : %lu x %g s per member\n", config->nb_steps, config->step_size);
+        printf("Wall time      : %.6f s\n", elapsed);
+        printf("Throughput     : %.1f steps/s (all members)\n",
+               (double)config->nb_steps * (double)config->nb_members / elapsed);
+    } else
+        fprintf(stderr, "Ensemble failed (status=%d).\n", status);
+
+    return status;
+}
+
+
+static unsigned long driver_csv_lines(const char *filename) {
+    unsigned long nb = 0;
+    char line[4096];
+    int start = 1;
+
+    FILE *fp = fopen(filename, "rt");
+    if (!fp)
+        return 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (start && line[0] != '\n' && line[0] != '\r')
+            nb += 1;
+        start = (strchr(line, '\n') != NULL);
+    }
+    fclose(fp);
+
+    return nb ? nb - 1 : 0;   /* header */
+}
+
+
+static void driver_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n steps] [-h step_size] [-b start_time] [-l library] [-v] [-s snapshot.bin] "
+                    "[-r] [-x clock_vr] [-e members] [-p parameters.csv] [-o output.csv] [-t threads] "
+                    "<fmu_directory|file.fmu>\n"
+                    "  -n steps      number of fmi3DoStep calls (default: %d)\n"
+                    "  -h step_size  communication step size in seconds (default: from modelDescription)\n"
+                    "  -b time       start time (default: 0). Time of the snapshot of warm-started containers\n"
+                    "  -l library    container library (default: %s)\n"
+                    "  -v            enable container logging\n"
+                    "  -s file.bin   write the serialized state of the container at the end of the run\n"
+                    "  -r            rollback: each step is done, cancelled by restoring the container state, then redone\n"
+                    "  -x clock_vr   scheduled execution: each step activates the partition of this input clock\n"
+                    "  -e members    ensemble: number of container instances simulated concurrently\n"
+                    "  -p file.csv   ensemble: parameters (Float64 or Int32) of each instance. Replaces -e\n"
+                    "  -o file.csv   ensemble: datalog of all instances (container built with datalog)\n"
+                    "  -t threads    ensemble: number of threads (default: one per CPU)\n",
+            program, DRIVER_DEFAULT_STEPS, CONTAINER_LIBRARY);
+
+    return;
+}
+
+
+int main(int argc, char *argv[]) {
+    const char *library = CONTAINER_LIBRARY;
+    const char *path = NULL;
+    unsigned long nb_steps = DRIVER_DEFAULT_STEPS;
+    double step_size = 0.0;
+    double start_time = 0.0;
+    const char *snapshot = NULL;
+    int rollback = 0;
+    long partition = -1;
+    int verbose = 0;
+    ensemble_config_t ensemble = { 0 };
+
+    for (int i = 1; i < argc; i += 1) {
+        if (!strcmp(argv[i], "-n") && (i + 1 < argc))
+            nb_steps = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-h") && (i + 1 < argc))
+            step_size = strtod(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-b") && (i + 1 < argc))
+            start_time = strtod(argv[++i], NULL);
+        else if (!strcmp(argv[i], "-s") && (i + 1 < argc))
+            snapshot = argv[++i];
+        else if (!strcmp(argv[i], "-l") && (i + 1 < argc))
+            library = argv[++i];
+        else if (!strcmp(argv[i], "-r"))
+            rollback = 1;
+        else if (!strcmp(argv[i], "-x") && (i + 1 < argc))
+            partition = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else if (!strcmp(argv[i], "-e") && (i + 1 < argc))
+            ensemble.nb_members = strtoul(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-p") && (i + 1 < argc))
+            ensemble.parameters = argv[++i];
+        else if (!strcmp(argv[i], "-o") && (i + 1 < argc))
+            ensemble.output = argv[++i];
+        else if (!strcmp(argv[i], "-t") && (i + 1 < argc))
+            ensemble.nb_threads = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else {
+            driver_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!path || nb_steps == 0) {
+        driver_usage(argv[0]);
+        return 1;
+    }
+
+    char directory[DRIVER_PATH_SZ];
+    struct stat path_stat;
+    int unpacked = 0;
+    if (stat(path, &path_stat)) {
+        fprintf(stderr, "Cannot access '%s'.\n", path);
+        return 2;
+    }
+    if (path_stat.st_mode & S_IFDIR) {
+        /* Embedded FMU's resources are located using absolute path */
+#ifdef WIN32
+        if (!_fullpath(directory, path, sizeof(directory)))
+#else
+        if (!realpath(path, directory))
+#endif
+            snprintf(directory, sizeof(directory), "%s", path);
+    } else {
+        if (driver_unpack(path, directory, sizeof(directory))) {
+            fprintf(stderr, "Cannot unpack '%s'.\n", path);
+            return 2;
+        }
+        unpacked = 1;
+    }
+
+    if (step_size <= 0.0) {
+        char value[64];
+        if (!driver_attribute(directory, "stepSize", value, sizeof(value)))
+            step_size = strtod(value, NULL);
+        if (step_size <= 0.0)
+            step_size = DRIVER_DEFAULT_STEP;
+    }
+
+    driver_t driver = { 0 };
+    int status = driver_load(&driver, library);
+    if (!status) {
+        if (ensemble.nb_members || ensemble.parameters) {
+            ensemble.directory = directory;
+            ensemble.nb_steps = nb_steps;
+            ensemble.step_size = step_size;
+            ensemble.debug = verbose;
+            if (ensemble.parameters)
+                ensemble.nb_members = driver_csv_lines(ensemble.parameters);
+            status = driver_ensemble(&driver, &ensemble);
+        } else
+            status = driver_run(&driver, directory, nb_steps, step_size, start_time, snapshot, rollback, partition,
+                                verbose);
+    }
+    driver_unload(&driver);
+
+    if (unpacked)
+        driver_cleanup(directory);
+
+    return status ? 3 : 0;
+}
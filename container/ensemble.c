@@ -0,0 +1,503 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "container.h"
+#include "ensemble.h"
+#include "logger.h"
+#include "thread.h"
+#include "trace.h"
+
+/*
+ * Ensemble: several instances of the same container are simulated concurrently in this
+ * process, with different parameters. Each thread of the pool picks the next member to be
+ * simulated until all members are done. Datalog of each member is written in its own file,
+ * then all files are merged into one CSV file with an additional `member` column.
+ */
+
+#define ENSEMBLE_LINE_SZ        65536
+#define ENSEMBLE_PATH_SZ        4096
+
+
+/*----------------------------------------------------------------------------
+                            E N S E M B L E _ T
+----------------------------------------------------------------------------*/
+
+struct ensemble_s;
+
+typedef struct {
+    struct ensemble_s           *ensemble;
+    unsigned long               index;
+    int                         status;
+    char                        datalog_filename[ENSEMBLE_PATH_SZ];
+} ensemble_member_t;
+
+typedef struct {
+    struct ensemble_s           *ensemble;
+    int                         slot;           /* 0 is the calling thread */
+    thread_t                    thread;
+} ensemble_worker_t;
+
+typedef struct ensemble_s {
+    const ensemble_config_t     *config;
+    char                        resources[ENSEMBLE_PATH_SZ];
+    unsigned long               nb_members;
+    ensemble_member_t           *members;
+    int                         nb_parameters;
+    fmi3ValueReference          *vr;
+    bool                        *integer;       /* Int32 parameter, otherwise Float64 */
+    double                      *values;        /* nb_members x nb_parameters */
+    thread_atomic_t             next;           /* next member to be simulated */
+} ensemble_t;
+
+
+static void ensemble_log(const ensemble_t *ensemble, fmi3Status status, const char *message, ...)
+    __attribute__((__format__(__printf__, 3, 4)));
+
+static void ensemble_log(const ensemble_t *ensemble, fmi3Status status, const char *message, ...) {
+    if (ensemble->config->logger) {
+        char buffer[4096];
+        va_list ap;
+
+        va_start(ap, message);
+        vsnprintf(buffer, sizeof(buffer), message, ap);
+        va_end(ap);
+        ensemble->config->logger(ensemble->config->environment, status, (status == fmi3OK) ? "Info" : "Error",
+                                 buffer);
+    }
+
+    return;
+}
+
+
+/* Messages of containers are prefixed by the member index */
+static void ensemble_logger(fmi3InstanceEnvironment environment, fmi3Status status, fmi3String category,
+                            fmi3String message) {
+    const ensemble_member_t *member = environment;
+    const ensemble_config_t *config = member->ensemble->config;
+
+    if (config->logger) {
+        char buffer[4096];
+
+        snprintf(buffer, sizeof(buffer), "member #%lu: %s", member->index, message);
+        config->logger(config->environment, status, category, buffer);
+    }
+
+    return;
+}
+
+
+/*----------------------------------------------------------------------------
+                            P A R A M E T E R S
+----------------------------------------------------------------------------*/
+
+static char *ensemble_read_file(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    const long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *content = malloc(length + 1);
+    if (content)
+        content[fread(content, 1, length, fp)] = '\0';
+    fclose(fp);
+
+    return content;
+}
+
+
+/*
+ * Find the value reference of a Float64 or Int32 (FMI-3.0), Real or Integer (FMI-2.0) variable
+ * in modelDescription.xml. This is not a full XML parser: attributes are expected to be
+ * written as `name="..."` and `valueReference="..."`.
+ */
+static int ensemble_variable(const char *xml, const char *name, fmi3ValueReference *vr, bool *integer) {
+    char pattern[512];
+
+    snprintf(pattern, sizeof(pattern), " name=\"%s\"", name);
+    for (const char *found = strstr(xml, pattern); found; found = strstr(found + 1, pattern)) {
+        const char *start = found;
+        while ((start > xml) && (*start != '<'))
+            start -= 1;
+        const char *end = strchr(found, '>');
+        if (!end)
+            return -1;
+
+        const char *type = start + 1;
+        if (!strncmp(type, "ScalarVariable", 14)) {
+            type = strchr(end, '<');
+            if (!type)
+                return -1;
+            type += 1;
+            if (!strncmp(type, "Integer", 7))
+                *integer = true;
+            else if (!strncmp(type, "Real", 4))
+                *integer = false;
+            else
+                return -2;
+        } else if (!strncmp(type, "Int32", 5))
+            *integer = true;
+        else if (!strncmp(type, "Float64", 7))
+            *integer = false;
+        else
+            continue;
+
+        const char *reference = strstr(start, "valueReference=\"");
+        if (!reference || (reference > end))
+            return -1;
+        *vr = (fmi3ValueReference)strtoul(reference + 16, NULL, 10);
+
+        return 0;
+    }
+
+    return -1;
+}
+
+
+static void ensemble_chomp(char *line) {
+    size_t len = strlen(line);
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' '))
+        line[--len] = '\0';
+
+    return;
+}
+
+
+/*
+ * CSV file: first line gives the names of the parameters, each following line gives the
+ * values of one member.
+ */
+static int ensemble_read_parameters(ensemble_t *ensemble, const char *directory, const char *filename) {
+    char xml_filename[ENSEMBLE_PATH_SZ];
+    int status = 0;
+
+    snprintf(xml_filename, sizeof(xml_filename), "%s/modelDescription.xml", directory);
+    char *xml = ensemble_read_file(xml_filename);
+    if (!xml) {
+        ensemble_log(ensemble, fmi3Error, "Cannot read '%s'.", xml_filename);
+        return -1;
+    }
+
+    char *line = malloc(ENSEMBLE_LINE_SZ);
+    FILE *fp = fopen(filename, "rt");
+    if (!line || !fp || !fgets(line, ENSEMBLE_LINE_SZ, fp)) {
+        ensemble_log(ensemble, fmi3Error, "Cannot read parameters from '%s'.", filename);
+        status = -2;
+        goto exit;
+    }
+
+    ensemble_chomp(line);
+    ensemble->nb_parameters = 1;
+    for (const char *c = line; *c; c += 1)
+        ensemble->nb_parameters += (*c == ',');
+    ensemble->vr = malloc(ensemble->nb_parameters * sizeof(*ensemble->vr));
+    ensemble->integer = malloc(ensemble->nb_parameters * sizeof(*ensemble->integer));
+    if (!ensemble->vr || !ensemble->integer) {
+        status = -3;
+        goto exit;
+    }
+
+    int i = 0;
+    for (char *name = strtok(line, ","); name; name = strtok(NULL, ","), i += 1) {
+        while (*name == ' ')
+            name += 1;
+        if (ensemble_variable(xml, name, &ensemble->vr[i], &ensemble->integer[i])) {
+            ensemble_log(ensemble, fmi3Error, "'%s' is not a Float64 or Int32 variable of the container.", name);
+            status = -4;
+            goto exit;
+        }
+    }
+    if (i != ensemble->nb_parameters) {
+        ensemble_log(ensemble, fmi3Error, "Empty parameter name in '%s'.", filename);
+        status = -4;
+        goto exit;
+    }
+
+    unsigned long nb_allocated = 0;
+    while (fgets(line, ENSEMBLE_LINE_SZ, fp)) {
+        ensemble_chomp(line);
+        if (!line[0])
+            continue;
+
+        if (ensemble->nb_members == nb_allocated) {
+            nb_allocated = nb_allocated ? 2 * nb_allocated : 64;
+            double *values = realloc(ensemble->values, nb_allocated * ensemble->nb_parameters * sizeof(*values));
+            if (!values) {
+                status = -3;
+                goto exit;
+            }
+            ensemble->values = values;
+        }
+
+        char *c = line;
+        for (i = 0; i < ensemble->nb_parameters; i += 1) {
+            char *next;
+            ensemble->values[ensemble->nb_members * ensemble->nb_parameters + i] = strtod(c, &next);
+            if ((next == c) || ((i + 1 < ensemble->nb_parameters) && (*next != ','))) {
+                ensemble_log(ensemble, fmi3Error, "Cannot read parameters of member #%lu in '%s'.",
+                             ensemble->nb_members, filename);
+                status = -5;
+                goto exit;
+            }
+            c = next + 1;
+        }
+        ensemble->nb_members += 1;
+    }
+
+exit:
+    if (fp)
+        fclose(fp);
+    free(line);
+    free(xml);
+
+    return status;
+}
+
+
+/*----------------------------------------------------------------------------
+                               M E M B E R S
+----------------------------------------------------------------------------*/
+
+static int ensemble_member_simulate(ensemble_member_t *member, container_t *container) {
+    const ensemble_t *ensemble = member->ensemble;
+    const ensemble_config_t *config = ensemble->config;
+    fmi3Boolean event_handling_needed;
+    fmi3Boolean terminate_simulation;
+    fmi3Boolean early_return;
+    fmi3Float64 last_successful_time;
+
+    for (int i = 0; i < ensemble->nb_parameters; i += 1) {
+        const double value = ensemble->values[member->index * ensemble->nb_parameters + i];
+        fmi3Status status;
+
+        if (ensemble->integer[i]) {
+            const fmi3Int32 integer = (fmi3Int32)value;
+            status = fmi3SetInt32(container, &ensemble->vr[i], 1, &integer, 1);
+        } else
+            status = fmi3SetFloat64(container, &ensemble->vr[i], 1, &value, 1);
+        if (status > fmi3Warning)
+            return -3;
+    }
+
+    if ((fmi3EnterInitializationMode(container, fmi3False, 0.0, 0.0, fmi3False, 0.0) > fmi3Warning) ||
+        (fmi3ExitInitializationMode(container) > fmi3Warning))
+        return -4;
+
+    for (unsigned long i = 0; i < config->nb_steps; i += 1) {
+        if (fmi3DoStep(container, (double)i * config->step_size, config->step_size, fmi3True,
+                       &event_handling_needed, &terminate_simulation, &early_return,
+                       &last_successful_time) > fmi3Warning)
+            return -5;
+        if (terminate_simulation)
+            break;
+    }
+
+    if (fmi3Terminate(container) > fmi3Warning)
+        return -6;
+
+    return 0;
+}
+
+
+static int ensemble_member_run(ensemble_member_t *member, int slot) {
+    const ensemble_t *ensemble = member->ensemble;
+    const ensemble_config_t *config = ensemble->config;
+    char instance_name[64];
+
+    snprintf(instance_name, sizeof(instance_name), "member-%lu", member->index);
+    const container_instantiation_t instantiation = {
+        .datalog_filename = config->output ? member->datalog_filename : NULL,
+        .library_copy = slot
+    };
+    container_t *container = fmi3_container_new(instance_name, "", ensemble->resources, config->debug, member,
+                                                ensemble_logger, &instantiation);
+    if (!container)
+        return -2;
+
+    /* Only first member writes execution trace and profile */
+    if (member->index > 0) {
+        trace_free(container->trace);
+        container->trace = NULL;
+        free(container->profile_filename);
+        container->profile_filename = NULL;
+    }
+
+    const int status = ensemble_member_simulate(member, container);
+    fmi3FreeInstance(container);
+
+    return status;
+}
+
+
+static void *ensemble_thread(ensemble_worker_t *worker) {
+    ensemble_t *ensemble = worker->ensemble;
+
+    for (;;) {
+        unsigned long long next = thread_atomic_load(&ensemble->next);
+        while ((next < ensemble->nb_members) && !thread_atomic_cas(&ensemble->next, next, next + 1))
+            next = thread_atomic_load(&ensemble->next);
+        if (next >= ensemble->nb_members)
+            break;
+
+        ensemble_member_t *member = &ensemble->members[next];
+        member->status = ensemble_member_run(member, worker->slot);
+        if (member->status)
+            ensemble_log(ensemble, fmi3Error, "member #%lu: simulation failed (status=%d).", member->index,
+                         member->status);
+    }
+
+    return NULL;
+}
+
+
+/*----------------------------------------------------------------------------
+                                O U T P U T
+----------------------------------------------------------------------------*/
+
+/* Copy a datalog file. Each line is prefixed by member index (or name of the column for the header) */
+static void ensemble_merge(FILE *out, FILE *in, const char *prefix, int with_header) {
+    int c;
+    int line = 0;
+    int start = 1;
+
+    while ((c = fgetc(in)) != EOF) {
+        if (start) {
+            if (line == 0 && !with_header) {
+                while ((c != '\n') && (c != EOF))
+                    c = fgetc(in);
+                line += 1;
+                continue;
+            }
+            fprintf(out, "%s,", (line == 0) ? "member" : prefix);
+            start = 0;
+        }
+        fputc(c, out);
+        if (c == '\n') {
+            line += 1;
+            start = 1;
+        }
+    }
+
+    return;
+}
+
+
+static int ensemble_output(const ensemble_t *ensemble) {
+    const char *filename = ensemble->config->output;
+    int with_header = 1;
+
+    FILE *out = fopen(filename, "wt");
+    if (!out) {
+        ensemble_log(ensemble, fmi3Error, "Cannot open '%s': %s", filename, strerror(errno));
+        return -1;
+    }
+
+    for (unsigned long i = 0; i < ensemble->nb_members; i += 1) {
+        const ensemble_member_t *member = &ensemble->members[i];
+        FILE *in = fopen(member->datalog_filename, "rt");
+
+        if (in) {
+            char prefix[32];
+
+            snprintf(prefix, sizeof(prefix), "%lu", member->index);
+            ensemble_merge(out, in, prefix, with_header);
+            with_header = 0;
+            fclose(in);
+            remove(member->datalog_filename);
+        }
+    }
+    fclose(out);
+
+    if (with_header)
+        ensemble_log(ensemble, fmi3Warning, "No datalog: the container should be built with datalog enabled.");
+    else
+        ensemble_log(ensemble, fmi3OK, "Results written to '%s'.", filename);
+
+    return 0;
+}
+
+
+/*----------------------------------------------------------------------------
+                              E N S E M B L E
+----------------------------------------------------------------------------*/
+
+int ensemble_run(const ensemble_config_t *config) {
+    ensemble_t ensemble;
+    int status = 0;
+
+    ensemble.config = config;
+    ensemble.nb_members = 0;
+    ensemble.members = NULL;
+    ensemble.nb_parameters = 0;
+    ensemble.vr = NULL;
+    ensemble.integer = NULL;
+    ensemble.values = NULL;
+    ensemble.next = 0;
+    snprintf(ensemble.resources, sizeof(ensemble.resources), "%s/resources", config->directory);
+
+    if (config->parameters) {
+        if (ensemble_read_parameters(&ensemble, config->directory, config->parameters)) {
+            status = -1;
+            goto exit;
+        }
+    } else
+        ensemble.nb_members = config->nb_members;
+
+    ensemble.members = malloc(ensemble.nb_members * sizeof(*ensemble.members));
+    if (!ensemble.members) {
+        ensemble_log(&ensemble, fmi3Error, "Cannot allocate %lu members.", ensemble.nb_members);
+        status = -2;
+        goto exit;
+    }
+    for (unsigned long i = 0; i < ensemble.nb_members; i += 1) {
+        ensemble.members[i].ensemble = &ensemble;
+        ensemble.members[i].index = i;
+        ensemble.members[i].status = 0;
+        snprintf(ensemble.members[i].datalog_filename, ENSEMBLE_PATH_SZ, "%s.%lu", config->output ? config->output : "", i);
+    }
+
+    int nb_threads = (config->nb_threads > 0) ? config->nb_threads : thread_nb_cpu();
+    if ((unsigned long)nb_threads > ensemble.nb_members)
+        nb_threads = (int)ensemble.nb_members;
+    ensemble_log(&ensemble, fmi3OK, "Ensemble of %lu members on %d threads.", ensemble.nb_members, nb_threads);
+
+    ensemble_worker_t *workers = malloc(nb_threads * sizeof(*workers));
+    if (nb_threads && !workers) {
+        status = -2;
+        goto exit;
+    }
+    for (int i = 0; i < nb_threads; i += 1) {
+        workers[i].ensemble = &ensemble;
+        workers[i].slot = i;
+    }
+
+    /* Calling thread is part of the pool */
+    for (int i = 1; i < nb_threads; i += 1)
+        workers[i].thread = thread_new((thread_function_t)ensemble_thread, &workers[i]);
+    if (nb_threads)
+        ensemble_thread(&workers[0]);
+    for (int i = 1; i < nb_threads; i += 1)
+        thread_join(workers[i].thread);
+    free(workers);
+
+    for (unsigned long i = 0; i < ensemble.nb_members; i += 1) {
+        if (ensemble.members[i].status)
+            status = -3;
+    }
+
+    if (config->output && ensemble_output(&ensemble))
+        status = -4;
+
+exit:
+    free(ensemble.members);
+    free(ensemble.vr);
+    free(ensemble.integer);
+    free(ensemble.values);
+
+    return status;
+}
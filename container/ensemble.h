@@ -0,0 +1,40 @@
+#ifndef ENSEMBLE_H
+#   define ENSEMBLE_H
+
+#	ifdef __cplusplus
+extern "C" {
+#	endif
+
+#include "fmi3Functions.h"
+
+
+/*----------------------------------------------------------------------------
+                       E N S E M B L E _ C O N F I G _ T
+----------------------------------------------------------------------------*/
+
+typedef struct {
+    const char                  *directory;     /* container FMU (extracted) */
+    const char                  *parameters;    /* CSV: names of Float64 or Int32 variables, then one line per member. Optional */
+    unsigned long               nb_members;     /* used if there is no parameters file */
+    unsigned long               nb_steps;
+    double                      step_size;
+    int                         nb_threads;     /* 0: one thread per CPU */
+    const char                  *output;        /* CSV: datalog of all members. Optional */
+    int                         debug;
+    fmi3LogMessageCallback      logger;         /* may be called concurrently by several threads */
+    void                        *environment;   /* given to logger */
+} ensemble_config_t;
+
+
+/*----------------------------------------------------------------------------
+                            P R O T O T Y P E S
+----------------------------------------------------------------------------*/
+
+typedef int ensemble_runTYPE(const ensemble_config_t *config);
+
+FMI3_Export ensemble_runTYPE ensemble_run;
+
+#	ifdef __cplusplus
+}
+#	endif
+#endif
@@ -3,8 +3,11 @@
 
 #include "fmi2Functions.h"
 
+#include "checkpoint.h"
 #include "container.h"
+#include "integrator.h"
 #include "logger.h"
+#include "trace.h"
 
 /*
  * FMI-2.0 implementation
@@ -15,14 +18,14 @@
 ----------------------------------------------------------------------------*/
 
 /* unimplemented fmi2 functions */
-#define __NOT_IMPLEMENTED__                                                         \
-    logger(LOGGER_ERROR, "Function '%s' is not implemented", __func__);             \
+#define __NOT_IMPLEMENTED__(_instance)                                                                       \
+    logger(&((container_t *)_instance)->logger, LOGGER_ERROR, "Function '%s' is not implemented", __func__); \
     return fmi2Error;
 
-#define ASSERT_CONTAINER_STATE(_container, _state)                                  \
-    if (_container->state != _state) {                                              \
-    	logger(LOGGER_ERROR, "Must be in state %s to call %s", #_state, __func__);  \
-        return fmi2Error;                                                           \
+#define ASSERT_CONTAINER_STATE(_container, _state)                                                           \
+    if (_container->state != _state) {                                                                       \
+    	logger(&_container->logger, LOGGER_ERROR, "Must be in state %s to call %s", #_state, __func__);      \
+        return fmi2Error;                                                                                    \
     }
 
 /*----------------------------------------------------------------------------
@@ -44,11 +47,12 @@ fmi2Status  fmi2SetDebugLogging(fmi2Component c,
     size_t nCategories,
     const fmi2String categories[]) {
 
-    (void)c; /* unused parameter */
+    container_t* container = (container_t*)c;
+
     (void)nCategories; /* unused parameter */
     (void)categories; /* unused parameter */
 
-    logger_set_debug(loggingOn);
+    logger_set_debug(&container->logger, loggingOn);
 
     return fmi2OK;
 }
@@ -74,16 +78,16 @@ fmi2Component fmi2Instantiate(fmi2String instanceName,
             container->allocate_memory = functions->allocateMemory;
             container->free_memory = functions->freeMemory;
         }
-        logger_init(FMU_2, container_logger, functions->componentEnvironment, container->instance_name, loggingOn); 
+        logger_init(&container->logger, FMU_2, container_logger, functions->componentEnvironment, container->instance_name, loggingOn); 
         /* logger() is available starting this point ! */
 
         if (fmuType != fmi2CoSimulation) {
-            logger(LOGGER_ERROR, "Only CoSimulation mode is supported.");
+            logger(&container->logger, LOGGER_ERROR, "Only CoSimulation mode is supported.");
             container_free(container);
             return NULL;
         } 
 
-        logger(LOGGER_DEBUG, "Container model loading...");
+        logger(&container->logger, LOGGER_DEBUG, "Container model loading...");
         if (strncmp(fmuResourceLocation, "file://", 7) == 0)
             fmuResourceLocation += 7;
 #ifdef WIN32
@@ -92,11 +96,11 @@ fmi2Component fmi2Instantiate(fmi2String instanceName,
 #endif
 
         if (container_configure(container, fmuResourceLocation)) {
-            logger(LOGGER_ERROR, "Cannot read container configuration.");
+            logger(&container->logger, LOGGER_ERROR, "Cannot read container configuration.");
             container_free(container);
             return NULL;
         }
-        logger(LOGGER_DEBUG, "Container configuration read.");
+        logger(&container->logger, LOGGER_DEBUG, "Container configuration read.");
     }
 
     container->state = CONTAINER_STATE_INSTANTIATED;
@@ -108,7 +112,7 @@ fmi2Component fmi2Instantiate(fmi2String instanceName,
 void fmi2FreeInstance(fmi2Component c) {
     container_t* container = (container_t*)c;
 
-    logger(LOGGER_DEBUG, "Container instance '%s' release", container->instance_name);
+    logger(&container->logger, LOGGER_DEBUG, "Container instance '%s' release", container->instance_name);
     container_free(container);
 
     return;
@@ -172,6 +176,8 @@ fmi2Status fmi2Terminate(fmi2Component c) {
             return fmi2Error;
     }
  
+    trace_write(container->trace, container);
+
     return fmi2OK;
 }
 
@@ -245,6 +251,8 @@ fmi2Status fmi2Set ## fmi_type (fmi2Component c, const fmi2ValueReference vr[],
                 status = fmuSet ## name (fmu, &fmu_vr, 1, &value[i], 1);                                                        \
                 if (status != FMU_STATUS_OK)                                                                                    \
                     return fmi2Error;                                                                                           \
+                if (fmu->model_exchange)                                                                                        \
+                    container->integrator->restart = true;   /* derivatives depend on inputs */                                 \
             }                                                                                                                   \
         }                                                                                                                       \
     }                                                                                                                           \
@@ -277,6 +285,8 @@ fmi2Status fmi2SetString(fmi2Component c, const fmi2ValueReference vr[], size_t
                 status = fmuSetString(fmu, &fmu_vr, 1, &value[i], 1);
                 if (status != FMU_STATUS_OK)
                     return fmi2Error;
+                if (fmu->model_exchange)
+                    container->integrator->restart = true;   /* derivatives depend on inputs */
             }
         }
     }
@@ -288,55 +298,69 @@ fmi2Status fmi2SetString(fmi2Component c, const fmi2ValueReference vr[], size_t
 
 /* Getting and setting the internal FMU state */
 fmi2Status fmi2GetFMUstate(fmi2Component c, fmi2FMUstate* FMUstate) {
-    (void)c; /* unused parameter */
-    (void)FMUstate; /* unused parameter */
+    container_t *container = (container_t *)c;
 
-    __NOT_IMPLEMENTED__
+    if (*FMUstate) {
+        if (checkpoint_get(container, *FMUstate) != FMU_STATUS_OK)
+            return fmi2Error;
+    } else {
+        *FMUstate = checkpoint_new(container);
+        if (!*FMUstate)
+            return fmi2Error;
+    }
+
+    return fmi2OK;
 }
 
 
-fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate  FMUstate) {
-    (void)c; /* unused parameter */
-    (void)FMUstate; /* unused parameter */
+fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate FMUstate) {
+    container_t *container = (container_t *)c;
 
-    __NOT_IMPLEMENTED__
+    if (!FMUstate || (checkpoint_set(container, FMUstate) != FMU_STATUS_OK))
+        return fmi2Error;
+
+    return fmi2OK;
 }
 
 
 fmi2Status fmi2FreeFMUstate(fmi2Component c, fmi2FMUstate* FMUstate) {
-    (void)c; /* unused parameter */
-    (void)FMUstate; /* unused parameter */
+    container_t *container = (container_t *)c;
 
-    __NOT_IMPLEMENTED__
+    checkpoint_free(container, *FMUstate);
+    *FMUstate = NULL;
+
+    return fmi2OK;
 }
 
 
 fmi2Status fmi2SerializedFMUstateSize(fmi2Component c, fmi2FMUstate  FMUstate, size_t* size) {
-    (void)c; /* unused parameter */
-    (void)FMUstate; /* unused parameter */
-    (void)size; /* unused parameter */
+    container_t *container = (container_t *)c;
+
+    if (!FMUstate || (checkpoint_serialized_size(container, FMUstate, size) != FMU_STATUS_OK))
+        return fmi2Error;
 
-    __NOT_IMPLEMENTED__
+    return fmi2OK;
 }
 
 
 fmi2Status fmi2SerializeFMUstate(fmi2Component c, fmi2FMUstate  FMUstate, fmi2Byte serializedState[], size_t size) {
-    (void)c; /* unused parameter */
-    (void)FMUstate; /* unused parameter */
-    (void)serializedState; /* unused parameter */
-    (void)size; /* unused parameter */
+    container_t *container = (container_t *)c;
 
-    __NOT_IMPLEMENTED__
+    if (!FMUstate || (checkpoint_serialize(container, FMUstate, (uint8_t *)serializedState, size) != FMU_STATUS_OK))
+        return fmi2Error;
+
+    return fmi2OK;
 }
 
 
 fmi2Status fmi2DeSerializeFMUstate(fmi2Component c, const fmi2Byte serializedState[], size_t size, fmi2FMUstate* FMUstate) {
-    (void)c; /* unused parameter */
-    (void)serializedState; /* unused parameter */
-    (void)size; /* unused parameter */
-    (void)FMUstate; /* unused parameter */
+    container_t *container = (container_t *)c;
 
-    __NOT_IMPLEMENTED__
+    *FMUstate = checkpoint_deserialize(container, (const uint8_t *)serializedState, size);
+    if (!*FMUstate)
+        return fmi2Error;
+
+    return fmi2OK;
 }
 
 
@@ -346,7 +370,6 @@ fmi2Status fmi2GetDirectionalDerivative(fmi2Component c,
     const fmi2ValueReference vKnown_ref[], size_t nKnown,
     const fmi2Real dvKnown[],
     fmi2Real dvUnknown[]) {
-    (void)c; /* unused parameter */
     (void)vUnknown_ref; /* unused parameter */
     (void)nUnknown; /* unused parameter */
     (void)vKnown_ref; /* unused parameter */
@@ -354,7 +377,7 @@ fmi2Status fmi2GetDirectionalDerivative(fmi2Component c,
     (void)dvKnown; /* unused parameter */
     (void)dvUnknown; /* unused parameter */
     
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(c)
 }
 
 
@@ -362,13 +385,12 @@ fmi2Status fmi2SetRealInputDerivatives(fmi2Component c,
     const fmi2ValueReference vr[], size_t nvr,
     const fmi2Integer order[],
     const fmi2Real value[]) {
-    (void)c; /* unused parameter */
     (void)vr; /* unused parameter */
     (void)nvr; /* unused parameter */
     (void)order; /* unused parameter */
     (void)value; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(c)
 }
 
 
@@ -376,13 +398,12 @@ fmi2Status fmi2GetRealOutputDerivatives(fmi2Component c,
     const fmi2ValueReference vr[], size_t nvr,
     const fmi2Integer order[],
     fmi2Real value[]) {
-    (void)c; /* unused parameter */
     (void)vr; /* unused parameter */
     (void)nvr; /* unused parameter */
     (void)order; /* unused parameter */
     (void)value; /* unused parameter */
 
-        __NOT_IMPLEMENTED__
+        __NOT_IMPLEMENTED__(c)
 }
 
 
@@ -410,9 +431,8 @@ fmi2Status fmi2DoStep(fmi2Component c,
 
 
 fmi2Status fmi2CancelStep(fmi2Component c) {
-    (void)c; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(c)
 }
 
 
@@ -424,11 +444,10 @@ fmi2Status fmi2CancelStep(fmi2Component c) {
  * fmi2DoStep call.
  */
 fmi2Status fmi2GetStatus(fmi2Component c, const fmi2StatusKind s, fmi2Status* value) {
-    (void)c; /* unused parameter */
     (void)s; /* unused parameter */
     (void)value; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(c)
 }
 
 
@@ -456,11 +475,10 @@ fmi2Status fmi2GetRealStatus(fmi2Component c, const fmi2StatusKind s, fmi2Real*
 
 
 fmi2Status fmi2GetIntegerStatus(fmi2Component c, const fmi2StatusKind s, fmi2Integer* value) {
-    (void)c; /* unused parameter */
     (void)s; /* unused parameter */
     (void)value; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(c)
 }
 
 
@@ -495,9 +513,8 @@ fmi2Status fmi2GetBooleanStatus(fmi2Component c, const fmi2StatusKind s, fmi2Boo
  * asynchronous fmi2DoStep computation.
  */
 fmi2Status fmi2GetStringStatus(fmi2Component c, const fmi2StatusKind s, fmi2String* value) {
-    (void)c; /* unused parameter */
     (void)s; /* unused parameter */
     (void)value; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(c)
 }
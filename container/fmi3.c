@@ -3,8 +3,11 @@
 
 #include "fmi3Functions.h"
 
+#include "checkpoint.h"
 #include "container.h"
+#include "integrator.h"
 #include "logger.h"
+#include "trace.h"
 
 /*
  * FMI-3.0 implementation
@@ -15,14 +18,14 @@
 ----------------------------------------------------------------------------*/
 
 /* unimplemented fmi3 functions */
-#define __NOT_IMPLEMENTED__                                                         \
-    logger(LOGGER_ERROR, "Function '%s' is not implemented", __func__);             \
+#define __NOT_IMPLEMENTED__(_instance)                                                                       \
+    logger(&((container_t *)_instance)->logger, LOGGER_ERROR, "Function '%s' is not implemented", __func__); \
     return fmi3Error;
 
-#define ASSERT_CONTAINER_STATE(_container, _state)                                  \
-    if (_container->state != _state) {                                              \
-    	logger(LOGGER_ERROR, "Must be in state %s to call %s", #_state, __func__);  \
-        return fmi3Error;                                                           \
+#define ASSERT_CONTAINER_STATE(_container, _state)                                                           \
+    if (_container->state != _state) {                                                                       \
+    	logger(&_container->logger, LOGGER_ERROR, "Must be in state %s to call %s", #_state, __func__);      \
+        return fmi3Error;                                                                                    \
     }
 
 
@@ -40,15 +43,60 @@ fmi3Status fmi3SetDebugLogging(fmi3Instance instance,
                               size_t nCategories,
                               const fmi3String categories[]) {
     
-    (void)instance; /* unused parameter */
+    container_t* container = (container_t*)instance;
+
     (void)nCategories; /* unused parameter */
     (void)categories; /* unused parameter */
 
-    logger_set_debug(loggingOn);
+    logger_set_debug(&container->logger, loggingOn);
 
     return fmi3OK;
 }
 
+container_t *fmi3_container_new(fmi3String instanceName,
+                                fmi3String instantiationToken,
+                                fmi3String resourcePath,
+                                fmi3Boolean loggingOn,
+                                fmi3InstanceEnvironment instanceEnvironment,
+                                fmi3LogMessageCallback logMessage,
+                                const container_instantiation_t *instantiation) {
+    container_t* container;
+    container = container_new(instanceName, instantiationToken);
+
+    if (container) {
+        logger_function_t container_logger;
+        container_logger.logger_fmi3 = logMessage;
+        logger_init(&container->logger, FMU_3, container_logger, instanceEnvironment, container->instance_name, loggingOn); 
+        /* logger() is available starting this point ! */
+
+        if (instantiation) {
+            if (instantiation->scheduled_execution)
+                container->scheduled_execution = *instantiation->scheduled_execution;
+            container->datalog_filename = instantiation->datalog_filename;
+            container->library_copy = instantiation->library_copy;
+        }
+
+        logger(&container->logger, LOGGER_DEBUG, "Container model loading...");
+        if (strncmp(resourcePath, "file://", 7) == 0)
+            resourcePath += 7;
+#ifdef WIN32
+        if (resourcePath[0] == '/')
+            resourcePath += 1;
+#endif
+
+        if (container_configure(container, resourcePath)) {
+            logger(&container->logger, LOGGER_ERROR, "Cannot read container configuration.");
+            container_free(container);
+            return NULL;
+        }
+        logger(&container->logger, LOGGER_DEBUG, "Container configuration read.");
+        container->state = CONTAINER_STATE_INSTANTIATED;
+    }
+
+    return container;
+}
+
+
 fmi3Instance fmi3InstantiateCoSimulation(
     fmi3String                     instanceName,
     fmi3String                     instantiationToken,
@@ -72,41 +120,15 @@ fmi3Instance fmi3InstantiateCoSimulation(
     (void)instanceEnvironment; /* unused parameter */
     (void)intermediateUpdate; /* unused parameter */    
 
-    container_t* container;
-    container = container_new(instanceName, instantiationToken);
-
-    if (container) {
-        logger_function_t container_logger;
-        container_logger.logger_fmi3 = logMessage;
-        logger_init(FMU_3, container_logger, instanceEnvironment, container->instance_name, loggingOn); 
-        /* logger() is available starting this point ! */
-
-        logger(LOGGER_DEBUG, "Container model loading...");
-        if (strncmp(resourcePath, "file://", 7) == 0)
-            resourcePath += 7;
-#ifdef WIN32
-        if (resourcePath[0] == '/')
-            resourcePath += 1;
-#endif
-
-        if (container_configure(container, resourcePath)) {
-            logger(LOGGER_ERROR, "Cannot read container configuration.");
-            container_free(container);
-            return NULL;
-        }
-        logger(LOGGER_DEBUG, "Container configuration read.");
-    }
-
-    container->state = CONTAINER_STATE_INSTANTIATED;
-
-    return container;
+    return fmi3_container_new(instanceName, instantiationToken, resourcePath, loggingOn,
+                              instanceEnvironment, logMessage, NULL);
 }
 
 
 void fmi3FreeInstance(fmi3Instance instance) {
     container_t* container = (container_t*)instance;
 
-    logger(LOGGER_DEBUG, "Container instance '%s' to be freed...", container->instance_name);
+    logger(&container->logger, LOGGER_DEBUG, "Container instance '%s' to be freed...", container->instance_name);
     container_free(container);
 
     return;
@@ -175,6 +197,8 @@ fmi3Status fmi3Terminate(fmi3Instance instance) {
     
     container->state = CONTAINER_STATE_TERMINATED;
 
+    trace_write(container->trace, container);
+
     return fmi3OK;
 }
 
@@ -224,7 +248,7 @@ fmi3Status fmi3Get ## fmi_type (fmi3Instance instance, const fmi3ValueReference
     }                                                                                                   \
                                                                                                         \
     if (value_index != nValues) {                                                                       \
-        logger(LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",                           \
+        logger(&container->logger, LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",       \
             __func__, value_index, nValues);                                                            \
         return fmi3Error;                                                                               \
     }                                                                                                   \
@@ -279,7 +303,7 @@ fmi3Status fmi3GetBinary(fmi3Instance instance,
     }
 
     if (value_index != nValues) {
-        logger(LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",
+        logger(&container->logger, LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",
             __func__, value_index, nValues);
         return fmi3Error;
     }
@@ -342,13 +366,15 @@ fmi3Status fmi3Set ## fmi_type (fmi3Instance instance, const fmi3ValueReference
                 status = fmuSet ## fmu_type (fmu, &fmu_vr, 1, &value[value_index], port->dimension);\
                 if (status != FMU_STATUS_OK)                                                        \
                     return fmi3Error;                                                               \
+                if (fmu->model_exchange)                                                            \
+                    container->integrator->restart = true;   /* derivatives depend on inputs */     \
             }                                                                                       \
         }                                                                                           \
         value_index += port->dimension;                                                             \
     }                                                                                               \
                                                                                                     \
     if (value_index != nValues) {                                                                   \
-        logger(LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",                       \
+        logger(&container->logger, LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",   \
             __func__, value_index, nValues);                                                        \
         return fmi3Error;                                                                           \
     }                                                                                               \
@@ -392,13 +418,15 @@ fmi3Status fmi3SetString(fmi3Instance instance, const fmi3ValueReference valueRe
                 status = fmuSetString(fmu, &fmu_vr, 1, &value[value_index], port->dimension);
                 if (status != FMU_STATUS_OK)
                     return fmi3Error;
+                if (fmu->model_exchange)
+                    container->integrator->restart = true;   /* derivatives depend on inputs */
             }
         }
         value_index += port->dimension;
     }
 
     if (value_index != nValues) {   
-        logger(LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",
+        logger(&container->logger, LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",
             __func__, value_index, nValues);
         return fmi3Error;
     }  
@@ -429,7 +457,7 @@ fmi3Status fmi3SetBinary(fmi3Instance instance,
                         container->binaries[fmu_vr + k].data = realloc(container->binaries[fmu_vr + k].data, valueSizes[value_index + k]);
                         if (! container->binaries[fmu_vr + k].data) {
                             container->binaries[fmu_vr + k].max_size = 0;
-                            logger(LOGGER_ERROR, "Cannot allocate memory for SetBinary");
+                            logger(&container->logger, LOGGER_ERROR, "Cannot allocate memory for SetBinary");
                             return fmi3Error;
                         }
                         container->binaries[fmu_vr + k].max_size = valueSizes[value_index + k];
@@ -445,13 +473,15 @@ fmi3Status fmi3SetBinary(fmi3Instance instance,
 
                 if (status != FMU_STATUS_OK)
                     return fmi3Error;
+                if (fmu->model_exchange)
+                    container->integrator->restart = true;   /* derivatives depend on inputs */
             }
         }
         value_index += port->dimension;
     }
 
     if (value_index != nValues) {   
-        logger(LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",
+        logger(&container->logger, LOGGER_ERROR, "%s expected %zu and called with nValues = %zu",
             __func__, value_index, nValues);
         return fmi3Error;
     }  
@@ -495,11 +525,10 @@ fmi3Status fmi3SetClock(fmi3Instance instance,
 fmi3Status fmi3GetNumberOfVariableDependencies(fmi3Instance instance,
                                                fmi3ValueReference valueReference,
                                                size_t* nDependencies) {
-    (void)instance; /* unused parameter */
     (void)valueReference; /* unused parameter */
     (void)nDependencies; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -510,7 +539,6 @@ fmi3Status fmi3GetVariableDependencies(fmi3Instance instance,
                                        size_t elementIndicesOfIndependents[],
                                        fmi3DependencyKind dependencyKinds[],
                                        size_t nDependencies) {
-    (void)instance; /* unused parameter */
     (void)dependent; /* unused parameter */
     (void)elementIndicesOfDependent; /* unused parameter */
     (void)independents; /* unused parameter */
@@ -518,41 +546,54 @@ fmi3Status fmi3GetVariableDependencies(fmi3Instance instance,
     (void)dependencyKinds; /* unused parameter */
     (void)nDependencies; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState) {
-    (void)instance; /* unused parameter */
-    (void)FMUState; /* unused parameter */
+    container_t *container = (container_t *)instance;
+
+    if (*FMUState) {
+        if (checkpoint_get(container, *FMUState) != FMU_STATUS_OK)
+            return fmi3Error;
+    } else {
+        *FMUState = checkpoint_new(container);
+        if (!*FMUState)
+            return fmi3Error;
+    }
 
-    __NOT_IMPLEMENTED__
+    return fmi3OK;
 }
 
 
-fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState  FMUState) {
-    (void)instance; /* unused parameter */
-    (void)FMUState; /* unused parameter */
+fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState) {
+    container_t *container = (container_t *)instance;
 
-    __NOT_IMPLEMENTED__
+    if (!FMUState || (checkpoint_set(container, FMUState) != FMU_STATUS_OK))
+        return fmi3Error;
+
+    return fmi3OK;
 }
 
 fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState) {
-    (void)instance; /* unused parameter */
-    (void)FMUState; /* unused parameter */
+    container_t *container = (container_t *)instance;
 
-    __NOT_IMPLEMENTED__
+    checkpoint_free(container, *FMUState);
+    *FMUState = NULL;
+
+    return fmi3OK;
 }
 
 
 fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance,
                                       fmi3FMUState FMUState,
                                       size_t* size) {
-    (void)instance; /* unused parameter */
-    (void)FMUState; /* unused parameter */
-    (void)size; /* unused parameter */
+    container_t *container = (container_t *)instance;
 
-    __NOT_IMPLEMENTED__
+    if (!FMUState || (checkpoint_serialized_size(container, FMUState, size) != FMU_STATUS_OK))
+        return fmi3Error;
+
+    return fmi3OK;
 }
 
 
@@ -560,12 +601,12 @@ fmi3Status fmi3SerializeFMUState(fmi3Instance instance,
                                  fmi3FMUState FMUState,
                                  fmi3Byte serializedState[],
                                  size_t size) {
-    (void)instance; /* unused parameter */
-    (void)FMUState; /* unused parameter */
-    (void)serializedState; /* unused parameter */
-    (void)size; /* unused parameter */
+    container_t *container = (container_t *)instance;
 
-    __NOT_IMPLEMENTED__
+    if (!FMUState || (checkpoint_serialize(container, FMUState, serializedState, size) != FMU_STATUS_OK))
+        return fmi3Error;
+
+    return fmi3OK;
 }
 
 
@@ -573,12 +614,13 @@ fmi3Status fmi3DeserializeFMUState(fmi3Instance instance,
                                    const fmi3Byte serializedState[],
                                    size_t size,
                                    fmi3FMUState* FMUState) {
-    (void)instance; /* unused parameter */
-    (void)serializedState; /* unused parameter */
-    (void)size; /* unused parameter */
-    (void)FMUState; /* unused parameter */
+    container_t *container = (container_t *)instance;
 
-    __NOT_IMPLEMENTED__
+    *FMUState = checkpoint_deserialize(container, serializedState, size);
+    if (!*FMUState)
+        return fmi3Error;
+
+    return fmi3OK;
 }
 
 
@@ -591,7 +633,6 @@ fmi3Status fmi3GetDirectionalDerivative(fmi3Instance instance,
                                         size_t nSeed,
                                         fmi3Float64 sensitivity[],
                                         size_t nSensitivity) {
-    (void)instance; /* unused parameter */
     (void)unknowns; /* unused parameter */
     (void)nUnknowns; /* unused parameter */
     (void)knowns; /* unused parameter */
@@ -601,7 +642,7 @@ fmi3Status fmi3GetDirectionalDerivative(fmi3Instance instance,
     (void)sensitivity; /* unused parameter */
     (void)nSensitivity; /* unused parameter */  
     
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -614,7 +655,6 @@ fmi3Status fmi3GetAdjointDerivative(fmi3Instance instance,
                                     size_t nSeed,
                                     fmi3Float64 sensitivity[],
                                     size_t nSensitivity) {
-    (void)instance; /* unused parameter */
     (void)unknowns; /* unused parameter */
     (void)nUnknowns; /* unused parameter */
     (void)knowns; /* unused parameter */
@@ -624,7 +664,7 @@ fmi3Status fmi3GetAdjointDerivative(fmi3Instance instance,
     (void)sensitivity; /* unused parameter */
     (void)nSensitivity; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -664,7 +704,7 @@ fmi3Status fmi3GetIntervalDecimal(fmi3Instance instance,
         const int fmu_id = port->links[0].fmu_id;
 
         if (fmu_id < 0) {
-            logger(LOGGER_ERROR, "GetIntervalDecimal not available for vr=%d", valueReferences[i]);
+            logger(&container->logger, LOGGER_ERROR, "GetIntervalDecimal not available for vr=%d", valueReferences[i]);
             return fmi3Error;
         }
         else {
@@ -687,14 +727,13 @@ fmi3Status fmi3GetIntervalFraction(fmi3Instance instance,
                                    fmi3UInt64 counters[],
                                    fmi3UInt64 resolutions[],
                                    fmi3IntervalQualifier qualifiers[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)counters; /* unused parameter */
     (void)resolutions; /* unused parameter */
     (void)qualifiers; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -702,11 +741,10 @@ fmi3Status fmi3GetShiftDecimal(fmi3Instance instance,
                                const fmi3ValueReference valueReferences[],
                                size_t nValueReferences,
                                fmi3Float64 shifts[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)shifts; /* unused parameter */
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -715,13 +753,12 @@ fmi3Status fmi3GetShiftFraction(fmi3Instance instance,
                                 size_t nValueReferences,
                                 fmi3UInt64 counters[],
                                 fmi3UInt64 resolutions[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)counters; /* unused parameter */
     (void)resolutions; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -729,12 +766,11 @@ fmi3Status fmi3SetIntervalDecimal(fmi3Instance instance,
                                   const fmi3ValueReference valueReferences[],
                                   size_t nValueReferences,
                                   const fmi3Float64 intervals[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)intervals; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -743,13 +779,12 @@ fmi3Status fmi3SetIntervalFraction(fmi3Instance instance,
                                    size_t nValueReferences,
                                    const fmi3UInt64 counters[],
                                    const fmi3UInt64 resolutions[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)counters; /* unused parameter */
     (void)resolutions; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -757,12 +792,11 @@ fmi3Status fmi3SetShiftDecimal(fmi3Instance instance,
                                const fmi3ValueReference valueReferences[],
                                size_t nValueReferences,
                                const fmi3Float64 shifts[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)shifts; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -771,20 +805,18 @@ fmi3Status fmi3SetShiftFraction(fmi3Instance instance,
                                 size_t nValueReferences,
                                 const fmi3UInt64 counters[],
                                 const fmi3UInt64 resolutions[]) {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)counters; /* unused parameter */
     (void)resolutions; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3EvaluateDiscreteStates(fmi3Instance instance) {
-    (void)instance; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -838,14 +870,13 @@ fmi3Status fmi3GetOutputDerivatives(fmi3Instance instance,
                                     const fmi3Int32 orders[],
                                     fmi3Float64 values[],
                                     size_t nValues)  {
-    (void)instance; /* unused parameter */
     (void)valueReferences; /* unused parameter */
     (void)nValueReferences; /* unused parameter */
     (void)orders; /* unused parameter */
     (void)values; /* unused parameter */
     (void)nValues; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -902,9 +933,8 @@ fmi3Instance fmi3InstantiateModelExchange(
 
 
 fmi3Status fmi3EnterContinuousTimeMode(fmi3Instance instance) {
-    (void)instance; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -912,95 +942,86 @@ fmi3Status fmi3CompletedIntegratorStep(fmi3Instance instance,
                                        fmi3Boolean  noSetFMUStatePriorToCurrentPoint,
                                        fmi3Boolean* enterEventMode,
                                        fmi3Boolean* terminateSimulation) {
-    (void)instance; /* unused parameter */
     (void)noSetFMUStatePriorToCurrentPoint; /* unused parameter */
     (void)enterEventMode; /* unused parameter */
     (void)terminateSimulation; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3SetTime(fmi3Instance instance, fmi3Float64 time) {
-    (void)instance; /* unused parameter */
     (void)time; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3SetContinuousStates(fmi3Instance instance,
                                    const fmi3Float64 continuousStates[],
                                    size_t nContinuousStates) {
-    (void)instance; /* unused parameter */
     (void)continuousStates; /* unused parameter */
     (void)nContinuousStates; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3GetContinuousStateDerivatives(fmi3Instance instance,
                                              fmi3Float64 derivatives[],
                                             size_t nContinuousStates) {
-    (void)instance; /* unused parameter */
     (void)derivatives; /* unused parameter */
     (void)nContinuousStates; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3GetEventIndicators(fmi3Instance instance,
                                   fmi3Float64 eventIndicators[],
                                   size_t nEventIndicators) {
-    (void)instance; /* unused parameter */
     (void)eventIndicators; /* unused parameter */
     (void)nEventIndicators; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3GetContinuousStates(fmi3Instance instance,
                                    fmi3Float64 continuousStates[],
                                    size_t nContinuousStates)  {
-    (void)instance; /* unused parameter */
     (void)continuousStates; /* unused parameter */
     (void)nContinuousStates; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 fmi3Status fmi3GetNominalsOfContinuousStates(fmi3Instance instance,
                                              fmi3Float64 nominals[],
                                              size_t nContinuousStates) {
-    (void)instance; /* unused parameter */
     (void)nominals; /* unused parameter */
     (void)nContinuousStates; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 
 fmi3Status fmi3GetNumberOfEventIndicators(fmi3Instance instance,
                                           size_t* nEventIndicators)  {
-    (void)instance; /* unused parameter */
     (void)nEventIndicators; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
 
 fmi3Status fmi3GetNumberOfContinuousStates(fmi3Instance instance,
                                            size_t* nContinuousStates) {
-    (void)instance; /* unused parameter */
     (void)nContinuousStates; /* unused parameter */
 
-    __NOT_IMPLEMENTED__
+    __NOT_IMPLEMENTED__(instance)
 }
 
 
@@ -1019,25 +1040,32 @@ fmi3Instance fmi3InstantiateScheduledExecution(
     fmi3ClockUpdateCallback        clockUpdate,
     fmi3LockPreemptionCallback     lockPreemption,
     fmi3UnlockPreemptionCallback   unlockPreemption) {
-    (void)instanceName; /* unused parameter */
-    (void)instantiationToken; /* unused parameter */
-    (void)resourcePath; /* unused parameter */
     (void)visible; /* unused parameter */
-    (void)loggingOn; /* unused parameter */
-    (void)instanceEnvironment; /* unused parameter */
-    (void)logMessage; /* unused parameter */
-    (void)clockUpdate; /* unused parameter */
-    (void)lockPreemption; /* unused parameter */
-    (void)unlockPreemption; /* unused parameter */
-    return NULL;
+
+    const container_scheduled_execution_t scheduled_execution = {
+        .enabled = true,
+        .environment = instanceEnvironment,
+        .clock_update = clockUpdate,
+        .lock_preemption = lockPreemption,
+        .unlock_preemption = unlockPreemption
+    };
+    const container_instantiation_t instantiation = {
+        .scheduled_execution = &scheduled_execution
+    };
+
+    return fmi3_container_new(instanceName, instantiationToken, resourcePath, loggingOn,
+                              instanceEnvironment, logMessage, &instantiation);
 }
 
 fmi3Status fmi3ActivateModelPartition(fmi3Instance instance,
                                       fmi3ValueReference clockReference,
                                       fmi3Float64 activationTime) {
-    (void)instance; /* unused parameter */
-    (void)clockReference; /* unused parameter */
-    (void)activationTime; /* unused parameter */
-    
-    __NOT_IMPLEMENTED__
+    container_t* container = (container_t*)instance;
+
+    ASSERT_CONTAINER_STATE(container, CONTAINER_STATE_STEP_MODE);
+
+    if (container_activate_model_partition(container, clockReference & 0xFFFFFF, activationTime) != FMU_STATUS_OK)
+        return fmi3Error;
+
+    return fmi3OK;
 }
@@ -7,6 +7,7 @@
 #include "fmu.h"
 #include "logger.h"
 #include "profile.h"
+#include "trace.h"
 
 //#define DEBUG
 
@@ -33,12 +34,29 @@
     X(booleans1,   Boolean1)
 
 
+/*
+ * Profiling helpers: a phase is measured from FMU_PROFILE_START to FMU_PROFILE_STOP.
+ * FMU_PROFILE_ACCUMULATE sums several calls into one sample (see profile_commit).
+ */
+#define FMU_PROFILE_START(fmu)                                          \
+    const profile_tic_t profile_start = (fmu)->profile ? profile_now() : 0
+
+#define FMU_PROFILE_STOP(fmu, phase)                                    \
+    if ((fmu)->profile)                                                 \
+        profile_record((fmu)->profile, phase, profile_start)
+
+#define FMU_PROFILE_ACCUMULATE(fmu, phase)                              \
+    if ((fmu)->profile)                                                 \
+        profile_accumulate((fmu)->profile, phase, profile_start)
+
+
 fmu_status_t fmu_set_inputs(const fmu_t* fmu) {
     fmu_status_t status = FMU_STATUS_OK;
     const container_t* container = fmu->container;
     const fmu_io_t* fmu_io = &fmu->fmu_io;
+    FMU_PROFILE_START(fmu);
 #ifdef DEBUG
-        logger(LOGGER_DEBUG, "[DEBUG] Time=%e | fmu_set_inputs(%s)", fmu->container->time, fmu->name);
+        logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] Time=%e | fmu_set_inputs(%s)", fmu->container->time, fmu->name);
 #endif
 
 #define SET_INPUT(variable, fmi_type)                                                               \
@@ -77,90 +95,165 @@ fmu_status_t fmu_set_inputs(const fmu_t* fmu) {
 
 #undef SET_INPUT
 
+    /* derivatives: valid until next doStep */
+    for (unsigned long i = 0; i < fmu_io->derivatives.in.nb; i += 1) {
+        static const int order = 1;
+        const fmu_vr_t fmu_vr = fmu_io->derivatives.in.translations[i].fmu_vr;
+        const fmu_vr_t local_vr = fmu_io->derivatives.in.translations[i].vr;
+        status = fmuSetInputDerivatives(fmu, &fmu_vr, 1, &order, &container->derivatives[local_vr]);
+        if (status != FMU_STATUS_OK)
+            return status;
+    }
+
+    FMU_PROFILE_STOP(fmu, PROFILE_SET_INPUTS);
+
     return status;
 }
 
-fmu_status_t fmu_set_clocks(const fmu_t* fmu) {
-    fmu_status_t status = FMU_STATUS_OK;
-    const container_t* container = fmu->container;
+
+/* True if fmu_set_inputs() sets at least one variable of the FMU */
+bool fmu_has_inputs(const fmu_t *fmu) {
+    const fmu_io_t *fmu_io = &fmu->fmu_io;
+
+#define HAS_INPUT(variable, fmi_type)           if (fmu_io-> variable .in.nb > 0)               return true;
+
+    FOR_ALL_NUMERIC_TYPES(HAS_INPUT)
+#undef HAS_INPUT
+
+    return (fmu_io->strings.in.nb > 0) || (fmu_io->binaries.in.nb > 0) || (fmu_io->derivatives.in.nb > 0);
+}
+
+/*
+ * Types of fmu_clock_consumer_t: input clock, then clocked inputs of each type.
+ */
+enum {
+    FMU_CLOCK_CONSUMER_clocks = FMU_CLOCK_CONSUMER_CLOCK,
+#define CLOCK_CONSUMER_TYPE(variable, fmi_type) FMU_CLOCK_CONSUMER_ ## variable,
+    FOR_ALL_NUMERIC_TYPES(CLOCK_CONSUMER_TYPE)
+#undef CLOCK_CONSUMER_TYPE
+    FMU_CLOCK_CONSUMER_strings,
+    FMU_CLOCK_CONSUMER_binaries
+};
+
+
+static int fmu_clock_consumer_append(fmu_clock_consumer_list_t *consumers, unsigned long nb_clocks,
+                                     unsigned long clock_vr, int fmu_id, int type, unsigned long index) {
+    if (clock_vr >= nb_clocks)
+        return -1;
+
+    fmu_clock_consumer_list_t *list = &consumers[clock_vr];
+    fmu_clock_consumer_t *new_consumers = realloc(list->consumers, (list->nb + 1) * sizeof(*new_consumers));
+    if (!new_consumers)
+        return -2;
+
+    new_consumers[list->nb].fmu_id = fmu_id;
+    new_consumers[list->nb].type = type;
+    new_consumers[list->nb].index = index;
+    list->consumers = new_consumers;
+    list->nb += 1;
+
+    return 0;
+}
+
+
+/*
+ * Reverse index: register input clocks and clocked inputs of the FMU to the list of the
+ * local clock which activates them (consumers has nb_clocks lists). Input clocks of the FMU
+ * are registered before its clocked inputs.
+ */
+int fmu_clock_consumers_append(const fmu_t *fmu, fmu_clock_consumer_list_t *consumers, unsigned long nb_clocks) {
     const fmu_io_t* fmu_io = &fmu->fmu_io;
 
-    /* clocks: set active clocks only */
     for (unsigned long i = 0; i < fmu_io->clocks.in.nb; i += 1) {
-        const unsigned int fmu_vr = fmu_io->clocks.in.translations[i].fmu_vr;
-        const unsigned int local_vr = fmu_io->clocks.in.translations[i].vr;
-        if (container->clocks[local_vr]) {
-            status = fmuSetClock(fmu, &fmu_vr, 1, &container->clocks[local_vr]);
-            if (status != FMU_STATUS_OK)
-                return status;
-        }
+        if (fmu_clock_consumer_append(consumers, nb_clocks, fmu_io->clocks.in.translations[i].vr,
+                                      fmu->index, FMU_CLOCK_CONSUMER_CLOCK, i))
+            return -1;
     }
 
-    return FMU_STATUS_OK;
+#define APPEND_CLOCKED_INPUT(variable, fmi_type)                                                            \
+    for (unsigned long i = 0; i < fmu_io->clocked_ ## variable .nb_in; i += 1) {                            \
+        if (fmu_clock_consumer_append(consumers, nb_clocks, fmu_io->clocked_ ## variable .in[i].clock_vr,   \
+                                      fmu->index, FMU_CLOCK_CONSUMER_ ## variable, i))                      \
+            return -1;                                                                                      \
+    }
+
+    FOR_ALL_NUMERIC_TYPES(APPEND_CLOCKED_INPUT)
+    APPEND_CLOCKED_INPUT(strings, String)
+    APPEND_CLOCKED_INPUT(binaries, Binary)
+#undef APPEND_CLOCKED_INPUT
+
+    return 0;
 }
 
 
-fmu_status_t fmu_set_clocked_inputs(const fmu_t* fmu) {
+/*
+ * Set the input clock or the clocked inputs activated by a local clock.
+ */
+fmu_status_t fmu_set_clock_consumer(const fmu_t *fmu, const fmu_clock_consumer_t *consumer) {
     fmu_status_t status = FMU_STATUS_OK;
     const container_t* container = fmu->container;
     const fmu_io_t* fmu_io = &fmu->fmu_io;
-
-#ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | fmu_set_clocked_inputs(fmu=%s)", fmu->container->time, fmu->name);
-#endif
-
+    const fmu_clocked_port_t *clocked_port = NULL;
+    FMU_PROFILE_START(fmu);
+
+    switch(consumer->type) {
+    case FMU_CLOCK_CONSUMER_CLOCK: {
+        const fmu_vr_t fmu_vr = fmu_io->clocks.in.translations[consumer->index].fmu_vr;
+        const fmu_vr_t local_vr = fmu_io->clocks.in.translations[consumer->index].vr;
+        status = fmuSetClock(fmu, &fmu_vr, 1, &container->clocks[local_vr]);
+        break;
+    }
 
 #define SET_CLOCKED_INPUT(variable, fmi_type)                                                               \
-    for (unsigned long i = 0; i < fmu_io->clocked_ ## variable .nb_in; i += 1) {                            \
-        fmu_clocked_port_t *clocked_port = &fmu_io->clocked_ ## variable .in[i];                            \
-        if (container->clocks[clocked_port->clock_vr]) {                                                    \
-            for(unsigned long j=0; j < clocked_port->translations_list.nb; j += 1) {                        \
-                const unsigned int fmu_vr = clocked_port->translations_list.translations[j].fmu_vr;         \
-                const unsigned int local_vr = clocked_port->translations_list.translations[j].vr;           \
-                const unsigned int dimension = clocked_port->translations_list.translations[j].dimension;   \
-                status = fmuSet ## fmi_type (fmu, &fmu_vr, 1, &container-> variable [local_vr], dimension); \
-                if (status != FMU_STATUS_OK)                                                                \
-                    return status;                                                                          \
-            }                                                                                               \
+    case FMU_CLOCK_CONSUMER_ ## variable:                                                                   \
+        clocked_port = &fmu_io->clocked_ ## variable .in[consumer->index];                                  \
+        for(unsigned long j=0; j < clocked_port->translations_list.nb; j += 1) {                            \
+            const unsigned int fmu_vr = clocked_port->translations_list.translations[j].fmu_vr;             \
+            const unsigned int local_vr = clocked_port->translations_list.translations[j].vr;               \
+            const unsigned int dimension = clocked_port->translations_list.translations[j].dimension;       \
+            status = fmuSet ## fmi_type (fmu, &fmu_vr, 1, &container-> variable [local_vr], dimension);     \
+            if (status != FMU_STATUS_OK)                                                                    \
+                return status;                                                                              \
         }                                                                                                   \
-    }
+        break;
     /*
      * CLOCKED INPUTs
      */
     FOR_ALL_NUMERIC_TYPES(SET_CLOCKED_INPUT)
+#undef SET_CLOCKED_INPUT
 
     /* strings: Need to add a (cast) to avoid a warning */
-    for (unsigned long i = 0; i < fmu_io->clocked_strings.nb_in; i += 1) {
-        fmu_clocked_port_t *clocked_port = &fmu_io->clocked_strings.in[i];
-        if (container->clocks[clocked_port->clock_vr]) {
-            for(unsigned long j=0; j < clocked_port->translations_list.nb; j += 1) {
-                const unsigned int fmu_vr = clocked_port->translations_list.translations[j].fmu_vr;
-                const unsigned int local_vr = clocked_port->translations_list.translations[j].vr;
-                const unsigned int dimension = clocked_port->translations_list.translations[j].dimension;
-                status = fmuSetString(fmu, &fmu_vr, 1, (const char *const*)&container->strings[local_vr], dimension);
-                if (status != FMU_STATUS_OK)
-                    return status;
-            }
+    case FMU_CLOCK_CONSUMER_strings:
+        clocked_port = &fmu_io->clocked_strings.in[consumer->index];
+        for(unsigned long j=0; j < clocked_port->translations_list.nb; j += 1) {
+            const unsigned int fmu_vr = clocked_port->translations_list.translations[j].fmu_vr;
+            const unsigned int local_vr = clocked_port->translations_list.translations[j].vr;
+            const unsigned int dimension = clocked_port->translations_list.translations[j].dimension;
+            status = fmuSetString(fmu, &fmu_vr, 1, (const char *const*)&container->strings[local_vr], dimension);
+            if (status != FMU_STATUS_OK)
+                return status;
         }
-    }
+        break;
 
     /* binaries: Need to add size parameter */
-    for (unsigned long i = 0; i < fmu_io->clocked_binaries.nb_in; i += 1) {
-        fmu_clocked_port_t *clocked_port = &fmu_io->clocked_binaries.in[i];
-        if (container->clocks[clocked_port->clock_vr]) {
-            for(unsigned long j=0; j < clocked_port->translations_list.nb; j += 1) {
-                const unsigned int fmu_vr = clocked_port->translations_list.translations[j].fmu_vr;
-                const unsigned int local_vr = clocked_port->translations_list.translations[j].vr;
-                const unsigned int dimension = clocked_port->translations_list.translations[j].dimension;
-                status = fmuSetBinary(fmu, &fmu_vr, 1, &container->binaries[local_vr].size,
-                        (const uint8_t *const*)&container->binaries[local_vr].data, dimension);
-                if (status != FMU_STATUS_OK)
-                    return status;
-            }
+    case FMU_CLOCK_CONSUMER_binaries:
+        clocked_port = &fmu_io->clocked_binaries.in[consumer->index];
+        for(unsigned long j=0; j < clocked_port->translations_list.nb; j += 1) {
+            const unsigned int fmu_vr = clocked_port->translations_list.translations[j].fmu_vr;
+            const unsigned int local_vr = clocked_port->translations_list.translations[j].vr;
+            const unsigned int dimension = clocked_port->translations_list.translations[j].dimension;
+            status = fmuSetBinary(fmu, &fmu_vr, 1, &container->binaries[local_vr].size,
+                    (const uint8_t *const*)&container->binaries[local_vr].data, dimension);
+            if (status != FMU_STATUS_OK)
+                return status;
         }
+        break;
+
+    default:
+        break;
     }
 
-#undef SET_CLOCKED_INPUT
+    FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
 
     return status;
 }
@@ -170,9 +263,10 @@ fmu_status_t fmu_get_outputs(const fmu_t* fmu) {
     container_t* container = fmu->container;
     const fmu_io_t* fmu_io = &fmu->fmu_io;
     fmu_status_t status = FMU_STATUS_OK;
+    FMU_PROFILE_START(fmu);
 
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | fmu_get_outputs(fmu=%s)", fmu->container->time, fmu->name);
+    logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | fmu_get_outputs(fmu=%s)", fmu->container->time, fmu->name);
 #endif
 
 #define GET_OUTPUT(variable, fmi_type)                                                              \
@@ -219,7 +313,7 @@ fmu_status_t fmu_get_outputs(const fmu_t* fmu) {
                     free(container->binaries[local_vr + j].data);
                     container->binaries[local_vr + j].data = malloc(size * sizeof(*container->binaries[local_vr + j].data));
                     if (! container->binaries[local_vr + j].data) {
-                        logger(LOGGER_ERROR, "Cannot allocate memory for get output.");
+                        logger(fmu->logger, LOGGER_ERROR, "Cannot allocate memory for get output.");
                         return FMU_STATUS_ERROR;
                     }
                     container->binaries[local_vr + j].max_size = size;
@@ -229,20 +323,111 @@ fmu_status_t fmu_get_outputs(const fmu_t* fmu) {
             }
         }
 
+    /* derivatives can be queried in StepMode only */
+    if (container->state == CONTAINER_STATE_STEP_MODE) {
+        status = fmu_get_output_derivatives(fmu);
+        if (status != FMU_STATUS_OK)
+            return status;
+    }
+
+    FMU_PROFILE_STOP(fmu, PROFILE_GET_OUTPUTS);
+
     /* cast conversion between local variables */
     convert_proceed(fmu->container, fmu->conversions);
 
+    if (fmu->profile)
+        profile_record(fmu->profile, PROFILE_CONVERT, fmu->profile->current_tic);
+
     return status;
 }
 
-    
+
+/*
+ * Derivatives (order 1) of Float64 outputs which feed FMUs able to interpolate their inputs.
+ */
+fmu_status_t fmu_get_output_derivatives(const fmu_t *fmu) {
+    const fmu_io_t *fmu_io = &fmu->fmu_io;
+
+    for (unsigned long i = 0; i < fmu_io->derivatives.out.nb; i += 1) {
+        static const int order = 1;
+        const fmu_vr_t fmu_vr = fmu_io->derivatives.out.translations[i].fmu_vr;
+        const fmu_vr_t local_vr = fmu_io->derivatives.out.translations[i].vr;
+        fmu_status_t status = fmuGetOutputDerivatives(fmu, &fmu_vr, 1, &order, &fmu->container->derivatives[local_vr]);
+        if (status != FMU_STATUS_OK)
+            return status;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/*
+ * Profiling: count the steps where outputs of the FMU have changed. A digest (FNV-1a) of
+ * the local variables fed by the FMU is compared with the one of previous step.
+ */
+#define FMU_DIGEST_OFFSET   0xcbf29ce484222325ULL
+#define FMU_DIGEST_PRIME    0x100000001b3ULL
+
+static uint64_t fmu_digest(uint64_t digest, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < size; i += 1) {
+        digest ^= bytes[i];
+        digest *= FMU_DIGEST_PRIME;
+    }
+
+    return digest;
+}
+
+
+void fmu_outputs_activity(fmu_t *fmu) {
+    const container_t* container = fmu->container;
+    const fmu_io_t* fmu_io = &fmu->fmu_io;
+    uint64_t digest = FMU_DIGEST_OFFSET;
+
+#define DIGEST_OUTPUT(variable, fmi_type)                                                           \
+    for (size_t i = 0; i < fmu_io-> variable .out.nb; i += 1) {                                     \
+        const fmu_vr_t local_vr = fmu_io-> variable .out.translations[i].vr;                        \
+        const unsigned int dimension = fmu_io-> variable .out.translations[i].dimension;            \
+        digest = fmu_digest(digest, &container-> variable [local_vr],                               \
+                            dimension * sizeof(*container-> variable));                             \
+    }
+
+    FOR_ALL_NUMERIC_TYPES(DIGEST_OUTPUT)
+
+#undef DIGEST_OUTPUT
+
+    for (size_t i = 0; i < fmu_io->strings.out.nb; i += 1) {
+        const fmu_vr_t local_vr = fmu_io->strings.out.translations[i].vr;
+        for (unsigned int j = 0; j < fmu_io->strings.out.translations[i].dimension; j += 1) {
+            const char *value = container->strings[local_vr + j];
+            if (value)
+                digest = fmu_digest(digest, value, strlen(value));
+        }
+    }
+
+    for (size_t i = 0; i < fmu_io->binaries.out.nb; i += 1) {
+        const fmu_vr_t local_vr = fmu_io->binaries.out.translations[i].vr;
+        for (unsigned int j = 0; j < fmu_io->binaries.out.translations[i].dimension; j += 1)
+            digest = fmu_digest(digest, container->binaries[local_vr + j].data, container->binaries[local_vr + j].size);
+    }
+
+    if (digest != fmu->outputs_digest)
+        fmu->outputs_changes += 1;
+    fmu->outputs_digest = digest;
+
+    return;
+}
+
+
 fmu_status_t fmu_get_clocked_outputs(const fmu_t* fmu) {
     container_t* container = fmu->container;
     const fmu_io_t* fmu_io = &fmu->fmu_io;
     fmu_status_t status = FMU_STATUS_OK;
+    FMU_PROFILE_START(fmu);
 
 #ifdef DEBUG
-    logger(LOGGER_DEBUG, "[DEBUG] time=%e | fmu_get_clocked_outputs(fmu=%s)", fmu->container->time, fmu->name);
+    logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | fmu_get_clocked_outputs(fmu=%s)", fmu->container->time, fmu->name);
 #endif
 
     for (size_t i = 0; i < fmu_io->clocks.out.nb; i += 1) {
@@ -309,7 +494,7 @@ fmu_status_t fmu_get_clocked_outputs(const fmu_t* fmu) {
                     free(container->binaries[local_vr].data);
                     container->binaries[local_vr].data = malloc(size * sizeof(*container->binaries[local_vr].data));
                     if (! container->binaries[local_vr].data) {
-                        logger(LOGGER_ERROR, "Cannot allocate memory for get output.");
+                        logger(fmu->logger, LOGGER_ERROR, "Cannot allocate memory for get output.");
                         return FMU_STATUS_ERROR;
                     }
                     container->binaries[local_vr].max_size = size;
@@ -320,12 +505,366 @@ fmu_status_t fmu_get_clocked_outputs(const fmu_t* fmu) {
         }
     }
 
-#undef GET_CLOCKED_OUTPUT
+#undef GET_CLOCKED_OUTPUT
+
+    /* cast conversion between local variables */
+    convert_proceed(fmu->container, fmu->conversions);
+
+    FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
+
+    return status;
+}
+
+
+/*
+ * Set inputs and doStep of one FMU. Elapsed time is accumulated in step_cost to let the
+ * container group FMUs onto threads.
+ */
+static fmu_status_t fmu_do_step_measured(fmu_t *fmu, trace_buffer_t *trace) {
+    const container_t* container = fmu->container;
+    const profile_tic_t start = profile_now();
+
+    if (trace)
+        trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_SET_INPUTS), 0, 0.0);
+    fmu->status = fmu_set_inputs(fmu);
+    if (trace)
+        trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_SET_INPUTS), 0, 0.0);
+
+    if (fmu->status == FMU_STATUS_OK) {
+        if (trace)
+            trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_DO_STEP), 0, 0.0);
+        fmu->status = fmuDoStep(fmu, 
+                                container->time,
+                                container->next_step);
+        if (trace)
+            trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_DO_STEP), 0, 0.0);
+    }
+
+    fmu->step_cost += profile_now() - start;
+
+    return fmu->status;
+}
+
+
+/* FMU stepped by the main thread in MT mode */
+fmu_status_t fmu_do_step_inline(fmu_t *fmu) {
+    const container_t* container = fmu->container;
+
+    return fmu_do_step_measured(fmu, container->trace ? &container->trace->buffers[0] : NULL);
+}
+
+
+/* Job other than stepping: applies to the FMU itself */
+fmu_status_t fmu_do_job(fmu_t *fmu) {
+    switch (fmu->job) {
+    case FMU_JOB_GET_STATE:
+        fmu->status = fmuGetFMUState(fmu, &fmu->state);
+        break;
+    case FMU_JOB_SET_STATE:
+        fmu->status = fmuSetFMUState(fmu, fmu->state);
+        break;
+    case FMU_JOB_FREE_STATE:
+        fmu->status = fmuFreeFMUState(fmu, &fmu->state);
+        break;
+    default:
+        fmu->status = FMU_STATUS_ERROR;
+        break;
+    }
+
+    return fmu->status;
+}
+
+
+/*----------------------------------------------------------------------------
+                     A S Y N C H R O N O U S   M O D E
+----------------------------------------------------------------------------*/
+
+/*
+ * An FMU does its step n once its producers and its consumers have done n - max_lag steps.
+ * Producers do not overwrite outputs which may still be read: history of depth 2 x max_lag + 2
+ * steps is enough. Waiting is cancelled if an FMU fails.
+ */
+static bool fmu_async_wait(const fmu_t *fmu, long long step) {
+    container_async_t *async = &fmu->container->async;
+    const long long min_step = step - async->max_lag;
+
+    for (unsigned long i = async->peer_offset[fmu->index]; i < async->peer_offset[fmu->index + 1]; i += 1) {
+        thread_atomic_t *completed = &async->completed[async->peers[i]];
+
+        while ((long long)thread_atomic_load(completed) < min_step) {
+            if (thread_atomic_load(&async->failed))
+                return false;
+            thread_yield();
+        }
+    }
+
+    return true;
+}
+
+
+/* Slot of the newest outputs of producer for step */
+static unsigned long fmu_async_slot(container_async_t *async, int producer, long long step) {
+    long long completed = (long long)thread_atomic_load(&async->completed[producer]);
+
+    if (completed > step)
+        completed = step;
+
+    return (unsigned long)(completed % (long long)async->depth);
+}
+
+
+static fmu_status_t fmu_async_set_inputs(const fmu_t *fmu, long long step) {
+    fmu_status_t status = FMU_STATUS_OK;
+    const container_t *container = fmu->container;
+    container_async_t *async = &fmu->container->async;
+    const fmu_io_t *fmu_io = &fmu->fmu_io;
+    FMU_PROFILE_START(fmu);
+
+#define SET_INPUT_ASYNC(variable, fmi_type)                                                         \
+    for (unsigned long i = 0; i < fmu_io-> variable .in.nb; i += 1) {                               \
+        const fmu_vr_t fmu_vr = fmu_io-> variable .in.translations[i].fmu_vr;                       \
+        const fmu_vr_t local_vr = fmu_io-> variable .in.translations[i].vr;                         \
+        const unsigned int dimension = fmu_io-> variable .in.translations[i].dimension;             \
+        const int producer = async->producer_ ## variable [local_vr];                               \
+        if (producer < 0)                                                                           \
+            status = fmuSet ## fmi_type (fmu, &fmu_vr, 1, &container-> variable [local_vr], dimension); \
+        else {                                                                                      \
+            const unsigned long slot = fmu_async_slot(async, producer, step);                       \
+            status = fmuSet ## fmi_type (fmu, &fmu_vr, 1,                                           \
+                &async->history_ ## variable [slot * container->nb_local_ ## variable + local_vr], dimension); \
+        }                                                                                           \
+        if (status != FMU_STATUS_OK)                                                                \
+            return status;                                                                          \
+    }
+
+    FOR_ALL_NUMERIC_TYPES(SET_INPUT_ASYNC)
+
+#undef SET_INPUT_ASYNC
+
+    FMU_PROFILE_STOP(fmu, PROFILE_SET_INPUTS);
+
+    return status;
+}
+
+
+static fmu_status_t fmu_async_get_outputs(const fmu_t *fmu, long long step) {
+    fmu_status_t status = FMU_STATUS_OK;
+    const container_t *container = fmu->container;
+    container_async_t *async = &fmu->container->async;
+    const fmu_io_t *fmu_io = &fmu->fmu_io;
+    const unsigned long slot = (unsigned long)((step + 1) % (long long)async->depth);
+    FMU_PROFILE_START(fmu);
+
+#define GET_OUTPUT_ASYNC(variable, fmi_type)                                                        \
+    for (unsigned long i = 0; i < fmu_io-> variable .out.nb; i += 1) {                              \
+        const fmu_vr_t fmu_vr = fmu_io-> variable .out.translations[i].fmu_vr;                      \
+        const fmu_vr_t local_vr = fmu_io-> variable .out.translations[i].vr;                        \
+        const unsigned int dimension = fmu_io-> variable .out.translations[i].dimension;            \
+        status = fmuGet ## fmi_type (fmu, &fmu_vr, 1,                                              \
+            &async->history_ ## variable [slot * container->nb_local_ ## variable + local_vr], dimension); \
+        if (status != FMU_STATUS_OK)                                                                \
+            return status;                                                                          \
+    }
+
+    FOR_ALL_NUMERIC_TYPES(GET_OUTPUT_ASYNC)
+
+#undef GET_OUTPUT_ASYNC
+
+    FMU_PROFILE_STOP(fmu, PROFILE_GET_OUTPUTS);
+
+    return status;
+}
+
+
+/* Step n (from communication point) of one FMU */
+static fmu_status_t fmu_do_step_async(fmu_t *fmu, long long step, trace_buffer_t *trace) {
+    const container_t *container = fmu->container;
+    container_async_t *async = &fmu->container->async;
+
+    if (!fmu_async_wait(fmu, step)) {
+        fmu->status = FMU_STATUS_ERROR;
+        return fmu->status;
+    }
+
+    const profile_tic_t start = profile_now();
+
+    if (trace)
+        trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_SET_INPUTS), 0, 0.0);
+    fmu->status = fmu_async_set_inputs(fmu, step);
+    if (trace)
+        trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_SET_INPUTS), 0, 0.0);
+
+    if (fmu->status == FMU_STATUS_OK) {
+        if (trace)
+            trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_DO_STEP), 0, 0.0);
+        fmu->status = fmuDoStep(fmu,
+                                container->start_time + container->time_step * (double)(async->first_step + step * async->multiplier),
+                                container->time_step * async->multiplier);
+        if (trace)
+            trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_DO_STEP), 0, 0.0);
+        if (fmu->need_event_udpate)
+            thread_atomic_store(&async->need_event_update, 1);
+    }
+
+    if (fmu->status == FMU_STATUS_OK) {
+        if (trace)
+            trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_GET_OUTPUTS), 0, 0.0);
+        fmu->status = fmu_async_get_outputs(fmu, step);
+        if (trace)
+            trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_GET_OUTPUTS), 0, 0.0);
+    }
+
+    fmu->step_cost += profile_now() - start;
+
+    if (fmu->status == FMU_STATUS_OK)
+        thread_atomic_store(&async->completed[fmu->index], (unsigned long long)(step + 1));
+    else
+        thread_atomic_store(&async->failed, 1);
+
+    return fmu->status;
+}
+
+
+/* All steps of a group of FMUs between two communication points */
+static fmu_status_t fmu_do_steps_async(fmu_t **group, int nb_group, long long nb_steps, trace_buffer_t *trace) {
+    for (long long step = 0; step < nb_steps; step += 1) {
+        for (int i = 0; i < nb_group; i += 1) {
+            if (fmu_do_step_async(group[i], step, trace) != FMU_STATUS_OK)
+                return FMU_STATUS_ERROR;
+        }
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/* FMUs stepped by the main thread in ASYNC mode */
+fmu_status_t fmu_do_steps_async_inline(container_t *container, fmu_t **group, int nb_group) {
+    return fmu_do_steps_async(group, nb_group, container->async.nb_steps,
+                              container->trace ? &container->trace->buffers[0] : NULL);
+}
+
+
+
+/*----------------------------------------------------------------------------
+                 W A V E F O R M   R E L A X A T I O N
+----------------------------------------------------------------------------*/
+
+/*
+ * During an iteration, FMUs read their inputs from the previous waveform and write their
+ * outputs to the current one: they do not wait for each other.
+ */
+static fmu_status_t fmu_waveform_set_inputs(const fmu_t *fmu, int step) {
+    fmu_status_t status = FMU_STATUS_OK;
+    const container_t *container = fmu->container;
+    const container_waveform_t *waveform = &fmu->container->waveform;
+    const fmu_io_t *fmu_io = &fmu->fmu_io;
+    FMU_PROFILE_START(fmu);
+
+#define SET_INPUT_WAVEFORM(variable, fmi_type)                                                      \
+    for (unsigned long i = 0; i < fmu_io-> variable .in.nb; i += 1) {                               \
+        const fmu_vr_t fmu_vr = fmu_io-> variable .in.translations[i].fmu_vr;                       \
+        const fmu_vr_t local_vr = fmu_io-> variable .in.translations[i].vr;                         \
+        const unsigned int dimension = fmu_io-> variable .in.translations[i].dimension;             \
+        status = fmuSet ## fmi_type (fmu, &fmu_vr, 1,                                              \
+            &waveform->previous_ ## variable [step * container->nb_local_ ## variable + local_vr], dimension); \
+        if (status != FMU_STATUS_OK)                                                                \
+            return status;                                                                          \
+    }
+
+    FOR_ALL_NUMERIC_TYPES(SET_INPUT_WAVEFORM)
+
+#undef SET_INPUT_WAVEFORM
+
+    FMU_PROFILE_STOP(fmu, PROFILE_SET_INPUTS);
+
+    return status;
+}
+
+
+static fmu_status_t fmu_waveform_get_outputs(const fmu_t *fmu, int step) {
+    fmu_status_t status = FMU_STATUS_OK;
+    const container_t *container = fmu->container;
+    const container_waveform_t *waveform = &fmu->container->waveform;
+    const fmu_io_t *fmu_io = &fmu->fmu_io;
+    FMU_PROFILE_START(fmu);
+
+#define GET_OUTPUT_WAVEFORM(variable, fmi_type)                                                     \
+    for (unsigned long i = 0; i < fmu_io-> variable .out.nb; i += 1) {                              \
+        const fmu_vr_t fmu_vr = fmu_io-> variable .out.translations[i].fmu_vr;                      \
+        const fmu_vr_t local_vr = fmu_io-> variable .out.translations[i].vr;                        \
+        const unsigned int dimension = fmu_io-> variable .out.translations[i].dimension;            \
+        status = fmuGet ## fmi_type (fmu, &fmu_vr, 1,                                              \
+            &waveform->current_ ## variable [(step + 1) * container->nb_local_ ## variable + local_vr], dimension); \
+        if (status != FMU_STATUS_OK)                                                                \
+            return status;                                                                          \
+    }
+
+    FOR_ALL_NUMERIC_TYPES(GET_OUTPUT_WAVEFORM)
+
+#undef GET_OUTPUT_WAVEFORM
+
+    FMU_PROFILE_STOP(fmu, PROFILE_GET_OUTPUTS);
+
+    return status;
+}
+
+
+/* Step k (from beginning of window) of one FMU */
+static fmu_status_t fmu_do_step_waveform(fmu_t *fmu, int step, trace_buffer_t *trace) {
+    const container_t *container = fmu->container;
+    container_waveform_t *waveform = &fmu->container->waveform;
+    const profile_tic_t start = profile_now();
+
+    if (trace)
+        trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_SET_INPUTS), 0, 0.0);
+    fmu->status = fmu_waveform_set_inputs(fmu, step);
+    if (trace)
+        trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_SET_INPUTS), 0, 0.0);
+
+    if (fmu->status == FMU_STATUS_OK) {
+        if (trace)
+            trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_DO_STEP), 0, 0.0);
+        fmu->status = fmuDoStep(fmu,
+                                container->start_time + container->time_step * (double)(waveform->first_step + (long long)step * waveform->multiplier),
+                                container->time_step * waveform->multiplier);
+        if (trace)
+            trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_DO_STEP), 0, 0.0);
+        if (fmu->need_event_udpate)
+            thread_atomic_store(&waveform->need_event_update, 1);
+    }
+
+    if (fmu->status == FMU_STATUS_OK) {
+        if (trace)
+            trace_event(trace, TRACE_BEGIN, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_GET_OUTPUTS), 0, 0.0);
+        fmu->status = fmu_waveform_get_outputs(fmu, step);
+        if (trace)
+            trace_event(trace, TRACE_END, TRACE_TRACK_FMU + fmu->index, profile_phase_name(PROFILE_GET_OUTPUTS), 0, 0.0);
+    }
+
+    fmu->step_cost += profile_now() - start;
+
+    return fmu->status;
+}
+
+
+/* Whole window of a group of FMUs, one FMU after the other */
+static fmu_status_t fmu_do_steps_waveform(fmu_t **group, int nb_group, int nb_steps, trace_buffer_t *trace) {
+    for (int i = 0; i < nb_group; i += 1) {
+        for (int step = 0; step < nb_steps; step += 1) {
+            if (fmu_do_step_waveform(group[i], step, trace) != FMU_STATUS_OK)
+                return FMU_STATUS_ERROR;
+        }
+    }
+
+    return FMU_STATUS_OK;
+}
 
-    /* cast conversion between local variables */
-    convert_proceed(fmu->container, fmu->conversions);
 
-    return status;
+/* FMUs iterated by the main thread */
+fmu_status_t fmu_do_steps_waveform_inline(container_t *container, fmu_t **group, int nb_group) {
+    return fmu_do_steps_waveform(group, nb_group, container->waveform.nb_steps,
+                                 container->trace ? &container->trace->buffers[0] : NULL);
 }
 
 
@@ -337,15 +876,26 @@ static void *fmu_do_step_thread(fmu_t* fmu) {
         if (fmu->cancel)
             break;
 
-        fmu->status = fmu_set_inputs(fmu);
-        if (fmu->status != FMU_STATUS_OK) {
+        if (fmu->job != FMU_JOB_STEP) {
+            fmu_do_job(fmu);
             thread_mutex_unlock(&fmu->mutex_fmu);
             continue;
         }
 
-        fmu->status = fmuDoStep(fmu, 
-                                container->time,
-                                container->next_step);
+        /* Each thread owns its trace buffer */
+        trace_buffer_t *trace = container->trace ? &container->trace->buffers[1 + fmu->index] : NULL;
+
+        /* Step the FMUs grouped on this thread */
+        if (container->async.max_lag >= 0)
+            fmu_do_steps_async(fmu->group, fmu->nb_group, container->async.nb_steps, trace);
+        else if (container->waveform.window)
+            fmu_do_steps_waveform(fmu->group, fmu->nb_group, container->waveform.nb_steps, trace);
+        else {
+            for (int i = 0; i < fmu->nb_group; i += 1) {
+                if (fmu_do_step_measured(fmu->group[i], trace) != FMU_STATUS_OK)
+                    break;
+            }
+        }
 
         thread_mutex_unlock(&fmu->mutex_fmu);
     }
@@ -362,9 +912,11 @@ static int fmu_map_functions(fmu_t *fmu, fmu_version_t fmi_version){
     if (fmi_version == 2) {
 #define OPT_MAP(x) fmu->fmi_functions.version_2.x = (x ## TYPE*)library_symbol(fmu->library, #x)
 #define REQ_MAP(x) OPT_MAP(x); if (!fmu->fmi_functions.version_2.x) {   \
-    logger(LOGGER_ERROR, "Missing API '" #x "'.");                      \
+    logger(fmu->logger, LOGGER_ERROR, "Missing API '" #x "'.");         \
     status = -1;                                                        \
 }
+#define CS_MAP(x) if (fmu->model_exchange) { OPT_MAP(x); } else { REQ_MAP(x); }
+#define ME_MAP(x) if (fmu->model_exchange) { REQ_MAP(x); } else { OPT_MAP(x); }
         OPT_MAP(fmi2GetTypesPlatform);
         OPT_MAP(fmi2GetVersion);
         OPT_MAP(fmi2SetDebugLogging);
@@ -392,26 +944,39 @@ static int fmu_map_functions(fmu_t *fmu, fmu_version_t fmi_version){
         OPT_MAP(fmi2GetDirectionalDerivative);
         OPT_MAP(fmi2SetRealInputDerivatives);
         OPT_MAP(fmi2GetRealOutputDerivatives);
-        REQ_MAP(fmi2DoStep);
+        CS_MAP(fmi2DoStep);
         OPT_MAP(fmi2CancelStep);
         OPT_MAP(fmi2GetStatus);
-        REQ_MAP(fmi2GetRealStatus);
+        CS_MAP(fmi2GetRealStatus);
         OPT_MAP(fmi2GetIntegerStatus);
-        REQ_MAP(fmi2GetBooleanStatus);
+        CS_MAP(fmi2GetBooleanStatus);
         OPT_MAP(fmi2GetStringStatus);
+        ME_MAP(fmi2EnterEventMode);
+        ME_MAP(fmi2NewDiscreteStates);
+        ME_MAP(fmi2EnterContinuousTimeMode);
+        ME_MAP(fmi2CompletedIntegratorStep);
+        ME_MAP(fmi2SetTime);
+        ME_MAP(fmi2SetContinuousStates);
+        ME_MAP(fmi2GetDerivatives);
+        ME_MAP(fmi2GetEventIndicators);
+        ME_MAP(fmi2GetContinuousStates);
 #undef OPT_MAP
 #undef REQ_MAP
+#undef CS_MAP
+#undef ME_MAP
     }
 
     if (fmi_version == 3) {
 #define OPT_MAP(x) fmu->fmi_functions.version_3.x = (x ## TYPE*)library_symbol(fmu->library, #x)
 #define REQ_MAP(x) OPT_MAP(x); if (!fmu->fmi_functions.version_3.x) {   \
-    logger(LOGGER_ERROR, "Missing API '" #x "'.");                      \
+    logger(fmu->logger, LOGGER_ERROR, "Missing API '" #x "'.");         \
     status = -1;                                                        \
 }
+#define CS_MAP(x) if (fmu->model_exchange) { OPT_MAP(x); } else { REQ_MAP(x); }
+#define ME_MAP(x) if (fmu->model_exchange) { REQ_MAP(x); } else { OPT_MAP(x); }
         OPT_MAP(fmi3GetVersion);
         OPT_MAP(fmi3SetDebugLogging);
-        REQ_MAP(fmi3InstantiateCoSimulation);
+        CS_MAP(fmi3InstantiateCoSimulation);
         REQ_MAP(fmi3FreeInstance);
         REQ_MAP(fmi3EnterInitializationMode);
         REQ_MAP(fmi3ExitInitializationMode);
@@ -468,11 +1033,23 @@ static int fmu_map_functions(fmu_t *fmu, fmu_version_t fmi_version){
         OPT_MAP(fmi3SetShiftFraction);
         OPT_MAP(fmi3EvaluateDiscreteStates);
         REQ_MAP(fmi3UpdateDiscreteStates);
-        REQ_MAP(fmi3EnterStepMode);
+        CS_MAP(fmi3EnterStepMode);
         OPT_MAP(fmi3GetOutputDerivatives);
-        REQ_MAP(fmi3DoStep);
+        CS_MAP(fmi3DoStep);
+        OPT_MAP(fmi3InstantiateScheduledExecution);
+        OPT_MAP(fmi3ActivateModelPartition);
+        ME_MAP(fmi3InstantiateModelExchange);
+        ME_MAP(fmi3EnterContinuousTimeMode);
+        ME_MAP(fmi3CompletedIntegratorStep);
+        ME_MAP(fmi3SetTime);
+        ME_MAP(fmi3SetContinuousStates);
+        ME_MAP(fmi3GetContinuousStateDerivatives);
+        ME_MAP(fmi3GetEventIndicators);
+        ME_MAP(fmi3GetContinuousStates);
 #undef OPT_MAP
 #undef REQ_MAP
+#undef CS_MAP
+#undef ME_MAP
     }
 
     return status;
@@ -501,19 +1078,50 @@ static void fs_make_path(char* buffer, size_t len, ...) {
 }
 
 
+/*
+ * Look for canBeInstantiatedOnlyOncePerProcess in modelDescription.xml. This is not a full
+ * XML parser: attribute is expected to be on a single line.
+ */
+static bool fmu_is_reentrant(const char *directory) {
+    char filename[FMU_PATH_MAX_LEN];
+    char line[4096];
+    bool reentrant = true;
+
+    filename[0] = '\0';
+    fs_make_path(filename, FMU_PATH_MAX_LEN, directory, "modelDescription.xml", NULL);
+    FILE *fp = fopen(filename, "rt");
+    if (!fp)
+        return true;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (strstr(line, "canBeInstantiatedOnlyOncePerProcess=\"true\"")) {
+            reentrant = false;
+            break;
+        }
+    }
+    fclose(fp);
+
+    return reentrant;
+}
+
+
 int fmu_load_from_directory(container_t *container, int i, const char *directory, const char *name,
-                            const char *identifier, const char *guid, fmu_version_t fmi_version, int support_event) {
-    logger(LOGGER_DEBUG, "FMU#%d: loading '%s" FMU_BIN_SUFFIXE "' from directory '%s' (FMI-%d)", i, identifier, directory, fmi_version);
+                            const char *identifier, const char *guid, fmu_version_t fmi_version, int support_event,
+                            bool model_exchange) {
+    logger(&container->logger, LOGGER_DEBUG, "FMU#%d: loading '%s" FMU_BIN_SUFFIXE "' from directory '%s' (FMI-%d)", i, identifier, directory, fmi_version);
 
     fmu_t *fmu = &container->fmu[i];
 
     fmu->container = container;
+    fmu->logger = &container->logger;
+    fmu->library_copy = NULL;
     fmu->conversions = NULL;
     fmu->name = strdup(name);
     fmu->guid = strdup(guid);
     fmu->index = i;
     fmu->fmi_version = fmi_version;
     fmu->component = NULL;  /* will be set by fmuInstantiateCoSimulation() */
+    fmu->model_exchange = model_exchange;   /* needed to map functions */
 
 #define INIT_FMU_DATA(type)                             \
     fmu->fmu_io. type .in.translations = NULL;          \
@@ -548,27 +1156,48 @@ int fmu_load_from_directory(container_t *container, int i, const char *directory
             fs_make_path(library_filename, FMU_PATH_MAX_LEN, directory, "binaries", FMU3_BINDIR, identifier, NULL);
             break;
         default:
-            logger(LOGGER_ERROR, "Unsupported FMI-%d version.", fmi_version);
+            logger(fmu->logger, LOGGER_ERROR, "Unsupported FMI-%d version.", fmi_version);
             return -1;
     }
     STRLCAT(library_filename, FMU_BIN_SUFFIXE, FMU_PATH_MAX_LEN);
  	fs_make_path(fmu->resource_dir, FMU_PATH_MAX_LEN, directory, "resources", NULL);
 
-    fmu->library = library_load(library_filename);
+    /* Ensemble: each container needs its own instance of global variables */
+    if (container->library_copy && !fmu_is_reentrant(directory)) {
+        char copy_filename[FMU_PATH_MAX_LEN];
+
+        snprintf(copy_filename, sizeof(copy_filename), "%.*s-%d" FMU_BIN_SUFFIXE,
+                 (int)(strlen(library_filename) - strlen(FMU_BIN_SUFFIXE)), library_filename, container->library_copy);
+        if (library_copy(fmu->logger, library_filename, copy_filename))
+            return -2;
+        fmu->library_copy = strdup(copy_filename);
+        logger(fmu->logger, LOGGER_DEBUG, "FMU#%d: is not reentrant. Use a copy of its library.", i);
+    }
+
+    fmu->library = library_load(fmu->logger, fmu->library_copy ? fmu->library_copy : library_filename);
     if (!fmu->library)
         return -2;
     
     if (fmu_map_functions(fmu, fmi_version)) {
-        logger(LOGGER_ERROR, "missing API in %s", library_filename);
+        logger(fmu->logger, LOGGER_ERROR, "missing API in %s", library_filename);
         return -3;
     }
 
     fmu->cancel = false;
     fmu->support_event = support_event;
     fmu->need_event_udpate = false;
+    fmu->early_return = false;
+    fmu->last_successful_time = 0.0;
+    fmu->nb_group = 0;  /* set by container_schedule_new() */
+    fmu->group = NULL;
+    fmu->step_cost = 0;
+    fmu->outputs_digest = 0;
+    fmu->outputs_changes = 0;
+    fmu->job = FMU_JOB_STEP;
+    fmu->state = NULL;
 
     if (container->profiling)
-        fmu->profile = profile_new();
+        fmu->profile = profile_new(fmu->logger);
     else
         fmu->profile = NULL;
 
@@ -581,7 +1210,7 @@ int fmu_load_from_directory(container_t *container, int i, const char *directory
 
 
 void fmu_unload(fmu_t *fmu) {
-    logger(LOGGER_DEBUG, "Unload FMU %s", fmu->name);
+    logger(fmu->logger, LOGGER_DEBUG, "Unload FMU %s", fmu->name);
 
     /* Stop the thread */
     fmu->cancel = true;
@@ -594,13 +1223,20 @@ void fmu_unload(fmu_t *fmu) {
     thread_mutex_free(&fmu->mutex_fmu);
     thread_mutex_free(&fmu->mutex_container);
 
+    if (fmu->profile)
+        profile_report(fmu->logger, fmu->profile, fmu->name);
+    profile_free(fmu->profile);
+
     free(fmu->guid);
     free(fmu->name);
     convert_free(fmu->conversions);
-    profile_free(fmu->profile);
 
     /* and finally unload the library */
     library_unload(fmu->library);
+    if (fmu->library_copy) {
+        remove(fmu->library_copy);
+        free(fmu->library_copy);
+    }
 
 /* Free a plain translation port (in + out) and the associated start values  */
 #define FREE_FMU_DATA(type)                                             \
@@ -644,6 +1280,9 @@ void fmu_unload(fmu_t *fmu) {
     free(fmu->fmu_io.clocks.in.translations);
     free(fmu->fmu_io.clocks.out.translations);
 
+    free(fmu->fmu_io.derivatives.in.translations);
+    free(fmu->fmu_io.derivatives.out.translations);
+
     FREE_CLOCKED_DATA(reals64);
     FREE_CLOCKED_DATA(reals32);
     FREE_CLOCKED_DATA(integers8);
@@ -673,13 +1312,13 @@ fmu_status_t fmuGet ## fmi_type(const fmu_t *fmu, const fmu_vr_t vr[], size_t nv
     if (fmu->fmi_version == FMU_2) {                                                                                \
         fmi2Status status2 = fmu->fmi_functions.version_2. fmi2_function (fmu->component, vr, nvr, value);          \
         if (status2 != fmi2OK) {                                                                                    \
-            logger(LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status2);                          \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status2);             \
             status = FMU_STATUS_ERROR;                                                                              \
         }                                                                                                           \
     } else {                                                                                                        \
         fmi3Status status3 = fmu->fmi_functions.version_3. fmi3_function (fmu->component, vr, nvr, value, nvalues); \
         if (status3 != fmi3OK) {                                                                                    \
-            logger(LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status3);                          \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status3);             \
             status = FMU_STATUS_ERROR;                                                                              \
         }                                                                                                           \
     }                                                                                                               \
@@ -693,12 +1332,12 @@ fmu_status_t fmuGet ## fmi_type(const fmu_t *fmu, const fmu_vr_t vr[], size_t nv
     fmu_status_t status = FMU_STATUS_OK;                                                                            \
                                                                                                                     \
     if (fmu->fmi_version == FMU_2) {                                                                                \
-        logger(LOGGER_ERROR, "%s: fmuGet" #fmi_type " not supported.", fmu->name);                                  \
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuGet" #fmi_type " not supported.", fmu->name);                     \
         status = FMU_STATUS_ERROR;                                                                                  \
     } else {                                                                                                        \
         fmi3Status status3 = fmu->fmi_functions.version_3. fmi3_function (fmu->component, vr, nvr, value, nvalues); \
         if (status3 != fmi3OK) {                                                                                    \
-            logger(LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status3);                          \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status3);             \
             status = FMU_STATUS_ERROR;                                                                              \
         }                                                                                                           \
     }                                                                                                               \
@@ -715,11 +1354,11 @@ fmu_status_t fmuGet ## fmi_type(const fmu_t *fmu, const fmu_vr_t vr[], size_t nv
     if (fmu->fmi_version == FMU_2) {                                                                                \
         fmi2Status status2 = fmu->fmi_functions.version_2. fmi2_function (fmu->component, vr, nvr, value);          \
         if (status2 != fmi2OK) {                                                                                    \
-            logger(LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status2);                          \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuGet" #fmi_type " status=%d", fmu->name, status2);             \
             status = FMU_STATUS_ERROR;                                                                              \
         }                                                                                                           \
     } else {                                                                                                        \
-        logger(LOGGER_ERROR, "%s: fmuGet" #fmi_type " not supported.", fmu->name);                                  \
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuGet" #fmi_type " not supported.", fmu->name);                     \
         status = FMU_STATUS_ERROR;                                                                                  \
     }                                                                                                               \
                                                                                                                     \
@@ -752,12 +1391,12 @@ fmu_status_t fmuGetBinary(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, siz
     fmu_status_t status = FMU_STATUS_OK;
 
     if (fmu->fmi_version == FMU_2) {
-        logger(LOGGER_ERROR, "%s: fmuGetBinary not supported.", fmu->name);
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuGetBinary not supported.", fmu->name);
         status = FMU_STATUS_ERROR;
     } else {
         fmi3Status status3 = fmu->fmi_functions.version_3.fmi3GetBinary(fmu->component, vr, nvr, size, value, nvalues);
         if (status3 != fmi3OK) {
-            logger(LOGGER_ERROR, "%s: fmuGetBinary status=%d", fmu->name, status3);
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuGetBinary status=%d", fmu->name, status3);
             status = FMU_STATUS_ERROR;
         }
     }
@@ -769,12 +1408,12 @@ fmu_status_t fmuGetClock(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, bool
     fmu_status_t status = FMU_STATUS_OK;
 
     if (fmu->fmi_version == FMU_2) {
-        logger(LOGGER_ERROR, "%s: fmuGetClock not supported.", fmu->name);
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuGetClock not supported.", fmu->name);
         status = FMU_STATUS_ERROR;
     } else {
         fmi3Status status3 = fmu->fmi_functions.version_3.fmi3GetClock(fmu->component, vr, nvr, value);
         if (status3 != fmi3OK) {
-            logger(LOGGER_ERROR, "%s: fmuGetClock status=%d", fmu->name, status3);
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuGetClock status=%d", fmu->name, status3);
             status = FMU_STATUS_ERROR;
         }
     }
@@ -789,13 +1428,13 @@ fmu_status_t fmuSet ## fmi_type(const fmu_t *fmu, const fmu_vr_t vr[], size_t nv
     if (fmu->fmi_version == FMU_2) {                                                                                        \
         fmi2Status status2 = fmu->fmi_functions.version_2. fmi2_function (fmu->component, vr, nvr, value);                  \
         if (status2 != fmi2OK) {                                                                                            \
-            logger(LOGGER_ERROR, "%s: fmuSet" #fmi_type " status=%d", fmu->name, status2);                                  \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuSet" #fmi_type " status=%d", fmu->name, status2);                     \
             status = FMU_STATUS_ERROR;                                                                                      \
         }                                                                                                                   \
     } else {                                                                                                                \
         fmi3Status status3 = fmu->fmi_functions.version_3. fmi3_function (fmu->component, vr, nvr, value, nvalues);         \
         if (status3 != fmi3OK) {                                                                                            \
-            logger(LOGGER_ERROR, "%s: fmuSet" #fmi_type " status=%d", fmu->name, status3);                                  \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuSet" #fmi_type " status=%d", fmu->name, status3);                     \
             status = FMU_STATUS_ERROR;                                                                                      \
         }                                                                                                                   \
     }                                                                                                                       \
@@ -809,12 +1448,12 @@ fmu_status_t fmuSet ## fmi_type(const fmu_t *fmu, const fmu_vr_t vr[], size_t nv
     fmu_status_t status = FMU_STATUS_OK;                                                                                    \
                                                                                                                             \
     if (fmu->fmi_version == FMU_2) {                                                                                        \
-        logger(LOGGER_ERROR, "%s: fmuSet" #fmi_type " not supported.", fmu->name);                                          \
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuSet" #fmi_type " not supported.", fmu->name);                             \
         status = FMU_STATUS_ERROR;                                                                                          \
     } else {                                                                                                                \
         fmi3Status status3 = fmu->fmi_functions.version_3. fmi3_function (fmu->component, vr, nvr, value, nvalues);         \
         if (status3 != fmi3OK) {                                                                                            \
-            logger(LOGGER_ERROR, "%s: fmuSet" #fmi_type " tatus=%d", fmu->name, status3);                                   \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuSet" #fmi_type " tatus=%d", fmu->name, status3);                      \
             status = FMU_STATUS_ERROR;                                                                                      \
         }                                                                                                                   \
     }                                                                                                                       \
@@ -831,11 +1470,11 @@ fmu_status_t fmuSet ## fmi_type(const fmu_t *fmu, const fmu_vr_t vr[], size_t nv
     if (fmu->fmi_version == FMU_2) {                                                                                        \
         fmi2Status status2 = fmu->fmi_functions.version_2. fmi2_function (fmu->component, vr, nvr, value);                  \
         if (status2 != fmi2OK) {                                                                                            \
-            logger(LOGGER_ERROR, "%s: fmuSet" #fmi_type " status=%d", fmu->name, status2);                                  \
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuSet" #fmi_type " status=%d", fmu->name, status2);                     \
             status = FMU_STATUS_ERROR;                                                                                      \
         }                                                                                                                   \
     } else {                                                                                                                \
-        logger(LOGGER_ERROR, "%s: fmuSet" #fmi_type " not supported.", fmu->name);                                          \
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuSet" #fmi_type " not supported.", fmu->name);                             \
         status = FMU_STATUS_ERROR;                                                                                          \
     }                                                                                                                       \
                                                                                                                             \
@@ -867,12 +1506,12 @@ fmu_status_t fmuSetBinary(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, con
     fmu_status_t status = FMU_STATUS_OK;
 
     if (fmu->fmi_version == FMU_2) {
-        logger(LOGGER_ERROR, "%s: fmuSetBinary not supported.", fmu->name);
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuSetBinary not supported.", fmu->name);
         status = FMU_STATUS_ERROR;
     } else {
         fmi3Status status3 = fmu->fmi_functions.version_3.fmi3SetBinary(fmu->component, vr, nvr, size, value, nvalues);
         if (status3 != fmi3OK) {
-            logger(LOGGER_ERROR, "%s: fmuSetBinary status=%d", fmu->name, status3);
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuSetBinary status=%d", fmu->name, status3);
             status = FMU_STATUS_ERROR;
         }
     }
@@ -885,15 +1524,15 @@ fmu_status_t fmuSetClock(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, cons
 
 #ifdef DEBUG
     for(int i = 0; i<nvr; i += 1)
-        logger(LOGGER_DEBUG, "[DEBUG] time=%e | fmuSetClock(fmu=%s, vr=%d, value=%d)", fmu->container->time, fmu->name, vr[i], value[i]);
+        logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | fmuSetClock(fmu=%s, vr=%d, value=%d)", fmu->container->time, fmu->name, vr[i], value[i]);
 #endif
     if (fmu->fmi_version == FMU_2) {
-        logger(LOGGER_ERROR, "%s: fmuSetClock not supported.", fmu->name);
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuSetClock not supported.", fmu->name);
         status = FMU_STATUS_ERROR;
     } else {
         fmi3Status status3 = fmu->fmi_functions.version_3.fmi3SetClock(fmu->component, vr, nvr, value);
         if (status3 != fmi3OK) {
-            logger(LOGGER_ERROR, "%s: fmuSetClock status=%d", fmu->name, status3);
+            logger(fmu->logger, LOGGER_ERROR, "%s: fmuSetClock status=%d", fmu->name, status3);
             status = FMU_STATUS_ERROR;
         }
     }
@@ -901,6 +1540,41 @@ fmu_status_t fmuSetClock(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, cons
 }
 
 
+fmu_status_t fmuGetOutputDerivatives(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, const int order[], double value[]) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (fmu->fmi_version == FMU_2) {
+        if (fmu->fmi_functions.version_2.fmi2GetRealOutputDerivatives &&
+            fmu->fmi_functions.version_2.fmi2GetRealOutputDerivatives(fmu->component, vr, nvr, order, value) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3GetOutputDerivatives &&
+            fmu->fmi_functions.version_3.fmi3GetOutputDerivatives(fmu->component, vr, nvr, order, value, nvr) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuGetOutputDerivatives failed.", fmu->name);
+
+    return status;
+}
+
+
+fmu_status_t fmuSetInputDerivatives(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, const int order[], const double value[]) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    /* FMI-3.0 has no input derivatives */
+    if (fmu->fmi_version == FMU_2) {
+        if (fmu->fmi_functions.version_2.fmi2SetRealInputDerivatives &&
+            fmu->fmi_functions.version_2.fmi2SetRealInputDerivatives(fmu->component, vr, nvr, order, value) == fmi2OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "%s: fmuSetInputDerivatives failed.", fmu->name);
+
+    return status;
+}
+
+
 fmu_status_t fmuUpdateDiscreteStates(const fmu_t *fmu, bool *discreteStatesNeedUpdate) {
     if (fmu->support_event) {
         fmi3Boolean terminateSimulation;
@@ -909,9 +1583,10 @@ fmu_status_t fmuUpdateDiscreteStates(const fmu_t *fmu, bool *discreteStatesNeedU
         fmi3Boolean nextEventTimeDefined;
         fmi3Float64 nextEventTime;
         fmi3Status status;
+        FMU_PROFILE_START(fmu);
         
 #ifdef DEBUG
-        logger(LOGGER_DEBUG, "[DEBUG] time=%e | fmi3UpdateDiscreteStates(%s)", fmu->container->time, fmu->name);
+        logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | fmi3UpdateDiscreteStates(%s)", fmu->container->time, fmu->name);
 #endif
         status = fmu->fmi_functions.version_3.fmi3UpdateDiscreteStates(fmu->component,
                 discreteStatesNeedUpdate,
@@ -920,30 +1595,31 @@ fmu_status_t fmuUpdateDiscreteStates(const fmu_t *fmu, bool *discreteStatesNeedU
                 &valuesOfContinuousStatesChanged,
                 &nextEventTimeDefined,
                 &nextEventTime);
+        FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
 
 #ifdef DEBUG
-        logger(LOGGER_DEBUG, "[DEBUG] time=%e | fmuUpdateDiscreteStates(%s): discreteStatesNeedUpdate=%d, terminateSimulation=%d, nominalsOfContinuousStatesChanged=%d, valuesOfContinuousStatesChanged=%d nextEventTimeDefined=%d", 
+        logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | fmuUpdateDiscreteStates(%s): discreteStatesNeedUpdate=%d, terminateSimulation=%d, nominalsOfContinuousStatesChanged=%d, valuesOfContinuousStatesChanged=%d nextEventTimeDefined=%d", 
             fmu->container->time, fmu->name,
             *discreteStatesNeedUpdate, terminateSimulation, nominalsOfContinuousStatesChanged, valuesOfContinuousStatesChanged, nextEventTimeDefined);
 #endif
         if (status != fmi3OK) {
-            logger(LOGGER_ERROR, "Cannot update discrete states for '%s'", fmu->name);
+            logger(fmu->logger, LOGGER_ERROR, "Cannot update discrete states for '%s'", fmu->name);
             return FMU_STATUS_ERROR;
         }
 
         if (terminateSimulation) {
-            logger(LOGGER_WARNING, "FMU '%s' requested to stop simulation.", fmu->name);
+            logger(fmu->logger, LOGGER_WARNING, "FMU '%s' requested to stop simulation.", fmu->name);
             return FMU_STATUS_ERROR;
         }
 
         /* support next event time (requires to change the way the master computes the next step time) */
         if (nextEventTimeDefined) { 
             if (nextEventTime < fmu->container->time) {
-                logger(LOGGER_ERROR, "%s: UpdateDiscreteStates defined next event time %g in the past (current time is %g).", fmu->name, nextEventTime, fmu->container->time);
+                logger(fmu->logger, LOGGER_ERROR, "%s: UpdateDiscreteStates defined next event time %g in the past (current time is %g).", fmu->name, nextEventTime, fmu->container->time);
                 return FMU_STATUS_ERROR;
             } else if (nextEventTime + fmu->container->tolerance < fmu->container->time + fmu->container->next_step) {
                 fmu->container->next_step = nextEventTime - fmu->container->time;
-                logger(LOGGER_DEBUG, "%s: UpdateDiscreteStates defined next event time %g, updating next step to %g.", fmu->name, nextEventTime, fmu->container->next_step);
+                logger(fmu->logger, LOGGER_DEBUG, "%s: UpdateDiscreteStates defined next event time %g, updating next step to %g.", fmu->name, nextEventTime, fmu->container->next_step);
             }
         }
     }
@@ -958,6 +1634,11 @@ fmu_status_t fmuDoStep(fmu_t *fmu,
     fmu_status_t status = FMU_STATUS_ERROR;
 
     fmu->need_event_udpate = false;
+    fmu->early_return = false;
+
+    /* Model-Exchange FMUs are integrated together once co-simulation FMUs have stepped */
+    if (fmu->model_exchange)
+        return FMU_STATUS_OK;
 
     if (fmu->profile)
         profile_tic(fmu->profile);
@@ -984,17 +1665,23 @@ fmu_status_t fmuDoStep(fmu_t *fmu,
                                                           &earlyReturn, 
                                                           &lastSuccessfulTime);
         if (terminateSimulation) {
-            logger(LOGGER_WARNING, "FMU '%s' requested to end the simulation.", fmu->name);
+            logger(fmu->logger, LOGGER_WARNING, "FMU '%s' requested to end the simulation.", fmu->name);
             status = FMU_STATUS_ERROR;
         }
 
-        if (earlyReturn) {
-            logger(LOGGER_ERROR, "FMU '%s' made an early return which is not supported.", fmu->name);
-            status = FMU_STATUS_ERROR;
-        }
-            
         if ((status3 == fmi3OK) || (status3 == fmi3Warning))
             status = FMU_STATUS_OK;
+
+        /* Container truncates the step of all FMUs at lastSuccessfulTime (see container_do_step_rollback()) */
+        if (earlyReturn) {
+            if (fmu->container->early_return) {
+                fmu->early_return = true;
+                fmu->last_successful_time = lastSuccessfulTime;
+            } else {
+                logger(fmu->logger, LOGGER_ERROR, "FMU '%s' made an early return which is not supported.", fmu->name);
+                status = FMU_STATUS_ERROR;
+            }
+        }
     }
       
     if (fmu->profile) {
@@ -1076,16 +1763,16 @@ fmu_status_t fmuInstantiateCoSimulation(fmu_t *fmu, const char *instanceName) {
                                                                       fmu->resource_dir,
                                                                       &fmu->fmi2_callback_functions,
                                                                       fmi2False,    /* visible */
-                                                                      logger_get_debug());
+                                                                      logger_get_debug(fmu->logger));
     } else {
         fmu->component =  fmu->fmi_functions.version_3.fmi3InstantiateCoSimulation(
             instanceName, 
             fmu->guid,
             fmu->resource_dir,
             fmi3False,  /* visible */
-            logger_get_debug(),
+            logger_get_debug(fmu->logger),
             (fmu->support_event)?fmi3True:fmi3False, /* eventModeUsed */
-            fmi3False, /* earlyReturnAllowed */
+            (fmu->container->early_return)?fmi3True:fmi3False, /* earlyReturnAllowed */
             NULL, /* requiredIntermediateVariables[] */
             0, /*  nRequiredIntermediateVariables */
             fmu, /* fmi3InstanceEnvironment */
@@ -1100,6 +1787,225 @@ fmu_status_t fmuInstantiateCoSimulation(fmu_t *fmu, const char *instanceName) {
 }
 
 
+/* Output clocks are read by the container once the partition is executed */
+static void fmu_clock_update(fmi3InstanceEnvironment instanceEnvironment) {
+    const fmu_t *fmu = instanceEnvironment;
+    const container_t *container = fmu->container;
+
+    if (container->scheduled_execution.clock_update)
+        container->scheduled_execution.clock_update(container->scheduled_execution.environment);
+
+    return;
+}
+
+
+fmu_status_t fmuInstantiateScheduledExecution(fmu_t *fmu, const char *instanceName) {
+    const container_t *container = fmu->container;
+
+    if ((fmu->fmi_version != 3) ||
+        !fmu->fmi_functions.version_3.fmi3InstantiateScheduledExecution ||
+        !fmu->fmi_functions.version_3.fmi3ActivateModelPartition) {
+        logger(fmu->logger, LOGGER_ERROR, "FMU '%s' does not support Scheduled Execution.", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+
+    fmu->support_event = false; /* no event mode in Scheduled Execution */
+    fmu->component = fmu->fmi_functions.version_3.fmi3InstantiateScheduledExecution(
+        instanceName,
+        fmu->guid,
+        fmu->resource_dir,
+        fmi3False,  /* visible */
+        logger_get_debug(fmu->logger),
+        fmu, /* fmi3InstanceEnvironment */
+        logger_embedded_fmu3,
+        fmu_clock_update,
+        container->scheduled_execution.lock_preemption,
+        container->scheduled_execution.unlock_preemption
+    );
+    if (!fmu->component)
+        return FMU_STATUS_ERROR;
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t fmuActivateModelPartition(const fmu_t *fmu, fmu_vr_t clock, double activationTime) {
+#ifdef DEBUG
+    logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | fmi3ActivateModelPartition(%s, %u)", activationTime, fmu->name, clock);
+#endif
+    fmi3Status status3 = fmu->fmi_functions.version_3.fmi3ActivateModelPartition(fmu->component, clock, activationTime);
+    if ((status3 != fmi3OK) && (status3 != fmi3Warning)) {
+        logger(fmu->logger, LOGGER_ERROR, "FMU '%s' failed to activate partition of clock %u.", fmu->name, clock);
+        return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t fmuInstantiateModelExchange(fmu_t *fmu, const char *instanceName) {
+    fmu->support_event = false; /* events are handled by the integrator of the container */
+    if (fmu->fmi_version == 2) {
+        fmu->fmi2_callback_functions.componentEnvironment = fmu;
+        fmu->fmi2_callback_functions.logger = logger_embedded_fmu2;
+        fmu->fmi2_callback_functions.allocateMemory = fmu->container->allocate_memory;
+        fmu->fmi2_callback_functions.freeMemory = fmu->container->free_memory;
+        fmu->fmi2_callback_functions.stepFinished = NULL;
+
+        fmu->component = fmu->fmi_functions.version_2.fmi2Instantiate(instanceName,
+                                                                      fmi2ModelExchange,
+                                                                      fmu->guid,
+                                                                      fmu->resource_dir,
+                                                                      &fmu->fmi2_callback_functions,
+                                                                      fmi2False,    /* visible */
+                                                                      logger_get_debug(fmu->logger));
+    } else {
+        fmu->component = fmu->fmi_functions.version_3.fmi3InstantiateModelExchange(
+            instanceName,
+            fmu->guid,
+            fmu->resource_dir,
+            fmi3False,  /* visible */
+            logger_get_debug(fmu->logger),
+            fmu, /* fmi3InstanceEnvironment */
+            logger_embedded_fmu3
+        );
+    }
+    if (!fmu->component)
+        return FMU_STATUS_ERROR;
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t fmuEnterContinuousTimeMode(const fmu_t *fmu) {
+    int ok;
+
+    if (fmu->fmi_version == 2)
+        ok = fmu->fmi_functions.version_2.fmi2EnterContinuousTimeMode(fmu->component) == fmi2OK;
+    else
+        ok = fmu->fmi_functions.version_3.fmi3EnterContinuousTimeMode(fmu->component) == fmi3OK;
+    if (!ok) {
+        logger(fmu->logger, LOGGER_ERROR, "Cannot enter continuous time mode for %s", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/* Event iteration of a Model-Exchange FMU: fmi2NewDiscreteStates() or fmi3UpdateDiscreteStates() */
+fmu_status_t fmuNewDiscreteStates(const fmu_t *fmu, bool *needUpdate, bool *statesChanged,
+                                  bool *nextEventTimeDefined, double *nextEventTime) {
+    bool terminate;
+    int ok;
+    FMU_PROFILE_START(fmu);
+
+    if (fmu->fmi_version == 2) {
+        fmi2EventInfo event_info;
+        ok = fmu->fmi_functions.version_2.fmi2NewDiscreteStates(fmu->component, &event_info) == fmi2OK;
+        *needUpdate = event_info.newDiscreteStatesNeeded;
+        terminate = event_info.terminateSimulation;
+        *statesChanged = event_info.valuesOfContinuousStatesChanged;
+        *nextEventTimeDefined = event_info.nextEventTimeDefined;
+        *nextEventTime = event_info.nextEventTime;
+    } else {
+        fmi3Boolean nominalsOfContinuousStatesChanged;
+        ok = fmu->fmi_functions.version_3.fmi3UpdateDiscreteStates(fmu->component,
+                needUpdate,
+                &terminate,
+                &nominalsOfContinuousStatesChanged,
+                statesChanged,
+                nextEventTimeDefined,
+                nextEventTime) == fmi3OK;
+    }
+    FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
+
+    if (!ok) {
+        logger(fmu->logger, LOGGER_ERROR, "Cannot update discrete states for '%s'", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+    if (terminate) {
+        logger(fmu->logger, LOGGER_WARNING, "FMU '%s' requested to stop simulation.", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t fmuCompletedIntegratorStep(const fmu_t *fmu, bool *enterEventMode) {
+    bool terminate;
+    int ok;
+
+    if (fmu->fmi_version == 2) {
+        fmi2Boolean enter_event_mode;
+        fmi2Boolean terminate2;
+        ok = fmu->fmi_functions.version_2.fmi2CompletedIntegratorStep(fmu->component,
+                                                                      fmi2True, /* noSetFMUStatePriorToCurrentPoint */
+                                                                      &enter_event_mode, &terminate2) == fmi2OK;
+        *enterEventMode = enter_event_mode;
+        terminate = terminate2;
+    } else {
+        ok = fmu->fmi_functions.version_3.fmi3CompletedIntegratorStep(fmu->component,
+                                                                      fmi3True, /* noSetFMUStatePriorToCurrentPoint */
+                                                                      enterEventMode, &terminate) == fmi3OK;
+    }
+
+    if (!ok) {
+        logger(fmu->logger, LOGGER_ERROR, "FMU '%s' failed to complete integrator step.", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+    if (terminate) {
+        logger(fmu->logger, LOGGER_WARNING, "FMU '%s' requested to end the simulation.", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/*
+ * Continuous states, derivatives and event indicators are exchanged as Float64 arrays. Names
+ * of the functions follow FMI-2.0.
+ */
+#define FMU_ME_FUNCTION(function, fmi2_function, fmi3_function, type, message)          \
+fmu_status_t function(const fmu_t *fmu, type values[], size_t nb) {                     \
+    int ok;                                                                             \
+    if (fmu->fmi_version == 2)                                                          \
+        ok = fmu->fmi_functions.version_2.fmi2_function(fmu->component, values, nb) == fmi2OK; \
+    else                                                                                \
+        ok = fmu->fmi_functions.version_3.fmi3_function(fmu->component, values, nb) == fmi3OK; \
+    if (!ok) {                                                                          \
+        logger(fmu->logger, LOGGER_ERROR, "Cannot " message " of FMU '%s'", fmu->name);  \
+        return FMU_STATUS_ERROR;                                                        \
+    }                                                                                   \
+    return FMU_STATUS_OK;                                                               \
+}
+
+FMU_ME_FUNCTION(fmuSetContinuousStates, fmi2SetContinuousStates, fmi3SetContinuousStates, const double, "set continuous states")
+FMU_ME_FUNCTION(fmuGetContinuousStates, fmi2GetContinuousStates, fmi3GetContinuousStates, double, "get continuous states")
+FMU_ME_FUNCTION(fmuGetDerivatives, fmi2GetDerivatives, fmi3GetContinuousStateDerivatives, double, "get derivatives")
+FMU_ME_FUNCTION(fmuGetEventIndicators, fmi2GetEventIndicators, fmi3GetEventIndicators, double, "get event indicators")
+
+#undef FMU_ME_FUNCTION
+
+
+fmu_status_t fmuSetTime(const fmu_t *fmu, double time) {
+    int ok;
+
+    if (fmu->fmi_version == 2)
+        ok = fmu->fmi_functions.version_2.fmi2SetTime(fmu->component, time) == fmi2OK;
+    else
+        ok = fmu->fmi_functions.version_3.fmi3SetTime(fmu->component, time) == fmi3OK;
+    if (!ok) {
+        logger(fmu->logger, LOGGER_ERROR, "Cannot set time of FMU '%s'", fmu->name);
+        return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
 void fmuFreeInstance(const fmu_t *fmu) {
     if (fmu && fmu->component) { /* if embedded FMU is not well initialized */
         if (fmu->fmi_version == 2)
@@ -1145,7 +2051,10 @@ fmu_status_t fmuReset(const fmu_t *fmu) {
 fmu_status_t fmuGetBooleanStatus(const fmu_t *fmu, const fmi2StatusKind s, fmi2Boolean* value) {
     fmu_status_t status = FMU_STATUS_ERROR;
 
-    if (fmu->fmi_version == 2) {
+    if (fmu->model_exchange) {
+        *value = fmi2False;
+        status = FMU_STATUS_OK;
+    } else if (fmu->fmi_version == 2) {
         fmi2Status status2 = fmu->fmi_functions.version_2.fmi2GetBooleanStatus(fmu->component, s, value);
         if (status2 == fmi2OK)
             status = FMU_STATUS_OK;
@@ -1157,7 +2066,10 @@ fmu_status_t fmuGetBooleanStatus(const fmu_t *fmu, const fmi2StatusKind s, fmi2B
 
 fmu_status_t fmuGetRealStatus(const fmu_t *fmu, const fmi2StatusKind s, fmi2Real* value) {
     fmu_status_t status = FMU_STATUS_ERROR;
-    if (fmu->fmi_version == 2) {
+    if (fmu->model_exchange) {
+        *value = fmu->container->time;
+        status = FMU_STATUS_OK;
+    } else if (fmu->fmi_version == 2) {
         fmi2Status status2 = fmu->fmi_functions.version_2.fmi2GetRealStatus(fmu->component, s, value);
         if (status2 == fmi2OK)
             status = FMU_STATUS_OK;
@@ -1168,10 +2080,24 @@ fmu_status_t fmuGetRealStatus(const fmu_t *fmu, const fmi2StatusKind s, fmi2Real
 
 
 fmu_status_t fmuEnterEventMode(const fmu_t *fmu) {
-    if (fmu->support_event) {
+    if (fmu->model_exchange) {
+        FMU_PROFILE_START(fmu);
+        int ok;
+        if (fmu->fmi_version == 2)
+            ok = fmu->fmi_functions.version_2.fmi2EnterEventMode(fmu->component) == fmi2OK;
+        else
+            ok = fmu->fmi_functions.version_3.fmi3EnterEventMode(fmu->component) == fmi3OK;
+        FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
+        if (!ok) {
+            logger(fmu->logger, LOGGER_ERROR, "Cannot enter in Event mode for fmu %s", fmu->name);
+            return FMU_STATUS_ERROR;
+        }
+    } else if (fmu->support_event) {
+        FMU_PROFILE_START(fmu);
         fmi3Status status = fmu->fmi_functions.version_3.fmi3EnterEventMode(fmu->component);
+        FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
         if (status != fmi3OK) {
-            logger(LOGGER_ERROR, "Cannot enter in Event mode for fmu %s", fmu->name);
+            logger(fmu->logger, LOGGER_ERROR, "Cannot enter in Event mode for fmu %s", fmu->name);
             return FMU_STATUS_ERROR;
         }
     }
@@ -1182,9 +2108,11 @@ fmu_status_t fmuEnterEventMode(const fmu_t *fmu) {
 
 fmu_status_t fmuEnterStepMode(const fmu_t *fmu) {
     if (fmu->support_event) {
+        FMU_PROFILE_START(fmu);
         fmi3Status status = fmu->fmi_functions.version_3.fmi3EnterStepMode(fmu->component);
+        FMU_PROFILE_ACCUMULATE(fmu, PROFILE_EVENT);
         if (status != fmi3OK) {
-            logger(LOGGER_ERROR, "Cannot enter step mode for %s", fmu->name);
+            logger(fmu->logger, LOGGER_ERROR, "Cannot enter step mode for %s", fmu->name);
             return FMU_STATUS_ERROR;
         }
     }
@@ -1193,13 +2121,144 @@ fmu_status_t fmuEnterStepMode(const fmu_t *fmu) {
 }
 
 
+/* True if the FMU exports the functions to get, set and free its state */
+bool fmu_can_get_set_state(const fmu_t *fmu) {
+    if (fmu->fmi_version == 2)
+        return fmu->fmi_functions.version_2.fmi2GetFMUstate && fmu->fmi_functions.version_2.fmi2SetFMUstate &&
+               fmu->fmi_functions.version_2.fmi2FreeFMUstate;
+    else
+        return fmu->fmi_functions.version_3.fmi3GetFMUState && fmu->fmi_functions.version_3.fmi3SetFMUState &&
+               fmu->fmi_functions.version_3.fmi3FreeFMUState;
+}
+
+
+fmu_status_t fmuGetFMUState(const fmu_t *fmu, void **state) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (fmu->fmi_version == 2) {
+        if (fmu->fmi_functions.version_2.fmi2GetFMUstate &&
+            fmu->fmi_functions.version_2.fmi2GetFMUstate(fmu->component, (fmi2FMUstate *)state) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3GetFMUState &&
+            fmu->fmi_functions.version_3.fmi3GetFMUState(fmu->component, (fmi3FMUState *)state) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "Cannot get state of FMU '%s'", fmu->name);
+
+    return status;
+}
+
+
+fmu_status_t fmuSetFMUState(const fmu_t *fmu, void *state) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (fmu->fmi_version == 2) {
+        if (fmu->fmi_functions.version_2.fmi2SetFMUstate &&
+            fmu->fmi_functions.version_2.fmi2SetFMUstate(fmu->component, state) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3SetFMUState &&
+            fmu->fmi_functions.version_3.fmi3SetFMUState(fmu->component, state) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "Cannot set state of FMU '%s'", fmu->name);
+
+    return status;
+}
+
+
+fmu_status_t fmuFreeFMUState(const fmu_t *fmu, void **state) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (!*state)
+        return FMU_STATUS_OK;
+
+    if (fmu->fmi_version == 2) {
+        if (fmu->fmi_functions.version_2.fmi2FreeFMUstate &&
+            fmu->fmi_functions.version_2.fmi2FreeFMUstate(fmu->component, (fmi2FMUstate *)state) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3FreeFMUState &&
+            fmu->fmi_functions.version_3.fmi3FreeFMUState(fmu->component, (fmi3FMUState *)state) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "Cannot free state of FMU '%s'", fmu->name);
+    *state = NULL;
+
+    return status;
+}
+
+
+fmu_status_t fmuSerializedFMUStateSize(const fmu_t *fmu, void *state, size_t *size) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (fmu->fmi_version == 2) {
+        if (fmu->fmi_functions.version_2.fmi2SerializedFMUstateSize &&
+            fmu->fmi_functions.version_2.fmi2SerializedFMUstateSize(fmu->component, state, size) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3SerializedFMUStateSize &&
+            fmu->fmi_functions.version_3.fmi3SerializedFMUStateSize(fmu->component, state, size) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "Cannot get size of serialized state of FMU '%s'", fmu->name);
+
+    return status;
+}
+
+
+fmu_status_t fmuSerializeFMUState(const fmu_t *fmu, void *state, uint8_t *buffer, size_t size) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (fmu->fmi_version == 2) {
+        if (fmu->fmi_functions.version_2.fmi2SerializeFMUstate &&
+            fmu->fmi_functions.version_2.fmi2SerializeFMUstate(fmu->component, state, (fmi2Byte *)buffer, size) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3SerializeFMUState &&
+            fmu->fmi_functions.version_3.fmi3SerializeFMUState(fmu->component, state, buffer, size) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "Cannot serialize state of FMU '%s'", fmu->name);
+
+    return status;
+}
+
+
+fmu_status_t fmuDeserializeFMUState(const fmu_t *fmu, const uint8_t *buffer, size_t size, void **state) {
+    fmu_status_t status = FMU_STATUS_ERROR;
+
+    if (fmu->fmi_version == 2) {
+        if (fmu->fmi_functions.version_2.fmi2DeSerializeFMUstate &&
+            fmu->fmi_functions.version_2.fmi2DeSerializeFMUstate(fmu->component, (const fmi2Byte *)buffer, size,
+                                                                 (fmi2FMUstate *)state) == fmi2OK)
+            status = FMU_STATUS_OK;
+    } else {
+        if (fmu->fmi_functions.version_3.fmi3DeserializeFMUState &&
+            fmu->fmi_functions.version_3.fmi3DeserializeFMUState(fmu->component, buffer, size,
+                                                                 (fmi3FMUState *)state) == fmi3OK)
+            status = FMU_STATUS_OK;
+    }
+    if (status != FMU_STATUS_OK)
+        logger(fmu->logger, LOGGER_ERROR, "Cannot deserialize state of FMU '%s'", fmu->name);
+
+    return status;
+}
+
+
 fmu_status_t fmuGetIntervalDecimal(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, 
                                    double *interval, int *qualifier) {
     fmi3Status status = fmu->fmi_functions.version_3.fmi3GetIntervalDecimal(fmu->component,
         vr, nvr, interval, (fmi3IntervalQualifier *)qualifier);
 
     if (status != fmi3OK) {
-        logger(LOGGER_ERROR, "Cannot GetIntervalDecimal for FMU  '%s'", fmu->name);
+        logger(fmu->logger, LOGGER_ERROR, "Cannot GetIntervalDecimal for FMU  '%s'", fmu->name);
         return FMU_STATUS_ERROR;
     }
     
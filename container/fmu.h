@@ -72,6 +72,28 @@ typedef struct {
 } fmu_clocked_port_list_t;
 
 
+/*----------------------------------------------------------------------------
+                   F M U _ C L O C K _ C O N S U M E R _ T
+----------------------------------------------------------------------------*/
+
+/*
+ * Port of an FMU activated by a local clock: the input clock itself or the clocked inputs
+ * of a type. index is the position in fmu_io.clocks.in or in fmu_io.clocked_xxx.in.
+ */
+#define FMU_CLOCK_CONSUMER_CLOCK    0   /* other types are clocked inputs */
+
+typedef struct {
+    int                         fmu_id;
+    int                         type;
+    unsigned long               index;
+} fmu_clock_consumer_t;
+
+typedef struct {
+    unsigned long               nb;
+    fmu_clock_consumer_t        *consumers;
+} fmu_clock_consumer_list_t;
+
+
 /*----------------------------------------------------------------------------
                           F M U _ S T A R T _ xxx _ T
 ----------------------------------------------------------------------------*/
@@ -139,6 +161,8 @@ typedef struct {
 	fmu_clocked_port_list_t		clocked_strings;
     fmu_clocked_port_list_t		clocked_binaries;
 
+    fmu_translation_port_t      derivatives;    /* of Float64 links. vr is index in container->derivatives */
+
     double                      *start_values_reals64;
     float                       *start_values_reals32;
     int8_t                      *start_values_integers8;
@@ -219,6 +243,15 @@ typedef union {
         DECLARE_FMI_FUNCTION(fmi2GetIntegerStatus);
         DECLARE_FMI_FUNCTION(fmi2GetBooleanStatus);
         DECLARE_FMI_FUNCTION(fmi2GetStringStatus);
+        DECLARE_FMI_FUNCTION(fmi2EnterEventMode);
+        DECLARE_FMI_FUNCTION(fmi2NewDiscreteStates);
+        DECLARE_FMI_FUNCTION(fmi2EnterContinuousTimeMode);
+        DECLARE_FMI_FUNCTION(fmi2CompletedIntegratorStep);
+        DECLARE_FMI_FUNCTION(fmi2SetTime);
+        DECLARE_FMI_FUNCTION(fmi2SetContinuousStates);
+        DECLARE_FMI_FUNCTION(fmi2GetDerivatives);
+        DECLARE_FMI_FUNCTION(fmi2GetEventIndicators);
+        DECLARE_FMI_FUNCTION(fmi2GetContinuousStates);
     } version_2;
     struct {
         DECLARE_FMI_FUNCTION(fmi3GetVersion);
@@ -283,6 +316,16 @@ typedef union {
         DECLARE_FMI_FUNCTION(fmi3EnterStepMode);
         DECLARE_FMI_FUNCTION(fmi3GetOutputDerivatives);
         DECLARE_FMI_FUNCTION(fmi3DoStep);
+        DECLARE_FMI_FUNCTION(fmi3InstantiateScheduledExecution);
+        DECLARE_FMI_FUNCTION(fmi3ActivateModelPartition);
+        DECLARE_FMI_FUNCTION(fmi3InstantiateModelExchange);
+        DECLARE_FMI_FUNCTION(fmi3EnterContinuousTimeMode);
+        DECLARE_FMI_FUNCTION(fmi3CompletedIntegratorStep);
+        DECLARE_FMI_FUNCTION(fmi3SetTime);
+        DECLARE_FMI_FUNCTION(fmi3SetContinuousStates);
+        DECLARE_FMI_FUNCTION(fmi3GetContinuousStateDerivatives);
+        DECLARE_FMI_FUNCTION(fmi3GetEventIndicators);
+        DECLARE_FMI_FUNCTION(fmi3GetContinuousStates);
     } version_3;
 } fmu_interface_t;
 #	undef DECLARE_FMI_FUNCTION
@@ -308,6 +351,19 @@ typedef enum {
 } fmu_version_t;
 
 
+/*----------------------------------------------------------------------------
+                              F M U _ J O B _ T
+----------------------------------------------------------------------------*/
+
+/* Work done by the thread of an FMU once unlocked by the container */
+typedef enum {
+    FMU_JOB_STEP = 0,       /* step the FMUs of its group */
+    FMU_JOB_GET_STATE,      /* on this FMU only */
+    FMU_JOB_SET_STATE,
+    FMU_JOB_FREE_STATE
+} fmu_job_t;
+
+
 /*----------------------------------------------------------------------------
                                 F M U _ T
 ----------------------------------------------------------------------------*/
@@ -338,10 +394,11 @@ typedef enum {
 #   define FMU_BIN_SUFFIXE  ".dll"
 #endif
 
-typedef struct {
+typedef struct fmu_s {
     char                        *name; /* based on directory */
     int                         index; /* index of this FMU in container */
 	library_t                   library;
+    char                        *library_copy;  /* ensemble: removed when FMU is unloaded. NULL if not used */
 	char						resource_dir[FMU_PATH_MAX_LEN];
 	char						*guid;
     fmu_version_t               fmi_version;
@@ -352,19 +409,31 @@ typedef struct {
 	thread_t			    	thread;
 	mutex_t				    	mutex_fmu;
 	mutex_t				    	mutex_container;
+    int                         nb_group;   /* MT: FMUs stepped by this thread. 0 if thread is idle */
+    struct fmu_s                **group;
+    profile_tic_t               step_cost;  /* ns, set inputs and doStep since last grouping */
+    int                         worker;     /* MT: group set in container.txt. -1 if not set */
+    fmu_job_t                   job;
+    void                        *state;     /* fmi2FMUstate or fmi3FMUState given to or got by job */
 
 	fmu_io_t					fmu_io;
 	
 	fmu_status_t				status;
 	bool						cancel;
     bool                        support_event;
+    bool                        model_exchange;     /* advanced by the integrator of the container */
     bool                        need_event_udpate;
+    bool                        early_return;       /* FMI-3.0: last doStep stopped at last_successful_time */
+    double                      last_successful_time;
 	
     profile_t                   *profile;
+    uint64_t                    outputs_digest;     /* profiling: outputs of previous step */
+    unsigned long long          outputs_changes;    /* profiling: steps where outputs have changed */
 
     struct convert_table_s      *conversions;
 
 	struct container_s			*container;
+    struct logger_s             *logger;    /* context of the container */
 
     /* despite the FMI spec, simulink expects this fmi2CallbackFunctions to live 
      * during all the simulation ! Keep track this structure here.
@@ -378,15 +447,23 @@ typedef struct {
 ----------------------------------------------------------------------------*/
 
 extern fmu_status_t fmu_set_inputs(const fmu_t *fmu);
-extern fmu_status_t fmu_set_clocks(const fmu_t* fmu);
-extern fmu_status_t fmu_set_clocked_inputs(const fmu_t* fmu);
+extern bool fmu_has_inputs(const fmu_t *fmu);
+extern bool fmu_can_get_set_state(const fmu_t *fmu);
+extern int fmu_clock_consumers_append(const fmu_t *fmu, fmu_clock_consumer_list_t *consumers, unsigned long nb_clocks);
+extern fmu_status_t fmu_set_clock_consumer(const fmu_t *fmu, const fmu_clock_consumer_t *consumer);
 extern fmu_status_t fmu_get_outputs(const fmu_t* fmu);
 extern fmu_status_t fmu_get_clocked_outputs(const fmu_t* fmu);
+extern fmu_status_t fmu_get_output_derivatives(const fmu_t *fmu);
+extern void fmu_outputs_activity(fmu_t *fmu);
+extern fmu_status_t fmu_do_step_inline(fmu_t *fmu);
+extern fmu_status_t fmu_do_job(fmu_t *fmu);
+extern fmu_status_t fmu_do_steps_async_inline(struct container_s *container, fmu_t **group, int nb_group);
+extern fmu_status_t fmu_do_steps_waveform_inline(struct container_s *container, fmu_t **group, int nb_group);
 extern fmu_status_t fmuUpdateDiscreteStates(const fmu_t *fmu, bool *discreteStatesNeedUpdate);
 extern int fmu_load_from_directory(struct container_s *container, int i,
                                    const char *directory, const char *name,
                                    const char *identifier, const char *guid,
-                                   fmu_version_t fmi_version, int support_event);
+                                   fmu_version_t fmi_version, int support_event, bool model_exchange);
 extern void fmu_unload(fmu_t *fmu);
 
 extern fmu_status_t fmuGetReal64(const fmu_t *fmu, const fmu_vr_t vr[],
@@ -450,6 +527,10 @@ extern fmu_status_t fmuSetBinary(const fmu_t* fmu, const fmu_vr_t vr[],
                                  size_t nvr, const size_t size[], const uint8_t * const value[], size_t nvalues);
 extern fmu_status_t fmuSetClock(const fmu_t* fmu, const fmu_vr_t vr[],
                                 size_t nvr, const bool value[]);
+extern fmu_status_t fmuGetOutputDerivatives(const fmu_t *fmu, const fmu_vr_t vr[],
+                                            size_t nvr, const int order[], double value[]);
+extern fmu_status_t fmuSetInputDerivatives(const fmu_t *fmu, const fmu_vr_t vr[],
+                                           size_t nvr, const int order[], const double value[]);
 extern fmu_status_t fmuDoStep(fmu_t *fmu, 
                               fmi2Real currentCommunicationPoint, 
                               fmi2Real communicationStepSize);
@@ -457,6 +538,8 @@ extern fmu_status_t fmuEnterInitializationMode(const fmu_t *fmu);
 extern fmu_status_t fmuExitInitializationMode(const fmu_t *fmu);
 extern fmu_status_t fmuSetupExperiment(const fmu_t *fmu);
 extern fmu_status_t fmuInstantiateCoSimulation(fmu_t *fmu, fmi2String instanceName);
+extern fmu_status_t fmuInstantiateScheduledExecution(fmu_t *fmu, const char *instanceName);
+extern fmu_status_t fmuActivateModelPartition(const fmu_t *fmu, fmu_vr_t clock, double activationTime);
 extern void fmuFreeInstance(const fmu_t *fmu);
 extern fmu_status_t fmuTerminate(const fmu_t *fmu);
 extern fmu_status_t fmuReset(const fmu_t *fmu);
@@ -464,6 +547,22 @@ extern fmu_status_t fmuGetBooleanStatus(const fmu_t *fmu, const fmi2StatusKind s
 extern fmu_status_t fmuGetRealStatus(const fmu_t *fmu, const fmi2StatusKind s, fmi2Real* value);
 extern fmu_status_t fmuEnterEventMode(const fmu_t *fmu);
 extern fmu_status_t fmuEnterStepMode(const fmu_t *fmu);
+extern fmu_status_t fmuGetFMUState(const fmu_t *fmu, void **state);
+extern fmu_status_t fmuSetFMUState(const fmu_t *fmu, void *state);
+extern fmu_status_t fmuFreeFMUState(const fmu_t *fmu, void **state);
+extern fmu_status_t fmuSerializedFMUStateSize(const fmu_t *fmu, void *state, size_t *size);
+extern fmu_status_t fmuSerializeFMUState(const fmu_t *fmu, void *state, uint8_t *buffer, size_t size);
+extern fmu_status_t fmuDeserializeFMUState(const fmu_t *fmu, const uint8_t *buffer, size_t size, void **state);
+extern fmu_status_t fmuInstantiateModelExchange(fmu_t *fmu, const char *instanceName);
+extern fmu_status_t fmuEnterContinuousTimeMode(const fmu_t *fmu);
+extern fmu_status_t fmuNewDiscreteStates(const fmu_t *fmu, bool *needUpdate, bool *statesChanged,
+                                         bool *nextEventTimeDefined, double *nextEventTime);
+extern fmu_status_t fmuCompletedIntegratorStep(const fmu_t *fmu, bool *enterEventMode);
+extern fmu_status_t fmuSetTime(const fmu_t *fmu, double time);
+extern fmu_status_t fmuSetContinuousStates(const fmu_t *fmu, const double x[], size_t nx);
+extern fmu_status_t fmuGetContinuousStates(const fmu_t *fmu, double x[], size_t nx);
+extern fmu_status_t fmuGetDerivatives(const fmu_t *fmu, double dx[], size_t nx);
+extern fmu_status_t fmuGetEventIndicators(const fmu_t *fmu, double z[], size_t nz);
 extern fmu_status_t fmuGetIntervalDecimal(const fmu_t *fmu, const fmu_vr_t vr[], size_t nvr, 
                                           double *interval, int *qualifier);
 
@@ -0,0 +1,467 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "container.h"
+#include "fmu.h"
+#include "integrator.h"
+#include "logger.h"
+
+//#define DEBUG
+
+/*
+ * Integrator of the Model-Exchange FMUs embedded in a container. Their continuous states
+ * are advanced together by an explicit Runge-Kutta method over each step of the container,
+ * once co-simulation FMUs have stepped: inputs coming from co-simulation FMUs are held
+ * during the step. Each evaluation of the derivatives sets the states of all FMUs, then
+ * sets inputs, gets derivatives and gets outputs of each FMU in declaration order: coupled
+ * Model-Exchange FMUs exchange their values at each stage, without co-simulation delay.
+ *
+ * State events are located by bisection of the substep on the sign of the event indicators.
+ * Time events shorten the substep. FMUs with an event (or asking for one at the end of the
+ * substep) iterate on their discrete states before the integration goes on.
+ */
+
+
+/*----------------------------------------------------------------------------
+                              T A B L E A U
+----------------------------------------------------------------------------*/
+
+typedef struct {
+    int							nb_stages;
+    bool						fsal;		/* last stage is the derivative at the end of the step */
+    double						c[INTEGRATOR_NB_STAGES];
+    double						a[INTEGRATOR_NB_STAGES][INTEGRATOR_NB_STAGES];
+    double						b[INTEGRATOR_NB_STAGES];
+    double						e[INTEGRATOR_NB_STAGES];	/* error estimate. Unused without step size control */
+} integrator_tableau_t;
+
+static const integrator_tableau_t integrator_tableau[] = {
+    [INTEGRATOR_EULER] = {
+        .nb_stages = 1,
+        .b = { 1.0 }
+    },
+    [INTEGRATOR_RK4] = {
+        .nb_stages = 4,
+        .c = { 0.0, 1.0/2.0, 1.0/2.0, 1.0 },
+        .a = {
+            { 0.0 },
+            { 1.0/2.0 },
+            { 0.0, 1.0/2.0 },
+            { 0.0, 0.0, 1.0 }
+        },
+        .b = { 1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0 }
+    },
+    [INTEGRATOR_RK45] = {
+        .nb_stages = 7,
+        .fsal = true,
+        .c = { 0.0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1.0, 1.0 },
+        .a = {
+            { 0.0 },
+            { 1.0/5.0 },
+            { 3.0/40.0, 9.0/40.0 },
+            { 44.0/45.0, -56.0/15.0, 32.0/9.0 },
+            { 19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0 },
+            { 9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0 },
+            { 35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0 }
+        },
+        .b = { 35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0, 0.0 },
+        .e = { 71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0 }
+    }
+};
+
+
+int integrator_method(const char *name) {
+    if (!strcmp(name, "euler"))
+        return INTEGRATOR_EULER;
+    if (!strcmp(name, "rk4"))
+        return INTEGRATOR_RK4;
+    if (!strcmp(name, "rk45"))
+        return INTEGRATOR_RK45;
+
+    return -1;
+}
+
+
+/*----------------------------------------------------------------------------
+                         E V A L U A T I O N
+----------------------------------------------------------------------------*/
+
+/* Derivatives of all FMUs at (time, x). Outputs of the FMUs are refreshed on the way. */
+static fmu_status_t integrator_derivatives(const integrator_t *integrator, double time, const double *x, double *dx) {
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        const fmu_t *fmu = integrator->fmu[i];
+        const unsigned long offset = integrator->state_offset[i];
+        const size_t nb = integrator->state_offset[i + 1] - offset;
+
+        if (fmuSetTime(fmu, time) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        if (nb && (fmuSetContinuousStates(fmu, x + offset, nb) != FMU_STATUS_OK))
+            return FMU_STATUS_ERROR;
+    }
+
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        const fmu_t *fmu = integrator->fmu[i];
+        const unsigned long offset = integrator->state_offset[i];
+        const size_t nb = integrator->state_offset[i + 1] - offset;
+
+        if (fmu_set_inputs(fmu) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        if (nb && (fmuGetDerivatives(fmu, dx + offset, nb) != FMU_STATUS_OK))
+            return FMU_STATUS_ERROR;
+        if (fmu_get_outputs(fmu) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/* Event indicators of all FMUs, once their states are set */
+static fmu_status_t integrator_indicators(const integrator_t *integrator, double *z) {
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        const unsigned long offset = integrator->indicator_offset[i];
+        const size_t nb = integrator->indicator_offset[i + 1] - offset;
+
+        if (nb && (fmuGetEventIndicators(integrator->fmu[i], z + offset, nb) != FMU_STATUS_OK))
+            return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/*
+ * One substep of size h from (time, x) where k[0] holds the derivatives. Gives x_next, the
+ * derivatives at the end of the substep in the last slot of k, and the normalized error (RK45).
+ */
+static fmu_status_t integrator_substep(integrator_t *integrator, double time, double h, double *error) {
+    const integrator_tableau_t *tableau = &integrator_tableau[integrator->method];
+    const unsigned long n = integrator->nb_states;
+    double *k_end = integrator->k + (INTEGRATOR_NB_STAGES - 1) * n;
+
+    for (int s = 1; s < tableau->nb_stages; s += 1) {
+        memcpy(integrator->x_stage, integrator->x, n * sizeof(*integrator->x));
+        for (int j = 0; j < s; j += 1) {
+            const double coef = h * tableau->a[s][j];
+            const double *k = integrator->k + j * n;
+            if (coef != 0.0) {
+                for (unsigned long i = 0; i < n; i += 1)
+                    integrator->x_stage[i] += coef * k[i];
+            }
+        }
+        if (integrator_derivatives(integrator, time + tableau->c[s] * h, integrator->x_stage,
+                                   integrator->k + s * n) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+    }
+
+    if (tableau->fsal)
+        memcpy(integrator->x_next, integrator->x_stage, n * sizeof(*integrator->x));
+    else {
+        memcpy(integrator->x_next, integrator->x, n * sizeof(*integrator->x));
+        for (int j = 0; j < tableau->nb_stages; j += 1) {
+            const double coef = h * tableau->b[j];
+            const double *k = integrator->k + j * n;
+            for (unsigned long i = 0; i < n; i += 1)
+                integrator->x_next[i] += coef * k[i];
+        }
+        if (integrator_derivatives(integrator, time + h, integrator->x_next, k_end) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+    }
+
+    *error = 0.0;
+    if (integrator->method == INTEGRATOR_RK45) {
+        for (unsigned long i = 0; i < n; i += 1) {
+            double e = 0.0;
+            for (int j = 0; j < tableau->nb_stages; j += 1)
+                e += tableau->e[j] * integrator->k[j * n + i];
+            e = fabs(h * e) / (integrator->tolerance * (1.0 + fabs(integrator->x_next[i])));
+            if (e > *error)
+                *error = e;
+        }
+    }
+
+    return integrator_indicators(integrator, integrator->z_next);
+}
+
+
+static bool integrator_crossing(const integrator_t *integrator, unsigned long from, unsigned long to) {
+    for (unsigned long i = from; i < to; i += 1) {
+        if ((integrator->z[i] > 0.0) != (integrator->z_next[i] > 0.0))
+            return true;
+    }
+
+    return false;
+}
+
+
+/*----------------------------------------------------------------------------
+                                E V E N T S
+----------------------------------------------------------------------------*/
+
+/* Event iteration of one FMU. It ends in continuous time mode. */
+static fmu_status_t integrator_event(integrator_t *integrator, int i, bool enter) {
+    const fmu_t *fmu = integrator->fmu[i];
+    bool need_update = true;
+    bool states_changed;
+    bool next_event_time_defined;
+    double next_event_time;
+
+#ifdef DEBUG
+    logger(fmu->logger, LOGGER_DEBUG, "[DEBUG] time=%e | Model-Exchange event for '%s'", fmu->container->time, fmu->name);
+#endif
+    if (enter && (fmuEnterEventMode(fmu) != FMU_STATUS_OK))
+        return FMU_STATUS_ERROR;
+
+    integrator->next_event_time[i] = INFINITY;
+    for (int n = 0; need_update; n += 1) {
+        if (n == INTEGRATOR_EVENT_ITERATIONS) {
+            logger(fmu->logger, LOGGER_ERROR, "Discrete states of FMU '%s' do not converge.", fmu->name);
+            return FMU_STATUS_ERROR;
+        }
+        if (fmuNewDiscreteStates(fmu, &need_update, &states_changed, &next_event_time_defined,
+                                 &next_event_time) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        if (next_event_time_defined)
+            integrator->next_event_time[i] = next_event_time;
+    }
+
+    return fmuEnterContinuousTimeMode(fmu);
+}
+
+
+/* States and event indicators of the FMUs are read back: they may have changed at events */
+static fmu_status_t integrator_restart(integrator_t *integrator, double time) {
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        const unsigned long offset = integrator->state_offset[i];
+        const size_t nb = integrator->state_offset[i + 1] - offset;
+
+        if (nb && (fmuGetContinuousStates(integrator->fmu[i], integrator->x + offset, nb) != FMU_STATUS_OK))
+            return FMU_STATUS_ERROR;
+    }
+
+    if (integrator_derivatives(integrator, time, integrator->x, integrator->k) != FMU_STATUS_OK)
+        return FMU_STATUS_ERROR;
+
+    return integrator_indicators(integrator, integrator->z);
+}
+
+
+/* FMUs are in event mode after fmuExitInitializationMode() */
+fmu_status_t integrator_initialize(container_t *container) {
+    integrator_t *integrator = container->integrator;
+
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        if (integrator_event(integrator, i, false) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+    }
+    integrator->h = 0.0;
+    integrator->restart = true;
+
+    return FMU_STATUS_OK;
+}
+
+
+/*----------------------------------------------------------------------------
+                                D O   S T E P
+----------------------------------------------------------------------------*/
+
+/*
+ * Locate the first state event in ]0, h] by bisection. The substep ends just after the
+ * crossing: x_next and z_next are given at this point.
+ */
+static fmu_status_t integrator_locate(const container_t *container, integrator_t *integrator, double time,
+                                      double *h) {
+    double low = 0.0;
+    double high = *h;
+    bool at_high = true;
+    double error;
+
+    for (int n = 0; (n < INTEGRATOR_EVENT_ITERATIONS) && (high - low > container->tolerance); n += 1) {
+        const double middle = (low + high) / 2.0;
+
+        if (integrator_substep(integrator, time, middle, &error) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        at_high = integrator_crossing(integrator, 0, integrator->nb_indicators);
+        if (at_high)
+            high = middle;
+        else
+            low = middle;
+    }
+
+    if (!at_high && (integrator_substep(integrator, time, high, &error) != FMU_STATUS_OK))
+        return FMU_STATUS_ERROR;
+    *h = high;
+
+    return FMU_STATUS_OK;
+}
+
+
+/* Substep accepted: FMUs which asked for it or whose indicators crossed zero handle events */
+static fmu_status_t integrator_accept(const container_t *container, integrator_t *integrator, double time) {
+    const unsigned long n = integrator->nb_states;
+    bool has_event = false;
+
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        if (fmuCompletedIntegratorStep(integrator->fmu[i], &integrator->event[i]) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        integrator->event[i] |= integrator_crossing(integrator, integrator->indicator_offset[i],
+                                                    integrator->indicator_offset[i + 1]);
+        integrator->event[i] |= integrator->next_event_time[i] <= time + container->tolerance;
+    }
+
+    memcpy(integrator->x, integrator->x_next, n * sizeof(*integrator->x));
+    memcpy(integrator->z, integrator->z_next, integrator->nb_indicators * sizeof(*integrator->z));
+    memcpy(integrator->k, integrator->k + (INTEGRATOR_NB_STAGES - 1) * n, n * sizeof(*integrator->k));
+
+    for (int i = 0; i < integrator->nb_fmu; i += 1) {
+        if (integrator->event[i]) {
+            if (integrator_event(integrator, i, true) != FMU_STATUS_OK)
+                return FMU_STATUS_ERROR;
+            has_event = true;
+        }
+    }
+
+    if (has_event)
+        return integrator_restart(integrator, time);
+
+    return FMU_STATUS_OK;
+}
+
+
+fmu_status_t integrator_do_step(container_t *container) {
+    integrator_t *integrator = container->integrator;
+    const double end_time = container->time + container->next_step;
+    const double fixed_h = container->time_step / integrator->nb_substeps;
+    double time = container->time;
+
+    if (container->next_step <= 0.0)
+        return FMU_STATUS_OK;
+
+    /*
+     * FMUs may have been restored (FMU state, early return) since last step. Otherwise, states
+     * and derivatives at the end of last step still hold unless inputs have changed meanwhile.
+     */
+    if (integrator->restart || integrator->has_inputs) {
+        if (integrator_restart(integrator, time) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+        integrator->restart = false;
+    }
+    if (integrator->h <= 0.0)
+        integrator->h = fixed_h;
+
+    while (end_time - time > container->tolerance) {
+        double h = (integrator->method == INTEGRATOR_RK45) ? integrator->h : fixed_h;
+        double h_next = h;
+        double error;
+
+        for (int i = 0; i < integrator->nb_fmu; i += 1) {
+            if (integrator->next_event_time[i] - time > container->tolerance)
+                h = fmin(h, integrator->next_event_time[i] - time);
+        }
+        h = fmin(h, end_time - time);
+
+        for (;;) {
+            if (integrator_substep(integrator, time, h, &error) != FMU_STATUS_OK)
+                return FMU_STATUS_ERROR;
+            if (error <= 1.0)
+                break;
+
+            /* RK45: substep is rejected */
+            h *= fmax(0.2, 0.9 * pow(error, -0.2));
+            h_next = h;
+            if (h < container->tolerance) {
+                logger(&container->logger, LOGGER_ERROR, "Integrator step size becomes too small (time=%e).", time);
+                return FMU_STATUS_ERROR;
+            }
+        }
+        if (integrator->method == INTEGRATOR_RK45) {
+            const double factor = (error > 0.0) ? 0.9 * pow(error, -0.2) : 5.0;
+            integrator->h = fmax(h, h_next) * fmin(5.0, factor);
+        }
+
+        if (integrator_crossing(integrator, 0, integrator->nb_indicators) &&
+            (integrator_locate(container, integrator, time, &h) != FMU_STATUS_OK))
+            return FMU_STATUS_ERROR;
+
+        time += h;
+        if (integrator_accept(container, integrator, time) != FMU_STATUS_OK)
+            return FMU_STATUS_ERROR;
+    }
+
+    return FMU_STATUS_OK;
+}
+
+
+/*----------------------------------------------------------------------------
+                         C O N F I G U R A T I O N
+----------------------------------------------------------------------------*/
+
+integrator_t *integrator_new(integrator_method_t method, int nb_substeps, double tolerance, int nb_fmu) {
+    integrator_t *integrator = calloc(1, sizeof(*integrator));
+
+    if (!integrator)
+        return NULL;
+
+    integrator->method = method;
+    integrator->nb_substeps = nb_substeps;
+    integrator->tolerance = tolerance;
+    integrator->nb_fmu = nb_fmu;
+    integrator->fmu = calloc(nb_fmu, sizeof(*integrator->fmu));
+    integrator->state_offset = calloc(nb_fmu + 1, sizeof(*integrator->state_offset));
+    integrator->indicator_offset = calloc(nb_fmu + 1, sizeof(*integrator->indicator_offset));
+    integrator->next_event_time = calloc(nb_fmu, sizeof(*integrator->next_event_time));
+    integrator->event = calloc(nb_fmu, sizeof(*integrator->event));
+    if (!integrator->fmu || !integrator->state_offset || !integrator->indicator_offset ||
+        !integrator->next_event_time || !integrator->event) {
+        integrator_free(integrator);
+        return NULL;
+    }
+
+    for (int i = 0; i < nb_fmu; i += 1)
+        integrator->next_event_time[i] = INFINITY;
+
+    return integrator;
+}
+
+
+/* Vectors are allocated once fmu, state_offset and indicator_offset are set */
+int integrator_configure(integrator_t *integrator) {
+    /* at least one slot: FMUs without states still need their outputs refreshed */
+    const unsigned long n = integrator->state_offset[integrator->nb_fmu] + 1;
+    const unsigned long nz = integrator->indicator_offset[integrator->nb_fmu] + 1;
+
+    integrator->nb_states = n - 1;
+    integrator->nb_indicators = nz - 1;
+    integrator->x = calloc(n, sizeof(*integrator->x));
+    integrator->x_stage = calloc(n, sizeof(*integrator->x_stage));
+    integrator->x_next = calloc(n, sizeof(*integrator->x_next));
+    integrator->k = calloc(INTEGRATOR_NB_STAGES * n, sizeof(*integrator->k));
+    integrator->z = calloc(nz, sizeof(*integrator->z));
+    integrator->z_next = calloc(nz, sizeof(*integrator->z_next));
+    if (!integrator->x || !integrator->x_stage || !integrator->x_next || !integrator->k ||
+        !integrator->z || !integrator->z_next)
+        return -1;
+
+    return 0;
+}
+
+
+void integrator_free(integrator_t *integrator) {
+    if (integrator) {
+        free(integrator->fmu);
+        free(integrator->state_offset);
+        free(integrator->indicator_offset);
+        free(integrator->next_event_time);
+        free(integrator->event);
+        free(integrator->x);
+        free(integrator->x_stage);
+        free(integrator->x_next);
+        free(integrator->k);
+        free(integrator->z);
+        free(integrator->z_next);
+        free(integrator);
+    }
+
+    return;
+}
@@ -0,0 +1,67 @@
+#ifndef INTEGRATOR_H
+#   define INTEGRATOR_H
+
+#	ifdef __cplusplus
+extern "C" {
+#	endif
+
+#include "container.h"
+
+/*----------------------------------------------------------------------------
+                         I N T E G R A T O R _ T
+----------------------------------------------------------------------------*/
+
+typedef enum {
+	INTEGRATOR_EULER = 0,
+	INTEGRATOR_RK4,
+	INTEGRATOR_RK45				/* Dormand-Prince 5(4) with step size control */
+} integrator_method_t;
+
+#define INTEGRATOR_NB_STAGES		7	/* of RK45. Last one is the derivative at the end of the step */
+#define INTEGRATOR_EVENT_ITERATIONS	64	/* of discrete states update and of state event location */
+
+/*
+ * Continuous states of all Model-Exchange FMUs are concatenated into one vector which is
+ * advanced by a single explicit integrator. Event indicators are concatenated the same way.
+ */
+typedef struct integrator_s {
+	integrator_method_t			method;
+	int							nb_substeps;		/* per container step. Initial substep for RK45 */
+	double						tolerance;			/* RK45: relative error (absolute near zero) */
+	double						h;					/* RK45: size of next substep */
+	bool						restart;			/* states and derivatives are read back at next step */
+	bool						has_inputs;			/* FMUs with inputs: restart at each step */
+
+	int							nb_fmu;
+	fmu_t						**fmu;				/* in declaration order */
+	unsigned long				*state_offset;		/* nb_fmu + 1: states of fmu[i] in x */
+	unsigned long				*indicator_offset;	/* nb_fmu + 1: event indicators of fmu[i] in z */
+	double						*next_event_time;	/* nb_fmu: time event, INFINITY if not defined */
+	bool						*event;				/* nb_fmu: FMUs entering event mode */
+
+	unsigned long				nb_states;
+	double						*x;					/* at current time */
+	double						*x_stage;
+	double						*x_next;			/* at the end of the substep */
+	double						*k;					/* INTEGRATOR_NB_STAGES * nb_states */
+	unsigned long				nb_indicators;
+	double						*z;					/* at current time */
+	double						*z_next;
+} integrator_t;
+
+
+/*----------------------------------------------------------------------------
+                            P R O T O T Y P E S
+----------------------------------------------------------------------------*/
+
+extern int integrator_method(const char *name);
+extern integrator_t *integrator_new(integrator_method_t method, int nb_substeps, double tolerance, int nb_fmu);
+extern int integrator_configure(integrator_t *integrator);
+extern fmu_status_t integrator_initialize(container_t *container);
+extern fmu_status_t integrator_do_step(container_t *container);
+extern void integrator_free(integrator_t *integrator);
+
+#	ifdef __cplusplus
+}
+#	endif
+#endif
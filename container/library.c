@@ -9,6 +9,7 @@
 #   include <dlfcn.h>
 #   include <unistd.h> 
 #endif
+#include <stdio.h>
 
 #include "hash.h"
 #include "library.h"
@@ -25,7 +26,7 @@ typedef enum {
     LIBRARY_DLL_OK
 } libray_status_t;
 
-static libray_status_t* libray_analyse(hash_t* dll_db, const char* filename);
+static libray_status_t* libray_analyse(const logger_t *context, hash_t* dll_db, const char* filename);
 #endif
 
 void *library_symbol(library_t library, const char *symbol_name) {
@@ -37,21 +38,21 @@ void *library_symbol(library_t library, const char *symbol_name) {
 }
 
 
-static void library_load_error(const char* library_filename) {
+static void library_load_error(const logger_t *context, const char* library_filename) {
 #ifdef WIN32
     hash_t* dll_db = hash_new();
-    libray_analyse(dll_db, library_filename);
+    libray_analyse(context, dll_db, library_filename);
     hash_free(dll_db);
 #else
-    logger(LOGGER_ERROR, "dlopen Error: %s", dlerror());
+    logger(context, LOGGER_ERROR, "dlopen Error: %s", dlerror());
 #endif
-    logger(LOGGER_ERROR, "Cannot load `%s'", library_filename);
+    logger(context, LOGGER_ERROR, "Cannot load `%s'", library_filename);
 
     return; /* Never reached */
 }
 
 
-library_t library_load(const char* library_filename) {
+library_t library_load(const logger_t *context, const char* library_filename) {
     library_t handle;
 #ifdef WIN32
     handle = LoadLibraryA(library_filename);
@@ -59,7 +60,7 @@ library_t library_load(const char* library_filename) {
     handle = dlopen(library_filename, RTLD_LAZY);	/* RTLD_LOCAL can lead to failure */
 #endif
     if (!handle)
-        library_load_error(library_filename);
+        library_load_error(context, library_filename);
 
     return handle;
 }
@@ -75,6 +76,44 @@ void library_unload(library_t library) {
     }
 }
 
+
+/*
+ * A copy of a library is loaded as a different library: its global variables are not shared
+ * with the original one.
+ */
+int library_copy(const logger_t *context, const char *from, const char *to) {
+#ifdef WIN32
+    if (!CopyFileA(from, to, FALSE)) {
+        logger(context, LOGGER_ERROR, "Cannot copy `%s' into `%s'", from, to);
+        return -1;
+    }
+#else
+    char buffer[65536];
+    size_t len;
+    int status = 0;
+
+    FILE *in = fopen(from, "rb");
+    FILE *out = fopen(to, "wb");
+    if (!in || !out)
+        status = -1;
+    while (!status && (len = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, len, out) != len)
+            status = -2;
+    }
+    if (in)
+        fclose(in);
+    if (out && fclose(out))
+        status = -3;
+    if (status) {
+        logger(context, LOGGER_ERROR, "Cannot copy `%s' into `%s'", from, to);
+        remove(to);
+        return status;
+    }
+#endif
+
+    return 0;
+}
+
 /*----------------------------------------------------------------------------
                   D E P E N D E N C I E S   A N A L Y S I S
 ----------------------------------------------------------------------------*/
@@ -140,25 +179,25 @@ static libray_status_t* libray_try_load(const char* filename) {
 }
 
 
-static void libray_log_status(const char* filename, libray_status_t* status) {
+static void libray_log_status(const logger_t *context, const char* filename, libray_status_t* status) {
     switch (*status) {
     case LIBRARY_DLL_OK:
-        logger(LOGGER_WARNING, "DLL `%s' is found.", filename);
+        logger(context, LOGGER_WARNING, "DLL `%s' is found.", filename);
         break;
     case LIBRARY_DLL_NOT_FOUND:
-        logger(LOGGER_WARNING, "DLL `%s' is not found.", filename);
+        logger(context, LOGGER_WARNING, "DLL `%s' is not found.", filename);
         break;
     case LIBRARY_DLL_MISSING_DEPENDENCIES:
-        logger(LOGGER_WARNING, "DLL `%s' has missing dependencies.", filename);
+        logger(context, LOGGER_WARNING, "DLL `%s' has missing dependencies.", filename);
         break;
     }
 }
 
 
-static void libray_analyse_deeply(hash_t* dll_db, const char* filename) {
+static void libray_analyse_deeply(const logger_t *context, hash_t* dll_db, const char* filename) {
     PLOADED_IMAGE image = ImageLoad(filename, NULL);
     if (!image) {
-        logger(LOGGER_ERROR, "Cannot ImageLoad(%s)", filename);
+        logger(context, LOGGER_ERROR, "Cannot ImageLoad(%s)", filename);
     }
     else {
         if (image->FileHeader->OptionalHeader.NumberOfRvaAndSizes >= 2) {
@@ -171,7 +210,7 @@ static void libray_analyse_deeply(hash_t* dll_db, const char* filename) {
                 if ((importDesc->TimeDateStamp == 0) && (importDesc->Name == 0))
                     break;
                 const char* dll_filename = GetPtrFromRVA(importDesc->Name, image->FileHeader, image->MappedAddress);
-                libray_analyse(dll_db, dll_filename);
+                libray_analyse(context, dll_db, dll_filename);
                 importDesc++;
             }
         }
@@ -181,24 +220,24 @@ static void libray_analyse_deeply(hash_t* dll_db, const char* filename) {
 }
 
 
-static libray_status_t* libray_analyse_really(hash_t* dll_db, const char* filename) {
+static libray_status_t* libray_analyse_really(const logger_t *context, hash_t* dll_db, const char* filename) {
     libray_status_t* status = libray_try_load(filename);
     hash_set_value(dll_db, strdup(filename), status);
     if (*status == LIBRARY_DLL_MISSING_DEPENDENCIES)
-        libray_analyse_deeply(dll_db, filename);
+        libray_analyse_deeply(context, dll_db, filename);
 
-    libray_log_status(filename, status);
+    libray_log_status(context, filename, status);
 
     return status;
 }
 
 
-static libray_status_t* libray_analyse(hash_t* dll_db, const char* filename) {
+static libray_status_t* libray_analyse(const logger_t *context, hash_t* dll_db, const char* filename) {
     libray_status_t* status;
 
     status = hash_get_value(dll_db, filename);
     if (!status)
-        status = libray_analyse_really(dll_db, filename);
+        status = libray_analyse_really(context, dll_db, filename);
 
     return status;
 }
@@ -24,9 +24,12 @@ typedef void* library_t;
                              P R O T O T Y P E S
 ----------------------------------------------------------------------------*/
 
+struct logger_s;
+
 extern void* library_symbol(library_t library, const char *symbol_name);
-extern library_t library_load(const char* library_filename);
+extern library_t library_load(const struct logger_s *context, const char* library_filename);
 extern void library_unload(library_t library);
+extern int library_copy(const struct logger_s *context, const char *from, const char *to);
 
 #	ifdef __cplusplus
 }
@@ -8,55 +8,48 @@
 
 /*
  * logger facilities conforming to FMI-2.0 and 3.0 specifications.
+ * Each container instance owns its logger context: several instances can run
+ * concurrently in the same process.
  */
 
- static struct {
-    fmu_version_t       version;
-    logger_function_t   callback;
-    void                *environment;
-    const char          *instance_name;
-    int                 debug;
-} logger_config = { 0, {NULL}, NULL, NULL, 0};
-
-
-void logger_init(fmu_version_t  version, logger_function_t callback, void *environment, const char *instance_name, int debug) {
-    logger_config.version = version;
-    logger_config.callback = callback;
-    logger_config.environment = environment;
-    logger_config.instance_name = instance_name;
-    logger_config.debug = debug;
+void logger_init(logger_t *context, fmu_version_t  version, logger_function_t callback, void *environment, const char *instance_name, int debug) {
+    context->version = version;
+    context->callback = callback;
+    context->environment = environment;
+    context->instance_name = instance_name;
+    context->debug = debug;
 
     return;
 }
 
 
-void logger_set_debug(int debug)  {
-    logger_config.debug = debug;
+void logger_set_debug(logger_t *context, int debug)  {
+    context->debug = debug;
 
     return;
 }
 
 
-int logger_get_debug(void) {
-    return logger_config.debug;
+int logger_get_debug(const logger_t *context) {
+    return context->debug;
 }
 
 
-static void logger_log(int status, const char *message) {
+static void logger_log(const logger_t *context, int status, const char *message) {
 	const char* category = "Error";
 	if (status == LOGGER_DEBUG)
 		category = "Info";
 	
-    switch(logger_config.version) {
+    switch(context->version) {
     case FMU_2:
-        logger_config.callback.logger_fmi2(logger_config.environment,
-                                           logger_config.instance_name,
-                                           status, category, "%s", message);
+        context->callback.logger_fmi2(context->environment,
+                                      context->instance_name,
+                                      status, category, "%s", message);
         break;
 
     case FMU_3:
-        logger_config.callback.logger_fmi3(logger_config.environment,
-                                           status, category, message);
+        context->callback.logger_fmi3(context->environment,
+                                      status, category, message);
         break;
 
     default: /* Normally never reached. */
@@ -67,15 +60,149 @@ static void logger_log(int status, const char *message) {
 }
 
 
-void logger(int status, const char *message, ...) {
-    if ((status != LOGGER_DEBUG) || (logger_config.debug)) {
-        va_list ap;
-        va_start(ap, message);
+/*
+ * Queue of messages logged while worker threads are running (MT mode). Any thread may
+ * push a record without lock; main thread pops them at the end of the step and calls the
+ * importer's callback. Records of one thread keep their order. If the queue is full, the
+ * record is dropped and counted.
+ */
+int logger_queue_new(logger_t *context) {
+    logger_queue_t *queue = malloc(sizeof(*queue));
+
+    if (!queue)
+        return -1;
+
+    for (unsigned long long i = 0; i < LOGGER_QUEUE_SIZE; i += 1)
+        queue->records[i].sequence = i;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->lost = 0;
+    queue->reported = 0;
+    queue->deferred = false;
+    context->queue = queue;
+
+    return 0;
+}
+
+
+void logger_queue_free(logger_t *context) {
+    free(context->queue);
+    context->queue = NULL;
+
+    return;
+}
+
+
+static logger_record_t *logger_queue_claim(logger_queue_t *queue, unsigned long long *position) {
+    unsigned long long head = thread_atomic_load(&queue->head);
+
+    for (;;) {
+        logger_record_t *record = &queue->records[head & (LOGGER_QUEUE_SIZE - 1)];
+        const long long diff = (long long)(thread_atomic_load(&record->sequence) - head);
+
+        if (diff == 0) {
+            if (thread_atomic_cas(&queue->head, head, head + 1)) {
+                *position = head;
+                return record;
+            }
+        } else if (diff < 0) {
+            thread_atomic_add(&queue->lost, 1);
+            return NULL;
+        }
+        head = thread_atomic_load(&queue->head);
+    }
+}
+
+
+static void logger_format(char *buffer, size_t size, const char *prefix, const char *message, va_list ap) {
+    size_t len = 0;
+
+    if (prefix) {
+        snprintf(buffer, size, "%s: ", prefix);
+        len = strlen(buffer);
+    }
+    vsnprintf(buffer + len, size - len, message, ap);
+
+    return;
+}
+
+
+static void logger_vmessage(const logger_t *context, int status, const char *prefix, const char *message, va_list ap) {
+    logger_queue_t *queue = context->queue;
+
+    if (queue && queue->deferred) {
+        unsigned long long position;
+        logger_record_t *record = logger_queue_claim(queue, &position);
+
+        if (record) {
+            record->status = status;
+            logger_format(record->message, sizeof(record->message), prefix, message, ap);
+            thread_atomic_store(&record->sequence, position + 1);
+        }
+    } else {
         char buffer[4096];
 
-        vsnprintf(buffer, sizeof(buffer), message, ap);
+        logger_format(buffer, sizeof(buffer), prefix, message, ap);
+        logger_log(context, status, buffer);
+    }
+
+    return;
+}
+
+
+static void logger_message(const logger_t *context, int status, const char *prefix, const char *message, ...) {
+    va_list ap;
+
+    va_start(ap, message);
+    logger_vmessage(context, status, prefix, message, ap);
+    va_end(ap);
+
+    return;
+}
+
+
+/*
+ * While deferred, messages are queued. Queue is flushed when deferral ends.
+ * Should be called by main thread when worker threads are idle.
+ */
+void logger_defer(logger_t *context, bool deferred) {
+    logger_queue_t *queue = context->queue;
+
+    if (!queue)
+        return;
+
+    queue->deferred = deferred;
+    if (deferred)
+        return;
+
+    for (;;) {
+        logger_record_t *record = &queue->records[queue->tail & (LOGGER_QUEUE_SIZE - 1)];
+
+        if (thread_atomic_load(&record->sequence) != queue->tail + 1)
+            break;
+        logger_log(context, record->status, record->message);
+        thread_atomic_store(&record->sequence, queue->tail + LOGGER_QUEUE_SIZE);
+        queue->tail += 1;
+    }
+
+    const unsigned long long lost = thread_atomic_load(&queue->lost);
+    if (lost != queue->reported) {
+        logger_message(context, LOGGER_WARNING, NULL, "Logger: %llu messages of worker threads are lost (queue is full).",
+                       lost - queue->reported);
+        queue->reported = lost;
+    }
+
+    return;
+}
+
+
+void logger(const logger_t *context, int status, const char *message, ...) {
+    if ((status != LOGGER_DEBUG) || (context->debug)) {
+        va_list ap;
+
+        va_start(ap, message);
+        logger_vmessage(context, status, NULL, message, ap);
         va_end(ap);
-        logger_log(status, buffer);                
     }
 
     return;
@@ -90,15 +217,13 @@ void logger_embedded_fmu2(void *fmu, fmi2String instanceName, fmi2Status status,
     (void)instanceName; /* unused parameter */
     (void)category; /* unused parameter */
 
-    if ((status != 0) || (logger_config.debug)) {
-        char buffer[4096];
+    const fmu_t *embedded = fmu;
+    if ((status != 0) || (embedded->logger->debug)) {
         va_list ap;
+
         va_start(ap, message);
-        snprintf(buffer, sizeof(buffer), "%s: ", ((fmu_t *)fmu)->name);
-        vsnprintf(buffer+strlen(buffer), sizeof(buffer)-strlen(buffer), message, ap);
+        logger_vmessage(embedded->logger, status, embedded->name, message, ap);
         va_end(ap);
-
-        logger_log(status, buffer);
     }
     return;
 }
@@ -107,11 +232,9 @@ void logger_embedded_fmu2(void *fmu, fmi2String instanceName, fmi2Status status,
 void logger_embedded_fmu3(void * fmu, fmi3Status status, fmi3String category, fmi3String message) {
     (void)category; /* unused parameter */
     
-    if ((status != 0) || (logger_config.debug)) {
-        char buffer[4096];
-        snprintf(buffer, sizeof(buffer), "%s: %s", ((fmu_t *)fmu)->name, message);
+    const fmu_t *embedded = fmu;
+    if ((status != 0) || (embedded->logger->debug))
+        logger_message(embedded->logger, status, embedded->name, "%s", message);
 
-        logger_log(status, buffer);
-    }
     return;
 }
@@ -23,16 +23,56 @@ typedef union {
 } logger_function_t;
 
 
+/*---------------------------------------------------------------------------
+                      L O G G E R _ Q U E U E _ T
+---------------------------------------------------------------------------*/
+
+#define LOGGER_QUEUE_SIZE   128     /* records, power of 2 */
+#define LOGGER_RECORD_SZ    1024
+
+typedef struct {
+    thread_atomic_t             sequence;   /* position + 1 once written */
+    int                         status;
+    char                        message[LOGGER_RECORD_SZ];
+} logger_record_t;
+
+typedef struct {
+    logger_record_t             records[LOGGER_QUEUE_SIZE];
+    thread_atomic_t             head;       /* next record written by any thread */
+    unsigned long long          tail;       /* next record read by main thread */
+    thread_atomic_t             lost;       /* records dropped because queue was full */
+    unsigned long long          reported;   /* lost records already reported */
+    bool                        deferred;   /* set by main thread while worker threads run */
+} logger_queue_t;
+
+
+/*---------------------------------------------------------------------------
+                            L O G G E R _ T
+---------------------------------------------------------------------------*/
+
+typedef struct logger_s {
+    fmu_version_t               version;
+    logger_function_t           callback;
+    void                        *environment;
+    const char                  *instance_name;
+    int                         debug;
+    logger_queue_t              *queue;     /* MT: messages of worker threads. NULL otherwise */
+} logger_t;
+
+
 /*----------------------------------------------------------------------------
                             P R O T O T Y P E S
 ----------------------------------------------------------------------------*/
 
-extern void logger_init(fmu_version_t version, logger_function_t callback,
+extern void logger_init(logger_t *context, fmu_version_t version, logger_function_t callback,
                         void *environment,
                         const char *instance_name, int debug);
-extern void logger_set_debug(int debug);
-extern int logger_get_debug(void);
-extern void logger(int status, const char *message, ...) __attribute__((__format__(__printf__, 2, 3)));
+extern void logger_set_debug(logger_t *context, int debug);
+extern int logger_get_debug(const logger_t *context);
+extern void logger(const logger_t *context, int status, const char *message, ...) __attribute__((__format__(__printf__, 3, 4)));
+extern int logger_queue_new(logger_t *context);
+extern void logger_queue_free(logger_t *context);
+extern void logger_defer(logger_t *context, bool deferred);
 extern void logger_embedded_fmu2(void *fmu, fmi2String instanceName,
                                  fmi2Status status, fmi2String category, fmi2String message, ...) __attribute__((__format__(__printf__, 5, 6)));
 extern void logger_embedded_fmu3(void *fmu,
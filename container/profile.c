@@ -3,7 +3,9 @@
 #else
 #	include <unistd.h>
 #endif
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "logger.h"
@@ -13,14 +15,16 @@
  * profiling routines.
  */
 
-profile_t *profile_new(void) {
+profile_t *profile_new(const logger_t *context) {
     profile_t *profile = malloc(sizeof(*profile));
 
     if (profile) {
         profile->current_tic = 0;
         profile->total_elapsed = 0.0;
+        memset(profile->phases, 0, sizeof(profile->phases));
+        memset(profile->pending, 0, sizeof(profile->pending));
     } else {
-        logger(LOGGER_ERROR, "Cannot allocate profiling structure.");
+        logger(context, LOGGER_ERROR, "Cannot allocate profiling structure.");
     }
 
     return profile;
@@ -34,36 +38,198 @@ void profile_free(profile_t *profile) {
 }
 
 
-void profile_tic(profile_t *profile) {
+profile_tic_t profile_now(void) {
 #ifdef WIN32
-	profile->current_tic = GetTickCount();
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (profile_tic_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+		   (profile_tic_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
 #else
 	struct timespec ts;
-	clock_gettime(CLOCK_REALTIME, &ts);
-	profile->current_tic = ts.tv_nsec / 1000000;
-	profile->current_tic += ts.tv_sec * 1000;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (profile_tic_t)ts.tv_sec * 1000000000ULL + (profile_tic_t)ts.tv_nsec;
 #endif
+}
+
+
+void profile_tic(profile_t *profile) {
+	profile->current_tic = profile_now();
 
 	return;
 }
 
 
 double profile_toc(profile_t *profile, double current_time) {
-	profile_tic_t now;
-	
-#ifdef WIN32
-	now = GetTickCount();
-#else
-	struct timespec ts;
-	clock_gettime(CLOCK_REALTIME, &ts);
-	now = ts.tv_nsec / 1000000;
-	now += ts.tv_sec * 1000;
-#endif
-	
-    profile->total_elapsed += (now - profile->current_tic) / 1000.0; /* seconds */
+	const profile_tic_t start = profile->current_tic;
+
+	profile_record(profile, PROFILE_DO_STEP, start);
+	profile->total_elapsed += (double)(profile->current_tic - start) / 1.0e9; /* seconds */
+
 	if (profile->total_elapsed > 1e-3)
 		return current_time / profile->total_elapsed;
 	else
 		return current_time / 1e-3;
 }
 
+
+static int profile_bucket(profile_tic_t duration) {
+	int bucket = 0;
+
+	while (duration >>= 1)
+		bucket += 1;
+
+	return bucket;
+}
+
+
+static void profile_stats_add(profile_stats_t *stats, profile_tic_t duration) {
+	if (stats->nb == 0 || duration < stats->min)
+		stats->min = duration;
+	if (duration > stats->max)
+		stats->max = duration;
+	stats->total += duration;
+	stats->nb += 1;
+	stats->histogram[profile_bucket(duration)] += 1;
+
+	return;
+}
+
+
+/*
+ * Account the duration elapsed since start. profile->current_tic is updated to
+ * the current time, so consecutive phases can be chained without extra clock reads.
+ */
+void profile_record(profile_t *profile, profile_phase_t phase, profile_tic_t start) {
+	const profile_tic_t now = profile_now();
+
+	profile_stats_add(&profile->phases[phase], now - start);
+	profile->current_tic = now;
+
+	return;
+}
+
+
+/*
+ * Some phases (event mode) are made of several calls interleaved with other FMUs.
+ * Their durations are summed and accounted as a single sample by profile_commit().
+ */
+void profile_accumulate(profile_t *profile, profile_phase_t phase, profile_tic_t start) {
+	const profile_tic_t now = profile_now();
+
+	profile->pending[phase] += now - start;
+	profile->current_tic = now;
+
+	return;
+}
+
+
+void profile_commit(profile_t *profile, profile_phase_t phase) {
+	if (profile->pending[phase]) {
+		profile_stats_add(&profile->phases[phase], profile->pending[phase]);
+		profile->pending[phase] = 0;
+	}
+
+	return;
+}
+
+
+/* 99th percentile, linearly interpolated inside the matching log2 bucket */
+static double profile_p99(const profile_stats_t *stats) {
+	const double target = 0.99 * (double)stats->nb;
+	double cumulated = 0.0;
+
+	for (int k = 0; k < PROFILE_NB_BUCKETS; k += 1) {
+		const double count = (double)stats->histogram[k];
+
+		if (count > 0.0 && cumulated + count >= target) {
+			const double lower = (k == 0) ? 0.0 : (double)(1ULL << k);
+			const double upper = (k == PROFILE_NB_BUCKETS - 1) ? (double)stats->max : (double)(1ULL << k) * 2.0;
+			double p99 = lower + (upper - lower) * (target - cumulated) / count;
+
+			if (p99 < (double)stats->min)
+				p99 = (double)stats->min;
+			if (p99 > (double)stats->max)
+				p99 = (double)stats->max;
+			return p99;
+		}
+		cumulated += count;
+	}
+
+	return (double)stats->max;
+}
+
+
+/*
+ * Write min, mean, p99 and max (in seconds) for phases [first, last[ into values.
+ */
+void profile_export(const profile_t *profile, profile_phase_t first, profile_phase_t last, double *values) {
+	for (int phase = first; phase < (int)last; phase += 1) {
+		const profile_stats_t *stats = &profile->phases[phase];
+
+		if (stats->nb) {
+			values[0] = (double)stats->min / 1.0e9;
+			values[1] = (double)stats->total / (double)stats->nb / 1.0e9;
+			values[2] = profile_p99(stats) / 1.0e9;
+			values[3] = (double)stats->max / 1.0e9;
+		} else {
+			values[0] = 0.0;
+			values[1] = 0.0;
+			values[2] = 0.0;
+			values[3] = 0.0;
+		}
+		values += PROFILE_NB_STATS;
+	}
+
+	return;
+}
+
+
+const char *profile_phase_name(profile_phase_t phase) {
+	static const char *names[PROFILE_NB_PHASES] = {
+		"set_inputs",
+		"doStep",
+		"get_outputs",
+		"convert",
+		"event",
+		"datalog"
+	};
+
+	return names[phase];
+}
+
+
+void profile_report(const logger_t *context, const profile_t *profile, const char *name) {
+	logger(context, LOGGER_WARNING, "Profiling of '%s': RT ratio is based on %.3fs spent in doStep.", name, profile->total_elapsed);
+
+	for (int phase = 0; phase < PROFILE_NB_PHASES; phase += 1) {
+		const profile_stats_t *stats = &profile->phases[phase];
+		char histogram[1024];
+		size_t len = 0;
+
+		if (!stats->nb)
+			continue;
+
+		logger(context, LOGGER_WARNING, "  %-12s n=%llu min=%.3fus mean=%.3fus p99=%.3fus max=%.3fus total=%.6fs",
+			profile_phase_name(phase), stats->nb,
+			(double)stats->min / 1.0e3,
+			(double)stats->total / (double)stats->nb / 1.0e3,
+			profile_p99(stats) / 1.0e3,
+			(double)stats->max / 1.0e3,
+			(double)stats->total / 1.0e9);
+
+		histogram[0] = '\0';
+		for (int k = 0; k < PROFILE_NB_BUCKETS && len < sizeof(histogram); k += 1) {
+			if (stats->histogram[k])
+				len += snprintf(histogram + len, sizeof(histogram) - len, " 2^%d:%llu", k, stats->histogram[k]);
+		}
+		logger(context, LOGGER_WARNING, "  %-12s histogram (ns):%s", "", histogram);
+	}
+
+	return;
+}
@@ -5,11 +5,45 @@
 extern "C" {
 #	endif
 
+#include <stdint.h>
+
 /*-----------------------------------------------------------------------------
                           P R O F I L E _ T I C _T
 -----------------------------------------------------------------------------*/
 
-typedef unsigned int profile_tic_t;
+typedef uint64_t profile_tic_t;             /* ns, monotonic clock */
+
+
+/*-----------------------------------------------------------------------------
+                        P R O F I L E _ P H A S E _ T
+-----------------------------------------------------------------------------*/
+
+typedef enum {
+    PROFILE_SET_INPUTS = 0,
+    PROFILE_DO_STEP,
+    PROFILE_GET_OUTPUTS,
+    PROFILE_CONVERT,
+    PROFILE_EVENT,
+    PROFILE_DATALOG,                        /* container only */
+    PROFILE_NB_PHASES
+} profile_phase_t;
+
+#define PROFILE_NB_FMU_PHASES   PROFILE_DATALOG /* phases exported for each embedded FMU */
+#define PROFILE_NB_STATS        4           /* min, mean, p99, max */
+#define PROFILE_NB_BUCKETS      64          /* bucket k holds durations in [2^k, 2^(k+1)[ ns */
+
+
+/*-----------------------------------------------------------------------------
+                        P R O F I L E _ S T A T S _ T
+-----------------------------------------------------------------------------*/
+
+typedef struct {
+    unsigned long long  nb;
+    profile_tic_t       total;              /* ns */
+    profile_tic_t       min;                /* ns */
+    profile_tic_t       max;                /* ns */
+    unsigned long long  histogram[PROFILE_NB_BUCKETS];
+} profile_stats_t;
 
 
 /*-----------------------------------------------------------------------------
@@ -17,8 +51,10 @@ typedef unsigned int profile_tic_t;
 -----------------------------------------------------------------------------*/
 
 typedef struct {
-    profile_tic_t   current_tic;            /* ms */
+    profile_tic_t   current_tic;            /* ns */
     double          total_elapsed;          /* s */
+    profile_stats_t phases[PROFILE_NB_PHASES];
+    profile_tic_t   pending[PROFILE_NB_PHASES]; /* ns, accumulated until profile_commit() */
 } profile_t;
 
 
@@ -26,10 +62,19 @@ typedef struct {
                             P R O T O T Y P E S
 ----------------------------------------------------------------------------*/
 
-extern profile_t *profile_new(void);
+struct logger_s;
+
+extern profile_t *profile_new(const struct logger_s *context);
 extern void profile_free(profile_t *profile);
+extern profile_tic_t profile_now(void);
 extern void profile_tic(profile_t *profile);
 extern double profile_toc(profile_t *profile, double current_time);
+extern void profile_record(profile_t *profile, profile_phase_t phase, profile_tic_t start);
+extern void profile_accumulate(profile_t *profile, profile_phase_t phase, profile_tic_t start);
+extern void profile_commit(profile_t *profile, profile_phase_t phase);
+extern void profile_export(const profile_t *profile, profile_phase_t first, profile_phase_t last, double *values);
+extern void profile_report(const struct logger_s *context, const profile_t *profile, const char *name);
+extern const char *profile_phase_name(profile_phase_t phase);
 
 #	ifdef __cplusplus
 }
@@ -1,3 +1,8 @@
+#ifndef WIN32
+#   include <sched.h>
+#   include <unistd.h>
+#endif
+
 #include "thread.h"
 
 /*
@@ -34,6 +39,30 @@ void thread_join(thread_t thread) {
 }
 
 
+int thread_nb_cpu(void) {
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const int nb_cpu = (int)info.dwNumberOfProcessors;
+#else
+    const int nb_cpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return (nb_cpu > 0) ? nb_cpu : 1;
+}
+
+
+/* Give the CPU to another thread while busy waiting */
+void thread_yield(void) {
+#ifdef WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+
+    return;
+}
+
+
 mutex_t thread_mutex_new(void) {
 #ifdef WIN32
     return CreateEventA(NULL, FALSE, FALSE, NULL);
@@ -77,3 +106,46 @@ void thread_mutex_unlock(mutex_t *mutex) {
 
     return;
 }
+
+
+/*
+ * Atomic counters: load has acquire semantic, store has release semantic.
+ */
+unsigned long long thread_atomic_load(thread_atomic_t *atomic) {
+#ifdef WIN32
+    return (unsigned long long)InterlockedOr64(atomic, 0);
+#else
+    return __atomic_load_n(atomic, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+void thread_atomic_store(thread_atomic_t *atomic, unsigned long long value) {
+#ifdef WIN32
+    InterlockedExchange64(atomic, (LONG64)value);
+#else
+    __atomic_store_n(atomic, value, __ATOMIC_RELEASE);
+#endif
+
+    return;
+}
+
+
+bool thread_atomic_cas(thread_atomic_t *atomic, unsigned long long expected, unsigned long long desired) {
+#ifdef WIN32
+    return InterlockedCompareExchange64(atomic, (LONG64)desired, (LONG64)expected) == (LONG64)expected;
+#else
+    return __atomic_compare_exchange_n(atomic, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+void thread_atomic_add(thread_atomic_t *atomic, unsigned long long value) {
+#ifdef WIN32
+    InterlockedExchangeAdd64(atomic, (LONG64)value);
+#else
+    __atomic_fetch_add(atomic, value, __ATOMIC_RELAXED);
+#endif
+
+    return;
+}
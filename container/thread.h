@@ -11,12 +11,16 @@ extern "C" {
 #       include <pthread.h>
 #   endif
 
+#   include <stdbool.h>
+
 #   ifdef WIN32
 typedef HANDLE          thread_t;
 typedef HANDLE          mutex_t;
+typedef volatile LONG64 thread_atomic_t;
 #   else
 typedef pthread_t       thread_t;
 typedef pthread_mutex_t mutex_t;
+typedef unsigned long long thread_atomic_t;
 #   endif
 
 typedef void *(*thread_function_t)(void *);
@@ -27,10 +31,16 @@ typedef void *(*thread_function_t)(void *);
 
 extern thread_t thread_new(thread_function_t function, void *data);
 extern void thread_join(thread_t thread);
+extern int thread_nb_cpu(void);
+extern void thread_yield(void);
 extern mutex_t thread_mutex_new(void);
 extern void thread_mutex_free(mutex_t *mutex);
 extern void thread_mutex_lock(mutex_t *mutex);
 extern void thread_mutex_unlock(mutex_t *mutex);
+extern unsigned long long thread_atomic_load(thread_atomic_t *atomic);
+extern void thread_atomic_store(thread_atomic_t *atomic, unsigned long long value);
+extern bool thread_atomic_cas(thread_atomic_t *atomic, unsigned long long expected, unsigned long long desired);
+extern void thread_atomic_add(thread_atomic_t *atomic, unsigned long long value);
 
 #	ifdef __cplusplus
 }
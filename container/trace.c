@@ -0,0 +1,239 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "container.h"
+#include "logger.h"
+#include "trace.h"
+
+/*
+ * Execution tracing. Each thread records begin/end events in its own ring buffer
+ * (no locking). At terminate, all buffers are merged and written as Chrome
+ * trace-event JSON which can be opened with Perfetto or chrome://tracing.
+ */
+
+#define TRACE_DEFAULT_SIZE      65536
+
+
+/*
+ * # Trace filename
+ * container-trace.json
+ * # Number of events per thread (ring buffer)
+ * 65536
+ */
+trace_t *trace_new(const logger_t *context, const char *dirname, int nb_fmu) {
+    config_file_t config;
+    unsigned long size = TRACE_DEFAULT_SIZE;
+
+    if (config_file_open(&config, context, dirname, "trace.txt"))
+        return NULL;
+
+    logger(context, LOGGER_WARNING, "Container enable TRACE.");
+
+    if (get_line(&config)) {
+        logger(context, LOGGER_ERROR, "Cannot determine trace file name");
+        config_file_close(&config);
+        return NULL;
+    }
+
+    trace_t *trace = malloc(sizeof(*trace));
+    if (!trace) {
+        logger(context, LOGGER_ERROR, "Cannot allocate trace memory.");
+        config_file_close(&config);
+        return NULL;
+    }
+    trace->filename = strdup(config.line);
+    trace->nb_buffers = 0;
+    trace->buffers = NULL;
+    trace->written = 0;
+
+    if (!get_line(&config) && sscanf(config.line, "%lu", &size) == 1 && size == 0)
+        size = TRACE_DEFAULT_SIZE;
+    config_file_close(&config);
+
+    trace->buffers = calloc(nb_fmu + 1, sizeof(*trace->buffers));
+    if (!trace->filename || !trace->buffers) {
+        logger(context, LOGGER_ERROR, "Cannot allocate trace memory.");
+        trace_free(trace);
+        return NULL;
+    }
+    trace->nb_buffers = nb_fmu + 1;
+
+    for (int i = 0; i < trace->nb_buffers; i += 1) {
+        trace->buffers[i].size = size;
+        trace->buffers[i].nb = 0;
+        trace->buffers[i].events = malloc(size * sizeof(*trace->buffers[i].events));
+        if (!trace->buffers[i].events) {
+            logger(context, LOGGER_ERROR, "Cannot allocate trace buffer of %lu events.", size);
+            trace_free(trace);
+            return NULL;
+        }
+    }
+
+    trace->origin = profile_now();
+    logger(context, LOGGER_DEBUG, "Trace will be written to '%s' (%lu events per thread)", trace->filename, size);
+
+    return trace;
+}
+
+
+void trace_free(trace_t *trace) {
+    if (trace) {
+        if (trace->buffers) {
+            for (int i = 0; i < trace->nb_buffers; i += 1)
+                free(trace->buffers[i].events);
+            free(trace->buffers);
+        }
+        free(trace->filename);
+        free(trace);
+    }
+
+    return;
+}
+
+
+void trace_event(trace_buffer_t *buffer, char phase, int track, const char *name, unsigned int arg, double value) {
+    trace_event_t *event = &buffer->events[buffer->nb % buffer->size];
+
+    event->time = profile_now();
+    event->name = name;
+    event->track = track;
+    event->phase = phase;
+    event->arg = arg;
+    event->value = value;
+    buffer->nb += 1;
+
+    return;
+}
+
+
+typedef struct {
+    const trace_event_t         *event;
+    unsigned long long          order;
+} trace_entry_t;
+
+
+static int trace_compare(const void *a, const void *b) {
+    const trace_entry_t *entry_a = a;
+    const trace_entry_t *entry_b = b;
+
+    if (entry_a->event->time != entry_b->event->time)
+        return (entry_a->event->time < entry_b->event->time) ? -1 : 1;
+    if (entry_a->order != entry_b->order)
+        return (entry_a->order < entry_b->order) ? -1 : 1;
+    return 0;
+}
+
+
+void trace_write_string(FILE *fp, const char *string) {
+    fputc('"', fp);
+    for (; *string; string += 1) {
+        if (*string == '"' || *string == '\\')
+            fputc('\\', fp);
+        if ((unsigned char)*string >= 0x20)
+            fputc(*string, fp);
+    }
+    fputc('"', fp);
+
+    return;
+}
+
+
+static void trace_write_track(FILE *fp, int track, const char *name) {
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", track);
+    trace_write_string(fp, name);
+    fprintf(fp, "}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}},\n",
+            track, track);
+
+    return;
+}
+
+
+int trace_write(trace_t *trace, const container_t *container) {
+    if (!trace || trace->written)
+        return 0;
+    trace->written = 1;
+
+    /* Merge ring buffers */
+    size_t nb_entries = 0;
+    for (int i = 0; i < trace->nb_buffers; i += 1) {
+        const trace_buffer_t *buffer = &trace->buffers[i];
+        nb_entries += (buffer->nb < buffer->size) ? buffer->nb : buffer->size;
+    }
+
+    trace_entry_t *entries = malloc(nb_entries * sizeof(*entries) + 1);
+    const int nb_tracks = TRACE_TRACK_FMU + container->nb_fmu;
+    int *depth = calloc(nb_tracks, sizeof(*depth));
+    if (!entries || !depth) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot allocate memory to write trace.");
+        free(entries);
+        free(depth);
+        return -1;
+    }
+
+    size_t pos = 0;
+    for (int i = 0; i < trace->nb_buffers; i += 1) {
+        const trace_buffer_t *buffer = &trace->buffers[i];
+        unsigned long long first = (buffer->nb < buffer->size) ? 0 : buffer->nb - buffer->size;
+
+        if (first > 0)
+            logger(&container->logger, LOGGER_WARNING, "Trace: %llu oldest events of thread #%d are lost.", first, i);
+
+        for (unsigned long long j = first; j < buffer->nb; j += 1) {
+            entries[pos].event = &buffer->events[j % buffer->size];
+            entries[pos].order = ((unsigned long long)i << 48) + j;
+            pos += 1;
+        }
+    }
+    qsort(entries, nb_entries, sizeof(*entries), trace_compare);
+
+    FILE *fp = fopen(trace->filename, "wt");
+    if (!fp) {
+        logger(&container->logger, LOGGER_ERROR, "Cannot open trace file '%s': %s", trace->filename, strerror(errno));
+        free(entries);
+        free(depth);
+        return -2;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":");
+    trace_write_string(fp, container->instance_name);
+    fprintf(fp, "}},\n");
+    trace_write_track(fp, TRACE_TRACK_STEPS, "container steps");
+    trace_write_track(fp, TRACE_TRACK_EVENTS, "event iterations");
+    trace_write_track(fp, TRACE_TRACK_CLOCKS, "clock ticks");
+    for (int i = 0; i < container->nb_fmu; i += 1)
+        trace_write_track(fp, TRACE_TRACK_FMU + i, container->fmu[i].name);
+
+    for (size_t i = 0; i < nb_entries; i += 1) {
+        const trace_event_t *event = entries[i].event;
+
+        /* Begin event may have been overwritten in ring buffer */
+        if (event->phase == TRACE_BEGIN)
+            depth[event->track] += 1;
+        else if (event->phase == TRACE_END) {
+            if (depth[event->track] == 0)
+                continue;
+            depth[event->track] -= 1;
+        }
+
+        fprintf(fp, "{\"name\":");
+        trace_write_string(fp, event->name);
+        fprintf(fp, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", event->phase,
+                (double)(event->time - trace->origin) / 1.0e3, event->track);
+        if (event->phase == TRACE_INSTANT)
+            fprintf(fp, ",\"s\":\"t\",\"args\":{\"vr\":%u,\"interval\":%.17g}", event->arg, event->value);
+        fprintf(fp, "},\n");
+    }
+    /* Chrome format does not allow trailing comma: close with a metadata event */
+    fprintf(fp, "{\"name\":\"trace_end\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{}}\n]}\n");
+    fclose(fp);
+
+    logger(&container->logger, LOGGER_WARNING, "Trace written to '%s' (%zu events).", trace->filename, nb_entries);
+
+    free(entries);
+    free(depth);
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#	ifdef __cplusplus
+extern "C" {
+#	endif
+
+#include <stdio.h>
+
+#include "profile.h"
+
+/*----------------------------------------------------------------------------
+                           T R A C E _ E V E N T _ T
+----------------------------------------------------------------------------*/
+
+#define TRACE_BEGIN             'B'
+#define TRACE_END               'E'
+#define TRACE_INSTANT           'i'
+
+#define TRACE_TRACK_STEPS       0       /* container internal steps */
+#define TRACE_TRACK_EVENTS      1       /* event mode and event iterations */
+#define TRACE_TRACK_CLOCKS      2       /* scheduled clock ticks */
+#define TRACE_TRACK_FMU         3       /* first track of embedded FMUs */
+
+typedef struct {
+    profile_tic_t               time;   /* ns */
+    const char                  *name;  /* static string or FMU name */
+    int                         track;
+    char                        phase;  /* TRACE_BEGIN, TRACE_END or TRACE_INSTANT */
+    unsigned int                arg;    /* clock ticks: FMU value reference */
+    double                      value;  /* clock ticks: interval */
+} trace_event_t;
+
+
+/*----------------------------------------------------------------------------
+                          T R A C E _ B U F F E R _ T
+----------------------------------------------------------------------------*/
+
+/* Ring buffer written by a single thread. Oldest events are overwritten. */
+typedef struct {
+    unsigned long               size;
+    unsigned long long          nb;     /* total number of recorded events */
+    trace_event_t               *events;
+} trace_buffer_t;
+
+
+/*----------------------------------------------------------------------------
+                                 T R A C E _ T
+----------------------------------------------------------------------------*/
+
+typedef struct trace_s {
+    char                        *filename;
+    profile_tic_t               origin;
+    int                         nb_buffers;  /* buffers[0] is main thread, buffers[1+i] is thread of FMU#i */
+    trace_buffer_t              *buffers;
+    int                         written;
+} trace_t;
+
+
+/*----------------------------------------------------------------------------
+                            P R O T O T Y P E S
+----------------------------------------------------------------------------*/
+
+struct container_s;
+struct logger_s;
+
+extern trace_t *trace_new(const struct logger_s *context, const char *dirname, int nb_fmu);
+extern void trace_free(trace_t *trace);
+extern void trace_event(trace_buffer_t *buffer, char phase, int track, const char *name,
+                        unsigned int arg, double value);
+extern int trace_write(trace_t *trace, const struct container_s *container);
+extern void trace_write_string(FILE *fp, const char *string);
+
+#	ifdef __cplusplus
+}
+#	endif
+#endif
@@ -40,11 +40,13 @@ class Connection:
     Attributes:
         from_port (Port): Source port of the connection.
         to_port (Port): Destination port of the connection.
+        extrapolation (int): Order of extrapolation of the link in parallel modes.
     """
 
-    def __init__(self, from_port: Port, to_port: Port):
+    def __init__(self, from_port: Port, to_port: Port, extrapolation: int = 0):
         self.from_port = from_port
         self.to_port = to_port
+        self.extrapolation = extrapolation
 
     def __str__(self):
         return f"{self.from_port} -> {self.to_port}"
@@ -63,7 +65,7 @@ class AssemblyNode:
         name (str | None): Output filename for the container (e.g. `"container.fmu"`).
         step_size (float | None): Internal fixed time step in seconds, or `None` to deduce
             from embedded FMUs.
-        mt (bool): Whether multithreaded mode is enabled.
+        mt (bool | str): Whether multithreaded mode is enabled. `"auto"` selects it at runtime.
         profiling (bool): Whether profiling mode is enabled.
         sequential (bool): Whether sequential scheduling is used.
         auto_link (bool): Automatically link ports with matching names and types.
@@ -72,6 +74,15 @@ class AssemblyNode:
         auto_parameter (bool): Automatically expose parameters of embedded FMUs.
         auto_local (bool): Automatically expose local variables of embedded FMUs.
         ts_multiplier (bool): Add a `TS_MULTIPLIER` input port to control step size dynamically.
+        adaptive (list[float] | None): `[min_step, max_step, tolerance]` of the adaptive internal step,
+            or `None` for a fixed internal step.
+        integrator (str | None): `"METHOD[:PARAM]"` integrating the FMUs embedded in Model Exchange
+            (`euler`, `rk4` or `rk45`), or `None` for the default integrator.
+        max_lag (int | None): Maximum lag, in internal steps, of the asynchronous mode (multithreaded mode
+            only), or `None` to synchronize all FMUs at each internal step.
+        waveform (list | None): `[window, max_iterations, tolerance]` of the waveform relaxation, or `None`
+            to synchronize all FMUs at each internal step.
+        early_return (bool): Allow embedded FMUs to return early from their step.
         parent (AssemblyNode | None): Parent node in a hierarchical assembly, or `None` for root.
         children (dict[str, AssemblyNode]): Sub-container nodes, keyed by name.
         fmu_names_list (list[str]): Ordered list of embedded FMU filenames.
@@ -84,7 +95,8 @@ class AssemblyNode:
 
     def __init__(self, name: str, step_size: float = None, mt=False, profiling=False, sequential=False,
                  auto_link=True, auto_input=True, auto_output=True, auto_parameter=False, auto_local=False,
-                 ts_multiplier=False):
+                 ts_multiplier=False, adaptive=None, integrator=None, max_lag=None, waveform=None,
+                 early_return=False):
         self.name = name
         if step_size:
             try:
@@ -103,6 +115,11 @@ class AssemblyNode:
         self.auto_parameter = auto_parameter
         self.auto_local = auto_local
         self.ts_multiplier = ts_multiplier
+        self.adaptive = adaptive
+        self.integrator = integrator
+        self.max_lag = max_lag
+        self.waveform = waveform
+        self.early_return = early_return
 
         self.parent: Optional[AssemblyNode] = None
         self.children: Dict[str, AssemblyNode] = {}     # sub-containers
@@ -174,7 +191,8 @@ class AssemblyNode:
         """
         self.drop_ports.append(Port(fmu_filename, port_name))
 
-    def add_link(self, from_fmu_filename: str, from_port_name: str, to_fmu_filename: str, to_port_name: str):
+    def add_link(self, from_fmu_filename: str, from_port_name: str, to_fmu_filename: str, to_port_name: str,
+                 extrapolation: int = 0):
         """Connect an output port of one embedded FMU to an input port of another.
 
         Args:
@@ -182,9 +200,11 @@ class AssemblyNode:
             from_port_name (str): Name of the output port on the source FMU.
             to_fmu_filename (str): Filename of the destination FMU.
             to_port_name (str): Name of the input port on the destination FMU.
+            extrapolation (int): Order (0, 1 or 2) of extrapolation of the link in
+                parallel modes. Float64 links only.
         """
         self.links.append(Connection(Port(from_fmu_filename, from_port_name),
-                          Port(to_fmu_filename, to_port_name)))
+                          Port(to_fmu_filename, to_port_name), extrapolation=int(extrapolation)))
 
     def add_start_value(self, fmu_filename: str, port_name: str, value: str):
         """Set a start value for a port of an embedded FMU.
@@ -197,7 +217,7 @@ class AssemblyNode:
         self.start_values[Port(fmu_filename, port_name)] = value
 
     def make_fmu(self, fmu_directory: Path, debug=False, description_pathname=None, fmi_version=2, datalog=False,
-                 filename=None):
+                 filename=None, trace=False, schedule=None, snapshot=None):
         """Build the FMU Container.
 
         Recursively builds any child containers first, then creates the container FMU
@@ -215,6 +235,12 @@ class AssemblyNode:
             datalog (bool): If `True`, generate a datalog configuration file inside
                 the container.
             filename (str | None): Override the output filename. Defaults to `name`.
+            trace (bool): If `True`, generate a trace configuration file inside
+                the container.
+            schedule (str | Path | None): Profile of a previous run used to schedule the
+                embedded FMUs. Sub-containers are not affected.
+            snapshot (str | Path | None): Serialized state of a previous instance of this
+                container, restored at the end of its initialization. Sub-containers are not affected.
         """
         for node in self.children.values():
             node.make_fmu(fmu_directory, debug=debug, fmi_version=fmi_version)
@@ -237,7 +263,7 @@ class AssemblyNode:
 
         for link in self.links:
             container.add_link(link.from_port.fmu_name, link.from_port.port_name,
-                               link.to_port.fmu_name, link.to_port.port_name)
+                               link.to_port.fmu_name, link.to_port.port_name, extrapolation=link.extrapolation)
 
         for drop in self.drop_ports:
             container.drop_port(drop.fmu_name, drop.port_name)
@@ -261,7 +287,10 @@ class AssemblyNode:
             filename = self.name
 
         container.make_fmu(filename, self.step_size, mt=self.mt, profiling=self.profiling, sequential=self.sequential,
-                           debug=debug, ts_multiplier=self.ts_multiplier, datalog=datalog)
+                           debug=debug, ts_multiplier=self.ts_multiplier, datalog=datalog,
+                           trace=trace, schedule=schedule, snapshot=snapshot, adaptive=self.adaptive,
+                           integrator=self.integrator, max_lag=self.max_lag, waveform=self.waveform,
+                           early_return=self.early_return)
 
         for node in self.children.values():
             logger.info(f"Deleting transient FMU Container '{node.name}'")
@@ -410,7 +439,9 @@ class Assembly:
     def __init__(self, filename: Union[str, Path] = None, default_step_size=None, default_auto_link=True,
                  default_auto_input=True, debug=False, default_sequential=False, default_auto_output=True,
                  default_mt=False, default_profiling=False, fmu_directory: Path = Path("."),
-                 default_auto_parameter=False, default_auto_local=False, default_ts_multiplier=False):
+                 default_auto_parameter=False, default_auto_local=False, default_ts_multiplier=False,
+                 default_adaptive=None, default_integrator=None, default_max_lag=None, default_waveform=None,
+                 default_early_return=False):
         self.filename = Path(filename) if filename else None
         self.default_auto_input = default_auto_input
         self.debug = debug
@@ -423,6 +454,11 @@ class Assembly:
         self.default_sequential = default_sequential
         self.default_profiling = default_profiling
         self.default_ts_multiplier = default_ts_multiplier
+        self.default_adaptive = default_adaptive
+        self.default_integrator = default_integrator
+        self.default_max_lag = default_max_lag
+        self.default_waveform = default_waveform
+        self.default_early_return = default_early_return
         self.fmu_directory = fmu_directory
 
         if not fmu_directory.is_dir():
@@ -482,7 +518,10 @@ class Assembly:
                                  mt=self.default_mt, profiling=self.default_profiling,
                                  sequential=self.default_sequential, auto_input=self.default_auto_input,
                                  auto_output=self.default_auto_output, auto_parameter=self.default_auto_parameter,
-                                 auto_local=self.default_auto_local, ts_multiplier=self.default_ts_multiplier)
+                                 auto_local=self.default_auto_local, ts_multiplier=self.default_ts_multiplier,
+                                 adaptive=self.default_adaptive, integrator=self.default_integrator,
+                                 max_lag=self.default_max_lag, waveform=self.default_waveform,
+                                 early_return=self.default_early_return)
 
         with open(self.input_pathname) as file:
             reader = csv.reader(file, delimiter=';')
@@ -605,15 +644,28 @@ class Assembly:
         auto_local = data.get("auto_local", self.default_auto_local)                        # 6c
         step_size = data.get("step_size", self.default_step_size)                           # 7
         ts_multiplier = data.get("ts_multiplier", self.default_ts_multiplier)               # 7b
+        adaptive = data.get("adaptive", self.default_adaptive)                              # 7c
+        if adaptive is not None and (not isinstance(adaptive, list) or len(adaptive) != 3):
+            raise AssemblyError("JSON: 'adaptive' keyword should define [min_step, max_step, tolerance].")
+        integrator = data.get("integrator", self.default_integrator)                        # 7d
+        max_lag = data.get("max_lag", self.default_max_lag)                                 # 7e
+        if max_lag is not None and (not isinstance(max_lag, int) or max_lag < 0):
+            raise AssemblyError("JSON: 'max_lag' keyword should define a positive or null integer.")
+        waveform = data.get("waveform", self.default_waveform)                              # 7f
+        if waveform is not None and (not isinstance(waveform, list) or len(waveform) != 3):
+            raise AssemblyError("JSON: 'waveform' keyword should define [window, max_iterations, tolerance].")
+        early_return = data.get("early_return", self.default_early_return)                  # 7g
 
         node = AssemblyNode(name, step_size=step_size, auto_link=auto_link, mt=mt, profiling=profiling,
                             sequential=sequential,
                             auto_input=auto_input, auto_output=auto_output, auto_parameter=auto_parameter,
-                            auto_local=auto_local, ts_multiplier=ts_multiplier)
+                            auto_local=auto_local, ts_multiplier=ts_multiplier, adaptive=adaptive,
+                            integrator=integrator, max_lag=max_lag, waveform=waveform, early_return=early_return)
 
         for key, value in data.items():
             if key in ('name', 'step_size', 'auto_link', 'auto_input', 'auto_output', 'mt', 'profiling', 'sequential',
-                       'auto_parameter', 'auto_local', 'ts_multiplier'):
+                       'auto_parameter', 'auto_local', 'ts_multiplier', 'adaptive', 'integrator',
+                       'max_lag', 'waveform', 'early_return'):
                 continue  # Already read
 
             elif key == "container":  # 8
@@ -695,6 +747,21 @@ class Assembly:
         if node.ts_multiplier:
             json_node["ts_multiplier"] = node.ts_multiplier # 7b
 
+        if node.adaptive:
+            json_node["adaptive"] = list(node.adaptive)    # 7c
+
+        if node.integrator:
+            json_node["integrator"] = node.integrator      # 7d
+
+        if node.max_lag is not None:
+            json_node["max_lag"] = node.max_lag            # 7e
+
+        if node.waveform:
+            json_node["waveform"] = list(node.waveform)    # 7f
+
+        if node.early_return:
+            json_node["early_return"] = node.early_return  # 7g
+
         if node.children:
             json_node["container"] = [self._json_encode_node(child) for child in node.children.values()]  # 8
 
@@ -711,7 +778,8 @@ class Assembly:
 
         if node.links:
             json_node["link"] = [[f"{link.from_port.fmu_name}", f"{link.from_port.port_name}",      # 12
-                                  f"{link.to_port.fmu_name}", f"{link.to_port.port_name}"]
+                                  f"{link.to_port.fmu_name}", f"{link.to_port.port_name}"] +
+                                 ([link.extrapolation] if link.extrapolation else [])
                                  for link in node.links]
 
         if node.start_values:
@@ -756,7 +824,8 @@ class Assembly:
             else:
                 raise AssemblyError(f"'SystemStructure.ssd' file not found in '{self.fmu_directory / self.filename}'")
 
-    def make_fmu(self, dump_json=False, fmi_version=2, datalog=False, filename=None):
+    def make_fmu(self, dump_json=False, fmi_version=2, datalog=False, filename=None, trace=False, schedule=None,
+                 snapshot=None):
         """Build the FMU Container from the loaded assembly.
 
         Args:
@@ -764,9 +833,15 @@ class Assembly:
             fmi_version (int): FMI version for the container interface (`2` or `3`).
             datalog (bool): If `True`, enable data logging inside the container.
             filename (str | None): Override the output filename.
+            trace (bool): If `True`, record a Chrome trace of the container execution.
+            schedule (str | Path | None): Profile written by a previous run of the container
+                (profiling enabled) to optimize the scheduling of embedded FMUs.
+            snapshot (str | Path | None): Serialized state of a previous instance of the container
+                (warm-start).
         """
         self.root.make_fmu(self.fmu_directory, debug=self.debug, description_pathname=self.description_pathname,
-                           fmi_version=fmi_version, datalog=datalog, filename=filename)
+                           fmi_version=fmi_version, datalog=datalog, filename=filename, trace=trace,
+                           schedule=schedule, snapshot=snapshot)
         if dump_json:
             dump_file = Path(self.input_pathname.stem + "-dump").with_suffix(".json")
             logger.info(f"Dump Json '{dump_file}'")
@@ -61,20 +61,76 @@ def fmucontainer():
     parser.add_argument("-mt", action="store_true", dest="mt", default=False,
                         help="Enable Multi-Threaded mode for the generated container.")
 
+    parser.add_argument("-auto-mt", action="store_const", dest="mt", const="auto",
+                        help="Let the generated container select Mono or Multi-Threaded mode at runtime.")
+
     parser.add_argument("-profile", action="store_true", dest="profiling", default=False,
                         help="Enable Profiling mode for the generated container.")
 
+    parser.add_argument("-schedule", action="store", dest="schedule", default=None, metavar="PROFILE",
+                        help="Schedule embedded fmu's according to the profile (JSON) written by a previous run "
+                             "of the container built with -profile.")
+
+    parser.add_argument("-snapshot", action="store", dest="snapshot", default=None, metavar="FILE",
+                        help="Restart the generated container from the serialized state of a previous run "
+                             "of the same container.")
+
     parser.add_argument("-sequential", action="store_true", dest="sequential", default=False,
                         help="Use sequential mode to schedule embedded fmu's.")
 
+    parser.add_argument("-trace", action="store_true", dest="trace", default=False,
+                        help="Record execution trace of the container (Chrome trace-event JSON).")
+
     parser.add_argument("-vr", action="store_true", dest="ts_multiplier", default=False,
                         help="Add TS_MULTIPLIER input port to control step_size")
 
+    parser.add_argument("-adaptive", action="store", dest="adaptive", default=None, metavar="MIN:MAX:TOL",
+                        help="Adapt internal step between MIN and MAX seconds to keep the coupling error "
+                             "below TOL.")
+
+    parser.add_argument("-integrator", action="store", dest="integrator", default=None, metavar="METHOD[:PARAM]",
+                        help="Integrate FMUs embedded in Model Exchange with euler[:SUBSTEPS], rk4[:SUBSTEPS] "
+                             "or rk45[:TOLERANCE]. Default is rk4.")
+
+    parser.add_argument("-async", action="store", dest="max_lag", default=None, type=int, metavar="MAX_LAG",
+                        help="Step FMUs asynchronously in multithreaded mode: inputs may lag by MAX_LAG "
+                             "internal steps at most.")
+
+    parser.add_argument("-waveform", action="store", dest="waveform", default=None, metavar="WINDOW:ITER:TOL",
+                        help="Simulate FMUs in parallel over windows of WINDOW seconds, iterated up to ITER times "
+                             "until their outputs converge within TOL.")
+
+    parser.add_argument("-early-return", action="store_true", dest="early_return", default=False,
+                        help="Allow embedded FMUs to return early from their step.")
+
     config = parser.parse_args(sys.argv[1:])
 
     if config.debug:
         logger.setLevel(logging.DEBUG)
 
+    adaptive = None
+    if config.adaptive:
+        try:
+            adaptive = [float(token) for token in config.adaptive.split(":")]
+        except ValueError:
+            adaptive = []
+        if len(adaptive) != 3:
+            logger.fatal(f"Adaptive step '{config.adaptive}' should be MIN:MAX:TOL.")
+            close_logger(logger)
+            sys.exit(-1)
+
+    waveform = None
+    if config.waveform:
+        try:
+            tokens = config.waveform.split(":")
+            waveform = [float(tokens[0]), int(tokens[1]), float(tokens[2])]
+            if len(tokens) != 3:
+                raise ValueError
+        except (ValueError, IndexError):
+            logger.fatal(f"Waveform relaxation '{config.waveform}' should be WINDOW:ITER:TOL.")
+            close_logger(logger)
+            sys.exit(-1)
+
     fmu_directory = Path(config.fmu_directory)
     logger.info(f"FMU directory: '{fmu_directory}'")
 
@@ -92,7 +148,10 @@ def fmucontainer():
                                 default_auto_input=config.auto_input, default_auto_output=config.auto_output,
                                 default_auto_local=config.auto_local, default_mt=config.mt, default_sequential=config.sequential,
                                 default_profiling=config.profiling, fmu_directory=fmu_directory, debug=config.debug,
-                                default_auto_parameter=config.auto_parameter, default_ts_multiplier=config.ts_multiplier)
+                                default_auto_parameter=config.auto_parameter, default_ts_multiplier=config.ts_multiplier,
+                                default_adaptive=adaptive, default_integrator=config.integrator,
+                                default_max_lag=config.max_lag, default_waveform=waveform,
+                                default_early_return=config.early_return)
         except FileNotFoundError as e:
             logger.fatal(f"Cannot read file: {e}")
             close_logger(logger)
@@ -103,7 +162,8 @@ def fmucontainer():
             sys.exit(-2)
 
         try:
-            assembly.make_fmu(dump_json=config.dump, fmi_version=int(config.fmi_version), datalog=config.datalog)
+            assembly.make_fmu(dump_json=config.dump, fmi_version=int(config.fmi_version), datalog=config.datalog,
+                              trace=config.trace, schedule=config.schedule, snapshot=config.snapshot)
         except FMUContainerError as e:
             logger.fatal(f"{filename}: {e}")
             close_logger(logger)
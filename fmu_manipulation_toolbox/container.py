@@ -1,5 +1,6 @@
 import logging
 import getpass
+import json
 import math
 import os
 import shutil
@@ -253,16 +254,21 @@ class EmbeddedFMU(OperationAbstract):
         step_size (float | None): Preferred step size in seconds, or `None`.
         start_time (float | None): Default experiment start time.
         stop_time (float | None): Default experiment stop time.
-        model_identifier (str | None): Co-simulation model identifier.
+        model_identifier (str | None): Co-simulation (or model exchange) model identifier.
         guid (str | None): GUID (FMI 2.0) or instantiation token (FMI 3.0).
         fmi_version (int | None): FMI version (`2` or `3`).
         platforms (set[str]): Supported operating systems (e.g. `{"Windows", "Linux"}`).
         ports (dict[str, EmbeddedFMUPort]): Ports of the FMU, keyed by name.
         has_event_mode (bool): Whether the FMU supports event mode (FMI 3.0).
+        has_scheduled_execution (bool): Whether the FMU implements Scheduled Execution (FMI 3.0).
+        model_exchange (bool): Whether the FMU is embedded in Model Exchange. Only if it does not
+            implement Co-Simulation: its continuous states are advanced by the integrator of the container.
+        nb_states (int): Number of continuous states (Model Exchange).
+        nb_event_indicators (int): Number of event indicators (Model Exchange).
         capabilities (dict[str, str]): FMI capability flags and their values.
 
     Raises:
-        FMUContainerError: If the FMU does not implement Co-Simulation mode.
+        FMUContainerError: If the FMU implements neither Co-Simulation nor Model Exchange mode.
     """
 
     capability_list = ("needsExecutionTool",
@@ -288,28 +294,74 @@ class EmbeddedFMU(OperationAbstract):
         self.ports: Dict[str, EmbeddedFMUPort] = {}
 
         self.has_event_mode = False
+        self.has_scheduled_execution = False
+        self.model_exchange = False
+        self.nb_states = 0
+        self.nb_event_indicators = 0
         self.capabilities: Dict[str, str] = {}
         self.current_port = None  # used during apply_operation()
+        self.structure_vr: Dict[str, List[int]] = defaultdict(list)  # used during apply_operation()
 
         self.fmu.apply_operation(self)  # Should be the last command in constructor!
         if self.model_identifier is None:
-            raise FMUContainerError(f"FMU '{self.name}' does not implement Co-Simulation mode.")
+            raise FMUContainerError(f"FMU '{self.name}' implements neither Co-Simulation nor Model Exchange mode.")
+        if self.model_exchange:
+            logger.info(f"FMU '{self.name}' is embedded in Model Exchange ({self.nb_states} states, "
+                        f"{self.nb_event_indicators} event indicators)")
 
     def fmi_attrs(self, attrs):
         fmi_version = attrs['fmiVersion']
         if fmi_version == "2.0":
             self.guid = attrs['guid']
             self.fmi_version = 2
+            self.nb_event_indicators = int(attrs.get("numberOfEventIndicators", "0"))
         if fmi_version.startswith("3."):
             self.guid = attrs['instantiationToken']
             self.fmi_version = 3
 
+    def model_exchange_attrs(self, attrs: Dict[str, str]):
+        if self.model_identifier is not None:
+            return # Co-Simulation is preferred
+        self.model_identifier = attrs['modelIdentifier']
+        self.model_exchange = True
+        for capability in self.capability_list:
+            self.capabilities[capability] = attrs.get(capability, "false")
+        # Step of the container is integrated by the container itself
+        self.capabilities["canHandleVariableCommunicationStepSize"] = "true"
+        self.capabilities["canGetAndSetFMUState"] = attrs.get("canGetAndSetFMUstate",
+                                                              attrs.get("canGetAndSetFMUState", "false"))
+        self.capabilities["canSerializeFMUState"] = attrs.get("canSerializeFMUstate",
+                                                              attrs.get("canSerializeFMUState", "false"))
+        self.capabilities["maxOutputDerivativeOrder"] = "0"
+        self.capabilities["canInterpolateInputs"] = "false"
+        self.capabilities["mightReturnEarlyFromDoStep"] = "false"
+
     def cosimulation_attrs(self, attrs: Dict[str, str]):
         self.model_identifier = attrs['modelIdentifier']
+        self.model_exchange = False
         if attrs.get("hasEventMode", "false") == "true":
             self.has_event_mode = True
         for capability in self.capability_list:
             self.capabilities[capability] = attrs.get(capability, "false")
+        # Spelling depends on FMI version
+        self.capabilities["canGetAndSetFMUState"] = attrs.get("canGetAndSetFMUstate",
+                                                              attrs.get("canGetAndSetFMUState", "false"))
+        self.capabilities["canSerializeFMUState"] = attrs.get("canSerializeFMUstate",
+                                                              attrs.get("canSerializeFMUState", "false"))
+        # Input derivatives are FMI-2.0 only
+        self.capabilities["maxOutputDerivativeOrder"] = attrs.get("maxOutputDerivativeOrder", "0")
+        self.capabilities["canInterpolateInputs"] = attrs.get("canInterpolateInputs", "false")
+        # Early return is FMI-3.0 only
+        self.capabilities["mightReturnEarlyFromDoStep"] = attrs.get("mightReturnEarlyFromDoStep", "false")
+
+    def scheduled_execution_attrs(self, attrs: Dict[str, str]):
+        self.has_scheduled_execution = True
+
+    def state_derivative_attrs(self, attrs: Dict[str, str]):
+        self.structure_vr["states"].append(int(attrs.get("valueReference", -1)))
+
+    def event_indicator_attrs(self, attrs: Dict[str, str]):
+        self.structure_vr["event_indicators"].append(int(attrs["valueReference"]))
 
     def experiment_attrs(self, attrs: Dict[str, str]):
         try:
@@ -345,6 +397,14 @@ class EmbeddedFMU(OperationAbstract):
         except FileNotFoundError:
             pass  # no binaries
 
+        if self.model_exchange:
+            # FMI-3.0 arrays of states or event indicators count for their size
+            port_per_vr = {port.vr: port for port in self.ports.values()}
+            def size(vr: int) -> int:
+                return port_per_vr[vr].size() if vr in port_per_vr else 1
+            self.nb_states = sum(size(vr) for vr in self.structure_vr["states"])
+            self.nb_event_indicators += sum(size(vr) for vr in self.structure_vr["event_indicators"])
+
     def __repr__(self):
         properties = f"{len(self.ports)} variables, ts={self.step_size}s"
         if len(self.terminals) > 0:
@@ -472,6 +532,8 @@ class Link:
         vr (int | None): Value reference for the local variable holding the link value.
         vr_converted (dict[str, int | None]): Value references for type-converted
             copies, keyed by target type name.
+        extrapolation (int): Order (0, 1 or 2) of the polynomial used to extrapolate
+            the link in parallel modes. `0` holds the last value.
     """
 
     CONVERSION_FUNCTION = {
@@ -518,6 +580,7 @@ class Link:
         self.size = cport_from.port.size()
         self.vr: Optional[int] = None
         self.vr_converted: Dict[str, Optional[int]] = {}
+        self.extrapolation = 0
 
         if not cport_from.port.causality == "output":
             if cport_from.port.type_name == "clock":
@@ -570,6 +633,25 @@ class Link:
         except KeyError:
             return None
 
+    def derivative_targets(self) -> List[ContainerPort]:
+        """Return the destination ports which receive the derivative of this link.
+
+        The derivative (order 1) of a scalar Float64 output is forwarded if the source
+        FMU provides output derivatives and the destination FMU can interpolate its
+        inputs (FMI-2.0 only). Extrapolated links are not concerned.
+
+        Returns:
+            list[ContainerPort]: Destination ports, possibly empty.
+        """
+        if (self.cport_from is None or self.extrapolation or self.size > 1 or
+                not self.cport_from.port.type_name == "real64" or self.cport_from.port.clock is not None or
+                int(self.cport_from.fmu.capabilities["maxOutputDerivativeOrder"]) < 1):
+            return []
+
+        return [cport_to for cport_to in self.cport_to_list
+                if cport_to.port.type_name == "real64" and cport_to.port.clock is None and
+                cport_to.fmu.fmi_version == 2 and cport_to.fmu.capabilities["canInterpolateInputs"] == "true"]
+
     def nb_local(self) -> int:
         """Return the number of local variables needed for this link.
 
@@ -916,6 +998,126 @@ class Port:
         self.vr: int = vr
         self.name = name
 
+
+class ContainerSchedule:
+    """Build-time schedule of a container, computed from the profile of a previous run.
+
+    The profile is a JSON file written by the container runtime when profiling is enabled. It gives,
+    for each embedded FMU, the mean cost of its phases (ns) and the ratio of steps where its outputs
+    have changed (activity).
+
+    Attributes:
+        nb_cpu (int): Number of CPUs of the host which ran the profiled container.
+        cost (dict[str, float]): Mean cost (ns) of set inputs and doStep, keyed by FMU filename.
+        activity (dict[str, float]): Ratio of steps where outputs have changed, keyed by FMU filename.
+
+    Raises:
+        FMUContainerError: If the profile cannot be read.
+    """
+
+    # Same heuristic as container_schedule_update() in container/container.c
+    LPT_TOLERANCE = 0.05            # makespan increase accepted to save a thread
+    THREAD_SYNC_COST = 5000.0       # ns, estimated cost to wake up and wait for a thread
+
+    def __init__(self, filename: Union[str, Path]):
+        try:
+            with open(filename, "rt") as file:
+                data = json.load(file)
+            self.nb_cpu = max(int(data.get("nb_cpu", 1)), 1)
+            self.cost: Dict[str, float] = {}
+            self.activity: Dict[str, float] = {}
+            for fmu in data["fmu"]:
+                self.cost[fmu["name"]] = float(fmu.get("set_inputs", 0.0)) + float(fmu.get("do_step", 0.0))
+                self.activity[fmu["name"]] = float(fmu.get("activity", 1.0))
+        except (OSError, ValueError, KeyError, TypeError) as e:
+            raise FMUContainerError(f"Cannot read profile '{filename}': {e}")
+        logger.info(f"Schedule based on profile '{filename}' ({len(self.cost)} FMUs, {self.nb_cpu} CPUs)")
+
+    def order(self, fmu_names: List[str], activity_links: Dict[Tuple[str, str], float]) -> List[str]:
+        """Order FMUs for sequential mode.
+
+        An FMU gets the values of the current step from the FMUs stepped before it, and the values
+        of the previous step (stale) from the others. The activity of links going backward is
+        minimized with the Eades-Lin-Smyth heuristic (weighted feedback arc set).
+
+        Args:
+            fmu_names (list[str]): FMU filenames in declaration order (used to break ties).
+            activity_links (dict[tuple[str, str], float]): Activity of links from an FMU to another.
+
+        Returns:
+            list[str]: FMU filenames in stepping order.
+        """
+        remaining = list(fmu_names)
+        head: List[str] = []
+        tail: List[str] = []
+
+        def weight(fmu_from: str, fmu_to: str) -> float:
+            return activity_links.get((fmu_from, fmu_to), 0.0) if fmu_from != fmu_to else 0.0
+
+        def weight_in(name: str) -> float:
+            return sum(weight(other, name) for other in remaining)
+
+        def weight_out(name: str) -> float:
+            return sum(weight(name, other) for other in remaining)
+
+        while remaining:
+            sinks = [name for name in remaining if weight_out(name) == 0.0]
+            if sinks:
+                for name in reversed(sinks):
+                    remaining.remove(name)
+                    tail.insert(0, name)
+                continue
+            sources = [name for name in remaining if weight_in(name) == 0.0]
+            if sources:
+                for name in sources:
+                    remaining.remove(name)
+                    head.append(name)
+                continue
+            name = max(remaining, key=lambda candidate: weight_out(candidate) - weight_in(candidate))
+            remaining.remove(name)
+            head.append(name)
+
+        return head + tail
+
+    def fmu_cost(self, fmu_name: str) -> float:
+        return self.cost.get(fmu_name, 0.0)
+
+    def lpt(self, fmu_names: List[str], nb_bins: int) -> Tuple[Dict[str, int], float]:
+        load = [0.0] * nb_bins
+        bins: Dict[str, int] = {}
+        for name in sorted(fmu_names, key=lambda fmu_name: -self.fmu_cost(fmu_name)):
+            lightest = load.index(min(load))
+            bins[name] = lightest
+            load[lightest] += self.fmu_cost(name)
+        return bins, max(load)
+
+    def workers(self, fmu_names: List[str]) -> Tuple[Dict[str, int], float]:
+        """Group FMUs onto threads for multi-threaded mode (LPT heuristic).
+
+        The main thread is the worker `0`. The fewest threads giving a makespan close to the best one
+        are used.
+
+        Args:
+            fmu_names (list[str]): FMU filenames.
+
+        Returns:
+            tuple[dict[str, int], float]: Worker of each FMU, and estimated makespan (ns).
+        """
+        max_bins = min(len(fmu_names), self.nb_cpu)
+        _, best = self.lpt(fmu_names, max_bins)
+        for nb_bins in range(1, max_bins + 1):
+            bins, makespan = self.lpt(fmu_names, nb_bins)
+            if makespan <= best * (1.0 + self.LPT_TOLERANCE):
+                return bins, makespan
+        return self.lpt(fmu_names, max_bins)
+
+    def use_mt(self, fmu_names: List[str]) -> bool:
+        """Return `True` if threads save more than they cost."""
+        bins, makespan = self.workers(fmu_names)
+        nb_threads = len(set(bins.values()) - {0})
+        total = sum(self.fmu_cost(name) for name in fmu_names)
+        return nb_threads > 0 and makespan + nb_threads * self.THREAD_SYNC_COST < total
+
 class FMUContainer:
     """Builds an FMU Container that embeds multiple FMUs into a single FMU.
 
@@ -956,6 +1158,10 @@ class FMUContainer:
         FMUContainerError: If the FMU directory is invalid.
     """
 
+    # Profiling statistics exposed for each embedded FMU (see container/profile.h)
+    PROFILING_FMU_PHASES = ("set_inputs", "doStep", "get_outputs", "convert", "event")
+    PROFILING_STATS = ("min", "mean", "p99", "max")
+
     HEADER_XML_2 = """<?xml version="1.0" encoding="ISO-8859-1"?>
 <fmiModelDescription
   fmiVersion="2.0"
@@ -974,8 +1180,8 @@ class FMUContainer:
     canHandleVariableCommunicationStepSize="true"
     canBeInstantiatedOnlyOncePerProcess="{only_once}"
     canNotUseMemoryManagementFunctions="true"
-    canGetAndSetFMUstate="false"
-    canSerializeFMUstate="false"
+    canGetAndSetFMUstate="{get_set_state}"
+    canSerializeFMUstate="{serialize_state}"
     providesDirectionalDerivative="false"
     needsExecutionTool="{execution_tool}">
   </CoSimulation>
@@ -1011,8 +1217,8 @@ class FMUContainer:
     canHandleVariableCommunicationStepSize="true"
     canBeInstantiatedOnlyOncePerProcess="{only_once}"
     canNotUseMemoryManagementFunctions="true"
-    canGetAndSetFMUState="false"
-    canSerializeFMUState="false"
+    canGetAndSetFMUState="{get_set_state}"
+    canSerializeFMUState="{serialize_state}"
     providesDirectionalDerivatives="false"
     providesAdjointDerivatives="false"
     providesPerElementDependencies="false"
@@ -1020,7 +1226,7 @@ class FMUContainer:
     hasEventMode="false"
     needsExecutionTool="{execution_tool}">
   </CoSimulation>
-
+{scheduled_execution}
   <LogCategories>
     <Category name="Info"
               description="Info log messages." />
@@ -1034,6 +1240,20 @@ class FMUContainer:
     <Float64 valueReference="0" name="time" causality="independent"/>
 """
 
+    SCHEDULED_EXECUTION_XML_3 = """
+  <ScheduledExecution
+    modelIdentifier="{identifier}"
+    canBeInstantiatedOnlyOncePerProcess="{only_once}"
+    canNotUseMemoryManagementFunctions="true"
+    canGetAndSetFMUState="false"
+    canSerializeFMUState="false"
+    providesDirectionalDerivatives="false"
+    providesAdjointDerivatives="false"
+    providesPerElementDependencies="false"
+    needsExecutionTool="{execution_tool}">
+  </ScheduledExecution>
+"""
+
     def __init__(self, identifier: str, fmu_directory: Union[str, Path], description_pathname=None, fmi_version=2):
         self.fmu_directory = Path(fmu_directory)
         self.identifier = identifier
@@ -1204,7 +1424,8 @@ class FMUContainer:
         logger.debug(f"DROP: {from_fmu_filename}:{from_port_name}")
         self.mark_ruled(cport_from, 'DROP')
 
-    def add_link(self, from_fmu_filename: str, from_port_name: str, to_fmu_filename: str, to_port_name: str):
+    def add_link(self, from_fmu_filename: str, from_port_name: str, to_fmu_filename: str, to_port_name: str,
+                 extrapolation: int = 0):
         """Connect an output of one embedded FMU to an input of another.
 
         If both port names match FMI Terminal definitions, a terminal-level
@@ -1216,6 +1437,8 @@ class FMUContainer:
             from_port_name (str): Output port name (or terminal name).
             to_fmu_filename (str): Filename of the destination FMU.
             to_port_name (str): Input port name (or terminal name).
+            extrapolation (int): Order of extrapolation of the link in parallel
+                modes (Float64 links only). `0` holds the last value.
 
         Raises:
             FMUContainerError: If port causalities are invalid or types
@@ -1231,14 +1454,16 @@ class FMUContainer:
             if terminal1 == terminal2:
                 logger.debug(f"Plugging terminals: {terminal1} <-> {terminal2}")
                 for terminal1_port_name, terminal2_port_name in terminal1.connect(terminal2):
-                    self.add_link_regular(fmu_from, terminal1_port_name, fmu_to, terminal2_port_name)
+                    self.add_link_regular(fmu_from, terminal1_port_name, fmu_to, terminal2_port_name,
+                                          extrapolation=extrapolation)
             else:
                 logger.error(f"Cannot plug incompatible terminals: {terminal1} <-> {terminal2}")
         else:
             # REGULAR port connection
-            self.add_link_regular(fmu_from, from_port_name, fmu_to, to_port_name)
+            self.add_link_regular(fmu_from, from_port_name, fmu_to, to_port_name, extrapolation=extrapolation)
 
-    def add_link_regular(self, fmu_from: EmbeddedFMU, from_port_name: str, fmu_to: EmbeddedFMU, to_port_name: str):
+    def add_link_regular(self, fmu_from: EmbeddedFMU, from_port_name: str, fmu_to: EmbeddedFMU, to_port_name: str,
+                         extrapolation: int = 0):
 
             try:
                 cport_from = ContainerPort(fmu_from, from_port_name)
@@ -1261,6 +1486,14 @@ class FMUContainer:
 
             local.add_target(cport_to)  # Causality is check in the add() function
 
+            if extrapolation:
+                if extrapolation not in (1, 2):
+                    logger.error(f"Extrapolation order of {cport_from} should be 0, 1 or 2.")
+                elif local.cport_from is None or not local.cport_from.port.type_name == "real64":
+                    logger.warning(f"Link {cport_from} is not Float64: it will not be extrapolated.")
+                else:
+                    local.extrapolation = max(local.extrapolation, extrapolation)
+
             logger.debug(f"LINK: {cport_from} -> {cport_to}")
             self.mark_ruled(cport_from, 'LINK')
             self.mark_ruled(cport_to, 'LINK')
@@ -1456,7 +1689,11 @@ class FMUContainer:
                         logger.warning(f"Output '{cport}' is not connected")
 
     def make_fmu(self, fmu_filename: Union[str, Path], step_size: Optional[float] = None, debug=False, mt=False,
-                 profiling=False, sequential=False, ts_multiplier=False, datalog=False):
+                 profiling=False, sequential=False, ts_multiplier=False, datalog=False, trace=False,
+                 schedule: Optional[Union[str, Path]] = None, snapshot: Optional[Union[str, Path]] = None,
+                 adaptive: Optional[Tuple[float, float, float]] = None, integrator: Optional[str] = None,
+                 max_lag: Optional[int] = None, waveform: Optional[Tuple[float, int, float]] = None,
+                 early_return=False):
         """Build the FMU Container archive.
 
         Generates the `modelDescription.xml`, the `container.txt` runtime
@@ -1467,11 +1704,35 @@ class FMUContainer:
             step_size (float | None): Internal time step in seconds. If `None`,
                 deduced from the embedded FMUs.
             debug (bool): Keep intermediate build artifacts.
-            mt (bool): Enable multithreaded mode.
+            mt (bool | str): Enable multithreaded mode. `"auto"` lets the container select mono or
+                multithreaded mode at runtime.
             profiling (bool): Enable profiling mode.
             sequential (bool): Use sequential scheduling.
             ts_multiplier (bool): Add a `TS_MULTIPLIER` input port.
             datalog (bool): Generate a datalog configuration.
+            trace (bool): Generate a trace configuration (Chrome trace-event JSON).
+            schedule (str | Path | None): Profile written by a previous run of the container (profiling
+                enabled). In sequential mode, FMUs are reordered to minimize the use of stale values.
+                Otherwise, the profile decides whether multithreaded mode is enabled (unless `mt` is
+                `"auto"`) and gives the grouping of FMUs onto threads.
+            snapshot (str | Path | None): Serialized state of a previous instance of the same container. The
+                container restarts from this state at the end of its initialization (warm-start).
+            adaptive (tuple | None): `(min_step, max_step, tolerance)`. The internal step varies between
+                `min_step` and `max_step` (rounded to multiples of `step_size`) according to the error of
+                the coupling, estimated on the Float64 outputs of the embedded FMUs.
+            integrator (str | None): `"METHOD[:PARAM]"` integrating the continuous states of the FMUs embedded
+                in Model Exchange: `euler` or `rk4` with PARAM substeps per internal step, or `rk45` with
+                PARAM relative tolerance. Default is `rk4` with 1 substep.
+            max_lag (int | None): Enable the asynchronous mode (multithreaded mode only). Between two
+                communication points, FMUs use outputs of their neighbours which are `max_lag` internal steps
+                old at most, instead of waiting for all FMUs at each internal step.
+            waveform (tuple | None): `(window, max_iterations, tolerance)`. Enable the waveform relaxation
+                (parallel modes only): each FMU simulates a window of `window` seconds (rounded to multiples of
+                `step_size`) with the inputs of the previous iteration. The window is simulated again until
+                the outputs converge within `tolerance`. All embedded FMUs should support get/set FMU state.
+            early_return (bool): Allow the embedded FMUs which declare `mightReturnEarlyFromDoStep` to return
+                early from their step. The state of all embedded FMUs is saved before each internal step:
+                all embedded FMUs should support get/set FMU state.
         """
         if isinstance(fmu_filename, str):
             fmu_filename = Path(fmu_filename)
@@ -1483,23 +1744,163 @@ class FMUContainer:
 
         logger.info(f"Building FMU '{fmu_filename}', step_size={step_size}")
 
+        if adaptive is not None:
+            adaptive = self.adaptive_multipliers(step_size, *adaptive)
+            if ts_multiplier:
+                logger.warning("TS_MULTIPLIER input is ignored when internal step is adaptive.")
+        integrator = self.integrator_parameters(integrator)
+
+        workers = None
+        if schedule:
+            mt, workers = self.make_schedule(ContainerSchedule(schedule), mt, sequential)
+        max_lag = self.async_max_lag(max_lag, mt, sequential, adaptive, integrator)
+        waveform = self.waveform_parameters(step_size, waveform, sequential, adaptive, integrator, max_lag)
+
         base_directory = self.fmu_directory / fmu_filename.with_suffix('')
         resources_directory = self.make_fmu_skeleton(base_directory)
 
         with open(base_directory / "modelDescription.xml", "wt") as xml_file:
-            self.make_fmu_xml(xml_file, step_size, profiling, ts_multiplier)
+            self.make_fmu_xml(xml_file, step_size, profiling, ts_multiplier, mt)
         with open(resources_directory / "container.txt", "wt") as txt_file:
-            self.make_fmu_txt(txt_file, step_size, mt, profiling, sequential)
+            self.make_fmu_txt(txt_file, step_size, mt, profiling, sequential, workers=workers,
+                              snapshot=snapshot is not None, adaptive=adaptive, integrator=integrator,
+                              max_lag=max_lag, waveform=waveform, early_return=early_return)
 
         if datalog:
             with open(resources_directory / "datalog.txt", "wt") as datalog_file:
                 self.make_datalog(datalog_file)
 
+        if trace:
+            with open(resources_directory / "trace.txt", "wt") as trace_file:
+                self.make_trace(trace_file)
+
+        if profiling:
+            with open(resources_directory / "profile.txt", "wt") as profile_file:
+                self.make_profile(profile_file)
+
+        if snapshot is not None:
+            logger.info(f"Container will restart from snapshot '{snapshot}'")
+            shutil.copyfile(snapshot, resources_directory / "snapshot.bin")
+
         self.make_fmu_package(base_directory, fmu_filename)
         if not debug:
             self.make_fmu_cleanup(base_directory)
 
-    def make_fmu_xml(self, xml_file, step_size: float, profiling: bool, ts_multiplier: bool):
+    @staticmethod
+    def adaptive_multipliers(step_size: float, min_step: float, max_step: float, tolerance: float):
+        if tolerance <= 0 or max_step < min_step:
+            raise FMUContainerError(f"Adaptive step [{min_step}, {max_step}] with tolerance={tolerance} is not valid.")
+        min_multiplier = max(1, round(min_step / step_size))
+        max_multiplier = max(min_multiplier, round(max_step / step_size))
+        logger.info(f"Internal step will vary between {min_multiplier * step_size} and "
+                    f"{max_multiplier * step_size} (tolerance={tolerance})")
+        return min_multiplier, max_multiplier, tolerance
+
+    def integrator_parameters(self, integrator: Optional[str]) -> Optional[Tuple[str, int, float]]:
+        model_exchange = [fmu.name for fmu in self.involved_fmu.values() if fmu.model_exchange]
+        if not model_exchange:
+            if integrator:
+                logger.warning(f"Integrator '{integrator}' is ignored: no FMU is embedded in Model Exchange.")
+            return None
+
+        tokens = (integrator or "rk4").split(":")
+        method = tokens[0].lower()
+        nb_substeps = 1
+        tolerance = 1e-6
+        try:
+            if method in ("euler", "rk4") and len(tokens) <= 2:
+                if len(tokens) == 2:
+                    nb_substeps = int(tokens[1])
+            elif method == "rk45" and len(tokens) <= 2:
+                if len(tokens) == 2:
+                    tolerance = float(tokens[1])
+            else:
+                raise ValueError
+        except ValueError:
+            raise FMUContainerError(f"Integrator '{integrator}' should be euler[:SUBSTEPS], rk4[:SUBSTEPS] "
+                                    f"or rk45[:TOLERANCE].")
+        if nb_substeps < 1 or tolerance <= 0:
+            raise FMUContainerError(f"Integrator '{integrator}' is not valid.")
+
+        logger.info(f"{', '.join(model_exchange)} integrated with {method} "
+                    f"({nb_substeps} substeps, tolerance={tolerance})")
+        return method, nb_substeps, tolerance
+
+    @staticmethod
+    def async_max_lag(max_lag: Optional[int], mt, sequential: bool, adaptive, integrator) -> Optional[int]:
+        if max_lag is None:
+            return None
+        if max_lag < 0:
+            raise FMUContainerError(f"Maximum lag of asynchronous mode should be positive or null (got {max_lag}).")
+        if not mt or sequential:
+            logger.warning("Asynchronous mode is ignored: it needs multithreaded mode.")
+            return None
+        if adaptive or integrator:
+            logger.warning("Asynchronous mode is ignored: it is not compatible with adaptive step or Model Exchange.")
+            return None
+
+        logger.info(f"FMUs will step asynchronously (maximum lag of {max_lag} internal steps)")
+        return max_lag
+
+    def waveform_parameters(self, step_size: float, waveform: Optional[Tuple[float, int, float]], sequential: bool,
+                            adaptive, integrator, max_lag) -> Optional[Tuple[int, int, float]]:
+        if waveform is None:
+            return None
+        window, max_iterations, tolerance = waveform
+        if window <= 0 or max_iterations < 1 or tolerance <= 0:
+            raise FMUContainerError(f"Waveform relaxation over {window}s ({max_iterations} iterations) "
+                                    f"with tolerance={tolerance} is not valid.")
+        if sequential:
+            logger.warning("Waveform relaxation is ignored: it needs parallel mode.")
+            return None
+        if adaptive or integrator or max_lag is not None:
+            logger.warning("Waveform relaxation is ignored: it is not compatible with adaptive step, Model Exchange "
+                           "or asynchronous mode.")
+            return None
+        if not all(fmu.capabilities["canGetAndSetFMUState"] == "true" for fmu in self.involved_fmu.values()):
+            logger.warning("Waveform relaxation is ignored: all embedded FMUs should support get/set FMU state.")
+            return None
+        if any(fmu.capabilities["mightReturnEarlyFromDoStep"] == "true" for fmu in self.involved_fmu.values()):
+            logger.warning("Waveform relaxation is ignored: it is not compatible with early return.")
+            return None
+
+        nb_steps = max(1, round(window / step_size))
+        logger.info(f"FMUs will iterate over windows of {nb_steps * step_size}s "
+                    f"({max_iterations} iterations max, tolerance={tolerance})")
+        return nb_steps, int(max_iterations), tolerance
+
+    def make_schedule(self, schedule: ContainerSchedule, mt, sequential: bool):
+        fmu_names = list(self.involved_fmu)
+        for fmu_name in fmu_names:
+            if fmu_name not in schedule.cost:
+                logger.warning(f"FMU '{fmu_name}' is not part of the profile.")
+
+        if sequential:
+            activity_links: Dict[Tuple[str, str], float] = defaultdict(float)
+            for link in self.links.values():
+                if link.cport_from:
+                    for cport_to in link.cport_to_list:
+                        activity_links[(link.cport_from.fmu.name, cport_to.fmu.name)] += \
+                            schedule.activity.get(link.cport_from.fmu.name, 1.0)
+            order = schedule.order(fmu_names, activity_links)
+            logger.info(f"Sequential mode: FMUs are stepped in order {', '.join(order)}")
+            self.involved_fmu = OrderedDict((fmu_name, self.involved_fmu[fmu_name]) for fmu_name in order)
+            return mt, None
+
+        if mt != "auto":
+            mt = schedule.use_mt(fmu_names)
+            logger.info(f"Multi-threaded mode is {'enabled' if mt else 'disabled'} according to profile")
+        if not mt:
+            return mt, None
+
+        workers, makespan = schedule.workers(fmu_names)
+        for fmu_name in fmu_names:
+            worker = f"thread #{workers[fmu_name]}" if workers[fmu_name] else "main thread"
+            logger.info(f"FMU '{fmu_name}' is stepped by {worker}")
+        logger.info(f"Estimated step time: {makespan / 1.0e3:.3f}us")
+        return mt, workers
+
+    def make_fmu_xml(self, xml_file, step_size: float, profiling: bool, ts_multiplier: bool, mt=False):
         timestamp = datetime.now().strftime('%Y-%m-%dT%H:%M:%SZ')
         guid = str(uuid.uuid4())
         embedded_fmu = ", ".join([fmu_name for fmu_name in self.involved_fmu])
@@ -1514,6 +1915,16 @@ class FMUContainer:
             for fmu in self.involved_fmu.values():
                 if fmu.capabilities[capability] == "true":
                     capabilities[capability] = "true"
+        # Container state aggregates the state of each embedded FMU
+        if all(fmu.capabilities["canGetAndSetFMUState"] == "true" for fmu in self.involved_fmu.values()):
+            capabilities["canGetAndSetFMUState"] = "true"
+        else:
+            capabilities["canGetAndSetFMUState"] = "false"
+        if capabilities["canGetAndSetFMUState"] == "true" and \
+                all(fmu.capabilities["canSerializeFMUState"] == "true" for fmu in self.involved_fmu.values()):
+            capabilities["canSerializeFMUState"] = "true"
+        else:
+            capabilities["canSerializeFMUState"] = "false"
 
         first_fmu = next(iter(self.involved_fmu.values()))
         if self.start_time is None:
@@ -1540,20 +1951,35 @@ class FMUContainer:
                                                     author=author,
                                                     only_once=capabilities['canBeInstantiatedOnlyOncePerProcess'],
                                                     execution_tool=capabilities['needsExecutionTool'],
+                                                    get_set_state=capabilities['canGetAndSetFMUState'],
+                                                    serialize_state=capabilities['canSerializeFMUState'],
                                                     default_experiment_times=default_experiment_times,
                                                     step_size=step_size))
         elif self.fmi_version == 3:
+            # Partitions of the container are activated only if all embedded FMUs have partitions
+            scheduled_execution = ""
+            if all(fmu.fmi_version == 3 and fmu.has_scheduled_execution for fmu in self.involved_fmu.values()):
+                logger.info("Container implements Scheduled Execution")
+                scheduled_execution = self.SCHEDULED_EXECUTION_XML_3.format(
+                    identifier=self.identifier,
+                    only_once=capabilities['canBeInstantiatedOnlyOncePerProcess'],
+                    execution_tool=capabilities['needsExecutionTool'])
             xml_file.write(self.HEADER_XML_3.format(identifier=self.identifier, tool_version=tool_version,
                                                     timestamp=timestamp, guid=guid, embedded_fmu=embedded_fmu,
                                                     author=author,
                                                     only_once=capabilities['canBeInstantiatedOnlyOncePerProcess'],
                                                     execution_tool=capabilities['needsExecutionTool'],
+                                                    get_set_state=capabilities['canGetAndSetFMUState'],
+                                                    serialize_state=capabilities['canSerializeFMUState'],
                                                     default_experiment_times=default_experiment_times,
+                                                    scheduled_execution=scheduled_execution,
                                                     step_size=step_size))
 
         vr_time = self.vr_table.add_vr("real64", local=True)
         logger.debug(f"Time vr = {vr_time}")
 
+        index_offset = 2    # index of output ports. Start at 2 to skip "time" port
+
         vr_ts_multiplier = self.vr_table.add_vr("integer32", local=True)
         if ts_multiplier:
             logger.debug(f"TS Multiplier vr = {vr_ts_multiplier}")
@@ -1565,6 +1991,18 @@ class FMUContainer:
                                                  "start": 1,
                                                  "initial": "exact"})
             print(f"    {port.xml(vr_ts_multiplier, fmi_version=self.fmi_version)}", file=xml_file)
+            index_offset += 1
+
+        if mt == "auto":
+            vr_strategy = self.vr_table.add_vr("integer32", local=True)
+            logger.debug(f"Strategy vr = {vr_strategy}")
+            port = EmbeddedFMUPort("integer32", {"valueReference": vr_strategy,
+                                                 "name": f"container.strategy",
+                                                 "description": f"Stepping strategy selected at runtime "
+                                                                f"(1: mono-thread, 2: multi-thread)",
+                                                 "variability": "discrete"})
+            print(f"    {port.xml(vr_strategy, fmi_version=self.fmi_version)}", file=xml_file)
+            index_offset += 1
 
         if profiling:
             for fmu in self.involved_fmu.values():
@@ -1573,8 +2011,19 @@ class FMUContainer:
                                         "name": f"container.{fmu.id}.rt_ratio",
                                         "description": f"RT ratio for embedded FMU '{fmu.name}'"})
                 print(f"    {port.xml(vr, fmi_version=self.fmi_version)}", file=xml_file)
+                index_offset += 1
 
-        index_offset = 2    # index of output ports. Start at 2 to skip "time" port
+            profiling_statistics = [(fmu.id, phase, f"embedded FMU '{fmu.name}'") for fmu in self.involved_fmu.values()
+                                    for phase in self.PROFILING_FMU_PHASES]
+            profiling_statistics.append(("datalog", "datalog", "container"))
+            for name, phase, owner in profiling_statistics:
+                for stat in self.PROFILING_STATS:
+                    vr = self.vr_table.add_vr("real64", local=True)
+                    port = EmbeddedFMUPort("real64", {"valueReference": vr,
+                                            "name": f"container.{name}.{phase}.{stat}" if name != phase else f"container.{phase}.{stat}",
+                                            "description": f"{stat} duration (s) of '{phase}' for {owner}"})
+                    print(f"    {port.xml(vr, fmi_version=self.fmi_version)}", file=xml_file)
+                    index_offset += 1
 
         # Local variable should be first to ensure to attribute them the lowest VR.
         nb_clocks = 0
@@ -1657,10 +2106,17 @@ class FMUContainer:
                        "\n"
                        "</fmiModelDescription>")
 
-    def make_fmu_txt(self, txt_file, step_size: float, mt: bool, profiling: bool, sequential: bool):
+    def make_fmu_txt(self, txt_file, step_size: float, mt: bool, profiling: bool, sequential: bool,
+                     workers: Optional[Dict[str, int]] = None, snapshot=False,
+                     adaptive: Optional[Tuple[int, int, float]] = None,
+                     integrator: Optional[Tuple[str, int, float]] = None,
+                     max_lag: Optional[int] = None,
+                     waveform: Optional[Tuple[int, int, float]] = None, early_return=False):
         print("# Version 4", file=txt_file)
         print("# Container flags <MT> <Profiling> <Sequential>", file=txt_file)
         flags = [ str(int(flag == True)) for flag in (mt, profiling, sequential)]
+        if mt == "auto":
+            flags[0] = "2"
         print(" ".join(flags), file=txt_file)
 
         print(f"# Internal time step in seconds", file=txt_file)
@@ -1669,7 +2125,10 @@ class FMUContainer:
         print(f"{len(self.involved_fmu)}", file=txt_file)
         fmu_rank: Dict[str, int] = {}
         for i, fmu in enumerate(self.involved_fmu.values()):
-            print(f"{fmu.name} {fmu.fmi_version} {int(fmu.has_event_mode)}", file=txt_file)
+            worker = f" {workers[fmu.name]}" if workers else ""
+            if fmu.model_exchange:
+                worker = f"{worker or ' -1'} 1"
+            print(f"{fmu.name} {fmu.fmi_version} {int(fmu.has_event_mode)}{worker}", file=txt_file)
             print(f"{fmu.model_identifier}", file=txt_file)
             print(f"{fmu.guid}", file=txt_file)
             fmu_rank[fmu.name] = i
@@ -1743,10 +2202,14 @@ class FMUContainer:
             if type_name == "real64":
                 print(f"0 1 1 -1 0", file=txt_file)  # Time slot
                 if profiling:
-                    for profiling_port, _ in enumerate(self.involved_fmu.values()):
+                    nb_profiling = (len(self.involved_fmu) * (1 + len(self.PROFILING_FMU_PHASES) * len(self.PROFILING_STATS))
+                                    + len(self.PROFILING_STATS))
+                    for profiling_port in range(nb_profiling):
                         print(f"{profiling_port + 1} 1 1 -2 {profiling_port + 1}", file=txt_file)
             elif type_name == "integer32":
                 print(f"0 1 1 -1 0", file=txt_file)  # TS Multiplier
+                if mt == "auto":
+                    print(f"1 1 1 -1 1", file=txt_file)  # Strategy
 
             for input_port in inputs_per_type[type_name]:
                 cport_string = [f"{fmu_rank[cport.fmu.name]} {cport.port.vr}" for cport in input_port.cport_list]
@@ -1781,6 +2244,72 @@ class FMUContainer:
         # CLOCKS
         clock_list.write_txt(txt_file)
 
+        # EXTRAPOLATION (optional)
+        extrapolated_links = [link for link in self.links.values() if link.extrapolation > 0]
+        if extrapolated_links:
+            print("# Extrapolation of Float64 links: EXTRAPOLATION <NB>, then <VR> <ORDER>", file=txt_file)
+            print(f"EXTRAPOLATION {len(extrapolated_links)}", file=txt_file)
+            for link in extrapolated_links:
+                print(f"{link.vr} {link.extrapolation}", file=txt_file)
+
+        # ADAPTIVE (optional)
+        if adaptive:
+            print("# Adaptive step: ADAPTIVE <MIN_MULTIPLIER> <MAX_MULTIPLIER> <TOLERANCE>", file=txt_file)
+            print(f"ADAPTIVE {adaptive[0]} {adaptive[1]} {adaptive[2]}", file=txt_file)
+
+        # ASYNC (optional)
+        if max_lag is not None:
+            print("# Asynchronous mode: ASYNC <MAX_LAG>", file=txt_file)
+            print(f"ASYNC {max_lag}", file=txt_file)
+
+        # WAVEFORM (optional)
+        if waveform:
+            print("# Waveform relaxation: WAVEFORM <WINDOW> <MAX_ITERATIONS> <TOLERANCE>", file=txt_file)
+            print(f"WAVEFORM {waveform[0]} {waveform[1]} {waveform[2]}", file=txt_file)
+
+        # DERIVATIVES (optional)
+        derivatives = [(link.cport_from, link.derivative_targets()) for link in self.links.values()]
+        derivatives = [(cport_from, cport_to_list) for cport_from, cport_to_list in derivatives if cport_to_list]
+        if derivatives:
+            nb_inputs = sum(len(cport_to_list) for _, cport_to_list in derivatives)
+            print("# Derivatives of Float64 links: DERIVATIVES <NB> <NB_INPUTS>, then "
+                  "<FMU_INDEX> <FMU_VR> <NB> <FMU_INDEX> <FMU_VR> [<FMU_INDEX> <FMU_VR>]", file=txt_file)
+            print(f"DERIVATIVES {len(derivatives)} {nb_inputs}", file=txt_file)
+            for cport_from, cport_to_list in derivatives:
+                logger.debug(f"Derivative of {cport_from} is forwarded to {len(cport_to_list)} input(s)")
+                cport_string = [f"{fmu_rank[cport_to.fmu.name]} {cport_to.port.vr}" for cport_to in cport_to_list]
+                print(f"{fmu_rank[cport_from.fmu.name]} {cport_from.port.vr} {len(cport_to_list)}",
+                      " ".join(cport_string), file=txt_file)
+
+        # MODEL_EXCHANGE (optional)
+        if integrator:
+            model_exchange = [fmu for fmu in self.involved_fmu.values() if fmu.model_exchange]
+            print("# Model Exchange: MODEL_EXCHANGE <NB_FMU> <METHOD> <SUBSTEPS> <TOLERANCE>, then "
+                  "<FMU_INDEX> <NB_STATES> <NB_EVENT_INDICATORS>", file=txt_file)
+            print(f"MODEL_EXCHANGE {len(model_exchange)} {integrator[0]} {integrator[1]} {integrator[2]}",
+                  file=txt_file)
+            for fmu in model_exchange:
+                print(f"{fmu_rank[fmu.name]} {fmu.nb_states} {fmu.nb_event_indicators}", file=txt_file)
+
+        # EARLY_RETURN (optional)
+        if early_return:
+            early_return = [fmu.name for fmu in self.involved_fmu.values()
+                            if fmu.capabilities["mightReturnEarlyFromDoStep"] == "true"]
+            if not early_return:
+                logger.warning("Early return is ignored: no embedded FMU might return early from its step")
+            elif all(fmu.capabilities["canGetAndSetFMUState"] == "true" for fmu in self.involved_fmu.values()):
+                logger.info(f"Early return is allowed for {', '.join(early_return)}")
+                print("# Early return of embedded FMUs: step of all FMUs is truncated", file=txt_file)
+                print("EARLY_RETURN", file=txt_file)
+            else:
+                logger.warning(f"Early return of {', '.join(early_return)} is not allowed: "
+                               f"all embedded FMUs should support get/set FMU state")
+
+        # SNAPSHOT (optional)
+        if snapshot:
+            print("# Snapshot loaded at the end of initialization", file=txt_file)
+            print("SNAPSHOT snapshot.bin", file=txt_file)
+
     def make_datalog(self, datalog_file):
         print(f"# Datalog filename", file=datalog_file)
         print(f"{self.identifier}-datalog.csv", file=datalog_file)
@@ -1803,6 +2332,16 @@ class FMUContainer:
             for port in ports[type_name]:
                 print(f"{port.vr} {port.name}", file=datalog_file)
 
+    def make_trace(self, trace_file):
+        print(f"# Trace filename", file=trace_file)
+        print(f"{self.identifier}-trace.json", file=trace_file)
+        print(f"# Number of events per thread", file=trace_file)
+        print(f"65536", file=trace_file)
+
+    def make_profile(self, profile_file):
+        print(f"# Profile filename", file=profile_file)
+        print(f"{self.identifier}-profile.json", file=profile_file)
+
     @staticmethod
     def long_path(path: Union[str, Path]) -> str:
         # https://stackoverflow.com/questions/14075465/copy-a-file-with-a-too-long-path-to-another-directory-in-python
@@ -253,6 +253,9 @@ class Manipulation:
         self.delayed_tag = None
         self.delayed_tag_open = False
 
+        # used to find derivatives of continuous states
+        self.current_structure: Optional[str] = None
+
         self.operation.set_fmu(fmu)
         self.fmu = fmu
 
@@ -312,15 +315,29 @@ class Manipulation:
                 self.current_port.push_attrs({"start": attrs.get("value", "")})
             elif self.fmu.fmi_version == 3 and name == "Dimension":
                 self.current_port.dimensions = attrs
+            elif name == 'ModelExchange':
+                self.operation.model_exchange_attrs(attrs)
             elif name == 'CoSimulation':
                 self.operation.cosimulation_attrs(attrs)
+            elif name == 'ScheduledExecution': # FMI-3.0 only
+                self.operation.scheduled_execution_attrs(attrs)
             elif name == 'DefaultExperiment':
                 self.operation.experiment_attrs(attrs)
             elif name == 'fmiModelDescription':
                 self.fmu.fmi_version = int(float(attrs["fmiVersion"]))
                 self.operation.fmi_attrs(attrs)
+            elif name in self.TAGS_MODEL_STRUCTURE: # FMI-2.0 only
+                self.current_structure = name
             elif name == 'Unknown': # FMI-2.0 only
+                if self.current_structure == "Derivatives":
+                    self.operation.state_derivative_attrs(attrs)
                 self.unknown_attrs(attrs)
+            elif name == "ContinuousStateDerivative" or name == "EventIndicator": #  FMI-3.0 only
+                if name == "ContinuousStateDerivative":
+                    self.operation.state_derivative_attrs(attrs)
+                else:
+                    self.operation.event_indicator_attrs(attrs)
+                self.handle_structure(attrs)
             elif name == 'Output' or name == "ContinuousStateDerivative" or "InitialUnknown": #  FMI-3.0 only
                 self.handle_structure(attrs)
 
@@ -512,6 +529,22 @@ class OperationAbstract:
         """
         pass
 
+    def model_exchange_attrs(self, attrs):
+        """Called when the `<ModelExchange>` element is encountered.
+
+        Args:
+            attrs (dict[str, str]): XML attributes of the model exchange element.
+        """
+        pass
+
+    def scheduled_execution_attrs(self, attrs):
+        """Called when the `<ScheduledExecution>` element is encountered (FMI 3.0).
+
+        Args:
+            attrs (dict[str, str]): XML attributes of the scheduled execution element.
+        """
+        pass
+
     def experiment_attrs(self, attrs):
         """Called when the `<DefaultExperiment>` element is encountered.
 
@@ -520,6 +553,23 @@ class OperationAbstract:
         """
         pass
 
+    def state_derivative_attrs(self, attrs):
+        """Called for each derivative of a continuous state in `<ModelStructure>`.
+
+        Args:
+            attrs (dict[str, str]): XML attributes of the `<Unknown>` (FMI 2.0) or
+                `<ContinuousStateDerivative>` (FMI 3.0) element.
+        """
+        pass
+
+    def event_indicator_attrs(self, attrs):
+        """Called for each `<EventIndicator>` element in `<ModelStructure>` (FMI 3.0).
+
+        Args:
+            attrs (dict[str, str]): XML attributes of the event indicator element.
+        """
+        pass
+
     def port_attrs(self, fmu_port: FMUPort) -> int:
         """Called for each port (variable) in the descriptor.
 
@@ -1,8 +1,13 @@
 import hashlib
+import json
 import numpy as np
 import pytest
+import math
+import re
+import subprocess
 import sys
 import os
+import zipfile
 
 from pathlib import Path
 from fmpy.simulation import simulate_fmu
@@ -19,6 +24,18 @@ from fmu_manipulation_toolbox.cli.fmucontainer import fmucontainer
 from fmu_manipulation_toolbox.cli.fmutool import fmutool
 from fmu_manipulation_toolbox.cli.datalog2pcap import datalog2pcap
 
+# Container runtime tools (headless driver and synthetic FMU library) are built by CMake into tests/bin
+RUNTIME_PLATFORM = {"win32": "win64", "darwin": "darwin64"}.get(sys.platform, "linux64")
+RUNTIME_SUFFIX = {"win64": "dll", "darwin64": "dylib", "linux64": "so"}[RUNTIME_PLATFORM]
+RUNTIME_DIRECTORY = Path(__file__).parent / "bin" / RUNTIME_PLATFORM
+CONTAINER_DRIVER = RUNTIME_DIRECTORY / ("container_driver.exe" if os.name == 'nt' else "container_driver")
+SYNTHETIC_LIBRARY = RUNTIME_DIRECTORY / f"synthetic.{RUNTIME_SUFFIX}"
+CONTAINER_LIBRARY = (Path(__file__).parent.parent / "fmu_manipulation_toolbox" / "resources" / RUNTIME_PLATFORM /
+                     f"container.{RUNTIME_SUFFIX}")
+HAS_RUNTIME = CONTAINER_DRIVER.exists() and SYNTHETIC_LIBRARY.exists() and CONTAINER_LIBRARY.exists()
+sys.path.insert(0, str(Path(__file__).parent.parent / "container" / "benchmark"))
+from synthetic import SyntheticAssembly
+
 # GUI imports (guarded – tests are skipped if display is unavailable)
 try:
     # Ensure the offscreen plugin is active before any Qt import
@@ -39,11 +56,13 @@ except Exception:
 
 
 class TestSuite:
-    def assert_simulation(self, filename: Union[Path, str], step_size: Optional[float] = None):
+    def assert_simulation(self, filename: Union[Path, str], step_size: Optional[float] = None,
+                          ref_filename: Optional[Union[Path, str]] = None):
         if isinstance(filename, str):
             filename = Path(filename)
         result_filename = filename.with_name("results-" + filename.with_suffix(".csv").name)
-        ref_filename = result_filename.with_stem("REF-" + result_filename.stem)
+        if ref_filename is None:
+            ref_filename = result_filename.with_stem("REF-" + result_filename.stem)
 
         result = simulate_fmu(filename, step_size=step_size, stop_time=10,
                               output_interval=step_size, validate=True)
@@ -188,6 +207,27 @@ class TestSuite:
         if os.name == 'nt':
             self.assert_simulation("containers/bouncing_ball/bouncing-seq.fmu")
 
+    def test_container_bouncing_ball_auto_mt(self):
+        assembly = Assembly("bouncing-auto-mt.csv", fmu_directory=Path("containers/bouncing_ball"), default_mt="auto",
+                            debug=True)
+        assembly.make_fmu()
+        self.assert_identical_files("containers/bouncing_ball/REF-container-auto-mt.txt",
+                                    "containers/bouncing_ball/bouncing-auto-mt/resources/container.txt")
+        if os.name == 'nt':
+            # AUTO mode only selects the stepping strategy: results are those of MT mode
+            self.assert_simulation("containers/bouncing_ball/bouncing-auto-mt.fmu",
+                                   ref_filename="containers/bouncing_ball/REF-results-bouncing.csv")
+
+    def test_container_bouncing_ball_schedule(self):
+        assembly = Assembly("bouncing-schedule.csv", fmu_directory=Path("containers/bouncing_ball"), debug=True)
+        assembly.make_fmu(schedule="containers/bouncing_ball/bouncing-schedule-profile.json")
+        self.assert_identical_files("containers/bouncing_ball/REF-container-schedule.txt",
+                                    "containers/bouncing_ball/bouncing-schedule/resources/container.txt")
+        if os.name == 'nt':
+            # Schedule only changes the grouping of FMUs onto threads: results are those of MT mode
+            self.assert_simulation("containers/bouncing_ball/bouncing-schedule.fmu",
+                                   ref_filename="containers/bouncing_ball/REF-results-bouncing.csv")
+
     def test_container_bouncing_ball_profiling(self):
         assembly = Assembly("bouncing-profiling.csv", fmu_directory=Path("containers/bouncing_ball"), default_profiling=True,
                             debug=True)
@@ -271,6 +311,16 @@ class TestSuite:
         assembly.make_fmu()
         self.assert_simulation("containers/VanDerPol/VanDerPol-Container.fmu", 0.1)
 
+    def test_container_vanderpol_auto_mt(self):
+        assembly = Assembly("VanDerPol-auto-mt.json", fmu_directory=Path("containers/VanDerPol"))
+        assembly.make_fmu()
+        self.assert_simulation("containers/VanDerPol/VanDerPol-auto-mt.fmu", 0.1)
+
+    def test_container_vanderpol_schedule(self):
+        assembly = Assembly("VanDerPol.json", fmu_directory=Path("containers/VanDerPol"))
+        assembly.make_fmu(filename="VanDerPol-schedule.fmu",
+                          schedule="containers/VanDerPol/VanDerPol-schedule-profile.json")
+        self.assert_simulation("containers/VanDerPol/VanDerPol-schedule.fmu", 0.1)
 
     def test_container_vanderpol_vr(self):
         assembly = Assembly("VanDerPol-vr.json", fmu_directory=Path("containers/VanDerPol"))
@@ -399,6 +449,277 @@ class TestSuite:
             self.assert_simulation("array/array.fmu", 0.1)
 
 
+@pytest.mark.skipif(not HAS_RUNTIME, reason="container_driver and synthetic library are not built")
+class TestRuntime:
+    """Behaviour of the container runtime.
+
+    Containers of synthetic FMUs are run by container_driver and their datalog is compared with the
+    one of the same container in its synchronous mode.
+    """
+
+    @staticmethod
+    def make_container(name: str, topology="chain", nb_fmu=4, fmi_version=3, mt=True, sequential=False,
+                       extrapolation=0, json_options=None, synthetic=None, library=SYNTHETIC_LIBRARY,
+                       **make_options) -> Path:
+        directory = Path("runtime") / name
+        if synthetic is None:
+            synthetic = SyntheticAssembly(topology, nb_fmu, fmi_version=fmi_version)
+        json_filename = synthetic.make(directory, library, mt=mt, sequential=sequential)
+        if json_options or extrapolation:
+            with open(json_filename, "rt") as file:
+                data = json.load(file)
+            data.update(json_options or {})
+            if extrapolation:
+                data["link"] = [link + [extrapolation] for link in data["link"]]
+            with open(json_filename, "wt") as file:
+                json.dump(data, file, indent=2)
+        assembly = Assembly(json_filename.name, fmu_directory=directory)
+        assembly.make_fmu(fmi_version=3, datalog=True, **make_options)
+
+        return directory / make_options.get("filename", f"{synthetic.name}.fmu")
+
+    @staticmethod
+    def run_driver(fmu: Path, *options, nb_steps=50, step_size=0.01) -> subprocess.CompletedProcess:
+        if not os.access(CONTAINER_DRIVER, os.X_OK):    # executable flag is not kept by CI artifacts
+            CONTAINER_DRIVER.chmod(0o755)
+        return subprocess.run([str(CONTAINER_DRIVER), "-l", str(CONTAINER_LIBRARY.resolve()), "-n", str(nb_steps),
+                               "-h", str(step_size), *options, fmu.name], cwd=fmu.parent, check=True,
+                              capture_output=True, text=True)
+
+    def run_container(self, fmu: Path, *options, nb_steps=50, step_size=0.01) -> str:
+        with zipfile.ZipFile(fmu) as zip_file:
+            datalog_filename = fmu.parent / zip_file.read("resources/datalog.txt").decode("utf-8").splitlines()[1]
+        datalog_filename.unlink(missing_ok=True)
+        self.run_driver(fmu, *options, nb_steps=nb_steps, step_size=step_size)
+        if datalog_filename.exists():
+            with open(datalog_filename, "rt") as file:
+                return file.read()
+        return ""
+
+    @staticmethod
+    def datalog_values(datalog: str, column: str) -> List[Tuple[float, float]]:
+        lines = datalog.splitlines()
+        index = lines[0].split(",").index(column)
+        return [(float(line.split(",")[0]), float(line.split(",")[index])) for line in lines[1:]]
+
+    @staticmethod
+    def ensemble_members(filename: Path) -> Dict[str, str]:
+        members = {}
+        with open(filename, "rt") as file:
+            header = file.readline().split(",", 1)[1]
+            for line in file:
+                member, row = line.split(",", 1)
+                members[member] = members.get(member, header) + row
+        return members
+
+    def test_checkpoint_rollback(self):
+        fmu = self.make_container("checkpoint")
+        self.run_container(fmu, "-s", "reference.bin")
+        self.run_container(fmu, "-r", "-s", "rollback.bin")
+        with open(fmu.parent / "reference.bin", "rb") as a, open(fmu.parent / "rollback.bin", "rb") as b:
+            assert a.read() == b.read()
+
+    def test_snapshot_warm_start(self):
+        fmu = self.make_container("snapshot")
+        reference = self.run_container(fmu, nb_steps=100).splitlines()
+        self.run_container(fmu, "-s", "snapshot.bin", nb_steps=50)
+
+        warm_fmu = self.make_container("snapshot", filename="warm.fmu", snapshot=fmu.parent / "snapshot.bin")
+        datalog = self.run_container(warm_fmu, "-b", "0.5", nb_steps=50).splitlines()
+        assert datalog[1].startswith("5.000000e-01,")
+        first = reference.index(datalog[1])
+        assert datalog[0] == reference[0]
+        assert datalog[1:] == reference[first:]
+
+    def test_link_extrapolation(self):
+        # fmu000 output is the time. In parallel mode, fmu001 reads it from the previous internal step (1 ms)
+        # or, if extrapolated, predicted at the middle of the current step.
+        for order, delay in ((0, 1e-3), (1, 0.5e-3), (2, 0.5e-3)):
+            fmu = self.make_container(f"extrapolation-{order}", extrapolation=order)
+            for time, value in self.datalog_values(self.run_container(fmu), "fmu001.out_float64_0"):
+                if time >= 3e-3:
+                    assert value == pytest.approx(2 * time - delay, abs=1e-6), f"order={order}, time={time}"
+
+        sequential = self.make_container("extrapolation-sequential", mt=False, sequential=True)
+        extrapolated = self.make_container("extrapolation-sequential-1", mt=False, sequential=True, extrapolation=1)
+        assert self.run_container(extrapolated) == self.run_container(sequential)
+
+    def test_input_derivatives(self):
+        # FMI-2 synthetic FMUs expose output derivatives: in parallel mode they compensate the 1 ms delay,
+        # in sequential mode they are not forwarded since inputs are already up to date.
+        for name, mt, sequential in (("parallel", True, False), ("sequential", False, True)):
+            fmu = self.make_container(f"derivatives-{name}", fmi_version=2, mt=mt, sequential=sequential)
+            for time, value in self.datalog_values(self.run_container(fmu), "fmu001.out_float64_0"):
+                if time >= 2e-3:
+                    assert value == pytest.approx(2 * time, abs=1e-6), f"{name}, time={time}"
+
+    def test_adaptive_ts_multiplier(self):
+        # TS_MULTIPLIER is ignored by adaptive step, even if it exceeds the communication step.
+        fmu = self.make_container("adaptive-ts-multiplier",
+                                  json_options={"adaptive": [0.001, 0.008, 1e-4], "ts_multiplier": True})
+        with open(fmu.parent / "parameters.csv", "wt") as file:
+            print("container.ts_multiplier\n1\n4", file=file)
+        self.run_container(fmu, "-p", "parameters.csv", "-o", "ensemble.csv", step_size=0.002)
+        members = self.ensemble_members(fmu.parent / "ensemble.csv")
+        assert members["0"] == members["1"]
+        assert self.datalog_values(members["1"], "fmu001.out_float64_0")[-1][0] == pytest.approx(0.1)
+
+    def test_ls_bus_clocks(self):
+        # Countdown clocks of the bus FMU are scheduled by the container
+        with open(Path("ls-bus") / "REF-bus+nodes-datalog.csv", "rt") as file:
+            reference = file.read()
+        for mt in (False, True):
+            assembly = Assembly("bus+nodes.json", fmu_directory=Path("ls-bus"), default_mt=mt)
+            assembly.make_fmu(filename="bus+nodes-runtime.fmu", fmi_version=3, datalog=True)
+            assert self.run_container(Path("ls-bus") / "bus+nodes-runtime.fmu", nb_steps=100, step_size=0.1) == \
+                   reference, f"mt={mt}"
+
+    def test_ls_bus_clock_propagation(self):
+        # Without bus, output clocks and clocked frames of each node are given to the other node
+        with open(Path("ls-bus") / "REF-nodes-only-datalog.csv", "rt") as file:
+            reference = file.read()
+        for mt in (False, True):
+            assembly = Assembly("nodes-only.json", fmu_directory=Path("ls-bus"), default_mt=mt)
+            assembly.make_fmu(filename="nodes-only-runtime.fmu", fmi_version=3, datalog=True)
+            fmu = Path("ls-bus") / "nodes-only-runtime.fmu"
+            assert self.run_container(fmu, nb_steps=100, step_size=0.1) == reference, f"mt={mt}"
+            log = self.run_driver(fmu, "-v", nb_steps=100, step_size=0.1).stderr
+            for node in ("node1", "node2"):
+                assert log.count(f"{node}.fmu: Received CAN frame") == 33, f"mt={mt}, {node}"
+
+    def test_event_iterations(self):
+        # Frames sent by the nodes are forwarded by the bus in a next event iteration, at the same time. Payload
+        # of the frames sent by a node is its number of steps plus the number of frames it received.
+        datalogs = [self.run_container(self.make_container(f"event-iterations-{mt}", topology="bus", mt=mt),
+                                       nb_steps=5) for mt in (False, True)]
+        assert datalogs[0] == datalogs[1]
+
+        lines = datalogs[0].splitlines()
+        rows = [dict(zip(lines[0].split(","), line.split(","))) for line in lines[1:]]
+        nb_received = [0, 0, 0]
+        for i, row in enumerate(rows):
+            if row["time"] == rows[-1]["time"]:     # forwarded frames are logged by the next step
+                break
+            for k in range(3):
+                node = f"node{k + 1:03d}"
+                if row[f"{node}.out_clock_0"] == "1":
+                    nb_steps = round(float(row["time"]) / 1e-3)
+                    assert row[f"{node}.out_binary_0"] == f"{(nb_steps + nb_received[k]) & 0xFF:02X}" * 64
+                    forwarded = [next_row for next_row in rows[i + 1:] if next_row["time"] == row["time"] and
+                                 next_row[f"bus.out_clock_{k}"] == "1"]
+                    assert len(forwarded) == 1, f"{node}, time={row['time']}"
+                    assert forwarded[0][f"bus.out_binary_{k}"] == row[f"{node}.out_binary_0"]
+                    nb_received[k] += 1
+        assert nb_received == [4, 4, 4]
+
+    def test_scheduled_execution(self):
+        # Each step activates the partition of the input clock of fmu000. Its frame carries its number of steps plus
+        # the number of activations it received: 2n-1 at activation #n. The frame is forwarded within the same
+        # activation by the partitions of fmu001 and fmu002, which are activated by their input clocks.
+        synthetic = SyntheticAssembly("chain", 3, types=("Binary", "Clock"))
+        synthetic.fmus[0].period = 1
+        for fmu in synthetic.fmus[1:]:
+            fmu.forward = True
+        fmu = self.make_container("scheduled-execution", synthetic=synthetic, mt=False,
+                                  json_options={"auto_input": True, "auto_output": True})
+        with zipfile.ZipFile(fmu) as zip_file:
+            xml = zip_file.read("modelDescription.xml").decode("utf-8")
+        assert "<ScheduledExecution" in xml
+        vr = re.search(r'<Clock name="in_clock_0" valueReference="(\d+)"', xml).group(1)
+
+        datalog = self.run_container(fmu, "-x", vr, nb_steps=5)
+        lines = datalog.splitlines()
+        rows = [dict(zip(lines[0].split(","), line.split(","))) for line in lines[2:]]
+        assert [row["time"] for row in rows] == [f"{n * 0.01:e}" for n in range(1, 6)]
+        for n, row in enumerate(rows, start=1):
+            payload = f"{(2 * n - 1) & 0xFF:02X}"
+            assert (row["fmu000.out_binary_0"], row["fmu001.out_binary_0"], row["out_binary_0"]) == (payload,) * 3
+
+        # Shared values are exchanged under preemption locks. Unbalanced locks make the driver fail
+        stdout = self.run_driver(fmu, "-x", vr, nb_steps=5).stdout
+        assert int(re.search(r"Preemption +: (\d+) locks", stdout).group(1)) > 0
+
+    def make_model_exchange(self, name: str, integrator: str, step_size=1e-3) -> Path:
+        # fmu001 is embedded in Model Exchange: its only output starts at 1 and follows der(x) = -x. Datalog
+        # has 6 decimal places.
+        synthetic = SyntheticAssembly("chain", 2, step_size=step_size)
+        synthetic.links = []
+        synthetic.fmus[0].set_ports("Float64", 0, 0)
+        synthetic.fmus[1].set_ports("Float64", 0, 1)
+        synthetic.fmus[1].model_exchange = True
+        return self.make_container(name, synthetic=synthetic, mt=False,
+                                   json_options={"auto_output": True, "integrator": integrator})
+
+    def test_model_exchange(self):
+        fmu = self.make_model_exchange("model-exchange-euler", "euler:1")
+        values = self.datalog_values(self.run_container(fmu), "out_float64_0")
+        assert values[-1][0] == pytest.approx(0.5)
+        for time, value in values:
+            assert value == pytest.approx((1 - 1e-3) ** round(time / 1e-3), abs=1e-6), f"time={time}"
+
+        # RK45 substeps are shorter than the step of the container
+        fmu = self.make_model_exchange("model-exchange-rk45", "rk45:1e-8", step_size=0.1)
+        for time, value in self.datalog_values(self.run_container(fmu, nb_steps=20, step_size=0.1), "out_float64_0"):
+            assert value == pytest.approx(math.exp(-time), abs=1e-6), f"time={time}"
+
+        # Step size of RK45 is part of the state of the container
+        self.run_container(fmu, "-s", "reference.bin", nb_steps=20, step_size=0.1)
+        self.run_container(fmu, "-r", "-s", "rollback.bin", nb_steps=20, step_size=0.1)
+        with open(fmu.parent / "reference.bin", "rb") as a, open(fmu.parent / "rollback.bin", "rb") as b:
+            assert a.read() == b.read()
+
+    def test_asynchronous_mode(self):
+        # Datalog is written at the communication points only. Without lag, values are those of the synchronous mode
+        reference = self.run_container(self.make_container("async-reference")).splitlines()
+        datalog = self.run_container(self.make_container("async-0", json_options={"max_lag": 0})).splitlines()
+        for row in datalog[1:]:
+            assert row in reference
+        assert len(reference) > len(datalog)
+
+        datalog = self.run_container(self.make_container("async-2", json_options={"max_lag": 2}))
+        times = sorted(set(time for time, _ in self.datalog_values(datalog, "fmu002.out_float64_0")))
+        assert times == pytest.approx([n * 0.01 for n in range(51)])
+
+    def test_waveform_relaxation(self):
+        # Datalog is written at the ends of the windows. Once converged, values are those of the parallel mode
+        reference = self.run_container(self.make_container("waveform-reference")).splitlines()
+        fmu = self.make_container("waveform", json_options={"waveform": [0.005, 10, 1e-9]})
+        datalog = self.run_container(fmu)
+        for row in datalog.splitlines()[1:]:
+            assert row in reference
+        times = sorted(set(time for time, _ in self.datalog_values(datalog, "fmu002.out_float64_0")))
+        assert times == pytest.approx([n * 0.005 for n in range(101)])
+
+        # FMUs which cannot get and set their state are rejected by the container. Their capability is not checked:
+        # the library does not export fmi3GetFMUState.
+        if SYNTHETIC_LIBRARY.suffix in (".so", ".dll"):
+            library = Path("runtime") / f"stateless{SYNTHETIC_LIBRARY.suffix}"
+            library.parent.mkdir(exist_ok=True)
+            library.write_bytes(SYNTHETIC_LIBRARY.read_bytes().replace(b"fmi3GetFMUState\0", b"fmi3GetFMUStatX\0"))
+            fmu = self.make_container("waveform-stateless", library=library,
+                                      json_options={"waveform": [0.005, 10, 1e-9]})
+            with pytest.raises(subprocess.CalledProcessError) as error:
+                self.run_driver(fmu, "-v")
+            assert "Waveform relaxation needs get/set state of FMU" in error.value.stderr
+
+    def test_ensemble(self):
+        fmu = self.make_container("ensemble", json_options={"auto_input": True})
+        reference = self.run_container(fmu)
+
+        self.run_container(fmu, "-e", "3", "-t", "2", "-o", "ensemble.csv")
+        members = self.ensemble_members(fmu.parent / "ensemble.csv")
+        assert sorted(members) == ["0", "1", "2"]
+        for datalog in members.values():
+            assert datalog == reference
+
+        with open(fmu.parent / "parameters.csv", "wt") as file:
+            print("in_float64_0\n0.0\n1.0", file=file)
+        self.run_container(fmu, "-p", "parameters.csv", "-o", "ensemble.csv")
+        members = self.ensemble_members(fmu.parent / "ensemble.csv")
+        assert members["0"] == reference
+        assert members["1"] != reference
+
+
 @pytest.mark.skipif(not HAS_GUI, reason="GUI dependencies not available")
 class TestGUI:
     """Tests for the 3 GUI interfaces (FMU Tool, FMU Editor, FMU Container Builder).